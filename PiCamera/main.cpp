@@ -1,5 +1,6 @@
 #include "pi_camera.hpp"
 
+#include <AL/OS/Timer.hpp>
 #include <AL/OS/Console.hpp>
 
 #include <AL/Collections/LinkedList.hpp>
@@ -55,6 +56,26 @@ enum PI_CAMERA_CONSOLE_COMMANDS : AL::uint8
 	PI_CAMERA_CONSOLE_COMMAND_SET_VIDEO_FRAME_RATE, // uint8     void      set           vfr|video_frame_rate           value
 	PI_CAMERA_CONSOLE_COMMAND_CAPTURE,              // string    void      capture       "/path/to/destination/file"
 	PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO,        // string    void      capture_video duration                      "/path/to/destination/file"
+	PI_CAMERA_CONSOLE_COMMAND_BENCHMARK,            // uint32    *         benchmark     count
+	PI_CAMERA_CONSOLE_COMMAND_GET_TRANSFER_STATS,   // void      *         get           stats
+	PI_CAMERA_CONSOLE_COMMAND_CAPTURE_STREAM,       // string    void      capture_stream "/path/to/destination/file"
+	PI_CAMERA_CONSOLE_COMMAND_PREVIEW,              // uint32    *         preview       count
+	PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO_STREAM, // uint32    *         capture_video_stream duration
+	PI_CAMERA_CONSOLE_COMMAND_START_RECORDING,      // uint16[2] void      start_recording segment_length budget_mb
+	PI_CAMERA_CONSOLE_COMMAND_STOP_RECORDING,       // void      void      stop_recording
+	PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENTS, // void    *         get           segments
+	PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENT, // uint64   void      get           segment                        id    "/path/to/destination/file"
+	PI_CAMERA_CONSOLE_COMMAND_START_PRE_ROLL,       // uint16[2] void      start_pre_roll seconds buffer_mb
+	PI_CAMERA_CONSOLE_COMMAND_STOP_PRE_ROLL,        // void      void      stop_pre_roll
+	PI_CAMERA_CONSOLE_COMMAND_CAPTURE_PRE_ROLL,     // string    void      capture_pre_roll duration                   "/path/to/destination/file"
+	PI_CAMERA_CONSOLE_COMMAND_CAPTURE_BURST,        // string    void      capture_burst count interval_ms             "/path/to/destination/directory"
+	PI_CAMERA_CONSOLE_COMMAND_START_TIMELAPSE,      // uint16[2] void      start_timelapse interval_seconds count
+	PI_CAMERA_CONSOLE_COMMAND_STOP_TIMELAPSE,       // void      void      stop_timelapse
+	PI_CAMERA_CONSOLE_COMMAND_GET_CAPTURES,         // void      *         get           captures
+	PI_CAMERA_CONSOLE_COMMAND_FETCH_CAPTURES,       // string    void      fetch_captures "/path/to/destination/directory"
+	PI_CAMERA_CONSOLE_COMMAND_DELETE_CAPTURES,      // void      *         delete_captures
+	PI_CAMERA_CONSOLE_COMMAND_RESUME_TRANSFER,      // uint64    void      resume_transfer id                          "/path/to/destination/file"
+	PI_CAMERA_CONSOLE_COMMAND_GET_CAPABILITIES,     // void      *         get           capabilities
 
 	PI_CAMERA_CONSOLE_COMMAND_COUNT
 };
@@ -65,6 +86,7 @@ struct pi_camera_args
 	AL::String host;
 	AL::uint16 port;
 	AL::size_t max_connections;
+	AL::size_t worker_count;
 };
 
 struct pi_camera_console_command
@@ -143,6 +165,27 @@ const char* pi_camera_console_command_to_string(AL::uint8 value)
 		case PI_CAMERA_CONSOLE_COMMAND_GET_IMAGE_ROTATION: return "get_image_rotation";
 		case PI_CAMERA_CONSOLE_COMMAND_SET_IMAGE_ROTATION: return "set_image_rotation";
 		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE:            return "capture";
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO:      return "capture_video";
+		case PI_CAMERA_CONSOLE_COMMAND_BENCHMARK:          return "benchmark";
+		case PI_CAMERA_CONSOLE_COMMAND_GET_TRANSFER_STATS: return "get_transfer_stats";
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_STREAM:     return "capture_stream";
+		case PI_CAMERA_CONSOLE_COMMAND_PREVIEW:            return "preview";
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO_STREAM: return "capture_video_stream";
+		case PI_CAMERA_CONSOLE_COMMAND_START_RECORDING:    return "start_recording";
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_RECORDING:     return "stop_recording";
+		case PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENTS: return "get_recording_segments";
+		case PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENT:  return "get_recording_segment";
+		case PI_CAMERA_CONSOLE_COMMAND_START_PRE_ROLL:     return "start_pre_roll";
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_PRE_ROLL:      return "stop_pre_roll";
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_PRE_ROLL:   return "capture_pre_roll";
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_BURST:      return "capture_burst";
+		case PI_CAMERA_CONSOLE_COMMAND_START_TIMELAPSE:    return "start_timelapse";
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_TIMELAPSE:     return "stop_timelapse";
+		case PI_CAMERA_CONSOLE_COMMAND_GET_CAPTURES:           return "get_captures";
+		case PI_CAMERA_CONSOLE_COMMAND_FETCH_CAPTURES:         return "fetch_captures";
+		case PI_CAMERA_CONSOLE_COMMAND_DELETE_CAPTURES:        return "delete_captures";
+		case PI_CAMERA_CONSOLE_COMMAND_RESUME_TRANSFER:        return "resume_transfer";
+		case PI_CAMERA_CONSOLE_COMMAND_GET_CAPABILITIES:       return "get_capabilities";
 	}
 
 	return "undefined";
@@ -204,6 +247,31 @@ bool        pi_camera_console_command_from_string(AL::uint8& value, const AL::St
 			value = PI_CAMERA_CONSOLE_COMMAND_GET_CONFIG;
 			return true;
 		}
+		else if (arg1.Compare("stats", AL::True))
+		{
+			value = PI_CAMERA_CONSOLE_COMMAND_GET_TRANSFER_STATS;
+			return true;
+		}
+		else if (arg1.Compare("segments", AL::True))
+		{
+			value = PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENTS;
+			return true;
+		}
+		else if (arg1.Compare("segment", AL::True))
+		{
+			value = PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENT;
+			return true;
+		}
+		else if (arg1.Compare("captures", AL::True))
+		{
+			value = PI_CAMERA_CONSOLE_COMMAND_GET_CAPTURES;
+			return true;
+		}
+		else if (arg1.Compare("capabilities", AL::True))
+		{
+			value = PI_CAMERA_CONSOLE_COMMAND_GET_CAPABILITIES;
+			return true;
+		}
 		else if (arg1.Compare('c', AL::True) || arg1.Compare("contrast", AL::True))
 		{
 			value = PI_CAMERA_CONSOLE_COMMAND_GET_CONTRAST;
@@ -373,6 +441,81 @@ bool        pi_camera_console_command_from_string(AL::uint8& value, const AL::St
 		value = PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO;
 		return true;
 	}
+	else if (arg0.Compare("capture_stream", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_CAPTURE_STREAM;
+		return true;
+	}
+	else if (arg0.Compare("benchmark", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_BENCHMARK;
+		return true;
+	}
+	else if (arg0.Compare("preview", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_PREVIEW;
+		return true;
+	}
+	else if (arg0.Compare("capture_video_stream", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO_STREAM;
+		return true;
+	}
+	else if (arg0.Compare("start_recording", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_START_RECORDING;
+		return true;
+	}
+	else if (arg0.Compare("stop_recording", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_STOP_RECORDING;
+		return true;
+	}
+	else if (arg0.Compare("start_pre_roll", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_START_PRE_ROLL;
+		return true;
+	}
+	else if (arg0.Compare("stop_pre_roll", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_STOP_PRE_ROLL;
+		return true;
+	}
+	else if (arg0.Compare("capture_pre_roll", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_CAPTURE_PRE_ROLL;
+		return true;
+	}
+	else if (arg0.Compare("capture_burst", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_CAPTURE_BURST;
+		return true;
+	}
+	else if (arg0.Compare("start_timelapse", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_START_TIMELAPSE;
+		return true;
+	}
+	else if (arg0.Compare("stop_timelapse", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_STOP_TIMELAPSE;
+		return true;
+	}
+	else if (arg0.Compare("fetch_captures", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_FETCH_CAPTURES;
+		return true;
+	}
+	else if (arg0.Compare("delete_captures", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_DELETE_CAPTURES;
+		return true;
+	}
+	else if (arg0.Compare("resume_transfer", AL::True))
+	{
+		value = PI_CAMERA_CONSOLE_COMMAND_RESUME_TRANSFER;
+		return true;
+	}
 
 	return false;
 }
@@ -548,6 +691,132 @@ bool        pi_camera_console_command_args_from_string(pi_camera_console_command
 				value.args.string.Append(args[i]);
 		}
 		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_BENCHMARK:
+			if (arg_count < 2) return false;
+			value.args.uint32 = AL::FromString<AL::uint32>(args[1]);
+			return value.args.uint32 != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_GET_TRANSFER_STATS:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_STREAM:
+		{
+			if (arg_count < 2)
+				return false;
+
+			for (AL::size_t i = 1; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_PREVIEW:
+			if (arg_count < 2) return false;
+			value.args.uint32 = AL::FromString<AL::uint32>(args[1]);
+			return value.args.uint32 != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO_STREAM:
+			if (arg_count < 2) return false;
+			value.args.uint32 = AL::FromString<AL::uint32>(args[1]);
+			return value.args.uint32 != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_START_RECORDING:
+			if (arg_count < 3) return false;
+			value.args.uint16_2[0] = AL::FromString<AL::uint16>(args[1]);
+			value.args.uint16_2[1] = AL::FromString<AL::uint16>(args[2]);
+			return (value.args.uint16_2[0] != 0) && (value.args.uint16_2[1] != 0);
+
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_RECORDING:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENTS:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENT:
+		{
+			if (arg_count < 4)
+				return false;
+
+			value.args.uint64 = AL::FromString<AL::uint64>(args[2]);
+
+			for (AL::size_t i = 3; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_START_PRE_ROLL:
+			if (arg_count < 3) return false;
+			value.args.uint16_2[0] = AL::FromString<AL::uint16>(args[1]);
+			value.args.uint16_2[1] = AL::FromString<AL::uint16>(args[2]);
+			return value.args.uint16_2[1] != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_PRE_ROLL:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_PRE_ROLL:
+		{
+			if (arg_count < 3)
+				return false;
+
+			value.args.uint32 = AL::FromString<AL::uint32>(args[1]);
+
+			for (AL::size_t i = 2; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_CAPTURE_BURST:
+		{
+			if (arg_count < 4)
+				return false;
+
+			value.args.uint16_2[0] = AL::FromString<AL::uint16>(args[1]);
+			value.args.uint16_2[1] = AL::FromString<AL::uint16>(args[2]);
+
+			for (AL::size_t i = 3; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return value.args.uint16_2[0] != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_START_TIMELAPSE:
+			if (arg_count < 3) return false;
+			value.args.uint16_2[0] = AL::FromString<AL::uint16>(args[1]);
+			value.args.uint16_2[1] = AL::FromString<AL::uint16>(args[2]);
+			return value.args.uint16_2[0] != 0;
+
+		case PI_CAMERA_CONSOLE_COMMAND_STOP_TIMELAPSE:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_GET_CAPTURES:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_FETCH_CAPTURES:
+		{
+			if (arg_count < 2)
+				return false;
+
+			for (AL::size_t i = 1; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_DELETE_CAPTURES:
+			return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_RESUME_TRANSFER:
+		{
+			if (arg_count < 3)
+				return false;
+
+			value.args.uint64 = AL::FromString<AL::uint64>(args[1]);
+
+			for (AL::size_t i = 2; i < arg_count; ++i)
+				value.args.string.Append(args[i]);
+		}
+		return true;
+
+		case PI_CAMERA_CONSOLE_COMMAND_GET_CAPABILITIES:
+			return true;
 	}
 
 	return false;
@@ -595,11 +864,12 @@ int  main_args_decode(int argc, char* argv[])
 #if defined(PI_CAMERA_DEBUG) || defined(AL_PLATFORM_LINUX)
 			camera_args.verb = PI_CAMERA_VERB_START;
 
-			if (argc == 5)
+			if ((argc == 5) || (argc == 6))
 			{
 				camera_args.host = argv[2];
 				camera_args.port = AL::FromString<AL::uint16>(argv[3]);
 				camera_args.max_connections = AL::FromString<AL::size_t>(argv[4]);
+				camera_args.worker_count = (argc == 6) ? AL::FromString<AL::size_t>(argv[5]) : PI_CAMERA_SERVICE_WORKER_COUNT_DEFAULT;
 				return true;
 			}
 #else
@@ -620,7 +890,7 @@ bool main_args_show_example(const char* argv0)
 	if (!AL::OS::Console::WriteLine("Remote: %s connect host port", argv0)) return false;
 
 #if defined(PI_CAMERA_DEBUG) || defined(AL_PLATFORM_LINUX)
-	if (!AL::OS::Console::WriteLine("Service: %s start host port max_connections", argv0)) return false;
+	if (!AL::OS::Console::WriteLine("Service: %s start host port max_connections [worker_count]", argv0)) return false;
 #endif
 
 	return true;
@@ -698,6 +968,9 @@ bool main_args_interactive_prompt_verb_start()
 	if (!main_args_interactive_prompt("Max Connections", camera_args.max_connections))
 		return false;
 
+	if (!main_args_interactive_prompt("Worker Count", camera_args.worker_count))
+		return false;
+
 	return true;
 }
 bool main_args_interactive_prompt_verb_connect()
@@ -743,7 +1016,7 @@ AL::uint8 main_init_open_camera()
 	switch (camera_args.verb)
 	{
 		case PI_CAMERA_VERB_OPEN:    return pi_camera_open(&camera);
-		case PI_CAMERA_VERB_START:   return pi_camera_open_service(&camera, camera_args.host.GetCString(), camera_args.port, camera_args.max_connections);
+		case PI_CAMERA_VERB_START:   return pi_camera_open_service_ex(&camera, camera_args.host.GetCString(), camera_args.port, camera_args.max_connections, camera_args.worker_count);
 		case PI_CAMERA_VERB_CONNECT: return pi_camera_open_remote(&camera, camera_args.host.GetCString(), camera_args.port);
 	}
 
@@ -836,7 +1109,15 @@ bool main_console_execute_command(const pi_camera_console_command& value)
 			return false;
 
 		if (error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+		{
+			AL::uint64 transfer_id;
+
+			// the service keeps the file for a while so the transfer can be resumed once reconnected
+			if ((pi_camera_get_transfer_id(camera, &transfer_id) == PI_CAMERA_ERROR_CODE_SUCCESS) && (transfer_id != 0))
+				AL::OS::Console::WriteLine("Reconnect and use resume_transfer %llu /path/to/file to receive the rest", transfer_id);
+
 			return false;
+		}
 	}
 
 	for (auto& command_result_line : command_result.lines)
@@ -1228,6 +1509,394 @@ AL::uint8 main_console_command_capture_video(const pi_camera_console_command& co
 
 	return error_code;
 }
+AL::uint8 main_console_command_capture_stream(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_capture_stream(camera, command.args.string.GetCString(), [](AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Received %llu bytes", number_of_bytes_received);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("Image saved to %s", command.args.string.GetCString()));
+
+	return error_code;
+}
+
+struct main_benchmark_result
+{
+	AL::uint64 min   = AL::Integer<AL::uint64>::Maximum;
+	AL::uint64 max   = 0;
+	AL::uint64 total = 0;
+	AL::uint32 count = 0;
+};
+
+void       main_benchmark_result_add(main_benchmark_result& result, AL::uint64 value)
+{
+	if (value < result.min) result.min = value;
+	if (value > result.max) result.max = value;
+
+	result.total += value;
+	++result.count;
+}
+AL::String main_benchmark_result_to_string(const main_benchmark_result& result, const char* name)
+{
+	return AL::String::Format("%s: min %lluus, avg %lluus, max %lluus over %u round trips", name, result.min, result.total / result.count, result.max, result.count);
+}
+
+// Round trips a property dump sized payload through lz4 and checks a truncated block is rejected, nothing is reported if built without compression
+void       main_benchmark_check_compression(pi_camera_console_command_result& command_result)
+{
+	AL::Collections::Array<AL::uint8> buffer;
+	AL::Collections::Array<AL::uint8> compressed_buffer;
+	AL::Collections::Array<AL::uint8> decompressed_buffer;
+	AL::uint32                        size = 0;
+
+	buffer.SetCapacity(65536);
+	compressed_buffer.SetCapacity(65536);
+	decompressed_buffer.SetCapacity(65536);
+
+	for (AL::uint32 i = 0; size < 65536; ++i)
+	{
+		auto line = AL::String::Format("property %u: iso %u ev %i contrast %i\n", i, 100 + (i % 8) * 100, static_cast<int>(i % 21) - 10, static_cast<int>(i % 201) - 100);
+
+		for (AL::size_t j = 0; (j < line.GetLength()) && (size < 65536); ++j, ++size)
+			buffer[size] = static_cast<AL::uint8>(line[j]);
+	}
+
+	AL::OS::Timer timer;
+	AL::uint32    compressed_size;
+	auto          error_code = pi_camera_compress(&buffer[0], size, &compressed_buffer[0], size, &compressed_size);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_NOT_SUPPORTED)
+		return;
+
+	auto compress_time_us = timer.GetElapsed().ToMicroseconds();
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		command_result.lines.PushBack(AL::String::Format("lz4 round trip: failed to compress %u bytes", size));
+
+		return;
+	}
+
+	timer.Reset();
+
+	bool is_equal           = pi_camera_decompress(&compressed_buffer[0], compressed_size, &decompressed_buffer[0], size) == PI_CAMERA_ERROR_CODE_SUCCESS;
+	auto decompress_time_us = timer.GetElapsed().ToMicroseconds();
+
+	for (AL::uint32 i = 0; is_equal && (i < size); ++i)
+		is_equal = decompressed_buffer[i] == buffer[i];
+
+	command_result.lines.PushBack(AL::String::Format("lz4 round trip: %s, %u bytes to %u bytes, compressed in %lluus, decompressed in %lluus", is_equal ? "passed" : "failed", size, compressed_size, compress_time_us, decompress_time_us));
+
+	bool is_rejected = true;
+
+	// every cut short block must be refused rather than read past its end
+	for (AL::uint32 i = 0; is_rejected && (i < compressed_size); ++i)
+		is_rejected = pi_camera_decompress(&compressed_buffer[0], i, &decompressed_buffer[0], size) != PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	command_result.lines.PushBack(AL::String::Format("lz4 truncated input: %s", is_rejected ? "passed" : "failed"));
+}
+
+AL::uint8 main_console_command_benchmark(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	main_benchmark_check_compression(command_result);
+
+	AL::uint16 iso;
+	auto       error_code = pi_camera_get_iso(camera, &iso);
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	AL::int8              ev;
+	AL::OS::Timer         timer;
+	main_benchmark_result get_ev_result;
+	main_benchmark_result set_iso_result;
+
+	for (AL::uint32 i = 0; i < command.args.uint32; ++i)
+	{
+		timer.Reset();
+
+		if ((error_code = pi_camera_get_ev(camera, &ev)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return error_code;
+
+		main_benchmark_result_add(get_ev_result, timer.GetElapsed().ToMicroseconds());
+
+		timer.Reset();
+
+		if ((error_code = pi_camera_set_iso(camera, iso)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return error_code;
+
+		main_benchmark_result_add(set_iso_result, timer.GetElapsed().ToMicroseconds());
+	}
+
+	command_result.lines.PushBack(main_benchmark_result_to_string(get_ev_result, "get ev"));
+	command_result.lines.PushBack(main_benchmark_result_to_string(set_iso_result, "set iso"));
+
+	if ((error_code = pi_camera_begin_pipeline(camera)) == PI_CAMERA_ERROR_CODE_NOT_SUPPORTED)
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	timer.Reset();
+
+	for (AL::uint32 i = 0; i < command.args.uint32; ++i)
+	{
+		if ((error_code = pi_camera_set_iso(camera, iso)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			pi_camera_end_pipeline(camera);
+
+			return error_code;
+		}
+	}
+
+	if ((error_code = pi_camera_end_pipeline(camera)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	command_result.lines.PushBack(AL::String::Format("set iso (pipelined): %lluus over %u requests", timer.GetElapsed().ToMicroseconds(), command.args.uint32));
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+
+AL::uint8 main_console_command_get_transfer_stats(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	pi_camera_transfer_stats value;
+	auto                     error_code = pi_camera_get_transfer_stats(camera, &value);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		command_result.lines.PushBack(AL::String::Format("Transfers: %llu", value.number_of_transfers));
+		command_result.lines.PushBack(AL::String::Format("Bytes Sent: %llu", value.number_of_bytes_sent));
+		command_result.lines.PushBack(AL::String::Format("CPU Time: %lluus", value.cpu_time_us));
+		command_result.lines.PushBack(AL::String::Format("CPU Time Per MB: %lluus", (value.number_of_bytes_sent == 0) ? 0 : ((value.cpu_time_us * 1000000) / value.number_of_bytes_sent)));
+		command_result.lines.PushBack(AL::String::Format("Requests: %llu", value.number_of_requests));
+		command_result.lines.PushBack(AL::String::Format("Buffer Allocations: %llu", value.number_of_buffer_allocations));
+		command_result.lines.PushBack(AL::String::Format("Buffer Allocations Per 1000 Requests: %llu", (value.number_of_requests == 0) ? 0 : ((value.number_of_buffer_allocations * 1000) / value.number_of_requests)));
+		command_result.lines.PushBack(AL::String::Format("Chunk Size: %u", value.chunk_size));
+		command_result.lines.PushBack(AL::String::Format("Window Size: %u", value.window_size));
+		command_result.lines.PushBack(AL::String::Format("RTT: %lluus", value.rtt_us));
+		command_result.lines.PushBack(AL::String::Format("Throughput: %llu bytes/s", value.bytes_per_second));
+		command_result.lines.PushBack(AL::String::Format("Compression: %llu bytes to %llu bytes", value.compression_bytes_in, value.compression_bytes_out));
+		command_result.lines.PushBack(AL::String::Format("Compression CPU Time Per MB: %lluus", (value.compression_bytes_in == 0) ? 0 : ((value.compression_cpu_time_us * 1000000) / value.compression_bytes_in)));
+	}
+
+	return error_code;
+}
+
+struct main_preview_context
+{
+	AL::uint32 count;
+	AL::uint32 count_max;
+	AL::uint64 number_of_bytes_received;
+};
+
+AL::uint8 main_console_command_preview(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	AL::OS::Timer        timer;
+	main_preview_context context =
+	{
+		.count                    = 0,
+		.count_max                = command.args.uint32,
+		.number_of_bytes_received = 0
+	};
+
+	auto error_code = pi_camera_preview(camera, [](const AL::uint8* buffer, AL::uint32 size, void* param)
+	{
+		auto context = static_cast<main_preview_context*>(param);
+
+		context->number_of_bytes_received += size;
+
+		AL::OS::Console::WriteLine("Received frame %u (%u bytes)", ++context->count, size);
+
+		return context->count < context->count_max;
+	}, &context);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("Received %u frames (%llu bytes) in %llums", context.count, context.number_of_bytes_received, timer.GetElapsed().ToMilliseconds()));
+
+	return error_code;
+}
+
+struct main_capture_video_stream_context
+{
+	AL::OS::Timer timer;
+	AL::uint64    first_nal_unit_ms;
+	AL::uint32    number_of_nal_units;
+	AL::uint64    number_of_bytes_received;
+};
+
+AL::uint8 main_console_command_capture_video_stream(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	main_capture_video_stream_context context =
+	{
+		.first_nal_unit_ms        = 0,
+		.number_of_nal_units      = 0,
+		.number_of_bytes_received = 0
+	};
+
+	auto error_code = pi_camera_capture_video_stream(camera, command.args.uint32, [](const AL::uint8* buffer, AL::uint32 size, void* param)
+	{
+		auto context = static_cast<main_capture_video_stream_context*>(param);
+
+		if (context->number_of_nal_units++ == 0)
+			context->first_nal_unit_ms = context->timer.GetElapsed().ToMilliseconds();
+
+		context->number_of_bytes_received += size;
+
+		return true;
+	}, &context);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		command_result.lines.PushBack(AL::String::Format("First nal unit after %llums", context.first_nal_unit_ms));
+		command_result.lines.PushBack(AL::String::Format("Received %u nal units (%llu bytes) in %llums", context.number_of_nal_units, context.number_of_bytes_received, context.timer.GetElapsed().ToMilliseconds()));
+	}
+
+	return error_code;
+}
+AL::uint8 main_console_command_start_recording(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_start_recording(camera, nullptr, command.args.uint16_2[0], static_cast<AL::uint64>(command.args.uint16_2[1]) * 1024 * 1024);
+}
+AL::uint8 main_console_command_stop_recording(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_stop_recording(camera);
+}
+AL::uint8 main_console_command_get_recording_segments(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	AL::Collections::Array<pi_camera_recording_segment> values;
+	AL::uint32                                          count = 0;
+	AL::uint8                                           error_code;
+
+	while ((error_code = pi_camera_get_recording_segments(camera, 0, AL::Integer<AL::uint64>::Maximum, (count != 0) ? &values[0] : nullptr, &count)) == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL)
+		values.SetCapacity(count);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		for (AL::uint32 i = 0; i < count; ++i)
+			command_result.lines.PushBack(AL::String::Format("Segment %llu: %llums + %ums (%llu bytes)", values[i].id, values[i].start_time_ms, values[i].duration_ms, values[i].size));
+
+	return error_code;
+}
+AL::uint8 main_console_command_get_recording_segment(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_get_recording_segment(camera, command.args.uint64, command.args.string.GetCString(), [](AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Received %llu/%llu bytes", number_of_bytes_received, file_size);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("Segment saved to %s", command.args.string.GetCString()));
+
+	return error_code;
+}
+AL::uint8 main_console_command_start_pre_roll(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_start_pre_roll(camera, command.args.uint16_2[0], static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>(static_cast<AL::uint64>(command.args.uint16_2[1]) * 1024 * 1024, 0, AL::Integer<AL::uint32>::Maximum)));
+}
+AL::uint8 main_console_command_stop_pre_roll(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_stop_pre_roll(camera);
+}
+AL::uint8 main_console_command_capture_pre_roll(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_capture_pre_roll(camera, command.args.string.GetCString(), command.args.uint32, [](AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Received %llu/%llu bytes", number_of_bytes_received, file_size);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("Video saved to %s", command.args.string.GetCString()));
+
+	return error_code;
+}
+AL::uint8 main_console_command_capture_burst(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_capture_burst(camera, command.args.string.GetCString(), command.args.uint16_2[0], command.args.uint16_2[1], [](AL::uint32 frame_index, AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Frame %u: received %llu/%llu bytes", frame_index, number_of_bytes_received, file_size);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("%u images saved to %s", command.args.uint16_2[0], command.args.string.GetCString()));
+
+	return error_code;
+}
+AL::uint8 main_console_command_start_timelapse(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_start_timelapse(camera, static_cast<AL::uint32>(command.args.uint16_2[0]) * 1000, command.args.uint16_2[1], 0);
+}
+AL::uint8 main_console_command_stop_timelapse(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	return pi_camera_stop_timelapse(camera);
+}
+AL::uint8 main_console_command_get_captures(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	AL::Collections::Array<pi_camera_capture_info> values;
+	AL::uint32                                     count = 0;
+	AL::uint8                                      error_code;
+
+	while ((error_code = pi_camera_get_captures(camera, 0, AL::Integer<AL::uint64>::Maximum, (count != 0) ? &values[0] : nullptr, &count)) == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL)
+		values.SetCapacity(count);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		for (AL::uint32 i = 0; i < count; ++i)
+			command_result.lines.PushBack(AL::String::Format("Capture %llu (%llu bytes, config %08X)", values[i].timestamp_ms, values[i].size, values[i].config_hash));
+
+	return error_code;
+}
+AL::uint8 main_console_command_fetch_captures(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_fetch_captures(camera, 0, AL::Integer<AL::uint64>::Maximum, command.args.string.GetCString(), [](AL::uint64 timestamp_ms, AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Capture %llu: received %llu/%llu bytes", timestamp_ms, number_of_bytes_received, file_size);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("Captures saved to %s", command.args.string.GetCString()));
+
+	return error_code;
+}
+AL::uint8 main_console_command_delete_captures(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	AL::uint32 count;
+	auto       error_code = pi_camera_delete_captures(camera, 0, AL::Integer<AL::uint64>::Maximum, &count);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("%u captures deleted", count));
+
+	return error_code;
+}
+AL::uint8 main_console_command_resume_transfer(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	auto error_code = pi_camera_resume_transfer(camera, command.args.uint64, command.args.string.GetCString(), [](AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+	{
+		AL::OS::Console::WriteLine("Received %llu/%llu bytes", number_of_bytes_received, file_size);
+	}, nullptr);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		command_result.lines.PushBack(AL::String::Format("File saved to %s", command.args.string.GetCString()));
+
+	return error_code;
+}
+AL::uint8 main_console_command_get_capabilities(const pi_camera_console_command& command, pi_camera_console_command_result& command_result)
+{
+	pi_camera_capabilities value;
+	auto                   error_code = pi_camera_get_capabilities(camera, &value);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		command_result.lines.PushBack(AL::String::Format("Protocol Version: %u", value.protocol_version));
+		command_result.lines.PushBack(AL::String::Format("Pipeline: %s", (value.features & PI_CAMERA_FEATURE_PIPELINE) ? "yes" : "no"));
+		command_result.lines.PushBack(AL::String::Format("Properties: %s", (value.features & PI_CAMERA_FEATURE_PROPERTIES) ? "yes" : "no"));
+		command_result.lines.PushBack(AL::String::Format("Resume File Transfer: %s", (value.features & PI_CAMERA_FEATURE_RESUME_FILE_TRANSFER) ? "yes" : "no"));
+		command_result.lines.PushBack(AL::String::Format("Chunk Size Max: %u", value.chunk_size_max));
+		command_result.lines.PushBack(AL::String::Format("Window Size Max: %u", value.window_size_max));
+		command_result.lines.PushBack(AL::String::Format("Codecs: 0x%X", value.codecs));
+	}
+
+	return error_code;
+}
 
 constexpr pi_camera_console_command_context CONSOLE_COMMANDS[PI_CAMERA_CONSOLE_COMMAND_COUNT] =
 {
@@ -1271,7 +1940,27 @@ constexpr pi_camera_console_command_context CONSOLE_COMMANDS[PI_CAMERA_CONSOLE_C
 	{ PI_CAMERA_CONSOLE_COMMAND_GET_VIDEO_FRAME_RATE, &main_console_command_get_video_frame_rate, "get vfr|video_frame_rate" },
 	{ PI_CAMERA_CONSOLE_COMMAND_SET_VIDEO_FRAME_RATE, &main_console_command_set_video_frame_rate, "set vfr|video_frame_rate" },
 	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE,              &main_console_command_capture,              "capture /path/to/file" },
-	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO,        &main_console_command_capture_video,        "capture_video duration /path/to/file" }
+	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO,        &main_console_command_capture_video,        "capture_video duration /path/to/file" },
+	{ PI_CAMERA_CONSOLE_COMMAND_BENCHMARK,            &main_console_command_benchmark,            "benchmark count" },
+	{ PI_CAMERA_CONSOLE_COMMAND_GET_TRANSFER_STATS,   &main_console_command_get_transfer_stats,   "get stats" },
+	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_STREAM,       &main_console_command_capture_stream,       "capture_stream /path/to/file" },
+	{ PI_CAMERA_CONSOLE_COMMAND_PREVIEW,              &main_console_command_preview,              "preview count" },
+	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_VIDEO_STREAM, &main_console_command_capture_video_stream, "capture_video_stream duration" },
+	{ PI_CAMERA_CONSOLE_COMMAND_START_RECORDING,      &main_console_command_start_recording,      "start_recording segment_length budget_mb" },
+	{ PI_CAMERA_CONSOLE_COMMAND_STOP_RECORDING,       &main_console_command_stop_recording,       "stop_recording" },
+	{ PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENTS, &main_console_command_get_recording_segments, "get segments" },
+	{ PI_CAMERA_CONSOLE_COMMAND_GET_RECORDING_SEGMENT, &main_console_command_get_recording_segment, "get segment id /path/to/file" },
+	{ PI_CAMERA_CONSOLE_COMMAND_START_PRE_ROLL,       &main_console_command_start_pre_roll,       "start_pre_roll seconds buffer_mb" },
+	{ PI_CAMERA_CONSOLE_COMMAND_STOP_PRE_ROLL,        &main_console_command_stop_pre_roll,        "stop_pre_roll" },
+	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_PRE_ROLL,     &main_console_command_capture_pre_roll,     "capture_pre_roll duration /path/to/file" },
+	{ PI_CAMERA_CONSOLE_COMMAND_CAPTURE_BURST,        &main_console_command_capture_burst,        "capture_burst count interval_ms /path/to/directory" },
+	{ PI_CAMERA_CONSOLE_COMMAND_START_TIMELAPSE,      &main_console_command_start_timelapse,      "start_timelapse interval_seconds count" },
+	{ PI_CAMERA_CONSOLE_COMMAND_STOP_TIMELAPSE,       &main_console_command_stop_timelapse,       "stop_timelapse" },
+	{ PI_CAMERA_CONSOLE_COMMAND_GET_CAPTURES,         &main_console_command_get_captures,         "get captures" },
+	{ PI_CAMERA_CONSOLE_COMMAND_FETCH_CAPTURES,       &main_console_command_fetch_captures,       "fetch_captures /path/to/directory" },
+	{ PI_CAMERA_CONSOLE_COMMAND_DELETE_CAPTURES,      &main_console_command_delete_captures,      "delete_captures" },
+	{ PI_CAMERA_CONSOLE_COMMAND_RESUME_TRANSFER,      &main_console_command_resume_transfer,      "resume_transfer id /path/to/file" },
+	{ PI_CAMERA_CONSOLE_COMMAND_GET_CAPABILITIES,     &main_console_command_get_capabilities,     "get capabilities" }
 };
 
 template<AL::size_t ... INDEXES>
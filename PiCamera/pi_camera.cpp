@@ -2,7 +2,9 @@
 
 #include <AL/OS/Shell.hpp>
 #include <AL/OS/Timer.hpp>
+#include <AL/OS/Mutex.hpp>
 #include <AL/OS/Thread.hpp>
+#include <AL/OS/ConditionalVariable.hpp>
 
 #include <AL/Game/Loop.hpp>
 
@@ -16,9 +18,89 @@
 #include <AL/Collections/Array.hpp>
 #include <AL/Collections/LinkedList.hpp>
 
-#define PI_CAMERA_FILE_CHUNK_SIZE   1000000
-#define PI_CAMERA_ERROR_CODE_COUNT  (PI_CAMERA_ERROR_CODE_UNDEFINED + 1)
-#define PI_CAMERA_SERVICE_TICK_RATE 2
+#include <new>
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(AL_PLATFORM_LINUX)
+	#include <poll.h>
+	#include <fcntl.h>
+	#include <errno.h>
+	#include <spawn.h>
+	#include <signal.h>
+	#include <string.h>
+	#include <time.h>
+	#include <dirent.h>
+	#include <unistd.h>
+	#include <stdlib.h>
+
+	#include <sys/epoll.h>
+	#include <sys/socket.h>
+	#include <sys/eventfd.h>
+	#include <sys/resource.h>
+	#include <sys/stat.h>
+	#include <sys/wait.h>
+	#include <sys/inotify.h>
+	#include <sys/sendfile.h>
+	#include <sys/mman.h>
+	#include <sys/uio.h>
+	#include <sys/random.h>
+
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+
+	#if !defined(PI_CAMERA_NO_ZERO_COPY)
+		#define PI_CAMERA_ZERO_COPY
+	#endif
+#endif
+
+#if !defined(PI_CAMERA_NO_COMPRESSION)
+	#define PI_CAMERA_COMPRESSION
+#endif
+
+#define PI_CAMERA_FILE_CHUNK_SIZE               1000000
+#define PI_CAMERA_FILE_CHUNK_SIZE_MIN           4096
+#define PI_CAMERA_FILE_CHUNK_SIZE_MAX           8000000
+#define PI_CAMERA_FILE_CHUNK_TIME_MS            100
+#define PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE     4
+#define PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX 64
+#define PI_CAMERA_FILE_TRANSFER_RETAIN_MS       300000
+#define PI_CAMERA_FILE_TRANSFER_RETAIN_SIZE_MAX 256000000
+#define PI_CAMERA_STREAM_CHUNK_SIZE             65536
+#define PI_CAMERA_STILL_WORKER_TIMEOUT_MS       10000
+#define PI_CAMERA_STILL_WORKER_READY_POLL_MS    10
+#define PI_CAMERA_PIPELINE_DEPTH_MAX            32
+// 0 only joins captures in flight, a finished capture is never handed out again
+#define PI_CAMERA_CAPTURE_CACHE_WINDOW_MS       0
+// larger images are only captured into a caller supplied buffer
+#define PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX    64000000
+#define PI_CAMERA_PREVIEW_FLUSH_TIMEOUT_MS      5000
+#define PI_CAMERA_PREVIEW_WIDTH                 640
+#define PI_CAMERA_PREVIEW_HEIGHT                480
+#define PI_CAMERA_PREVIEW_FRAME_SIZE_MAX        1000000
+#define PI_CAMERA_VIDEO_NAL_UNIT_SIZE_MAX       4000000
+#define PI_CAMERA_MP4_TIMESCALE                 90000
+#define PI_CAMERA_RECORDING_DIRECTORY           "./pi_recording"
+#define PI_CAMERA_RECORDING_RETRY_MS            1000
+#define PI_CAMERA_PRE_ROLL_BUFFER_SIZE_MIN      PI_CAMERA_VIDEO_NAL_UNIT_SIZE_MAX
+#define PI_CAMERA_PRE_ROLL_BUFFER_SIZE_MAX      256000000
+#define PI_CAMERA_STORE_DIRECTORY               "./pi_store"
+#define PI_CAMERA_STORE_INDEX_MAP_GROWTH        65536
+#define PI_CAMERA_TIMELAPSE_BUSY_RETRY_MS       100
+#define PI_CAMERA_PACKET_BUFFER_INLINE_SIZE     64
+// larger heap buffers are freed before the next packet instead of being kept for the life of the connection
+#define PI_CAMERA_PACKET_BUFFER_RETAIN_SIZE_MAX PI_CAMERA_FILE_CHUNK_SIZE_MAX
+// no request a client sends comes close, a larger one closes the session before anything is allocated for it
+#define PI_CAMERA_SERVICE_REQUEST_SIZE_MAX      65536
+// set on the opcode of a packet whose payload is compressed
+#define PI_CAMERA_PACKET_FLAG_COMPRESSED        0x80
+// smaller payloads can't save more than the cost of compressing them
+#define PI_CAMERA_COMPRESSION_SIZE_MIN          128
+#define PI_CAMERA_LZ4_HASH_BITS                 12
+#define PI_CAMERA_ERROR_CODE_COUNT              (PI_CAMERA_ERROR_CODE_CORRUPT_DATA + 1)
+#define PI_CAMERA_SERVICE_TICK_RATE             2
+#define PI_CAMERA_SERVICE_EPOLL_EVENT_COUNT     64
 
 enum PI_CAMERA_TYPES : AL::uint8
 {
@@ -88,3323 +170,12192 @@ enum PI_CAMERA_OPCODES : AL::uint8
 
 	PI_CAMERA_OPCODE_CAPTURE,
 	PI_CAMERA_OPCODE_CAPTURE_VIDEO,
+	PI_CAMERA_OPCODE_CAPTURE_STREAM,
+
+	PI_CAMERA_OPCODE_HELLO,
+
+	PI_CAMERA_OPCODE_GET_PROPERTIES,
+	PI_CAMERA_OPCODE_SET_PROPERTIES,
+
+	PI_CAMERA_OPCODE_PREVIEW_STREAM,
+	PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM,
+
+	PI_CAMERA_OPCODE_START_RECORDING,
+	PI_CAMERA_OPCODE_STOP_RECORDING,
+	PI_CAMERA_OPCODE_GET_RECORDING_SEGMENTS,
+	PI_CAMERA_OPCODE_GET_RECORDING_SEGMENT,
+
+	PI_CAMERA_OPCODE_START_PRE_ROLL,
+	PI_CAMERA_OPCODE_STOP_PRE_ROLL,
+	PI_CAMERA_OPCODE_CAPTURE_PRE_ROLL,
+
+	PI_CAMERA_OPCODE_CAPTURE_BURST,
+
+	PI_CAMERA_OPCODE_START_TIMELAPSE,
+	PI_CAMERA_OPCODE_STOP_TIMELAPSE,
+
+	PI_CAMERA_OPCODE_GET_CAPTURES,
+	PI_CAMERA_OPCODE_FETCH_CAPTURES,
+	PI_CAMERA_OPCODE_DELETE_CAPTURES,
+
+	PI_CAMERA_OPCODE_RESUME_FILE_TRANSFER,
 
 	PI_CAMERA_OPCODE_COUNT
 };
 
+static_assert(PI_CAMERA_OPCODE_COUNT <= PI_CAMERA_PACKET_FLAG_COMPRESSED);
+
+enum PI_CAMERA_PROTOCOL_VERSIONS : AL::uint8
+{
+	PI_CAMERA_PROTOCOL_VERSION_1 = 1,
+	// adds request_id to pi_camera_packet_header
+	PI_CAMERA_PROTOCOL_VERSION_2,
+	// hello carries pi_camera_capabilities
+	PI_CAMERA_PROTOCOL_VERSION_3,
+
+	PI_CAMERA_PROTOCOL_VERSION_CURRENT = PI_CAMERA_PROTOCOL_VERSION_3
+};
+
 #pragma pack(push, 1)
 struct pi_camera_packet_header
 {
 	AL::uint8  opcode;
 	AL::uint8  error_code;
 	AL::uint32 buffer_size;
+	AL::uint32 request_id; // PI_CAMERA_PROTOCOL_VERSION_2
 };
-#pragma pack(pop)
-
-typedef AL::Collections::Array<AL::uint8> pi_camera_packet_buffer;
 
-typedef bool(*pi_camera_service_packet_handler)(struct pi_camera_service* camera_service, struct pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size);
-
-struct pi_camera_service_packet_handler_context
+// starts a PI_CAMERA_OPCODE_FILE_TRANSFER
+struct pi_camera_file_transfer_header
 {
-	AL::uint8                        opcode;
-	pi_camera_service_packet_handler packet_handler;
+	AL::uint64 file_size;
+	// chunks the service keeps in flight at most, services that predate windowed transfers only send file_size and wait for every chunk to be acked
+	AL::uint8  window_size_max;
+	// only sent for transfers that can be resumed
+	AL::uint64 transfer_id;
+	// number of bytes the client already has
+	AL::uint64 offset;
 };
+#pragma pack(pop)
 
-struct pi_camera
+constexpr AL::size_t pi_camera_packet_header_get_size(AL::uint8 protocol_version)
 {
-	AL::uint8 type;
+	return (protocol_version >= PI_CAMERA_PROTOCOL_VERSION_2) ? sizeof(pi_camera_packet_header) : (sizeof(pi_camera_packet_header) - sizeof(AL::uint32));
+}
 
-	explicit pi_camera(AL::uint8 type)
-		: type(type)
+// what a peer that predates pi_camera_capabilities supports
+constexpr pi_camera_capabilities pi_camera_capabilities_from_protocol_version(AL::uint8 protocol_version)
+{
+	return
 	{
-	}
-};
+		.protocol_version = protocol_version,
+		.features         = (protocol_version >= PI_CAMERA_PROTOCOL_VERSION_2) ? static_cast<AL::uint32>(PI_CAMERA_FEATURE_PIPELINE | PI_CAMERA_FEATURE_PROPERTIES) : 0,
+		.chunk_size_max   = PI_CAMERA_FILE_CHUNK_SIZE,
+		// each transfer still announces the window the peer uses, stop and wait peers announce none
+		.window_size_max  = PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX,
+		.codecs           = 1 << PI_CAMERA_CODEC_NONE
+	};
+}
 
-struct pi_camera_local
-	: public pi_camera
+constexpr pi_camera_capabilities PI_CAMERA_CAPABILITIES =
 {
-	bool             is_busy = false;
-
-	pi_camera_config config;
-	AL::String       cli_params;
-	AL::String       cli_params_video;
-
-	pi_camera_local()
-		: pi_camera(PI_CAMERA_TYPE_LOCAL),
-		config(PI_CAMERA_CONFIG_DEFAULT)
-	{
-	}
+	.protocol_version = PI_CAMERA_PROTOCOL_VERSION_CURRENT,
+	.features         = PI_CAMERA_FEATURE_PIPELINE | PI_CAMERA_FEATURE_PROPERTIES | PI_CAMERA_FEATURE_RESUME_FILE_TRANSFER,
+	.chunk_size_max   = PI_CAMERA_FILE_CHUNK_SIZE_MAX,
+	.window_size_max  = PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX,
+#if defined(PI_CAMERA_COMPRESSION)
+	.codecs           = (1 << PI_CAMERA_CODEC_NONE) | (1 << PI_CAMERA_CODEC_LZ4)
+#else
+	.codecs           = 1 << PI_CAMERA_CODEC_NONE
+#endif
 };
 
-struct pi_camera_remote
-	: public pi_camera
+// @return what both PI_CAMERA_CAPABILITIES and peer support
+pi_camera_capabilities pi_camera_capabilities_negotiate(const pi_camera_capabilities& peer)
 {
-	AL::Network::TcpSocket  socket;
-	AL::Network::IPEndPoint remote_end_point;
-
-	explicit pi_camera_remote(AL::Network::IPEndPoint&& remote_end_point)
-		: pi_camera(PI_CAMERA_TYPE_REMOTE),
-		socket(remote_end_point.Host.GetFamily()),
-		remote_end_point(AL::Move(remote_end_point))
+	return
 	{
-	}
-};
-
-struct pi_camera_service;
-
-struct pi_camera_session
-	: public pi_camera
+		.protocol_version = AL::Math::Clamp<AL::uint8>(peer.protocol_version, PI_CAMERA_PROTOCOL_VERSION_1, PI_CAMERA_CAPABILITIES.protocol_version),
+		.features         = peer.features & PI_CAMERA_CAPABILITIES.features,
+		.chunk_size_max   = AL::Math::Clamp<AL::uint32>(peer.chunk_size_max, PI_CAMERA_FILE_CHUNK_SIZE_MIN, PI_CAMERA_CAPABILITIES.chunk_size_max),
+		.window_size_max  = AL::Math::Clamp<AL::uint8>(peer.window_size_max, 1, PI_CAMERA_CAPABILITIES.window_size_max),
+		// every peer can fall back to uncompressed
+		.codecs           = (peer.codecs & PI_CAMERA_CAPABILITIES.codecs) | (1 << PI_CAMERA_CODEC_NONE)
+	};
+}
+pi_camera_capabilities pi_camera_capabilities_to_network(const pi_camera_capabilities& value)
+{
+	return
+	{
+		.protocol_version = AL::BitConverter::HostToNetwork(value.protocol_version),
+		.features         = AL::BitConverter::HostToNetwork(value.features),
+		.chunk_size_max   = AL::BitConverter::HostToNetwork(value.chunk_size_max),
+		.window_size_max  = AL::BitConverter::HostToNetwork(value.window_size_max),
+		.codecs           = AL::BitConverter::HostToNetwork(value.codecs)
+	};
+}
+pi_camera_capabilities pi_camera_capabilities_from_network(const void* buffer)
 {
-	AL::Network::TcpSocket socket;
-	pi_camera_service*     service;
+	auto value = reinterpret_cast<const pi_camera_capabilities*>(buffer);
 
-	explicit pi_camera_session(pi_camera_service* service, AL::Network::TcpSocket&& socket)
-		: pi_camera(PI_CAMERA_TYPE_SESSION),
-		socket(AL::Move(socket)),
-		service(service)
+	return
 	{
-	}
-};
+		.protocol_version = AL::BitConverter::NetworkToHost(value->protocol_version),
+		.features         = AL::BitConverter::NetworkToHost(value->features),
+		.chunk_size_max   = AL::BitConverter::NetworkToHost(value->chunk_size_max),
+		.window_size_max  = AL::BitConverter::NetworkToHost(value->window_size_max),
+		.codecs           = AL::BitConverter::NetworkToHost(value->codecs)
+	};
+}
 
-typedef AL::Collections::LinkedList<pi_camera_session*> pi_camera_session_list;
+// heap allocations made by every packet buffer in the process
+AL::OS::Mutex pi_camera_packet_buffer_allocations_mutex;
+AL::uint64    pi_camera_packet_buffer_allocations = 0;
 
-struct pi_camera_service
-	: public pi_camera
+// small packets live inline, larger ones keep their allocation at the high-water mark so a reused buffer stops allocating
+class pi_camera_packet_buffer
 {
-	bool                    is_thread_stopping = false;
-
-	pi_camera_local         local;
-	AL::Network::TcpSocket  socket;
-	AL::OS::Thread          thread;
-	pi_camera_session_list  sessions;
-	AL::uint64              image_counter = 0;
-	AL::uint64              video_counter = 0;
-	AL::size_t              max_connections;
-	AL::Network::IPEndPoint local_end_point;
+	AL::uint8* heap_buffer   = nullptr;
+	AL::size_t heap_capacity = 0;
+	AL::size_t size          = 0;
+	alignas(AL::uint64) AL::uint8 inline_buffer[PI_CAMERA_PACKET_BUFFER_INLINE_SIZE];
 
-	pi_camera_service(AL::Network::IPEndPoint&& local_end_point, AL::size_t max_connections)
-		: pi_camera(PI_CAMERA_TYPE_SERVICE),
-		socket(local_end_point.Host.GetFamily()),
-		max_connections(max_connections),
-		local_end_point(AL::Move(local_end_point))
+public:
+	pi_camera_packet_buffer()
 	{
 	}
-};
 
-typedef AL::FileSystem::File pi_camera_file;
-
-struct pi_camera_error_string
-{
-	AL::uint8   code;
-	const char* string;
-};
+	explicit pi_camera_packet_buffer(AL::size_t size)
+	{
+		SetCapacity(size);
+	}
 
-bool            pi_camera_file_get_size(const char* path, AL::uint64& value)
-{
-	try
+	pi_camera_packet_buffer(pi_camera_packet_buffer&& buffer)
 	{
-		value = AL::FileSystem::File::GetSize(path);
+		*this = AL::Move(buffer);
 	}
-	catch (const AL::Exception& exception)
+
+	pi_camera_packet_buffer(const pi_camera_packet_buffer& buffer)
 	{
+		*this = buffer;
+	}
 
-		return false;
+	~pi_camera_packet_buffer()
+	{
+		delete[] heap_buffer;
 	}
 
-	return true;
-}
-pi_camera_file* pi_camera_file_open(const char* path, bool read, bool write)
-{
-	AL::BitMask<AL::FileSystem::FileOpenModes> mode;
-	mode.Add(AL::FileSystem::FileOpenModes::Binary);
-	mode.Set(AL::FileSystem::FileOpenModes::Read,     read);
-	mode.Set(AL::FileSystem::FileOpenModes::Write,    write);
-	mode.Set(AL::FileSystem::FileOpenModes::Truncate, !read && write);
+	AL::size_t GetSize() const
+	{
+		return size;
+	}
 
-	auto file = new pi_camera_file(
-		AL::FileSystem::Path(path)
-	);
+	AL::size_t GetCapacity() const
+	{
+		return (heap_buffer != nullptr) ? heap_capacity : PI_CAMERA_PACKET_BUFFER_INLINE_SIZE;
+	}
 
-	try
+	// resizes the buffer, the content up to the smaller size is kept
+	void SetCapacity(AL::size_t value)
 	{
-		if (!file->Open(mode.Value))
+		if (value > GetCapacity())
 		{
-			delete file;
+			auto buffer = new AL::uint8[value];
 
-			return nullptr;
+			{
+				AL::OS::MutexGuard lock(pi_camera_packet_buffer_allocations_mutex);
+
+				++pi_camera_packet_buffer_allocations;
+			}
+
+			if (size != 0)
+				::memcpy(buffer, &(*this)[0], size);
+
+			delete[] heap_buffer;
+			heap_buffer   = buffer;
+			heap_capacity = value;
 		}
+
+		size = value;
 	}
-	catch (const AL::Exception& exception)
+
+	// frees the heap buffer if it grew beyond size_max, the content is discarded
+	void Trim(AL::size_t size_max)
 	{
-		delete file;
+		if (heap_capacity <= size_max)
+			return;
 
-		return nullptr;
+		delete[] heap_buffer;
+		heap_buffer   = nullptr;
+		heap_capacity = 0;
+		size          = 0;
 	}
 
-	return file;
-}
-bool            pi_camera_file_read(pi_camera_file* file, void* buffer, AL::uint64 size)
-{
-	try
+	AL::uint8* begin()
 	{
-		for (AL::uint64 bytes_read, total_bytes_read = 0; total_bytes_read < size; total_bytes_read += bytes_read)
-			bytes_read = file->Read(&reinterpret_cast<AL::uint8*>(buffer)[total_bytes_read], static_cast<AL::size_t>(AL::Math::Clamp<AL::uint64>(size - total_bytes_read, 0, AL::Integer<AL::size_t>::Maximum)));
+		return (heap_buffer != nullptr) ? heap_buffer : inline_buffer;
 	}
-	catch (const AL::Exception& exception)
+	const AL::uint8* begin() const
 	{
-
-		return false;
+		return (heap_buffer != nullptr) ? heap_buffer : inline_buffer;
 	}
 
-	return true;
-}
-bool            pi_camera_file_append(pi_camera_file* file, const void* buffer, AL::uint64 size)
-{
-	try
+	AL::uint8* end()
 	{
-		for (AL::uint64 bytes_written, total_bytes_written = 0; total_bytes_written < size; total_bytes_written += bytes_written)
-			bytes_written = file->Write(&reinterpret_cast<const AL::uint8*>(buffer)[total_bytes_written], static_cast<AL::size_t>(AL::Math::Clamp<AL::uint64>(size - total_bytes_written, 0, AL::Integer<AL::size_t>::Maximum)));
+		return begin() + size;
 	}
-	catch (const AL::Exception& exception)
+	const AL::uint8* end() const
 	{
+		return begin() + size;
+	}
 
-		return false;
+	AL::uint8& operator [] (AL::size_t index)
+	{
+		return begin()[index];
+	}
+	const AL::uint8& operator [] (AL::size_t index) const
+	{
+		return begin()[index];
 	}
 
-	return true;
-}
-void            pi_camera_file_close(pi_camera_file* file)
-{
-	file->Close();
-	delete file;
-}
-bool            pi_camera_file_delete(const char* path)
-{
-	try
+	pi_camera_packet_buffer& operator = (pi_camera_packet_buffer&& buffer)
 	{
-		AL::FileSystem::File::Delete(path);
+		if (this == &buffer)
+			return *this;
+
+		delete[] heap_buffer;
+		heap_buffer   = buffer.heap_buffer;
+		heap_capacity = buffer.heap_capacity;
+		size          = buffer.size;
+
+		if (heap_buffer == nullptr)
+			::memcpy(inline_buffer, buffer.inline_buffer, size);
+
+		buffer.heap_buffer   = nullptr;
+		buffer.heap_capacity = 0;
+		buffer.size          = 0;
+
+		return *this;
 	}
-	catch (const AL::Exception& exception)
+	pi_camera_packet_buffer& operator = (const pi_camera_packet_buffer& buffer)
 	{
+		if (this == &buffer)
+			return *this;
 
-		return false;
+		size = 0;
+		SetCapacity(buffer.size);
+
+		if (size != 0)
+			::memcpy(&(*this)[0], &buffer[0], size);
+
+		return *this;
+	}
+};
+
+#if defined(PI_CAMERA_COMPRESSION)
+// payload bytes handed to the compressor and sent after it, anywhere in the process
+AL::OS::Mutex pi_camera_compression_stats_mutex;
+AL::uint64    pi_camera_compression_bytes_in    = 0;
+AL::uint64    pi_camera_compression_bytes_out   = 0;
+AL::uint64    pi_camera_compression_cpu_time_us = 0;
+
+// jpg and h264 payloads are already compressed, hello is read before codecs are negotiated
+constexpr bool pi_camera_opcode_is_compressible(AL::uint8 opcode)
+{
+	switch (opcode)
+	{
+		case PI_CAMERA_OPCODE_HELLO:
+		case PI_CAMERA_OPCODE_FILE_TRANSFER:
+		case PI_CAMERA_OPCODE_FILE_TRANSFER_ACK:
+		case PI_CAMERA_OPCODE_CAPTURE_STREAM:
+		case PI_CAMERA_OPCODE_PREVIEW_STREAM:
+		case PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM:
+			return false;
 	}
 
 	return true;
 }
 
-void pi_camera_net_socket_close(AL::Network::TcpSocket& socket)
+AL::uint32 pi_camera_lz4_read_uint32(const AL::uint8* buffer)
 {
-	socket.Close();
+	AL::uint32 value;
+	::memcpy(&value, buffer, sizeof(AL::uint32));
+
+	return value;
 }
-bool pi_camera_net_socket_listen(AL::Network::TcpSocket& socket, const AL::Network::IPEndPoint& local_end_point, AL::size_t backlog, bool block = false)
+bool       pi_camera_lz4_write_length(AL::uint8* buffer, AL::size_t size, AL::size_t& offset, AL::size_t length)
 {
-	socket.SetBlocking(block ? AL::True : AL::False);
-
-	try
+	for (; length >= 255; length -= 255)
 	{
-		socket.Open();
-		socket.Bind(local_end_point);
-		socket.Listen(backlog);
+		if (offset == size)
+			return false;
+
+		buffer[offset++] = 255;
 	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
 
+	if (offset == size)
 		return false;
-	}
+
+	buffer[offset++] = static_cast<AL::uint8>(length);
 
 	return true;
 }
-// @return 0 on error
-// @return -1 if would block
-int  pi_camera_net_socket_accept(AL::Network::TcpSocket& socket, AL::Network::TcpSocket& new_socket)
+// @param match_length 0 for the last sequence which only carries literals
+bool       pi_camera_lz4_write_sequence(AL::uint8* buffer, AL::size_t size, AL::size_t& offset, const AL::uint8* literals, AL::size_t literal_count, AL::size_t match_offset, AL::size_t match_length)
 {
-	try
-	{
-		if (!socket.Accept(new_socket))
-		{
+	if (offset == size)
+		return false;
 
-			return -1;
-		}
-	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
+	auto token = &buffer[offset++];
+	*token     = static_cast<AL::uint8>(((literal_count < 15) ? literal_count : 15) << 4);
 
-		return 0;
-	}
+	if ((literal_count >= 15) && !pi_camera_lz4_write_length(buffer, size, offset, literal_count - 15))
+		return false;
 
-	return 1;
+	if ((size - offset) < literal_count)
+		return false;
+
+	::memcpy(&buffer[offset], literals, literal_count);
+	offset += literal_count;
+
+	if (match_length == 0)
+		return true;
+
+	if ((size - offset) < sizeof(AL::uint16))
+		return false;
+
+	buffer[offset++] = static_cast<AL::uint8>(match_offset);
+	buffer[offset++] = static_cast<AL::uint8>(match_offset >> 8);
+	*token          |= static_cast<AL::uint8>(((match_length - 4) < 15) ? (match_length - 4) : 15);
+
+	return ((match_length - 4) < 15) || pi_camera_lz4_write_length(buffer, size, offset, match_length - 4 - 15);
 }
-bool pi_camera_net_socket_connect(AL::Network::TcpSocket& socket, const AL::Network::IPEndPoint& remote_end_point, bool block = false)
+// Writes an lz4 block, any lz4 decoder can read it back
+// @return 0 if the block doesn't fit in destination_size
+AL::size_t pi_camera_lz4_compress(const AL::uint8* source, AL::size_t source_size, AL::uint8* destination, AL::size_t destination_size)
 {
-	try
+	AL::uint32 table[1 << PI_CAMERA_LZ4_HASH_BITS] = {};
+	AL::size_t anchor             = 0;
+	AL::size_t source_offset      = 0;
+	AL::size_t destination_offset = 0;
+
+	// the last match starts 12 bytes before the end and leaves the last 5 bytes as literals
+	while ((source_offset + 12) <= source_size)
 	{
-		socket.Open();
+		auto value = pi_camera_lz4_read_uint32(&source[source_offset]);
+		auto hash  = (value * 2654435761U) >> (32 - PI_CAMERA_LZ4_HASH_BITS);
+		auto match = table[hash];
 
-		if (!socket.Connect(remote_end_point))
+		table[hash] = static_cast<AL::uint32>(source_offset);
+
+		if ((match >= source_offset) || ((source_offset - match) > 0xFFFF) || (pi_camera_lz4_read_uint32(&source[match]) != value))
 		{
-			pi_camera_net_socket_close(socket);
+			// skip ahead faster the longer nothing matched so incompressible payloads cost little
+			source_offset += 1 + ((source_offset - anchor) >> 6);
 
-			return false;
+			continue;
 		}
 
-		socket.SetBlocking(block ? AL::True : AL::False);
-	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
+		AL::size_t match_length = 4;
 
-		return false;
+		while (((source_offset + match_length) < (source_size - 5)) && (source[match + match_length] == source[source_offset + match_length]))
+			++match_length;
+
+		if (!pi_camera_lz4_write_sequence(destination, destination_size, destination_offset, &source[anchor], source_offset - anchor, source_offset - match, match_length))
+			return 0;
+
+		source_offset += match_length;
+		anchor         = source_offset;
 	}
 
-	return true;
+	if (!pi_camera_lz4_write_sequence(destination, destination_size, destination_offset, &source[anchor], source_size - anchor, 0, 0))
+		return 0;
+
+	return destination_offset;
 }
-bool pi_camera_net_socket_send(AL::Network::TcpSocket& socket, const void* buffer, AL::size_t size)
+// @return false if source is not an lz4 block of exactly destination_size bytes
+bool       pi_camera_lz4_decompress(const AL::uint8* source, AL::size_t source_size, AL::uint8* destination, AL::size_t destination_size)
 {
-	AL::size_t number_of_bytes_sent;
+	AL::size_t source_offset      = 0;
+	AL::size_t destination_offset = 0;
 
-	try
+	while (source_offset < source_size)
 	{
-		if (!AL::Network::SocketExtensions::SendAll(socket, buffer, size, number_of_bytes_sent))
+		AL::uint8  token         = source[source_offset++];
+		AL::size_t literal_count = token >> 4;
+
+		if (literal_count == 15)
 		{
-			pi_camera_net_socket_close(socket);
+			for (AL::uint8 length = 255; length == 255; literal_count += length)
+			{
+				if (source_offset == source_size)
+					return false;
 
-			return false;
+				length = source[source_offset++];
+			}
 		}
-	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
 
-		return false;
-	}
+		if (((source_size - source_offset) < literal_count) || ((destination_size - destination_offset) < literal_count))
+			return false;
 
-	return true;
-}
-// @return 0 on error
-// @return -1 if would block
-int  pi_camera_net_socket_receive(AL::Network::TcpSocket& socket, void* buffer, AL::size_t size, AL::size_t& number_of_bytes_received)
-{
-	try
-	{
-		if (!socket.Receive(buffer, size, number_of_bytes_received))
-		{
-			pi_camera_net_socket_close(socket);
+		::memcpy(&destination[destination_offset], &source[source_offset], literal_count);
+		source_offset      += literal_count;
+		destination_offset += literal_count;
 
-			return 0;
-		}
-	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
+		if (source_offset == source_size)
+			break;
 
-		return 0;
-	}
+		if ((source_size - source_offset) < sizeof(AL::uint16))
+			return false;
 
-	return (number_of_bytes_received > 0) ? 1 : -1;
-}
-// @return 0 on error
-// @return -1 if would block
-int  pi_camera_net_socket_receive_all(AL::Network::TcpSocket& socket, void* buffer, AL::size_t size, bool block_once = true)
-{
-	AL::size_t number_of_bytes_received;
+		AL::size_t match_offset = source[source_offset] | (source[source_offset + 1] << 8);
+		AL::size_t match_length = (token & 0x0F) + 4;
+		source_offset += sizeof(AL::uint16);
 
-	try
-	{
-		if ((block_once && !AL::Network::SocketExtensions::TryReceiveAll(socket, buffer, size, number_of_bytes_received)) ||
-			(!block_once && !AL::Network::SocketExtensions::ReceiveAll(socket, buffer, size, number_of_bytes_received)))
+		if ((match_offset == 0) || (match_offset > destination_offset))
+			return false;
+
+		if ((token & 0x0F) == 15)
 		{
+			for (AL::uint8 length = 255; length == 255; match_length += length)
+			{
+				if (source_offset == source_size)
+					return false;
 
-			return 0;
+				length = source[source_offset++];
+			}
 		}
-	}
-	catch (const AL::Exception& exception)
-	{
-		pi_camera_net_socket_close(socket);
 
-		return 0;
+		if ((destination_size - destination_offset) < match_length)
+			return false;
+
+		// matches may overlap what they copy
+		for (AL::size_t i = 0; i < match_length; ++i, ++destination_offset)
+			destination[destination_offset] = destination[destination_offset - match_offset];
 	}
 
-	return (number_of_bytes_received > 0) ? 1 : -1;
+	return destination_offset == destination_size;
 }
-bool pi_camera_net_socket_resolve_end_point(AL::Network::IPEndPoint& value, const char* host, AL::uint16 port)
-{
-	value.Port = port;
+#endif
 
-	try
-	{
-		if (!AL::Network::DNS::Resolve(value.Host, host))
-		{
+typedef AL::Collections::LinkedList<AL::uint32> pi_camera_request_id_list;
 
-			return false;
-		}
-	}
-	catch (const AL::Exception& exception)
-	{
+struct pi_camera_transfer_tuning
+{
+	AL::uint32 chunk_size_min   = PI_CAMERA_FILE_CHUNK_SIZE_MIN;
+	AL::uint32 chunk_size_max   = PI_CAMERA_FILE_CHUNK_SIZE_MAX;
+	AL::uint32 chunk_size       = PI_CAMERA_FILE_CHUNK_SIZE;
+	AL::uint8  window_size      = PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX;
+	// smoothed, 0 until the first ack
+	AL::uint64 rtt_us           = 0;
+	AL::uint64 bytes_per_second = 0;
+};
 
-		return false;
-	}
+// @param chunk_size_max negotiated with the client
+AL::uint32 pi_camera_transfer_tuning_get_chunk_size(const pi_camera_transfer_tuning& tuning, AL::uint32 chunk_size_max)
+{
+	chunk_size_max = AL::Math::Lowest(tuning.chunk_size_max, chunk_size_max);
 
-	return true;
+	return AL::Math::Clamp(tuning.chunk_size, AL::Math::Lowest(tuning.chunk_size_min, chunk_size_max), chunk_size_max);
 }
-
-bool pi_camera_net_send_packet(AL::Network::TcpSocket& socket, AL::uint8 opcode, AL::uint8 error_code, const void* buffer, AL::uint32 size)
+// chunks are sized to take PI_CAMERA_FILE_CHUNK_TIME_MS on the wire so slow links still report progress and fast links aren't held up by acks
+void       pi_camera_transfer_tuning_update(pi_camera_transfer_tuning& tuning, AL::uint32 chunk_size_max, AL::uint64 rtt_us, AL::uint64 bytes_per_second)
 {
-	pi_camera_packet_header packet_header =
-	{
-		.opcode      = AL::BitConverter::HostToNetwork(opcode),
-		.error_code  = AL::BitConverter::HostToNetwork(error_code),
-		.buffer_size = AL::BitConverter::HostToNetwork(size)
-	};
+	tuning.rtt_us = (tuning.rtt_us == 0) ? rtt_us : (((tuning.rtt_us * 3) + rtt_us) / 4);
+
+	// a slower link is taken at once so a stalled link stops sending large chunks, a faster one is smoothed
+	if ((tuning.bytes_per_second == 0) || (bytes_per_second < tuning.bytes_per_second))
+		tuning.bytes_per_second = bytes_per_second;
+	else
+		tuning.bytes_per_second = ((tuning.bytes_per_second * 3) + bytes_per_second) / 4;
 
-	return pi_camera_net_socket_send(socket, &packet_header, sizeof(pi_camera_packet_header)) && ((size == 0) || (error_code != PI_CAMERA_ERROR_CODE_SUCCESS) || pi_camera_net_socket_send(socket, buffer, size));
+	// grows by at most double per sample so the link is probed before a chunk can take longer than intended
+	tuning.chunk_size = static_cast<AL::uint32>(AL::Math::Lowest<AL::uint64>((tuning.bytes_per_second * PI_CAMERA_FILE_CHUNK_TIME_MS) / 1000, static_cast<AL::uint64>(pi_camera_transfer_tuning_get_chunk_size(tuning, chunk_size_max)) * 2));
+	tuning.chunk_size = pi_camera_transfer_tuning_get_chunk_size(tuning, chunk_size_max);
+
+	// enough chunks in flight to cover the bandwidth delay product plus the one waiting on its ack
+	tuning.window_size = static_cast<AL::uint8>(AL::Math::Clamp<AL::uint64>((((tuning.bytes_per_second * tuning.rtt_us) / 1000000) / tuning.chunk_size) + 2, 1, PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX));
 }
-// @return 0 on error
-// @return -1 if would block
-int  pi_camera_net_receive_packet(AL::Network::TcpSocket& socket, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer, bool block_once = true)
+
+struct pi_camera_file_transfer_window
 {
-	switch (pi_camera_net_socket_receive_all(socket, &header, sizeof(pi_camera_packet_header), block_once))
-	{
-		case 0:  return 0;
-		case -1: return -1;
-	}
+	// end offset and send time of every chunk not acked yet, oldest first
+	AL::uint64 chunk_ends[PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX];
+	AL::uint64 chunk_send_times_us[PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX];
+	AL::uint8  chunk_index           = 0;
+	AL::uint8  chunk_count           = 0;
 
-	header.opcode      = AL::BitConverter::NetworkToHost(header.opcode);
-	header.error_code  = AL::BitConverter::NetworkToHost(header.error_code);
-	header.buffer_size = AL::BitConverter::NetworkToHost(header.buffer_size);
+	AL::uint64 ack_time_us           = 0;
+	AL::uint64 number_of_bytes_acked = 0;
+};
 
-	if (header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+struct pi_camera_connection
+{
+	AL::Network::TcpSocket    socket;
+	AL::uint8                 protocol_version = PI_CAMERA_PROTOCOL_VERSION_1;
+	// client: id of the last request sent
+	// service: id of the request being handled
+	AL::uint32                request_id = 0;
+	// client: id of the last file transfer that didn't complete, 0 if none or it can't be resumed
+	AL::uint64                transfer_id = 0;
+	// negotiated by hello
+	pi_camera_capabilities    capabilities = pi_camera_capabilities_from_protocol_version(PI_CAMERA_PROTOCOL_VERSION_1);
+	// service: carried over from one file transfer to the next
+	pi_camera_transfer_tuning transfer_tuning;
+
+	bool                      is_pipelining = false;
+	AL::uint8                 pipeline_error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_request_id_list pipeline_requests;
+
+	// packets claiming a larger payload close the connection, sessions hold it to PI_CAMERA_SERVICE_REQUEST_SIZE_MAX
+	AL::uint32                receive_size_max = AL::Integer<AL::uint32>::Maximum;
+	// reused by every reply or request received so it only allocates when a packet is larger than any before it
+	pi_camera_packet_buffer   packet_buffer;
+	// compressed payloads on their way out and in
+	pi_camera_packet_buffer   compression_send_buffer;
+	pi_camera_packet_buffer   compression_receive_buffer;
+
+	explicit pi_camera_connection(AL::Network::AddressFamilies address_family)
+		: socket(address_family)
 	{
-		buffer.SetCapacity(header.buffer_size);
-
-		if (pi_camera_net_socket_receive_all(socket, &buffer[0], header.buffer_size, false) == 0)
-			return 0;
 	}
 
-	return 1;
-}
+	explicit pi_camera_connection(AL::Network::TcpSocket&& socket)
+		: socket(AL::Move(socket))
+	{
+	}
+};
 
-auto pi_camera_config_to_packet_buffer(const pi_camera_config& value)
-{
-	pi_camera_packet_buffer packet_buffer(sizeof(pi_camera_config));
-	auto                    camera_config = reinterpret_cast<pi_camera_config*>(&packet_buffer[0]);
-	camera_config->ev                = AL::BitConverter::HostToNetwork(value.ev);
-	camera_config->iso               = AL::BitConverter::HostToNetwork(value.iso);
-	camera_config->contrast          = AL::BitConverter::HostToNetwork(value.contrast);
-	camera_config->sharpness         = AL::BitConverter::HostToNetwork(value.sharpness);
-	camera_config->brightness        = AL::BitConverter::HostToNetwork(value.brightness);
-	camera_config->saturation        = AL::BitConverter::HostToNetwork(value.saturation);
-	camera_config->white_balance     = AL::BitConverter::HostToNetwork(value.white_balance);
-	camera_config->shutter_speed_us  = AL::BitConverter::HostToNetwork(value.shutter_speed_us);
-	camera_config->exposure_mode     = AL::BitConverter::HostToNetwork(value.exposure_mode);
-	camera_config->metoring_mode     = AL::BitConverter::HostToNetwork(value.metoring_mode);
-	camera_config->jpg_quality       = AL::BitConverter::HostToNetwork(value.jpg_quality);
-	camera_config->image_effect      = AL::BitConverter::HostToNetwork(value.image_effect);
-	camera_config->image_rotation    = AL::BitConverter::HostToNetwork(value.image_rotation);
-	camera_config->image_size_width  = AL::BitConverter::HostToNetwork(value.image_size_width);
-	camera_config->image_size_height = AL::BitConverter::HostToNetwork(value.image_size_height);
-	camera_config->video_bit_rate    = AL::BitConverter::HostToNetwork(value.video_bit_rate);
-	camera_config->video_frame_rate  = AL::BitConverter::HostToNetwork(value.video_frame_rate);
+typedef bool(*pi_camera_service_packet_handler)(struct pi_camera_service* camera_service, struct pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size);
 
-	return packet_buffer;
-}
-auto pi_camera_config_from_packet_buffer(const void* buffer, AL::size_t size)
+struct pi_camera_service_packet_handler_context
 {
-	pi_camera_config camera_config;
-	auto             camera_config_src = reinterpret_cast<const pi_camera_config*>(buffer);
+	AL::uint8                        opcode;
+	pi_camera_service_packet_handler packet_handler;
+	// run on the worker pool so the service thread keeps answering other sessions
+	bool                             is_long_running;
+};
 
-	camera_config.ev                = AL::BitConverter::NetworkToHost(camera_config_src->ev);
-	camera_config.iso               = AL::BitConverter::NetworkToHost(camera_config_src->iso);
-	camera_config.contrast          = AL::BitConverter::NetworkToHost(camera_config_src->contrast);
-	camera_config.sharpness         = AL::BitConverter::NetworkToHost(camera_config_src->sharpness);
-	camera_config.brightness        = AL::BitConverter::NetworkToHost(camera_config_src->brightness);
-	camera_config.saturation        = AL::BitConverter::NetworkToHost(camera_config_src->saturation);
-	camera_config.white_balance     = AL::BitConverter::NetworkToHost(camera_config_src->white_balance);
-	camera_config.shutter_speed_us  = AL::BitConverter::NetworkToHost(camera_config_src->shutter_speed_us);
-	camera_config.exposure_mode     = AL::BitConverter::NetworkToHost(camera_config_src->exposure_mode);
-	camera_config.metoring_mode     = AL::BitConverter::NetworkToHost(camera_config_src->metoring_mode);
-	camera_config.jpg_quality       = AL::BitConverter::NetworkToHost(camera_config_src->jpg_quality);
-	camera_config.image_effect      = AL::BitConverter::NetworkToHost(camera_config_src->image_effect);
-	camera_config.image_rotation    = AL::BitConverter::NetworkToHost(camera_config_src->image_rotation);
-	camera_config.image_size_width  = AL::BitConverter::NetworkToHost(camera_config_src->image_size_width);
-	camera_config.image_size_height = AL::BitConverter::NetworkToHost(camera_config_src->image_size_height);
-	camera_config.video_bit_rate    = AL::BitConverter::NetworkToHost(camera_config_src->video_bit_rate);
-	camera_config.video_frame_rate  = AL::BitConverter::NetworkToHost(camera_config_src->video_frame_rate);
+typedef AL::uint8(*pi_camera_cli_on_output)(const void* buffer, AL::size_t size, void* param);
+typedef AL::uint8(*pi_camera_cli_on_burst_frame)(AL::uint32 frame_index, const char* frame_path, void* param);
+typedef AL::uint8(*pi_camera_cli_on_capture)(const pi_camera_capture_info& capture, const char* file_path, void* param);
 
-	return camera_config;
-}
+typedef void(*pi_camera_worker_pool_job)(void* param);
 
-AL::uint8 pi_camera_net_begin_is_busy(AL::Network::TcpSocket& socket, bool& value)
+struct pi_camera_worker_pool_job_context
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_IS_BUSY, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	pi_camera_worker_pool_job job;
+	void*                     param;
+};
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+typedef AL::Collections::LinkedList<AL::OS::Thread*>                  pi_camera_worker_pool_thread_list;
+typedef AL::Collections::LinkedList<pi_camera_worker_pool_job_context> pi_camera_worker_pool_job_list;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+struct pi_camera_worker_pool
+{
+	bool                              is_stopping = false;
 
-	value = static_cast<bool>(packet_buffer[0]);
+	AL::OS::Mutex                     mutex;
+	AL::OS::ConditionalVariable       condition;
+	pi_camera_worker_pool_job_list    jobs;
+	pi_camera_worker_pool_thread_list threads;
+};
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_is_busy(AL::Network::TcpSocket& socket, AL::uint8 error_code, bool value)
+struct pi_camera
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_IS_BUSY, error_code, nullptr, 0);
+	AL::uint8        type;
+	// pending pi_camera_capture_async/pi_camera_capture_video_async
+	pi_camera_async* async = nullptr;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_IS_BUSY, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(bool));
-}
+	explicit pi_camera(AL::uint8 type)
+		: type(type)
+	{
+	}
+};
 
-AL::uint8 pi_camera_net_begin_get_ev(AL::Network::TcpSocket& socket, AL::int8& value)
+#if defined(AL_PLATFORM_LINUX)
+struct pi_camera_process
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EV, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return 0;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	pid_t pid    = -1;
+	int   output = -1;
+};
+#endif
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+struct pi_camera_local
+	: public pi_camera
+{
+	bool             is_busy = false;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	AL::OS::Mutex    mutex;
+	pi_camera_config config;
+	AL::String       cli_params;
+	AL::String       cli_params_video;
 
-	value = static_cast<AL::int8>(packet_buffer[0]);
+#if defined(AL_PLATFORM_LINUX)
+	// raspistill kept running in signal mode, only touched while is_busy is held
+	pi_camera_process still_worker;
+	AL::String        still_worker_cli_params;
+	AL::String        still_worker_directory;
+	int               still_worker_watch = -1;
+	// set once raspistill is known to keep a trigger pending until it sigwaits
+	bool              still_worker_is_ready = false;
+
+	// start/stop/lookups, the recording thread never takes it
+	AL::OS::Mutex               recording_mutex;
+	// kept once stopped so its segments can still be fetched
+	struct pi_camera_recording* recording = nullptr;
+
+	// held by captures until they complete
+	AL::OS::Mutex               pre_roll_mutex;
+	struct pi_camera_pre_roll*  pre_roll  = nullptr;
+
+	// opened on first use, kept until the camera is closed
+	AL::OS::Mutex               store_mutex;
+	struct pi_camera_store*     store     = nullptr;
+	// the budget the store is opened with, guarded by store_mutex
+	AL::uint64                  store_size_max          = PI_CAMERA_STORE_SIZE_DEFAULT;
+	AL::uint32                  store_capture_count_max = PI_CAMERA_STORE_CAPTURE_COUNT_DEFAULT;
+
+	// start/stop, the timelapse thread never takes it
+	AL::OS::Mutex               timelapse_mutex;
+	struct pi_camera_timelapse* timelapse = nullptr;
+#endif
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_ev(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EV, error_code, nullptr, 0);
+	pi_camera_local()
+		: pi_camera(PI_CAMERA_TYPE_LOCAL),
+		config(PI_CAMERA_CONFIG_DEFAULT)
+	{
+	}
+};
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EV, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
-}
-AL::uint8 pi_camera_net_begin_set_ev(AL::Network::TcpSocket& socket, AL::int8 value)
+struct pi_camera_remote
+	: public pi_camera
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_EV, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	pi_camera_connection    connection;
+	AL::Network::IPEndPoint remote_end_point;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	explicit pi_camera_remote(AL::Network::IPEndPoint&& remote_end_point)
+		: pi_camera(PI_CAMERA_TYPE_REMOTE),
+		connection(remote_end_point.Host.GetFamily()),
+		remote_end_point(AL::Move(remote_end_point))
+	{
+	}
+};
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+struct pi_camera_service;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_ev(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+struct pi_camera_preview_frame
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_EV, error_code, nullptr, 0);
-}
+	AL::uint32              reference_count = 1;
+	pi_camera_packet_buffer buffer;
+};
+
+#if defined(AL_PLATFORM_LINUX)
+// What the encoder thread still has to send a subscribed session, guarded by the preview mutex
+struct pi_camera_session_preview
+{
+	bool                     is_streaming         = false;
+	// the client asked to stop or the encoder exited, the final reply follows the packet being sent
+	bool                     is_ending            = false;
+	bool                     is_end_sent          = false;
+	AL::uint8                end_error_code       = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	// the packet being sent, frame is nullptr for the final reply
+	bool                     is_sending           = false;
+	pi_camera_preview_frame* frame                = nullptr;
+	pi_camera_packet_header  packet_header;
+	AL::size_t               number_of_bytes_sent = 0;
+	// latest frame published while the previous one was still being sent, replaced by newer ones
+	pi_camera_preview_frame* next_frame           = nullptr;
+};
+#endif
 
-AL::uint8 pi_camera_net_begin_get_iso(AL::Network::TcpSocket& socket, AL::uint16& value)
+struct pi_camera_session
+	: public pi_camera
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_ISO, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	bool                      is_job_pending = false;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	pi_camera_connection      connection;
+	pi_camera_service*        service;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_session_preview preview;
+#endif
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	explicit pi_camera_session(pi_camera_service* service, AL::Network::TcpSocket&& socket)
+		: pi_camera(PI_CAMERA_TYPE_SESSION),
+		connection(AL::Move(socket)),
+		service(service)
+	{
+	}
+};
 
-	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
+typedef AL::Collections::LinkedList<pi_camera_session*> pi_camera_session_list;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_iso(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 value)
+struct pi_camera_service_job
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_ISO, error_code, nullptr, 0);
+	pi_camera_service*               service;
+	pi_camera_session*               session;
+	pi_camera_service_packet_handler packet_handler;
+	pi_camera_packet_header          packet_header;
+	pi_camera_packet_buffer          packet_buffer;
+	bool                             result;
+};
 
-	value = AL::BitConverter::HostToNetwork(value);
+typedef AL::Collections::LinkedList<pi_camera_service_job*> pi_camera_service_job_list;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_ISO, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint16));
-}
-AL::uint8 pi_camera_net_begin_set_iso(AL::Network::TcpSocket& socket, AL::uint16 value)
+struct pi_camera_service_transfer
 {
-	value = AL::BitConverter::HostToNetwork(value);
+	AL::uint64 id;
+	AL::String file_path;
+	// 0 unless owned, only owned files count against PI_CAMERA_FILE_TRANSFER_RETAIN_SIZE_MAX
+	AL::uint64 file_size;
+	// deleted once sent or expired
+	bool       is_owned;
+	AL::uint64 expire_time_ms;
+};
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_ISO, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint16)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+typedef AL::Collections::LinkedList<pi_camera_service_transfer*> pi_camera_service_transfer_list;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+struct pi_camera_capture_cache_entry
+{
+	AL::uint32 reference_count = 1;
+	// in the store, or a file of its own when it couldn't be stored
+	AL::String file_path;
+	// deleted with the last reference
+	bool       is_owned = false;
+};
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+struct pi_camera_capture_cache
+{
+	bool                           is_capturing = false;
+	// incremented each time a capture completes
+	AL::uint64                     generation   = 0;
+	AL::uint32                     window_ms    = PI_CAMERA_CAPTURE_CACHE_WINDOW_MS;
+	// waiting on the capture in flight, with a window of 0 the result is released once the last one has it
+	AL::size_t                     joiner_count = 0;
+
+	AL::OS::Mutex                  mutex;
+	AL::OS::ConditionalVariable    condition;
+	AL::OS::Timer                  timer;
+	// config of the capture in flight or of result
+	pi_camera_config               config;
+	AL::uint8                      error_code   = PI_CAMERA_ERROR_CODE_SUCCESS;
+	AL::uint64                     timestamp_ms = 0;
+	pi_camera_capture_cache_entry* result       = nullptr;
+};
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+struct pi_camera_preview_stream
+{
+	bool                        is_running       = false;
+	// set when the last subscriber leaves, the encoder exits on its next frame
+	bool                        is_stopping      = false;
+	// set once the encoder has seen is_stopping, new subscribers wait for it to exit
+	bool                        is_stopped       = false;
+	bool                        is_closing       = false;
+	// incremented each time a frame is published
+	AL::uint64                  generation       = 0;
+	AL::size_t                  subscriber_count = 0;
+
+	AL::OS::Mutex               mutex;
+	AL::OS::ConditionalVariable condition;
+	AL::OS::Thread*             thread           = nullptr;
+	AL::uint8                   error_code       = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_preview_frame*    frame            = nullptr;
+	// sessions the encoder thread fans frames out to
+	pi_camera_session_list      sessions;
+};
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_iso(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 value)
+struct pi_camera_service
+	: public pi_camera
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_ISO, error_code, nullptr, 0);
-}
+	bool                    is_thread_stopping = false;
 
-AL::uint8 pi_camera_net_begin_get_config(AL::Network::TcpSocket& socket, pi_camera_config& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONFIG, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	pi_camera_local         local;
+	AL::Network::TcpSocket  socket;
+	AL::OS::Thread          thread;
+	pi_camera_session_list  sessions;
+	// images are named after the time they were captured
+	AL::uint64              image_timestamp_ms = 0;
+	AL::uint64              video_counter      = 0;
+	AL::size_t              max_connections;
+	AL::Network::IPEndPoint local_end_point;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	AL::size_t                 worker_count;
+	pi_camera_worker_pool      worker_pool;
+	AL::OS::Mutex              jobs_completed_mutex;
+	pi_camera_service_job_list jobs_completed;
+	// posted and not yet collected, only touched by the service thread
+	AL::size_t                 job_count = 0;
+	AL::OS::Mutex              video_stream_mutex;
+	// PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM handlers holding a worker
+	AL::size_t                 video_stream_count = 0;
+
+	AL::OS::Mutex              transfer_stats_mutex;
+	pi_camera_transfer_stats   transfer_stats = {};
+	// copied to the tuning of each new session, guarded by transfer_stats_mutex
+	AL::uint32                 file_chunk_size_min = PI_CAMERA_FILE_CHUNK_SIZE_MIN;
+	AL::uint32                 file_chunk_size_max = PI_CAMERA_FILE_CHUNK_SIZE_MAX;
+
+	AL::OS::Mutex                   transfers_mutex;
+	// transfers cut short by a lost connection, kept until resumed or expired
+	pi_camera_service_transfer_list transfers;
+	// owned files kept for transfers, held to PI_CAMERA_FILE_TRANSFER_RETAIN_SIZE_MAX
+	AL::uint64                      transfers_size = 0;
+	AL::uint64                      transfer_id    = 0;
+
+	pi_camera_capture_cache    capture_cache;
+	pi_camera_preview_stream   preview;
+
+#if defined(AL_PLATFORM_LINUX)
+	int                     epoll = -1;
+	int                     epoll_wake = -1;
+	bool                    is_accepting = true;
+#endif
+
+	pi_camera_service(AL::Network::IPEndPoint&& local_end_point, AL::size_t max_connections, AL::size_t worker_count)
+		: pi_camera(PI_CAMERA_TYPE_SERVICE),
+		socket(local_end_point.Host.GetFamily()),
+		max_connections(max_connections),
+		local_end_point(AL::Move(local_end_point)),
+		worker_count(worker_count)
+	{
+	}
+};
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+typedef AL::FileSystem::File pi_camera_file;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+enum PI_CAMERA_ASYNC_STATES : AL::uint8
+{
+	PI_CAMERA_ASYNC_STATE_WAIT_FILE_SIZE,
+	PI_CAMERA_ASYNC_STATE_RECEIVE,
+	// drains the chunks still in flight after a write error
+	PI_CAMERA_ASYNC_STATE_CANCEL,
+	PI_CAMERA_ASYNC_STATE_COMPLETE
+};
 
-	value = pi_camera_config_from_packet_buffer(&packet_buffer[0], packet_buffer.GetSize());
+struct pi_camera_async
+{
+	AL::uint8                             state      = PI_CAMERA_ASYNC_STATE_WAIT_FILE_SIZE;
+	AL::uint8                             error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	pi_camera*                            camera;
+	bool                                  is_video;
+	AL::String                            file_path;
+	AL::uint32                            video_length_seconds;
+	pi_camera_capture_on_progress_changed on_progress_changed;
+	pi_camera_capture_on_complete         on_complete;
+	void*                                 param;
+
+	// remote cameras receive the file without blocking from pi_camera_poll
+	pi_camera_file*                       file                      = nullptr;
+	AL::uint64                            file_size                 = 0;
+	AL::uint64                            number_of_bytes_received  = 0;
+	AL::uint64                            number_of_chunks_received = 0;
+	// set from the transfer header, 1 if the service waits for every chunk to be acked
+	AL::uint8                             window_size               = 1;
+	// a packet is taken across polls as it arrives, a chunk can be up to PI_CAMERA_FILE_CHUNK_SIZE_MAX bytes
+	pi_camera_packet_header               packet_header;
+	pi_camera_packet_buffer               packet_buffer;
+	AL::size_t                            number_of_packet_bytes_received = 0;
+
+	// other cameras run the blocking capture on thread
+	AL::OS::Thread*                       thread = nullptr;
+	AL::OS::Mutex                         thread_mutex;
+	AL::OS::ConditionalVariable           thread_condition;
+	bool                                  is_thread_done = false;
+	AL::uint8                             thread_error_code;
+};
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_config(AL::Network::TcpSocket& socket, AL::uint8 error_code, const pi_camera_config& value)
+struct pi_camera_error_string
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONFIG, error_code, nullptr, 0);
+	AL::uint8   code;
+	const char* string;
+};
 
-	auto packet_buffer = pi_camera_config_to_packet_buffer(value);
+bool            pi_camera_file_get_size(const char* path, AL::uint64& value)
+{
+	try
+	{
+		value = AL::FileSystem::File::GetSize(path);
+	}
+	catch (const AL::Exception& exception)
+	{
+
+		return false;
+	}
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONFIG, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize()));
+	return true;
 }
-AL::uint8 pi_camera_net_begin_set_config(AL::Network::TcpSocket& socket, const pi_camera_config& value)
+// @param append write after the existing content instead of truncating
+pi_camera_file* pi_camera_file_open(const char* path, bool read, bool write, bool append = false)
 {
-	auto packet_buffer = pi_camera_config_to_packet_buffer(value);
+	AL::BitMask<AL::FileSystem::FileOpenModes> mode;
+	mode.Add(AL::FileSystem::FileOpenModes::Binary);
+	mode.Set(AL::FileSystem::FileOpenModes::Read,     read);
+	mode.Set(AL::FileSystem::FileOpenModes::Write,    write);
+	mode.Set(AL::FileSystem::FileOpenModes::Append,   write && append);
+	mode.Set(AL::FileSystem::FileOpenModes::Truncate, !read && write && !append);
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_CONFIG, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize())))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	auto file = new pi_camera_file(
+		AL::FileSystem::Path(path)
+	);
 
-	pi_camera_packet_header packet_header;
+	try
+	{
+		if (!file->Open(mode.Value))
+		{
+			delete file;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			return nullptr;
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+		delete file;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		return nullptr;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_config(AL::Network::TcpSocket& socket, AL::uint8 error_code, const pi_camera_config& value)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_CONFIG, error_code, nullptr, 0);
+	return file;
 }
-
-AL::uint8 pi_camera_net_begin_get_contrast(AL::Network::TcpSocket& socket, AL::int8& value)
+bool            pi_camera_file_read(pi_camera_file* file, void* buffer, AL::uint64 size)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONTRAST, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
-
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	try
+	{
+		for (AL::uint64 bytes_read, total_bytes_read = 0; total_bytes_read < size; total_bytes_read += bytes_read)
+			bytes_read = file->Read(&reinterpret_cast<AL::uint8*>(buffer)[total_bytes_read], static_cast<AL::size_t>(AL::Math::Clamp<AL::uint64>(size - total_bytes_read, 0, AL::Integer<AL::size_t>::Maximum)));
+	}
+	catch (const AL::Exception& exception)
+	{
 
-	value = static_cast<AL::int8>(packet_buffer[0]);
+		return false;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
-bool      pi_camera_net_complete_get_contrast(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+#if defined(AL_PLATFORM_LINUX)
+// reads size bytes at offset without moving the file position
+bool            pi_camera_file_read_at(int file_handle, void* buffer, AL::size_t size, AL::uint64 offset)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONTRAST, error_code, nullptr, 0);
+	for (AL::size_t total_bytes_read = 0; total_bytes_read < size; )
+	{
+		auto bytes_read = ::pread(file_handle, &reinterpret_cast<AL::uint8*>(buffer)[total_bytes_read], size - total_bytes_read, static_cast<off_t>(offset + total_bytes_read));
+
+		if (bytes_read > 0)
+			total_bytes_read += static_cast<AL::size_t>(bytes_read);
+		else if ((bytes_read == 0) || (errno != EINTR))
+			return false;
+	}
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_CONTRAST, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
+	return true;
 }
-AL::uint8 pi_camera_net_begin_set_contrast(AL::Network::TcpSocket& socket, AL::int8 value)
+#else
+// reads and discards size bytes
+bool            pi_camera_file_skip(pi_camera_file* file, AL::uint64 size)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_CONTRAST, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::uint8 buffer[PI_CAMERA_STREAM_CHUNK_SIZE];
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	for (AL::uint64 chunk_size; size != 0; size -= chunk_size)
+		if (!pi_camera_file_read(file, buffer, chunk_size = AL::Math::Lowest<AL::uint64>(size, sizeof(buffer))))
+			return false;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	return true;
+}
+#endif
+bool            pi_camera_file_append(pi_camera_file* file, const void* buffer, AL::uint64 size)
+{
+	try
+	{
+		for (AL::uint64 bytes_written, total_bytes_written = 0; total_bytes_written < size; total_bytes_written += bytes_written)
+			bytes_written = file->Write(&reinterpret_cast<const AL::uint8*>(buffer)[total_bytes_written], static_cast<AL::size_t>(AL::Math::Clamp<AL::uint64>(size - total_bytes_written, 0, AL::Integer<AL::size_t>::Maximum)));
+	}
+	catch (const AL::Exception& exception)
+	{
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		return false;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
-bool      pi_camera_net_complete_set_contrast(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+void            pi_camera_file_close(pi_camera_file* file)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_CONTRAST, error_code, nullptr, 0);
+	file->Close();
+	delete file;
 }
-
-AL::uint8 pi_camera_net_begin_get_sharpness(AL::Network::TcpSocket& socket, AL::int8& value)
+bool            pi_camera_file_delete(const char* path)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHARPNESS, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
-
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	try
+	{
+		AL::FileSystem::File::Delete(path);
+	}
+	catch (const AL::Exception& exception)
+	{
 
-	value = static_cast<AL::int8>(packet_buffer[0]);
+		return false;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
-bool      pi_camera_net_complete_get_sharpness(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+bool            pi_camera_file_read_all(const char* path, pi_camera_packet_buffer& buffer)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHARPNESS, error_code, nullptr, 0);
+	AL::uint64      file_size;
+	pi_camera_file* file;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHARPNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
-}
-AL::uint8 pi_camera_net_begin_set_sharpness(AL::Network::TcpSocket& socket, AL::int8 value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SHARPNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (!pi_camera_file_get_size(path, file_size) || ((file = pi_camera_file_open(path, true, false)) == nullptr))
+		return false;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	buffer.SetCapacity(file_size);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	bool result = pi_camera_file_read(file, &buffer[0], file_size);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	pi_camera_file_close(file);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return result;
 }
-bool      pi_camera_net_complete_set_sharpness(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+// @param on_progress_changed can be nullptr
+// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if source_path doesn't exist
+AL::uint8       pi_camera_file_copy(const char* source_path, const char* target_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SHARPNESS, error_code, nullptr, 0);
-}
+	AL::uint64      file_size;
+	pi_camera_file* source;
+	pi_camera_file* target;
 
-AL::uint8 pi_camera_net_begin_get_brightness(AL::Network::TcpSocket& socket, AL::uint8& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_BRIGHTNESS, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (!pi_camera_file_get_size(source_path, file_size))
+		return PI_CAMERA_ERROR_CODE_NOT_FOUND;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if ((source = pi_camera_file_open(source_path, true, false)) == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if ((target = pi_camera_file_open(target_path, false, true)) == nullptr)
+	{
+		pi_camera_file_close(source);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+	}
 
-	value = packet_buffer[0];
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_packet_buffer buffer(PI_CAMERA_FILE_CHUNK_SIZE);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_brightness(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_BRIGHTNESS, error_code, nullptr, 0);
+	for (AL::uint64 number_of_bytes_copied = 0; number_of_bytes_copied < file_size; )
+	{
+		auto chunk_size = AL::Math::Clamp<AL::uint64>(file_size - number_of_bytes_copied, 0, buffer.GetSize());
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_BRIGHTNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
-}
-AL::uint8 pi_camera_net_begin_set_brightness(AL::Network::TcpSocket& socket, AL::uint8 value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_BRIGHTNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		if (!pi_camera_file_read(source, &buffer[0], chunk_size))
+		{
+			error_code = PI_CAMERA_ERROR_CODE_FILE_READ_ERROR;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+			break;
+		}
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		if (!pi_camera_file_append(target, &buffer[0], chunk_size))
+		{
+			error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+			break;
+		}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_brightness(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_BRIGHTNESS, error_code, nullptr, 0);
-}
+		number_of_bytes_copied += chunk_size;
 
-AL::uint8 pi_camera_net_begin_get_saturation(AL::Network::TcpSocket& socket, AL::int8& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SATURATION, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		if (on_progress_changed != nullptr)
+			on_progress_changed(file_size, number_of_bytes_copied, param);
+	}
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	pi_camera_file_close(target);
+	pi_camera_file_close(source);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_file_delete(target_path);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	return error_code;
+}
 
-	value = static_cast<AL::int8>(packet_buffer[0]);
+// @return user and system time spent by the calling thread
+AL::uint64 pi_camera_get_thread_cpu_time_us()
+{
+#if defined(AL_PLATFORM_LINUX)
+	rusage usage;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	if (::getrusage(RUSAGE_THREAD, &usage) == -1)
+		return 0;
+
+	return (static_cast<AL::uint64>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000) + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+	return 0;
+#endif
 }
-bool      pi_camera_net_complete_get_saturation(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+// @return milliseconds since the unix epoch
+AL::uint64 pi_camera_get_time_ms()
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SATURATION, error_code, nullptr, 0);
+#if defined(AL_PLATFORM_LINUX)
+	timespec value;
+	::clock_gettime(CLOCK_REALTIME, &value);
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SATURATION, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
+	return (static_cast<AL::uint64>(value.tv_sec) * 1000) + (static_cast<AL::uint64>(value.tv_nsec) / 1000000);
+#else
+	return 0;
+#endif
 }
-AL::uint8 pi_camera_net_begin_set_saturation(AL::Network::TcpSocket& socket, AL::int8& value)
+// @return the current time, or the millisecond after previous_time_ms if the clock hasn't moved past it
+AL::uint64 pi_camera_get_next_time_ms(AL::uint64 previous_time_ms)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SATURATION, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	auto time_ms = pi_camera_get_time_ms();
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	return (time_ms > previous_time_ms) ? time_ms : (previous_time_ms + 1);
+}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+#if defined(PI_CAMERA_ZERO_COPY)
+// sendfile has no MSG_NOSIGNAL so a client disconnecting mid transfer would raise SIGPIPE
+// it is blocked on the threads that send instead of ignored for the whole process
+void pi_camera_thread_block_sigpipe()
+{
+	sigset_t signals;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	::sigemptyset(&signals);
+	::sigaddset(&signals, SIGPIPE);
+	::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
 }
-bool      pi_camera_net_complete_set_saturation(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::int8 value)
+#endif
+
+AL::String pi_camera_store_get_file_path(const char* directory, AL::uint64 timestamp_ms)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SATURATION, error_code, nullptr, 0);
+	return AL::String::Format("%s/capture_%llu.jpg", directory, timestamp_ms);
 }
 
-AL::uint8 pi_camera_net_begin_get_white_balance(AL::Network::TcpSocket& socket, AL::uint8& value)
+#if defined(AL_PLATFORM_LINUX)
+enum PI_CAMERA_STORE_RECORD_FLAGS : AL::uint32
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	PI_CAMERA_STORE_RECORD_FLAG_DELETED = 0x1
+};
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+struct pi_camera_store_record
+{
+	AL::uint64 timestamp_ms;
+	AL::uint64 size;
+	AL::uint32 config_hash;
+	AL::uint32 flags;
+};
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+struct pi_camera_store
+{
+	AL::OS::Mutex           mutex;
+	AL::String              directory;
+	int                     index           = -1;
+	// index mapped in place, sorted by timestamp_ms since records are only appended or flagged
+	pi_camera_store_record* records         = nullptr;
+	AL::size_t              record_count    = 0;
+	AL::size_t              record_capacity = 0;
+	// records before it are all flagged as deleted
+	AL::size_t              oldest_record   = 0;
+	// captures not flagged as deleted, held to size_max and capture_count_max unless they are 0
+	AL::uint64              capture_size    = 0;
+	AL::size_t              capture_count   = 0;
+	AL::uint64              size_max;
+	AL::size_t              capture_count_max;
+};
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+// Maps room for record_capacity records, the file only grows as records are appended
+bool             pi_camera_store_map(pi_camera_store* store, AL::size_t record_capacity)
+{
+	auto records = ::mmap(nullptr, record_capacity * sizeof(pi_camera_store_record), PROT_READ | PROT_WRITE, MAP_SHARED, store->index, 0);
 
-	value = packet_buffer[0];
+	if (records == MAP_FAILED)
+		return false;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	if (store->records != nullptr)
+		::munmap(store->records, store->record_capacity * sizeof(pi_camera_store_record));
+
+	store->records         = reinterpret_cast<pi_camera_store_record*>(records);
+	store->record_capacity = record_capacity;
+
+	return true;
 }
-bool      pi_camera_net_complete_get_white_balance(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+void             pi_camera_store_close(pi_camera_store* store)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, error_code, nullptr, 0);
+	if (store->records != nullptr)
+		::munmap(store->records, store->record_capacity * sizeof(pi_camera_store_record));
+
+	if (store->index != -1)
+		::close(store->index);
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+	delete store;
 }
-AL::uint8 pi_camera_net_begin_set_white_balance(AL::Network::TcpSocket& socket, AL::uint8 value)
+// The index is trusted as is, captures aren't looked for on disk
+// @return nullptr if the directory or its index could not be opened
+pi_camera_store* pi_camera_store_open(const char* directory, AL::uint64 size_max, AL::size_t capture_count_max)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_WHITE_BALANCE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if ((::mkdir(directory, 0755) == -1) && (errno != EEXIST))
+		return nullptr;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	auto store = new pi_camera_store();
+	store->directory         = directory;
+	store->size_max          = size_max;
+	store->capture_count_max = capture_count_max;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	struct stat index_stat;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	if (((store->index = ::open(AL::String::Format("%s/index", directory).GetCString(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1) || (::fstat(store->index, &index_stat) == -1))
+	{
+		pi_camera_store_close(store);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_white_balance(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_WHITE_BALANCE, error_code, nullptr, 0);
-}
+		return nullptr;
+	}
 
-AL::uint8 pi_camera_net_begin_get_shutter_speed(AL::Network::TcpSocket& socket, AL::uint64& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	store->record_count = static_cast<AL::size_t>(index_stat.st_size) / sizeof(pi_camera_store_record);
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	// drop a record cut short by a crash, the next one overwrites it
+	if (((static_cast<AL::size_t>(index_stat.st_size) % sizeof(pi_camera_store_record)) != 0) && (::ftruncate(store->index, store->record_count * sizeof(pi_camera_store_record)) == -1))
+	{
+		pi_camera_store_close(store);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		return nullptr;
+	}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	if (!pi_camera_store_map(store, store->record_count + PI_CAMERA_STORE_INDEX_MAP_GROWTH))
+	{
+		pi_camera_store_close(store);
 
-	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+		return nullptr;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_shutter_speed(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint64 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, error_code, nullptr, 0);
+	for (AL::size_t i = 0; i < store->record_count; ++i)
+	{
+		if (store->records[i].flags & PI_CAMERA_STORE_RECORD_FLAG_DELETED)
+		{
+			if (store->oldest_record == i)
+				++store->oldest_record;
 
-	auto time = AL::BitConverter::HostToNetwork(value);
+			continue;
+		}
+
+		store->capture_size += store->records[i].size;
+		++store->capture_count;
+	}
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, PI_CAMERA_ERROR_CODE_SUCCESS, &time, sizeof(AL::uint64));
+	return store;
 }
-AL::uint8 pi_camera_net_begin_set_shutter_speed(AL::Network::TcpSocket& socket, AL::uint64 value)
+// Rewrites the index without the records flagged as deleted
+// Replaced with a rename so a power loss leaves either the old or the new index
+// @param mutex must be held
+bool             pi_camera_store_compact(pi_camera_store* store)
 {
-	value = AL::BitConverter::HostToNetwork(value);
+	auto index_path     = AL::String::Format("%s/index", store->directory.GetCString());
+	auto index_path_tmp = AL::String::Format("%s.tmp", index_path.GetCString());
+	auto index          = ::open(index_path_tmp.GetCString(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SHUTTER_SPEED, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint64)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (index == -1)
+		return false;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	bool       result       = true;
+	AL::size_t record_count = 0;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	for (auto i = store->oldest_record; i < store->record_count; ++i)
+	{
+		if (store->records[i].flags & PI_CAMERA_STORE_RECORD_FLAG_DELETED)
+			continue;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		if (!(result = (::pwrite(index, &store->records[i], sizeof(pi_camera_store_record), static_cast<off_t>(record_count * sizeof(pi_camera_store_record))) == static_cast<ssize_t>(sizeof(pi_camera_store_record)))))
+			break;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_shutter_speed(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint64 value)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_SHUTTER_SPEED, error_code, nullptr, 0);
-}
+		++record_count;
+	}
 
-AL::uint8 pi_camera_net_begin_get_exposure_mode(AL::Network::TcpSocket& socket, AL::uint8& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	auto record_capacity = record_count + PI_CAMERA_STORE_INDEX_MAP_GROWTH;
+	auto records         = result ? ::mmap(nullptr, record_capacity * sizeof(pi_camera_store_record), PROT_READ | PROT_WRITE, MAP_SHARED, index, 0) : MAP_FAILED;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if ((records == MAP_FAILED) || (::rename(index_path_tmp.GetCString(), index_path.GetCString()) == -1))
+	{
+		if (records != MAP_FAILED)
+			::munmap(records, record_capacity * sizeof(pi_camera_store_record));
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		::close(index);
+		::unlink(index_path_tmp.GetCString());
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		return false;
+	}
 
-	value = packet_buffer[0];
+	::munmap(store->records, store->record_capacity * sizeof(pi_camera_store_record));
+	::close(store->index);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_exposure_mode(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, error_code, nullptr, 0);
+	store->index           = index;
+	store->records         = reinterpret_cast<pi_camera_store_record*>(records);
+	store->record_count    = record_count;
+	store->record_capacity = record_capacity;
+	store->oldest_record   = 0;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+	return true;
 }
-AL::uint8 pi_camera_net_begin_set_exposure_mode(AL::Network::TcpSocket& socket, AL::uint8 value)
+// Deletes the oldest captures beyond the budget, the index is compacted once as many records are flagged as the budget holds
+// @param mutex must be held
+void             pi_camera_store_evict(pi_camera_store* store)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_EXPOSURE_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	// the newest capture is kept even if it alone exceeds the budget
+	while ((((store->size_max != 0) && (store->capture_size > store->size_max)) || ((store->capture_count_max != 0) && (store->capture_count > store->capture_count_max))) && (store->capture_count > 1))
+	{
+		auto& record = store->records[store->oldest_record++];
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+		if (record.flags & PI_CAMERA_STORE_RECORD_FLAG_DELETED)
+			continue;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		::unlink(pi_camera_store_get_file_path(store->directory.GetCString(), record.timestamp_ms).GetCString());
+		record.flags        |= PI_CAMERA_STORE_RECORD_FLAG_DELETED;
+		store->capture_size -= record.size;
+		--store->capture_count;
+	}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	// a store budgeted by size alone holds as many records as it has captures
+	auto compact_record_count = (store->capture_count_max != 0) ? store->capture_count_max : AL::Math::Clamp<AL::size_t>(store->capture_count, 1, AL::Integer<AL::size_t>::Maximum);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	if ((store->record_count - store->capture_count) >= compact_record_count)
+		pi_camera_store_compact(store);
 }
-bool      pi_camera_net_complete_set_exposure_mode(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+// @param mutex must be held
+// @return index of the first record captured at or after timestamp_ms
+AL::size_t       pi_camera_store_find(pi_camera_store* store, AL::uint64 timestamp_ms)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_EXPOSURE_MODE, error_code, nullptr, 0);
-}
+	AL::size_t first = 0;
+	AL::size_t last  = store->record_count;
 
-AL::uint8 pi_camera_net_begin_get_metoring_mode(AL::Network::TcpSocket& socket, AL::uint8& value)
+	while (first < last)
+	{
+		auto middle = first + ((last - first) / 2);
+
+		if (store->records[middle].timestamp_ms < timestamp_ms)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+// Moves file_path into the store, it is named after the current time so the index stays sorted
+// The oldest captures are deleted once the store exceeds its budget
+// @param store_path can be nullptr, set to where file_path was moved
+bool             pi_camera_store_add(pi_camera_store* store, const char* file_path, AL::uint32 config_hash, AL::String* store_path = nullptr)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_METORING_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	pi_camera_store_record record =
+	{
+		.timestamp_ms = 0,
+		.size         = 0,
+		.config_hash  = config_hash,
+		.flags        = 0
+	};
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if (!pi_camera_file_get_size(file_path, record.size))
+		return false;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::OS::MutexGuard lock(store->mutex);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	if ((store->record_count == store->record_capacity) && !pi_camera_store_map(store, store->record_capacity + PI_CAMERA_STORE_INDEX_MAP_GROWTH))
+		return false;
 
-	value = packet_buffer[0];
+	record.timestamp_ms = pi_camera_get_next_time_ms((store->record_count != 0) ? store->records[store->record_count - 1].timestamp_ms : 0);
+	auto record_path    = pi_camera_store_get_file_path(store->directory.GetCString(), record.timestamp_ms);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_metoring_mode(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_METORING_MODE, error_code, nullptr, 0);
+	if (::rename(file_path, record_path.GetCString()) == -1)
+		return false;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_METORING_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
-}
-AL::uint8 pi_camera_net_begin_set_metoring_mode(AL::Network::TcpSocket& socket, AL::uint8 value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_METORING_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (::pwrite(store->index, &record, sizeof(pi_camera_store_record), static_cast<off_t>(store->record_count * sizeof(pi_camera_store_record))) != static_cast<ssize_t>(sizeof(pi_camera_store_record)))
+	{
+		// a capture missing from the index could never be listed or fetched
+		::unlink(record_path.GetCString());
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+		return false;
+	}
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	++store->record_count;
+	store->capture_size += record.size;
+	++store->capture_count;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	pi_camera_store_evict(store);
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	if (store_path != nullptr)
+		*store_path = AL::Move(record_path);
+
+	return true;
 }
-bool      pi_camera_net_complete_set_metoring_mode(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+// @param count capacity of values, set to the number of captures found
+// @return false if more captures match than fit in values, values holds the first ones
+bool             pi_camera_store_list(pi_camera_store* store, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_capture_info* values, AL::uint32& count)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_METORING_MODE, error_code, nullptr, 0);
-}
+	AL::OS::MutexGuard lock(store->mutex);
 
-AL::uint8 pi_camera_net_begin_get_jpg_quality(AL::Network::TcpSocket& socket, AL::uint8& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_JPG_QUALITY, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::uint32 capture_count = 0;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	for (auto i = pi_camera_store_find(store, start_time_ms); (i < store->record_count) && (store->records[i].timestamp_ms <= end_time_ms); ++i)
+	{
+		auto& record = store->records[i];
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		if (record.flags & PI_CAMERA_STORE_RECORD_FLAG_DELETED)
+			continue;
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		if (capture_count < count)
+		{
+			values[capture_count].timestamp_ms = record.timestamp_ms;
+			values[capture_count].size         = record.size;
+			values[capture_count].config_hash  = record.config_hash;
+		}
 
-	value = packet_buffer[0];
+		++capture_count;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_jpg_quality(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_JPG_QUALITY, error_code, nullptr, 0);
+	bool result = capture_count <= count;
+	count       = capture_count;
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_JPG_QUALITY, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+	return result;
 }
-AL::uint8 pi_camera_net_begin_set_jpg_quality(AL::Network::TcpSocket& socket, AL::uint8 value)
+// Records stay in the index flagged as deleted until it is compacted
+// @return number of captures deleted
+AL::uint32       pi_camera_store_delete(pi_camera_store* store, AL::uint64 start_time_ms, AL::uint64 end_time_ms)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_JPG_QUALITY, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::OS::MutexGuard lock(store->mutex);
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	AL::uint32 capture_count = 0;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	for (auto i = pi_camera_store_find(store, start_time_ms); (i < store->record_count) && (store->records[i].timestamp_ms <= end_time_ms); ++i)
+	{
+		auto& record = store->records[i];
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		if (record.flags & PI_CAMERA_STORE_RECORD_FLAG_DELETED)
+			continue;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+		::unlink(pi_camera_store_get_file_path(store->directory.GetCString(), record.timestamp_ms).GetCString());
+		record.flags        |= PI_CAMERA_STORE_RECORD_FLAG_DELETED;
+		store->capture_size -= record.size;
+		--store->capture_count;
+
+		++capture_count;
+	}
+
+	pi_camera_store_evict(store);
+
+	return capture_count;
 }
-bool      pi_camera_net_complete_set_jpg_quality(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+void             pi_camera_store_set_budget(pi_camera_store* store, AL::uint64 size_max, AL::size_t capture_count_max)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_JPG_QUALITY, error_code, nullptr, 0);
+	AL::OS::MutexGuard lock(store->mutex);
+
+	store->size_max          = size_max;
+	store->capture_count_max = capture_count_max;
+
+	pi_camera_store_evict(store);
 }
+#endif
 
-AL::uint8 pi_camera_net_begin_get_image_size(AL::Network::TcpSocket& socket, AL::uint16& width, AL::uint16& height)
+#if defined(AL_PLATFORM_LINUX)
+// @return nullptr if the store could not be opened
+pi_camera_store* pi_camera_cli_store_open(pi_camera_local* camera_local)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_SIZE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::OS::MutexGuard lock(camera_local->store_mutex);
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if (camera_local->store == nullptr)
+		camera_local->store = pi_camera_store_open(PI_CAMERA_STORE_DIRECTORY, camera_local->store_size_max, camera_local->store_capture_count_max);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	return camera_local->store;
+}
+#endif
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+#if defined(AL_PLATFORM_LINUX)
+// @param command_line run through /bin/sh with stdout redirected to process.output
+// @param signal_mask can be nullptr, signals blocked in the new process stay pending until it waits for them
+bool pi_camera_process_open(pi_camera_process& process, const char* command_line, const sigset_t* signal_mask = nullptr)
+{
+	int pipe_handles[2];
 
-	width  = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
-	height = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[2]));
+	if (::pipe2(pipe_handles, O_CLOEXEC) == -1)
+		return false;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	posix_spawn_file_actions_t file_actions;
+	::posix_spawn_file_actions_init(&file_actions);
+	::posix_spawn_file_actions_adddup2(&file_actions, pipe_handles[1], STDOUT_FILENO);
+	::posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+	// the service threads block SIGPIPE, the camera process starts with signal_mask or nothing blocked
+	sigset_t          signals;
+	posix_spawnattr_t attributes;
+	::sigemptyset(&signals);
+	::posix_spawnattr_init(&attributes);
+	::posix_spawnattr_setsigmask(&attributes, (signal_mask != nullptr) ? signal_mask : &signals);
+	// signals in signal_mask also start with their default action, an ignored one inherited from us would look like the camera process ignoring it
+	::posix_spawnattr_setsigdefault(&attributes, (signal_mask != nullptr) ? signal_mask : &signals);
+	::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+	// exec replaces the shell so signals reach the camera process directly
+	auto  command = AL::String::Format("exec %s", command_line);
+	char* argv[]  = { const_cast<char*>("sh"), const_cast<char*>("-c"), const_cast<char*>(command.GetCString()), nullptr };
+	int   result  = ::posix_spawn(&process.pid, "/bin/sh", &file_actions, &attributes, argv, environ);
+
+	::posix_spawnattr_destroy(&attributes);
+	::posix_spawn_file_actions_destroy(&file_actions);
+	::close(pipe_handles[1]);
+
+	if (result != 0)
+	{
+		::close(pipe_handles[0]);
+		process.pid = -1;
+
+		return false;
+	}
+
+	process.output = pipe_handles[0];
+
+	return true;
 }
-bool      pi_camera_net_complete_get_image_size(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 width, AL::uint16 height)
+// @return 0 on error
+// @return -1 on end of output
+int  pi_camera_process_read(pi_camera_process& process, void* buffer, AL::size_t size, AL::size_t& number_of_bytes_read)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, error_code, nullptr, 0);
+	ssize_t result;
 
-	AL::uint16 packet_buffer[2] =
+	while ((result = ::read(process.output, buffer, size)) == -1)
 	{
-		AL::BitConverter::HostToNetwork(width),
-		AL::BitConverter::HostToNetwork(height)
-	};
+		if (errno != EINTR)
+			return 0;
+	}
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, packet_buffer, sizeof(packet_buffer));
+	if (result == 0)
+		return -1;
+
+	number_of_bytes_read = static_cast<AL::size_t>(result);
+
+	return 1;
 }
-AL::uint8 pi_camera_net_begin_set_image_size(AL::Network::TcpSocket& socket, AL::uint16 width, AL::uint16 height)
+// @return exit code or -1 if the process did not exit normally
+int  pi_camera_process_close(pi_camera_process& process, bool kill)
 {
-	AL::uint16 buffer[2] =
-	{
-		AL::BitConverter::HostToNetwork(width),
-		AL::BitConverter::HostToNetwork(height)
-	};
+	int status = 0;
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_SIZE, PI_CAMERA_ERROR_CODE_SUCCESS, buffer, sizeof(buffer)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	if (process.output != -1)
+	{
+		::close(process.output);
+		process.output = -1;
+	}
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if (process.pid != -1)
+	{
+		if (kill)
+			::kill(process.pid, SIGTERM);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		while ((::waitpid(process.pid, &status, 0) == -1) && (errno == EINTR))
+		{
+		}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		process.pid = -1;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_image_size(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 width, AL::uint16 height)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_SIZE, error_code, nullptr, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
+#endif
 
-AL::uint8 pi_camera_net_begin_get_image_effect(AL::Network::TcpSocket& socket, AL::uint8& value)
+void pi_camera_worker_pool_thread_main(pi_camera_worker_pool* worker_pool)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+#if defined(PI_CAMERA_ZERO_COPY)
+	pi_camera_thread_block_sigpipe();
+#endif
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	for (pi_camera_worker_pool_job_context job_context;; )
+	{
+		worker_pool->mutex.Lock();
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		while (!worker_pool->is_stopping && (worker_pool->jobs.GetSize() == 0))
+			worker_pool->condition.Sleep(worker_pool->mutex);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		if (worker_pool->jobs.GetSize() == 0)
+		{
+			worker_pool->mutex.Unlock();
 
-	value = packet_buffer[0];
+			break;
+		}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_image_effect(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, error_code, nullptr, 0);
+		auto it = worker_pool->jobs.begin();
+		job_context = *it;
+		worker_pool->jobs.Erase(it);
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+		worker_pool->mutex.Unlock();
+
+		job_context.job(job_context.param);
+	}
 }
-AL::uint8 pi_camera_net_begin_set_image_effect(AL::Network::TcpSocket& socket, AL::uint8 value)
+void pi_camera_worker_pool_stop(pi_camera_worker_pool* worker_pool)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_EFFECT, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	worker_pool->mutex.Lock();
+	worker_pool->is_stopping = true;
+	worker_pool->condition.WakeAll();
+	worker_pool->mutex.Unlock();
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	for (auto it = worker_pool->threads.begin(); it != worker_pool->threads.end(); )
+	{
+		try
+		{
+			while (!(*it)->Join())
+			{
+			}
+		}
+		catch (const AL::Exception& exception)
+		{
+		}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		delete *it;
+		worker_pool->threads.Erase(it++);
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	worker_pool->is_stopping = false;
 }
-bool      pi_camera_net_complete_set_image_effect(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+bool pi_camera_worker_pool_start(pi_camera_worker_pool* worker_pool, AL::size_t thread_count)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_EFFECT, error_code, nullptr, 0);
-}
-
-AL::uint8 pi_camera_net_begin_get_image_rotation(AL::Network::TcpSocket& socket, AL::uint16& value)
-{
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	for (AL::size_t i = 0; i < thread_count; ++i)
+	{
+		auto thread = new AL::OS::Thread();
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+		try
+		{
+			thread->Start([worker_pool]()
+			{
+				pi_camera_worker_pool_thread_main(worker_pool);
+			});
+		}
+		catch (const AL::Exception& exception)
+		{
+			delete thread;
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			pi_camera_worker_pool_stop(worker_pool);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+			return false;
+		}
 
-	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
+		worker_pool->threads.PushBack(thread);
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
-bool      pi_camera_net_complete_get_image_rotation(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 value)
+bool pi_camera_worker_pool_is_running(pi_camera_worker_pool* worker_pool)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, error_code, nullptr, 0);
-
-	value = AL::BitConverter::HostToNetwork(value);
-
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint16));
+	return worker_pool->threads.GetSize() != 0;
 }
-AL::uint8 pi_camera_net_begin_set_image_rotation(AL::Network::TcpSocket& socket, AL::uint16 value)
+void pi_camera_worker_pool_post(pi_camera_worker_pool* worker_pool, pi_camera_worker_pool_job job, void* param)
 {
-	auto rotation = AL::BitConverter::HostToNetwork(value);
-
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, &rotation, sizeof(AL::uint16)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
-
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::OS::MutexGuard lock(worker_pool->mutex);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
-
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	worker_pool->jobs.PushBack({ .job = job, .param = param });
+	worker_pool->condition.WakeOne();
 }
-bool      pi_camera_net_complete_set_image_rotation(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint16 value)
+
+void pi_camera_net_socket_close(AL::Network::TcpSocket& socket)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_IMAGE_ROTATION, error_code, nullptr, 0);
+	socket.Close();
 }
-
-AL::uint8 pi_camera_net_begin_get_video_bit_rate(AL::Network::TcpSocket& socket, AL::uint32& value)
+#if defined(AL_PLATFORM_LINUX)
+// packets are written whole so nothing is gained by letting nagle hold back the tail of a reply
+void pi_camera_net_socket_set_no_delay(AL::Network::TcpSocket& socket)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
-
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+	int value = 1;
 
-	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&packet_buffer[0]));
+	::setsockopt(static_cast<int>(socket.GetHandle()), IPPROTO_TCP, TCP_NODELAY, &value, sizeof(int));
+}
+// a corked socket only sends full segments, uncorking flushes the rest
+void pi_camera_net_socket_set_cork(AL::Network::TcpSocket& socket, bool value)
+{
+	int cork = value ? 1 : 0;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	::setsockopt(static_cast<int>(socket.GetHandle()), IPPROTO_TCP, TCP_CORK, &cork, sizeof(int));
 }
-bool      pi_camera_net_complete_get_video_bit_rate(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint32 value)
+#endif
+bool pi_camera_net_socket_listen(AL::Network::TcpSocket& socket, const AL::Network::IPEndPoint& local_end_point, AL::size_t backlog, bool block = false)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, error_code, nullptr, 0);
+	socket.SetBlocking(block ? AL::True : AL::False);
 
-	value = AL::BitConverter::HostToNetwork(value);
+	try
+	{
+		socket.Open();
+		socket.Bind(local_end_point);
+		socket.Listen(backlog);
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(socket);
+
+		return false;
+	}
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint32));
+	return true;
 }
-AL::uint8 pi_camera_net_begin_set_video_bit_rate(AL::Network::TcpSocket& socket, AL::uint32 value)
+// @return 0 on error
+// @return -1 if would block
+int  pi_camera_net_socket_accept(AL::Network::TcpSocket& socket, AL::Network::TcpSocket& new_socket)
 {
-	auto rotation = AL::BitConverter::HostToNetwork(value);
-
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &rotation, sizeof(AL::uint32)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	try
+	{
+		if (!socket.Accept(new_socket))
+		{
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+			return -1;
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(socket);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		return 0;
+	}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_net_socket_set_no_delay(new_socket);
+#endif
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_set_video_bit_rate(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint32 value)
-{
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE, error_code, nullptr, 0);
+	return 1;
 }
-
-AL::uint8 pi_camera_net_begin_get_video_frame_rate(AL::Network::TcpSocket& socket, AL::uint8& value)
+bool pi_camera_net_socket_connect(AL::Network::TcpSocket& socket, const AL::Network::IPEndPoint& remote_end_point, bool block = false)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	try
+	{
+		socket.Open();
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+		if (!socket.Connect(remote_end_point))
+		{
+			pi_camera_net_socket_close(socket);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			return false;
+		}
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		socket.SetBlocking(block ? AL::True : AL::False);
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(socket);
 
-	value = packet_buffer[0];
+		return false;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-bool      pi_camera_net_complete_get_video_frame_rate(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
-{
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, error_code, nullptr, 0);
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_net_socket_set_no_delay(socket);
+#endif
 
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+	return true;
 }
-AL::uint8 pi_camera_net_begin_set_video_frame_rate(AL::Network::TcpSocket& socket, AL::uint8 value)
+bool pi_camera_net_socket_send(AL::Network::TcpSocket& socket, const void* buffer, AL::size_t size)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	AL::size_t number_of_bytes_sent;
 
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	try
+	{
+		if (!AL::Network::SocketExtensions::SendAll(socket, buffer, size, number_of_bytes_sent))
+		{
+			pi_camera_net_socket_close(socket);
 
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			return false;
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(socket);
 
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
+		return false;
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
-bool      pi_camera_net_complete_set_video_frame_rate(AL::Network::TcpSocket& socket, AL::uint8 error_code, AL::uint8 value)
+#if defined(PI_CAMERA_ZERO_COPY)
+// sends size bytes starting at offset straight from the page cache
+bool pi_camera_net_socket_send_file(AL::Network::TcpSocket& socket, int file_handle, AL::uint64 offset, AL::size_t size)
 {
-	return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE, error_code, nullptr, 0);
-}
+	auto  socket_handle = socket.GetHandle();
+	off_t file_offset   = static_cast<off_t>(offset);
 
-bool      pi_camera_net_begin_file_transfer(AL::Network::TcpSocket& socket, const char* file_path, AL::uint32 file_chunk_size)
-{
-	AL::uint64 file_size;
+	while (size > 0)
+	{
+		auto number_of_bytes_sent = ::sendfile(socket_handle, file_handle, &file_offset, size);
 
-	if (!pi_camera_file_get_size(file_path, file_size))
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR, nullptr, 0);
+		if (number_of_bytes_sent > 0)
+		{
+			size -= static_cast<AL::size_t>(number_of_bytes_sent);
 
-	pi_camera_file* file;
+			continue;
+		}
 
-	if ((file = pi_camera_file_open(file_path, true, false)) == nullptr)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0);
+		if ((number_of_bytes_sent == -1) && (errno == EINTR))
+			continue;
 
-	file_size = AL::BitConverter::HostToNetwork(file_size);
+		if ((number_of_bytes_sent == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			pollfd socket_poll =
+			{
+				.fd      = socket_handle,
+				.events  = POLLOUT,
+				.revents = 0
+			};
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_SUCCESS, &file_size, sizeof(AL::uint64)))
-	{
-		pi_camera_file_close(file);
+			if ((::poll(&socket_poll, 1, -1) != -1) || (errno == EINTR))
+				continue;
+		}
+
+		// the packet header is already on the wire so any failure here is fatal to the connection
+		pi_camera_net_socket_close(socket);
 
 		return false;
 	}
 
-	file_size = AL::BitConverter::NetworkToHost(file_size);
-
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer(AL::Math::Lowest(file_size, file_chunk_size));
-	pi_camera_packet_buffer packet_buffer_ack;
+	return true;
+}
+#endif
+#if defined(AL_PLATFORM_LINUX)
+// sends every buffer in as few syscalls as the socket buffer allows
+// @param buffers consumed as they are sent
+bool pi_camera_net_socket_send_vector(AL::Network::TcpSocket& socket, iovec* buffers, AL::size_t count)
+{
+	auto   socket_handle = static_cast<int>(socket.GetHandle());
+	msghdr message       = {};
+	message.msg_iov      = buffers;
+	message.msg_iovlen   = count;
 
-	if (!pi_camera_net_receive_packet(socket, packet_header, packet_buffer_ack, false))
+	while (message.msg_iovlen > 0)
 	{
-		pi_camera_file_close(file);
-
-		return false;
-	}
+		auto number_of_bytes_sent = ::sendmsg(socket_handle, &message, MSG_NOSIGNAL);
 
-	if (packet_header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
-	{
-		for (AL::uint64 number_of_bytes_sent = 0; number_of_bytes_sent < file_size; number_of_bytes_sent += packet_buffer.GetSize())
+		if (number_of_bytes_sent > 0)
 		{
-			auto file_chunk_size = static_cast<AL::uint32>(AL::Math::Lowest(packet_buffer.GetSize(), (file_size - number_of_bytes_sent)));
-
-			if (!pi_camera_file_read(file, &packet_buffer[0], file_chunk_size))
+			for (auto size = static_cast<AL::size_t>(number_of_bytes_sent); size > 0; )
 			{
-				pi_camera_file_close(file);
+				if (size < message.msg_iov->iov_len)
+				{
+					message.msg_iov->iov_base = reinterpret_cast<AL::uint8*>(message.msg_iov->iov_base) + size;
+					message.msg_iov->iov_len -= size;
 
-				return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_READ_ERROR, nullptr, 0);
+					break;
+				}
+
+				size -= message.msg_iov->iov_len;
+				message.msg_iov++;
+				message.msg_iovlen--;
 			}
 
-			if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], file_chunk_size))
-			{
-				pi_camera_file_close(file);
+			continue;
+		}
 
-				return false;
-			}
+		if ((number_of_bytes_sent == -1) && (errno == EINTR))
+			continue;
 
-			if (!pi_camera_net_receive_packet(socket, packet_header, packet_buffer_ack, false))
+		if ((number_of_bytes_sent == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+		{
+			pollfd socket_poll =
 			{
-				pi_camera_file_close(file);
+				.fd      = socket_handle,
+				.events  = POLLOUT,
+				.revents = 0
+			};
 
-				return false;
-			}
-
-			if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-				break;
+			if ((::poll(&socket_poll, 1, -1) != -1) || (errno == EINTR))
+				continue;
 		}
-	}
 
-	pi_camera_file_close(file);
+		pi_camera_net_socket_close(socket);
+
+		return false;
+	}
 
 	return true;
 }
-// @param on_progress_changed can be nullptr
-AL::uint8 pi_camera_net_complete_file_transfer(AL::Network::TcpSocket& socket, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+// sends what the socket buffer takes without waiting for room
+// @return false on error, the connection is left to the caller
+bool pi_camera_net_socket_try_send_vector(AL::Network::TcpSocket& socket, iovec* buffers, AL::size_t count, AL::size_t& number_of_bytes_sent)
 {
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
-
-	if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-
-	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return packet_header.error_code;
-
-	pi_camera_file* file;
-	auto            file_size = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+	msghdr message     = {};
+	message.msg_iov    = buffers;
+	message.msg_iovlen = count;
 
-	if ((file = pi_camera_file_open(file_path, false, true)) == nullptr)
+	while (true)
 	{
-		if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0))
+		auto result = ::sendmsg(static_cast<int>(socket.GetHandle()), &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (result >= 0)
 		{
-			pi_camera_file_close(file);
+			number_of_bytes_sent = static_cast<AL::size_t>(result);
 
-			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			return true;
 		}
 
-		pi_camera_file_close(file);
+		if (errno == EINTR)
+			continue;
 
-		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+		number_of_bytes_sent = 0;
+
+		return (errno == EAGAIN) || (errno == EWOULDBLOCK);
 	}
+}
+#endif
+// @return 0 on error
+// @return -1 if would block
+int  pi_camera_net_socket_receive(AL::Network::TcpSocket& socket, void* buffer, AL::size_t size, AL::size_t& number_of_bytes_received)
+{
+	try
+	{
+		if (!socket.Receive(buffer, size, number_of_bytes_received))
+		{
+			pi_camera_net_socket_close(socket);
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
+			return 0;
+		}
+	}
+	catch (const AL::Exception& exception)
 	{
-		pi_camera_file_close(file);
+		pi_camera_net_socket_close(socket);
 
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		return 0;
 	}
 
-	for (AL::uint64 number_of_bytes_received = 0; number_of_bytes_received < file_size; )
+	return (number_of_bytes_received > 0) ? 1 : -1;
+}
+// @return 0 on error
+// @return -1 if would block
+int  pi_camera_net_socket_receive_all(AL::Network::TcpSocket& socket, void* buffer, AL::size_t size, bool block_once = true)
+{
+	AL::size_t number_of_bytes_received;
+
+	try
 	{
-		if (pi_camera_net_receive_packet(socket, packet_header, packet_buffer, false) == 0)
+		if ((block_once && !AL::Network::SocketExtensions::TryReceiveAll(socket, buffer, size, number_of_bytes_received)) ||
+			(!block_once && !AL::Network::SocketExtensions::ReceiveAll(socket, buffer, size, number_of_bytes_received)))
 		{
-			pi_camera_file_close(file);
 
-			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			return 0;
 		}
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(socket);
 
-		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		{
-			pi_camera_file_close(file);
-
-			return packet_header.error_code;
-		}
+		return 0;
+	}
 
-		auto file_chunk_size = AL::Math::Lowest(packet_buffer.GetSize(), (file_size - number_of_bytes_received));
+	return (number_of_bytes_received > 0) ? 1 : -1;
+}
+bool pi_camera_net_socket_resolve_end_point(AL::Network::IPEndPoint& value, const char* host, AL::uint16 port)
+{
+	value.Port = port;
 
-		if (!pi_camera_file_append(file, &packet_buffer[0], file_chunk_size))
+	try
+	{
+		if (!AL::Network::DNS::Resolve(value.Host, host))
 		{
-			if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR, nullptr, 0))
-			{
-				pi_camera_file_close(file);
-
-				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-			}
 
-			pi_camera_file_close(file);
-
-			return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+			return false;
 		}
+	}
+	catch (const AL::Exception& exception)
+	{
 
-		number_of_bytes_received += file_chunk_size;
-
-		if (on_progress_changed != nullptr)
-			on_progress_changed(file_size, number_of_bytes_received, param);
-
-		if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		{
-			pi_camera_file_close(file);
-
-			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
-		}
+		return false;
 	}
 
-	pi_camera_file_close(file);
-
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return true;
 }
 
-// @param on_progress_changed can be nullptr
-AL::uint8 pi_camera_net_begin_capture(AL::Network::TcpSocket& socket, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+bool pi_camera_net_send_packet_header(pi_camera_connection& connection, AL::uint8 opcode, AL::uint8 error_code, AL::uint32 size)
 {
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_CAPTURE, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	pi_camera_packet_header packet_header =
+	{
+		.opcode      = AL::BitConverter::HostToNetwork(opcode),
+		.error_code  = AL::BitConverter::HostToNetwork(error_code),
+		.buffer_size = AL::BitConverter::HostToNetwork(size),
+		.request_id  = AL::BitConverter::HostToNetwork(connection.request_id)
+	};
 
-	return pi_camera_net_complete_file_transfer(socket, file_path, on_progress_changed, param);
+	return pi_camera_net_socket_send(connection.socket, &packet_header, pi_camera_packet_header_get_size(connection.protocol_version));
 }
-bool      pi_camera_net_complete_capture(AL::Network::TcpSocket& socket, AL::uint8 error_code, const char* file_path)
+#if defined(PI_CAMERA_COMPRESSION)
+// @return size of the payload compressed into connection.compression_send_buffer
+// @return 0 if the payload is sent as is
+AL::uint32 pi_camera_net_compress_packet(pi_camera_connection& connection, AL::uint8 opcode, AL::uint8 error_code, const void* buffer, AL::uint32 size)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_CAPTURE, error_code, nullptr, 0);
+	if ((error_code != PI_CAMERA_ERROR_CODE_SUCCESS) || (size < PI_CAMERA_COMPRESSION_SIZE_MIN) || !pi_camera_opcode_is_compressible(opcode) || !(connection.capabilities.codecs & (1 << PI_CAMERA_CODEC_LZ4)))
+		return 0;
 
-	return pi_camera_net_begin_file_transfer(socket, file_path, PI_CAMERA_FILE_CHUNK_SIZE);
-}
+	auto  cpu_time_us     = pi_camera_get_thread_cpu_time_us();
+	auto& compressed      = connection.compression_send_buffer;
+	compressed.Trim(PI_CAMERA_PACKET_BUFFER_RETAIN_SIZE_MAX);
+	compressed.SetCapacity(size);
+	// the uncompressed size leads the block, anything that doesn't come out smaller is sent as is
+	auto  compressed_size = pi_camera_lz4_compress(reinterpret_cast<const AL::uint8*>(buffer), size, &compressed[sizeof(AL::uint32)], size - sizeof(AL::uint32) - 1);
 
-// @param on_progress_changed can be nullptr
-AL::uint8 pi_camera_net_begin_capture_video(AL::Network::TcpSocket& socket, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
-{
-	video_length_seconds = AL::BitConverter::HostToNetwork(video_length_seconds);
+	{
+		AL::OS::MutexGuard lock(pi_camera_compression_stats_mutex);
 
-	if (!pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_CAPTURE_VIDEO, PI_CAMERA_ERROR_CODE_SUCCESS, &video_length_seconds, sizeof(AL::uint32)))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		pi_camera_compression_bytes_in    += size;
+		pi_camera_compression_bytes_out   += (compressed_size == 0) ? size : (sizeof(AL::uint32) + compressed_size);
+		pi_camera_compression_cpu_time_us += pi_camera_get_thread_cpu_time_us() - cpu_time_us;
+	}
+
+	if (compressed_size == 0)
+		return 0;
 
-	return pi_camera_net_complete_file_transfer(socket, file_path, on_progress_changed, param);
+	*reinterpret_cast<AL::uint32*>(&compressed[0]) = AL::BitConverter::HostToNetwork(size);
+
+	return static_cast<AL::uint32>(sizeof(AL::uint32) + compressed_size);
 }
-bool      pi_camera_net_complete_capture_video(AL::Network::TcpSocket& socket, AL::uint8 error_code, const char* file_path)
+#endif
+bool pi_camera_net_send_packet(pi_camera_connection& connection, AL::uint8 opcode, AL::uint8 error_code, const void* buffer, AL::uint32 size)
 {
-	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
-		return pi_camera_net_send_packet(socket, PI_CAMERA_OPCODE_CAPTURE_VIDEO, error_code, nullptr, 0);
+#if defined(PI_CAMERA_COMPRESSION)
+	if (auto compressed_size = pi_camera_net_compress_packet(connection, opcode, error_code, buffer, size))
+	{
+		opcode |= PI_CAMERA_PACKET_FLAG_COMPRESSED;
+		buffer  = &connection.compression_send_buffer[0];
+		size    = compressed_size;
+	}
+#endif
 
-	return pi_camera_net_begin_file_transfer(socket, file_path, PI_CAMERA_FILE_CHUNK_SIZE);
-}
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_packet_header packet_header =
+	{
+		.opcode      = AL::BitConverter::HostToNetwork(opcode),
+		.error_code  = AL::BitConverter::HostToNetwork(error_code),
+		.buffer_size = AL::BitConverter::HostToNetwork(size),
+		.request_id  = AL::BitConverter::HostToNetwork(connection.request_id)
+	};
 
-bool pi_camera_service_packet_handler_is_busy(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	bool      value;
-	AL::uint8 error_code = pi_camera_is_busy(camera_service, &value);
+	// header and payload leave in one segment instead of the payload waiting on the ack of the header
+	iovec buffers[2] =
+	{
+		{ .iov_base = &packet_header,            .iov_len = pi_camera_packet_header_get_size(connection.protocol_version) },
+		{ .iov_base = const_cast<void*>(buffer), .iov_len = size }
+	};
 
-	return pi_camera_net_complete_is_busy(camera_session->socket, error_code, value);
+	return pi_camera_net_socket_send_vector(connection.socket, buffers, ((size == 0) || (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)) ? 1 : 2);
+#else
+	return pi_camera_net_send_packet_header(connection, opcode, error_code, size) && ((size == 0) || (error_code != PI_CAMERA_ERROR_CODE_SUCCESS) || pi_camera_net_socket_send(connection.socket, buffer, size));
+#endif
 }
-bool pi_camera_service_packet_handler_get_ev(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return false if header.buffer_size is beyond what the connection accepts
+bool pi_camera_net_is_packet_size_valid(pi_camera_connection& connection, const pi_camera_packet_header& header)
 {
-	AL::int8  value;
-	AL::uint8 error_code = pi_camera_get_ev(camera_service, &value);
+	if (header.buffer_size > connection.receive_size_max)
+	{
+		pi_camera_net_socket_close(connection.socket);
 
-	return pi_camera_net_complete_get_ev(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_set_ev(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	auto      value      = static_cast<AL::int8>(buffer[0]);
-	AL::uint8 error_code = pi_camera_set_ev(camera_service, value);
+		return false;
+	}
 
-	return pi_camera_net_complete_set_ev(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_get_iso(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+#if defined(PI_CAMERA_COMPRESSION)
+// @return false if header.buffer_size can't hold a compressed payload
+bool pi_camera_net_is_compressed_packet_size_valid(pi_camera_connection& connection, const pi_camera_packet_header& header)
 {
-	AL::uint16 value;
-	AL::uint8  error_code = pi_camera_get_iso(camera_service, &value);
+	if ((header.buffer_size <= sizeof(AL::uint32)) || (header.buffer_size > connection.receive_size_max))
+	{
+		pi_camera_net_socket_close(connection.socket);
 
-	return pi_camera_net_complete_get_iso(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_set_iso(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
-	AL::uint8 error_code = pi_camera_set_iso(camera_service, value);
+		return false;
+	}
 
-	return pi_camera_net_complete_set_iso(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_get_config(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// Decompresses the payload held in connection.compression_receive_buffer and replaces header.buffer_size with its uncompressed size
+bool pi_camera_net_decompress_packet_buffer(pi_camera_connection& connection, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer)
 {
-	pi_camera_config value;
-	AL::uint8        error_code = pi_camera_get_config(camera_service, &value);
+	auto& compressed = connection.compression_receive_buffer;
+	auto  size       = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&compressed[0]));
 
-	return pi_camera_net_complete_get_config(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_set_config(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	auto      value      = pi_camera_config_from_packet_buffer(buffer, size);
-	AL::uint8 error_code = pi_camera_set_config(camera_service, &value);
+	// lz4 can't expand more than 255:1, a larger size is a broken packet rather than a reason to allocate
+	if ((size > (static_cast<AL::uint64>(header.buffer_size - sizeof(AL::uint32)) * 255)) || (size > connection.receive_size_max))
+	{
+		pi_camera_net_socket_close(connection.socket);
 
-	return pi_camera_net_complete_set_config(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_get_contrast(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	AL::int8  value;
-	AL::uint8 error_code = pi_camera_get_contrast(camera_service, &value);
+		return false;
+	}
 
-	return pi_camera_net_complete_get_contrast(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_set_contrast(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	auto      value      = static_cast<AL::int8>(buffer[0]);
-	AL::uint8 error_code = pi_camera_set_contrast(camera_service, value);
+	buffer.SetCapacity(size);
 
-	return pi_camera_net_complete_set_contrast(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_get_sharpness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	AL::int8  value;
-	AL::uint8 error_code = pi_camera_get_sharpness(camera_service, &value);
+	if (!pi_camera_lz4_decompress(&compressed[sizeof(AL::uint32)], header.buffer_size - sizeof(AL::uint32), &buffer[0], size))
+	{
+		pi_camera_net_socket_close(connection.socket);
 
-	return pi_camera_net_complete_get_sharpness(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_set_sharpness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	auto      value      = static_cast<AL::int8>(buffer[0]);
-	AL::uint8 error_code = pi_camera_set_sharpness(camera_service, value);
+		return false;
+	}
 
-	return pi_camera_net_complete_set_sharpness(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_get_brightness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_brightness(camera_service, &value);
+	header.buffer_size = size;
+	compressed.Trim(PI_CAMERA_PACKET_BUFFER_RETAIN_SIZE_MAX);
 
-	return pi_camera_net_complete_get_brightness(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_set_brightness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// Receives a compressed payload and replaces header.buffer_size with its uncompressed size
+bool pi_camera_net_receive_compressed_packet_buffer(pi_camera_connection& connection, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_brightness(camera_service, value);
+	if (!pi_camera_net_is_compressed_packet_size_valid(connection, header))
+		return false;
 
-	return pi_camera_net_complete_set_brightness(camera_session->socket, error_code, value);
-}
-bool pi_camera_service_packet_handler_get_saturation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
-{
-	AL::int8  value;
-	AL::uint8 error_code = pi_camera_get_saturation(camera_service, &value);
+	connection.compression_receive_buffer.SetCapacity(header.buffer_size);
+
+	if (pi_camera_net_socket_receive_all(connection.socket, &connection.compression_receive_buffer[0], header.buffer_size, false) == 0)
+		return false;
 
-	return pi_camera_net_complete_get_saturation(camera_session->socket, error_code, value);
+	return pi_camera_net_decompress_packet_buffer(connection, header, buffer);
 }
-bool pi_camera_service_packet_handler_set_saturation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+#endif
+// @return 0 on error
+// @return -1 if would block
+int  pi_camera_net_receive_packet(pi_camera_connection& connection, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer, bool block_once = true)
 {
-	auto      value      = static_cast<AL::int8>(buffer[0]);
-	AL::uint8 error_code = pi_camera_set_saturation(camera_service, value);
+	header.request_id = 0;
+	buffer.Trim(PI_CAMERA_PACKET_BUFFER_RETAIN_SIZE_MAX);
 
-	return pi_camera_net_complete_set_saturation(camera_session->socket, error_code, value);
+	switch (pi_camera_net_socket_receive_all(connection.socket, &header, pi_camera_packet_header_get_size(connection.protocol_version), block_once))
+	{
+		case 0:  return 0;
+		case -1: return -1;
+	}
+
+	header.opcode      = AL::BitConverter::NetworkToHost(header.opcode);
+	header.error_code  = AL::BitConverter::NetworkToHost(header.error_code);
+	header.buffer_size = AL::BitConverter::NetworkToHost(header.buffer_size);
+	header.request_id  = AL::BitConverter::NetworkToHost(header.request_id);
+
+#if defined(PI_CAMERA_COMPRESSION)
+	if ((header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (header.opcode & PI_CAMERA_PACKET_FLAG_COMPRESSED))
+	{
+		header.opcode &= ~PI_CAMERA_PACKET_FLAG_COMPRESSED;
+
+		return pi_camera_net_receive_compressed_packet_buffer(connection, header, buffer) ? 1 : 0;
+	}
+#endif
+
+	if (header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		if (!pi_camera_net_is_packet_size_valid(connection, header))
+			return 0;
+
+		buffer.SetCapacity(header.buffer_size);
+
+		if (pi_camera_net_socket_receive_all(connection.socket, &buffer[0], header.buffer_size, false) == 0)
+			return 0;
+	}
+
+	return 1;
 }
-bool pi_camera_service_packet_handler_get_white_balance(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// Takes only what has arrived of a packet, call again with the same header, buffer and count until it completes
+// @param number_of_bytes_received 0 to start a packet, reset to 0 once it completes
+// @return 0 on error
+// @return -1 until the whole packet arrived
+int  pi_camera_net_receive_packet_partial(pi_camera_connection& connection, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer, AL::size_t& number_of_bytes_received)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_white_balance(camera_service, &value);
+	auto       header_size   = pi_camera_packet_header_get_size(connection.protocol_version);
+	auto       payload       = &buffer;
+	AL::size_t payload_size  = 0;
+	AL::size_t number_of_bytes;
+
+	if (number_of_bytes_received == 0)
+	{
+		header.request_id = 0;
+		buffer.Trim(PI_CAMERA_PACKET_BUFFER_RETAIN_SIZE_MAX);
+	}
+
+	while (number_of_bytes_received < header_size)
+	{
+		switch (pi_camera_net_socket_receive(connection.socket, reinterpret_cast<AL::uint8*>(&header) + number_of_bytes_received, header_size - number_of_bytes_received, number_of_bytes))
+		{
+			case 0:  return 0;
+			case -1: return -1;
+		}
+
+		if ((number_of_bytes_received += number_of_bytes) < header_size)
+			continue;
+
+		header.opcode      = AL::BitConverter::NetworkToHost(header.opcode);
+		header.error_code  = AL::BitConverter::NetworkToHost(header.error_code);
+		header.buffer_size = AL::BitConverter::NetworkToHost(header.buffer_size);
+		header.request_id  = AL::BitConverter::NetworkToHost(header.request_id);
+
+		if (header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			continue;
+
+#if defined(PI_CAMERA_COMPRESSION)
+		if (header.opcode & PI_CAMERA_PACKET_FLAG_COMPRESSED)
+		{
+			if (!pi_camera_net_is_compressed_packet_size_valid(connection, header))
+				return 0;
+
+			connection.compression_receive_buffer.SetCapacity(header.buffer_size);
+
+			continue;
+		}
+#endif
+
+		if (!pi_camera_net_is_packet_size_valid(connection, header))
+			return 0;
+
+		buffer.SetCapacity(header.buffer_size);
+	}
+
+	if (header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		payload_size = header.buffer_size;
+
+#if defined(PI_CAMERA_COMPRESSION)
+	bool is_compressed = (header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (header.opcode & PI_CAMERA_PACKET_FLAG_COMPRESSED);
+
+	if (is_compressed)
+		payload = &connection.compression_receive_buffer;
+#endif
+
+	while ((number_of_bytes_received - header_size) < payload_size)
+	{
+		switch (pi_camera_net_socket_receive(connection.socket, &(*payload)[number_of_bytes_received - header_size], payload_size - (number_of_bytes_received - header_size), number_of_bytes))
+		{
+			case 0:  return 0;
+			case -1: return -1;
+		}
+
+		number_of_bytes_received += number_of_bytes;
+	}
+
+	number_of_bytes_received = 0;
+
+#if defined(PI_CAMERA_COMPRESSION)
+	if (is_compressed)
+	{
+		header.opcode &= ~PI_CAMERA_PACKET_FLAG_COMPRESSED;
+
+		return pi_camera_net_decompress_packet_buffer(connection, header, buffer) ? 1 : 0;
+	}
+#endif
 
-	return pi_camera_net_complete_get_white_balance(camera_session->socket, error_code, value);
+	return 1;
 }
-bool pi_camera_service_packet_handler_set_white_balance(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+bool      pi_camera_net_send_request(pi_camera_connection& connection, AL::uint8 opcode, const void* buffer, AL::uint32 size)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_white_balance(camera_service, value);
+	++connection.request_id;
 
-	return pi_camera_net_complete_set_white_balance(camera_session->socket, error_code, value);
+	return pi_camera_net_send_packet(connection, opcode, PI_CAMERA_ERROR_CODE_SUCCESS, buffer, size);
 }
-bool pi_camera_service_packet_handler_get_shutter_speed(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return false if the reply does not belong to a pipelined request
+bool      pi_camera_net_complete_pipelined_request(pi_camera_connection& connection, const pi_camera_packet_header& header)
 {
-	AL::uint64 value;
-	AL::uint8    error_code = pi_camera_get_shutter_speed(camera_service, &value);
+	for (auto it = connection.pipeline_requests.begin(); it != connection.pipeline_requests.end(); ++it)
+	{
+		if (*it != header.request_id)
+			continue;
+
+		if (connection.pipeline_error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+			connection.pipeline_error_code = header.error_code;
 
-	return pi_camera_net_complete_get_shutter_speed(camera_session->socket, error_code, value);
+		connection.pipeline_requests.Erase(it);
+
+		return true;
+	}
+
+	return false;
 }
-bool pi_camera_service_packet_handler_set_shutter_speed(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// Receives the next packet for the last request, replies to pipelined requests are collected on the way
+// @return 0 on error
+int       pi_camera_net_receive_reply(pi_camera_connection& connection, pi_camera_packet_header& header, pi_camera_packet_buffer& buffer)
 {
-	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(buffer));
-	AL::uint8 error_code = pi_camera_set_shutter_speed(camera_service, value);
+	while (true)
+	{
+		if (pi_camera_net_receive_packet(connection, header, buffer, false) == 0)
+			return 0;
+
+		if ((connection.protocol_version < PI_CAMERA_PROTOCOL_VERSION_2) || (header.request_id == connection.request_id))
+			break;
 
-	return pi_camera_net_complete_set_shutter_speed(camera_session->socket, error_code, value);
+		if (!pi_camera_net_complete_pipelined_request(connection, header))
+		{
+			pi_camera_net_socket_close(connection.socket);
+
+			return 0;
+		}
+	}
+
+	return 1;
 }
-bool pi_camera_service_packet_handler_get_exposure_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return 0 on error
+int       pi_camera_net_receive_pipelined_reply(pi_camera_connection& connection)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_exposure_mode(camera_service, &value);
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_packet(connection, packet_header, packet_buffer, false) == 0)
+		return 0;
+
+	if (!pi_camera_net_complete_pipelined_request(connection, packet_header))
+	{
+		pi_camera_net_socket_close(connection.socket);
 
-	return pi_camera_net_complete_get_exposure_mode(camera_session->socket, error_code, value);
+		return 0;
+	}
+
+	return 1;
 }
-bool pi_camera_service_packet_handler_set_exposure_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// setters don't wait for their reply while pipelining, the error code is reported by pi_camera_net_end_pipeline
+AL::uint8 pi_camera_net_receive_set_reply(pi_camera_connection& connection)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_exposure_mode(camera_service, value);
+	if (connection.is_pipelining)
+	{
+		connection.pipeline_requests.PushBack(connection.request_id);
 
-	return pi_camera_net_complete_set_exposure_mode(camera_session->socket, error_code, value);
+		// bound the number of replies the service has to queue
+		while (connection.pipeline_requests.GetSize() > PI_CAMERA_PIPELINE_DEPTH_MAX)
+		{
+			if (pi_camera_net_receive_pipelined_reply(connection) == 0)
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		}
+
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+	}
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
 }
-bool pi_camera_service_packet_handler_get_metoring_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+AL::uint8 pi_camera_net_begin_pipeline(pi_camera_connection& connection)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_metoring_mode(camera_service, &value);
+	if (!(connection.capabilities.features & PI_CAMERA_FEATURE_PIPELINE))
+		return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+	connection.is_pipelining = true;
 
-	return pi_camera_net_complete_get_metoring_mode(camera_session->socket, error_code, value);
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-bool pi_camera_service_packet_handler_set_metoring_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return first error reported by a pipelined request
+AL::uint8 pi_camera_net_end_pipeline(pi_camera_connection& connection)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_metoring_mode(camera_service, value);
+	AL::uint8 error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	while (connection.pipeline_requests.GetSize() != 0)
+	{
+		if (pi_camera_net_receive_pipelined_reply(connection) == 0)
+		{
+			connection.pipeline_requests.Clear();
+			error_code = PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			break;
+		}
+	}
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		error_code = connection.pipeline_error_code;
 
-	return pi_camera_net_complete_set_metoring_mode(camera_session->socket, error_code, value);
+	connection.is_pipelining       = false;
+	connection.pipeline_error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	return error_code;
 }
-bool pi_camera_service_packet_handler_get_jpg_quality(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if the service predates the handshake
+// @return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED on any other connection error
+AL::uint8 pi_camera_net_begin_hello(pi_camera_connection& connection)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_jpg_quality(camera_service, &value);
+	// services that predate capabilities only read the protocol version in front
+	auto capabilities = pi_camera_capabilities_to_network(PI_CAMERA_CAPABILITIES);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_HELLO, &capabilities, sizeof(pi_camera_capabilities)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+	AL::size_t              number_of_bytes_received = 0;
+
+	try
+	{
+		if (!AL::Network::SocketExtensions::ReceiveAll(connection.socket, &packet_header, pi_camera_packet_header_get_size(connection.protocol_version), number_of_bytes_received))
+		{
+			pi_camera_net_socket_close(connection.socket);
+
+			// services that predate the handshake close the connection on unknown opcodes without replying
+			// a close after part of a reply is not a reason to downgrade
+			return (number_of_bytes_received == 0) ? PI_CAMERA_ERROR_CODE_NOT_SUPPORTED : PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_net_socket_close(connection.socket);
+
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	}
 
-	return pi_camera_net_complete_get_jpg_quality(camera_session->socket, error_code, value);
+	packet_header.error_code  = AL::BitConverter::NetworkToHost(packet_header.error_code);
+	packet_header.buffer_size = AL::BitConverter::NetworkToHost(packet_header.buffer_size);
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	packet_buffer.SetCapacity(packet_header.buffer_size);
+
+	if (pi_camera_net_socket_receive_all(connection.socket, &packet_buffer[0], packet_header.buffer_size, false) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.buffer_size >= sizeof(pi_camera_capabilities))
+		connection.capabilities = pi_camera_capabilities_negotiate(pi_camera_capabilities_from_network(&packet_buffer[0]));
+	else if (packet_header.buffer_size >= sizeof(AL::uint8))
+		connection.capabilities = pi_camera_capabilities_negotiate(pi_camera_capabilities_from_protocol_version(packet_buffer[0]));
+
+	connection.protocol_version = connection.capabilities.protocol_version;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-bool pi_camera_service_packet_handler_set_jpg_quality(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @param capabilities negotiated by the service, sent back so both ends agree
+bool      pi_camera_net_complete_hello(pi_camera_connection& connection, const pi_camera_capabilities& capabilities)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_jpg_quality(camera_service, value);
+	auto capabilities_network = pi_camera_capabilities_to_network(capabilities);
+
+	// the reply still uses the header format the request arrived with
+	if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_HELLO, PI_CAMERA_ERROR_CODE_SUCCESS, &capabilities_network, sizeof(pi_camera_capabilities)))
+		return false;
+
+	connection.capabilities     = capabilities;
+	connection.protocol_version = capabilities.protocol_version;
 
-	return pi_camera_net_complete_set_jpg_quality(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_get_image_size(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+auto pi_camera_config_to_packet_buffer(const pi_camera_config& value)
 {
-	AL::uint16 width, height;
-	AL::uint8  error_code = pi_camera_get_image_size(camera_service, &width, &height);
+	pi_camera_packet_buffer packet_buffer(sizeof(pi_camera_config));
+	auto                    camera_config = reinterpret_cast<pi_camera_config*>(&packet_buffer[0]);
+	camera_config->ev                = AL::BitConverter::HostToNetwork(value.ev);
+	camera_config->iso               = AL::BitConverter::HostToNetwork(value.iso);
+	camera_config->contrast          = AL::BitConverter::HostToNetwork(value.contrast);
+	camera_config->sharpness         = AL::BitConverter::HostToNetwork(value.sharpness);
+	camera_config->brightness        = AL::BitConverter::HostToNetwork(value.brightness);
+	camera_config->saturation        = AL::BitConverter::HostToNetwork(value.saturation);
+	camera_config->white_balance     = AL::BitConverter::HostToNetwork(value.white_balance);
+	camera_config->shutter_speed_us  = AL::BitConverter::HostToNetwork(value.shutter_speed_us);
+	camera_config->exposure_mode     = AL::BitConverter::HostToNetwork(value.exposure_mode);
+	camera_config->metoring_mode     = AL::BitConverter::HostToNetwork(value.metoring_mode);
+	camera_config->jpg_quality       = AL::BitConverter::HostToNetwork(value.jpg_quality);
+	camera_config->image_effect      = AL::BitConverter::HostToNetwork(value.image_effect);
+	camera_config->image_rotation    = AL::BitConverter::HostToNetwork(value.image_rotation);
+	camera_config->image_size_width  = AL::BitConverter::HostToNetwork(value.image_size_width);
+	camera_config->image_size_height = AL::BitConverter::HostToNetwork(value.image_size_height);
+	camera_config->video_bit_rate    = AL::BitConverter::HostToNetwork(value.video_bit_rate);
+	camera_config->video_frame_rate  = AL::BitConverter::HostToNetwork(value.video_frame_rate);
 
-	return pi_camera_net_complete_get_image_size(camera_session->socket, error_code, width, height);
+	return packet_buffer;
 }
-bool pi_camera_service_packet_handler_set_image_size(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+auto pi_camera_config_from_packet_buffer(const void* buffer, AL::size_t size)
 {
-	auto      width      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
-	auto      height     = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&buffer[2]));
-	AL::uint8 error_code = pi_camera_set_image_size(camera_service, width, height);
+	pi_camera_config camera_config;
+	auto             camera_config_src = reinterpret_cast<const pi_camera_config*>(buffer);
+
+	camera_config.ev                = AL::BitConverter::NetworkToHost(camera_config_src->ev);
+	camera_config.iso               = AL::BitConverter::NetworkToHost(camera_config_src->iso);
+	camera_config.contrast          = AL::BitConverter::NetworkToHost(camera_config_src->contrast);
+	camera_config.sharpness         = AL::BitConverter::NetworkToHost(camera_config_src->sharpness);
+	camera_config.brightness        = AL::BitConverter::NetworkToHost(camera_config_src->brightness);
+	camera_config.saturation        = AL::BitConverter::NetworkToHost(camera_config_src->saturation);
+	camera_config.white_balance     = AL::BitConverter::NetworkToHost(camera_config_src->white_balance);
+	camera_config.shutter_speed_us  = AL::BitConverter::NetworkToHost(camera_config_src->shutter_speed_us);
+	camera_config.exposure_mode     = AL::BitConverter::NetworkToHost(camera_config_src->exposure_mode);
+	camera_config.metoring_mode     = AL::BitConverter::NetworkToHost(camera_config_src->metoring_mode);
+	camera_config.jpg_quality       = AL::BitConverter::NetworkToHost(camera_config_src->jpg_quality);
+	camera_config.image_effect      = AL::BitConverter::NetworkToHost(camera_config_src->image_effect);
+	camera_config.image_rotation    = AL::BitConverter::NetworkToHost(camera_config_src->image_rotation);
+	camera_config.image_size_width  = AL::BitConverter::NetworkToHost(camera_config_src->image_size_width);
+	camera_config.image_size_height = AL::BitConverter::NetworkToHost(camera_config_src->image_size_height);
+	camera_config.video_bit_rate    = AL::BitConverter::NetworkToHost(camera_config_src->video_bit_rate);
+	camera_config.video_frame_rate  = AL::BitConverter::NetworkToHost(camera_config_src->video_frame_rate);
 
-	return pi_camera_net_complete_set_image_size(camera_session->socket, error_code, width, height);
+	return camera_config;
 }
-bool pi_camera_service_packet_handler_get_image_effect(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+typedef AL::Collections::Array<pi_camera_property> pi_camera_property_list;
+
+// @return false if property.id is unknown
+bool pi_camera_config_get_property(const pi_camera_config& config, pi_camera_property& property)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_image_effect(camera_service, &value);
+	switch (property.id)
+	{
+		case PI_CAMERA_PROPERTY_EV:               property.value = static_cast<AL::uint64>(static_cast<AL::int64>(config.ev));                                break;
+		case PI_CAMERA_PROPERTY_ISO:              property.value = config.iso;                                                                                break;
+		case PI_CAMERA_PROPERTY_CONTRAST:         property.value = static_cast<AL::uint64>(static_cast<AL::int64>(config.contrast));                          break;
+		case PI_CAMERA_PROPERTY_SHARPNESS:        property.value = static_cast<AL::uint64>(static_cast<AL::int64>(config.sharpness));                         break;
+		case PI_CAMERA_PROPERTY_BRIGHTNESS:       property.value = static_cast<AL::uint8>(config.brightness);                                                 break;
+		case PI_CAMERA_PROPERTY_SATURATION:       property.value = static_cast<AL::uint64>(static_cast<AL::int64>(config.saturation));                        break;
+		case PI_CAMERA_PROPERTY_WHITE_BALANCE:    property.value = config.white_balance;                                                                      break;
+		case PI_CAMERA_PROPERTY_SHUTTER_SPEED:    property.value = config.shutter_speed_us;                                                                   break;
+		case PI_CAMERA_PROPERTY_EXPOSURE_MODE:    property.value = config.exposure_mode;                                                                      break;
+		case PI_CAMERA_PROPERTY_METORING_MODE:    property.value = config.metoring_mode;                                                                      break;
+		case PI_CAMERA_PROPERTY_JPG_QUALITY:      property.value = config.jpg_quality;                                                                        break;
+		case PI_CAMERA_PROPERTY_IMAGE_SIZE:       property.value = (static_cast<AL::uint64>(config.image_size_width) << 16) | config.image_size_height;       break;
+		case PI_CAMERA_PROPERTY_IMAGE_EFFECT:     property.value = config.image_effect;                                                                       break;
+		case PI_CAMERA_PROPERTY_IMAGE_ROTATION:   property.value = config.image_rotation;                                                                     break;
+		case PI_CAMERA_PROPERTY_VIDEO_BIT_RATE:   property.value = config.video_bit_rate;                                                                     break;
+		case PI_CAMERA_PROPERTY_VIDEO_FRAME_RATE: property.value = config.video_frame_rate;                                                                   break;
+		default:                                  return false;
+	}
 
-	return pi_camera_net_complete_get_image_effect(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_set_image_effect(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return false if property.id is unknown
+bool pi_camera_config_set_property(pi_camera_config& config, const pi_camera_property& property)
 {
-	auto      value      = buffer[0];
-	AL::uint8 error_code = pi_camera_set_image_effect(camera_service, value);
+	switch (property.id)
+	{
+		case PI_CAMERA_PROPERTY_EV:               config.ev                = static_cast<AL::int8>(property.value);   break;
+		case PI_CAMERA_PROPERTY_ISO:              config.iso               = static_cast<AL::uint16>(property.value); break;
+		case PI_CAMERA_PROPERTY_CONTRAST:         config.contrast          = static_cast<AL::int8>(property.value);   break;
+		case PI_CAMERA_PROPERTY_SHARPNESS:        config.sharpness         = static_cast<AL::int8>(property.value);   break;
+		case PI_CAMERA_PROPERTY_BRIGHTNESS:       config.brightness        = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_SATURATION:       config.saturation        = static_cast<AL::int8>(property.value);   break;
+		case PI_CAMERA_PROPERTY_WHITE_BALANCE:    config.white_balance     = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_SHUTTER_SPEED:    config.shutter_speed_us  = property.value;                          break;
+		case PI_CAMERA_PROPERTY_EXPOSURE_MODE:    config.exposure_mode     = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_METORING_MODE:    config.metoring_mode     = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_JPG_QUALITY:      config.jpg_quality       = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_IMAGE_SIZE:
+			config.image_size_width  = static_cast<AL::uint16>((property.value >> 16) & 0xFFFF);
+			config.image_size_height = static_cast<AL::uint16>(property.value & 0xFFFF);
+			break;
+		case PI_CAMERA_PROPERTY_IMAGE_EFFECT:     config.image_effect      = static_cast<AL::uint8>(property.value);  break;
+		case PI_CAMERA_PROPERTY_IMAGE_ROTATION:   config.image_rotation    = static_cast<AL::uint16>(property.value); break;
+		case PI_CAMERA_PROPERTY_VIDEO_BIT_RATE:   config.video_bit_rate    = static_cast<AL::uint32>(property.value); break;
+		case PI_CAMERA_PROPERTY_VIDEO_FRAME_RATE: config.video_frame_rate  = static_cast<AL::uint8>(property.value);  break;
+		default:                                  return false;
+	}
 
-	return pi_camera_net_complete_set_image_effect(camera_session->socket, error_code, value);
+	return true;
 }
-bool pi_camera_service_packet_handler_get_image_rotation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+auto pi_camera_properties_to_packet_buffer(const pi_camera_property* values, AL::uint8 count)
 {
-	AL::uint16 value;
-	AL::uint8  error_code = pi_camera_get_image_rotation(camera_service, &value);
+	pi_camera_packet_buffer packet_buffer(count * sizeof(pi_camera_property));
+	auto                    properties = reinterpret_cast<pi_camera_property*>(&packet_buffer[0]);
+
+	for (AL::uint8 i = 0; i < count; ++i)
+	{
+		properties[i].id    = AL::BitConverter::HostToNetwork(values[i].id);
+		properties[i].value = AL::BitConverter::HostToNetwork(values[i].value);
+	}
 
-	return pi_camera_net_complete_get_image_rotation(camera_session->socket, error_code, value);
+	return packet_buffer;
 }
-bool pi_camera_service_packet_handler_set_image_rotation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+// @return false if size is not a whole number of properties
+bool pi_camera_properties_from_packet_buffer(pi_camera_property_list& values, const void* buffer, AL::size_t size)
 {
-	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
-	AL::uint8 error_code = pi_camera_set_image_rotation(camera_service, value);
+	if ((size % sizeof(pi_camera_property)) != 0)
+		return false;
+
+	auto properties = reinterpret_cast<const pi_camera_property*>(buffer);
 
-	return pi_camera_net_complete_set_image_rotation(camera_session->socket, error_code, value);
+	values.SetCapacity(size / sizeof(pi_camera_property));
+
+	for (AL::size_t i = 0; i < values.GetSize(); ++i)
+	{
+		values[i].id    = AL::BitConverter::NetworkToHost(properties[i].id);
+		values[i].value = AL::BitConverter::NetworkToHost(properties[i].value);
+	}
+
+	return true;
 }
-bool pi_camera_service_packet_handler_get_video_bit_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+AL::uint8 pi_camera_net_begin_is_busy(pi_camera_connection& connection, bool& value)
 {
-	AL::uint32 value;
-	AL::uint8  error_code = pi_camera_get_video_bit_rate(camera_service, &value);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_IS_BUSY, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = static_cast<bool>(packet_buffer[0]);
 
-	return pi_camera_net_complete_get_video_bit_rate(camera_session->socket, error_code, value);
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-bool pi_camera_service_packet_handler_set_video_bit_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+bool      pi_camera_net_complete_is_busy(pi_camera_connection& connection, AL::uint8 error_code, bool value)
 {
-	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
-	AL::uint8 error_code = pi_camera_set_video_bit_rate(camera_service, value);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_IS_BUSY, error_code, nullptr, 0);
 
-	return pi_camera_net_complete_set_video_bit_rate(camera_session->socket, error_code, value);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_IS_BUSY, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(bool));
 }
-bool pi_camera_service_packet_handler_get_video_frame_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+
+AL::uint8 pi_camera_net_begin_get_ev(pi_camera_connection& connection, AL::int8& value)
 {
-	AL::uint8 value;
-	AL::uint8 error_code = pi_camera_get_video_frame_rate(camera_service, &value);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_EV, nullptr, 0))
+		return 0;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-	return pi_camera_net_complete_get_video_frame_rate(camera_session->socket, error_code, value);
+	value = static_cast<AL::int8>(packet_buffer[0]);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-bool pi_camera_service_packet_handler_set_video_frame_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+bool      pi_camera_net_complete_get_ev(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	AL::uint8 error_code = pi_camera_set_video_frame_rate(camera_service, *buffer);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_EV, error_code, nullptr, 0);
 
-	return pi_camera_net_complete_set_video_frame_rate(camera_session->socket, error_code, *buffer);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_EV, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
 }
-bool pi_camera_service_packet_handler_capture(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+AL::uint8 pi_camera_net_begin_set_ev(pi_camera_connection& connection, AL::int8 value)
 {
-	auto      file_path  = AL::String::Format("./pi_image_%llu.jpg", ++camera_service->image_counter);
-	AL::uint8 error_code = pi_camera_capture(camera_service, file_path.GetCString(), nullptr, nullptr);
-	bool      result     = pi_camera_net_complete_capture(camera_session->socket, error_code, file_path.GetCString());
-
-	pi_camera_file_delete(file_path.GetCString());
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_EV, &value, sizeof(AL::int8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	return result;
+	return pi_camera_net_receive_set_reply(connection);
 }
-bool pi_camera_service_packet_handler_capture_video(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+bool      pi_camera_net_complete_set_ev(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	auto      video_length_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
-	auto      file_path            = AL::String::Format("./pi_video_%llu.mp4", ++camera_service->video_counter);
-	AL::uint8 error_code           = pi_camera_capture_video(camera_service, file_path.GetCString(), video_length_seconds, nullptr, nullptr);
-	bool      result               = pi_camera_net_complete_capture_video(camera_session->socket, error_code, file_path.GetCString());
-
-	pi_camera_file_delete(file_path.GetCString());
-
-	return result;
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_EV, error_code, nullptr, 0);
 }
 
-constexpr pi_camera_service_packet_handler_context pi_camera_service_packet_handlers[PI_CAMERA_OPCODE_COUNT] =
+AL::uint8 pi_camera_net_begin_get_iso(pi_camera_connection& connection, AL::uint16& value)
 {
-	{ PI_CAMERA_OPCODE_IS_BUSY,              &pi_camera_service_packet_handler_is_busy },
-
-	{ PI_CAMERA_OPCODE_GET_EV,               &pi_camera_service_packet_handler_get_ev },
-	{ PI_CAMERA_OPCODE_SET_EV,               &pi_camera_service_packet_handler_set_ev },
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_ISO, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	{ PI_CAMERA_OPCODE_GET_ISO,              &pi_camera_service_packet_handler_get_iso },
-	{ PI_CAMERA_OPCODE_SET_ISO,              &pi_camera_service_packet_handler_set_iso },
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-	{ PI_CAMERA_OPCODE_GET_CONFIG,           &pi_camera_service_packet_handler_get_config },
-	{ PI_CAMERA_OPCODE_SET_CONFIG,           &pi_camera_service_packet_handler_set_config },
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	{ PI_CAMERA_OPCODE_GET_CONTRAST,         &pi_camera_service_packet_handler_get_contrast },
-	{ PI_CAMERA_OPCODE_SET_CONTRAST,         &pi_camera_service_packet_handler_set_contrast },
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-	{ PI_CAMERA_OPCODE_GET_SHARPNESS,        &pi_camera_service_packet_handler_get_sharpness },
-	{ PI_CAMERA_OPCODE_SET_SHARPNESS,        &pi_camera_service_packet_handler_set_sharpness },
+	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
 
-	{ PI_CAMERA_OPCODE_GET_BRIGHTNESS,       &pi_camera_service_packet_handler_get_brightness },
-	{ PI_CAMERA_OPCODE_SET_BRIGHTNESS,       &pi_camera_service_packet_handler_set_brightness },
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_iso(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_ISO, error_code, nullptr, 0);
 
-	{ PI_CAMERA_OPCODE_GET_SATURATION,       &pi_camera_service_packet_handler_get_saturation },
-	{ PI_CAMERA_OPCODE_SET_SATURATION,       &pi_camera_service_packet_handler_set_saturation },
+	value = AL::BitConverter::HostToNetwork(value);
 
-	{ PI_CAMERA_OPCODE_GET_WHITE_BALANCE,    &pi_camera_service_packet_handler_get_white_balance },
-	{ PI_CAMERA_OPCODE_SET_WHITE_BALANCE,    &pi_camera_service_packet_handler_set_white_balance },
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_ISO, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint16));
+}
+AL::uint8 pi_camera_net_begin_set_iso(pi_camera_connection& connection, AL::uint16 value)
+{
+	value = AL::BitConverter::HostToNetwork(value);
 
-	{ PI_CAMERA_OPCODE_GET_SHUTTER_SPEED,    &pi_camera_service_packet_handler_get_shutter_speed },
-	{ PI_CAMERA_OPCODE_SET_SHUTTER_SPEED,    &pi_camera_service_packet_handler_set_shutter_speed },
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_ISO, &value, sizeof(AL::uint16)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	{ PI_CAMERA_OPCODE_GET_EXPOSURE_MODE,    &pi_camera_service_packet_handler_get_exposure_mode },
-	{ PI_CAMERA_OPCODE_SET_EXPOSURE_MODE,    &pi_camera_service_packet_handler_set_exposure_mode },
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_iso(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 value)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_ISO, error_code, nullptr, 0);
+}
 
-	{ PI_CAMERA_OPCODE_GET_METORING_MODE,    &pi_camera_service_packet_handler_get_metoring_mode },
-	{ PI_CAMERA_OPCODE_SET_METORING_MODE,    &pi_camera_service_packet_handler_set_metoring_mode },
+AL::uint8 pi_camera_net_begin_get_config(pi_camera_connection& connection, pi_camera_config& value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_CONFIG, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	{ PI_CAMERA_OPCODE_GET_JPG_QUALITY,      &pi_camera_service_packet_handler_get_jpg_quality },
-	{ PI_CAMERA_OPCODE_SET_JPG_QUALITY,      &pi_camera_service_packet_handler_set_jpg_quality },
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-	{ PI_CAMERA_OPCODE_GET_IMAGE_SIZE,       &pi_camera_service_packet_handler_get_image_size },
-	{ PI_CAMERA_OPCODE_SET_IMAGE_SIZE,       &pi_camera_service_packet_handler_set_image_size },
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	{ PI_CAMERA_OPCODE_GET_IMAGE_EFFECT,     &pi_camera_service_packet_handler_get_image_effect },
-	{ PI_CAMERA_OPCODE_SET_IMAGE_EFFECT,     &pi_camera_service_packet_handler_set_image_effect },
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-	{ PI_CAMERA_OPCODE_GET_IMAGE_ROTATION,   &pi_camera_service_packet_handler_get_image_rotation },
-	{ PI_CAMERA_OPCODE_SET_IMAGE_ROTATION,   &pi_camera_service_packet_handler_set_image_rotation },
+	value = pi_camera_config_from_packet_buffer(&packet_buffer[0], packet_buffer.GetSize());
 
-	{ PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE,   &pi_camera_service_packet_handler_get_video_bit_rate },
-	{ PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE,   &pi_camera_service_packet_handler_set_video_bit_rate },
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_config(pi_camera_connection& connection, AL::uint8 error_code, const pi_camera_config& value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CONFIG, error_code, nullptr, 0);
 
-	{ PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, &pi_camera_service_packet_handler_get_video_frame_rate },
-	{ PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE, &pi_camera_service_packet_handler_set_video_frame_rate },
+	auto packet_buffer = pi_camera_config_to_packet_buffer(value);
 
-	{ PI_CAMERA_OPCODE_FILE_TRANSFER,        nullptr },
-	{ PI_CAMERA_OPCODE_FILE_TRANSFER_ACK,    nullptr },
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CONFIG, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize()));
+}
+AL::uint8 pi_camera_net_begin_set_config(pi_camera_connection& connection, const pi_camera_config& value)
+{
+	auto packet_buffer = pi_camera_config_to_packet_buffer(value);
 
-	{ PI_CAMERA_OPCODE_CAPTURE,              &pi_camera_service_packet_handler_capture },
-	{ PI_CAMERA_OPCODE_CAPTURE_VIDEO,        &pi_camera_service_packet_handler_capture_video }
-};
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_CONFIG, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize())))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-template<AL::size_t ... INDEXES>
-constexpr bool pi_camera_service_packet_handlers_is_valid(AL::Index_Sequence<INDEXES ...>)
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_config(pi_camera_connection& connection, AL::uint8 error_code, const pi_camera_config& value)
 {
-	return ((pi_camera_service_packet_handlers[INDEXES].opcode == INDEXES) && ...);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_CONFIG, error_code, nullptr, 0);
 }
 
-static_assert(pi_camera_service_packet_handlers_is_valid(typename AL::Make_Index_Sequence<PI_CAMERA_OPCODE_COUNT>::Type {}));
-
-AL::uint8 pi_camera_open_session(pi_camera_session** camera_session, pi_camera_service* camera_service, AL::Network::TcpSocket&& socket);
-
-bool      pi_camera_service_accept_session(pi_camera_service* camera_service, pi_camera_session*& camera_session)
+AL::uint8 pi_camera_net_begin_get_properties(pi_camera_connection& connection, pi_camera_property* values, AL::uint8 count)
 {
-	AL::Network::TcpSocket socket(camera_service->socket.GetAddressFamily());
+	auto packet_buffer = pi_camera_properties_to_packet_buffer(values, count);
 
-	switch (pi_camera_net_socket_accept(camera_service->socket, socket))
-	{
-		case 0:                            return false;
-		case -1: camera_session = nullptr; return true;
-	}
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_PROPERTIES, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize())))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	if (pi_camera_open_session(&camera_session, camera_service, AL::Move(socket)) != PI_CAMERA_ERROR_CODE_SUCCESS)
-	{
-		socket.Close();
+	pi_camera_packet_header packet_header;
 
-		return false;
-	}
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	return true;
-}
-bool      pi_camera_service_update_session(pi_camera_service* camera_service, pi_camera_session* camera_session)
-{
-	pi_camera_packet_header packet_header;
-	pi_camera_packet_buffer packet_buffer;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-	switch (pi_camera_net_receive_packet(camera_session->socket, packet_header, packet_buffer))
-	{
-		case 0:  return false;
-		case -1: return true;
-	}
+	pi_camera_property_list properties;
 
-	if (packet_header.opcode >= PI_CAMERA_OPCODE_COUNT)
+	if (!pi_camera_properties_from_packet_buffer(properties, &packet_buffer[0], packet_header.buffer_size) || (properties.GetSize() != count))
 	{
-		pi_camera_net_socket_close(camera_session->socket);
+		pi_camera_net_socket_close(connection.socket);
 
-		return false;
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 	}
 
-	auto packet_handler = pi_camera_service_packet_handlers[packet_header.opcode].packet_handler;
-
-	if ((packet_handler == nullptr) || !packet_handler(camera_service, camera_session, packet_header, &packet_buffer[0], packet_header.buffer_size))
-	{
-		pi_camera_net_socket_close(camera_session->socket);
+	for (AL::uint8 i = 0; i < count; ++i)
+		values[i].value = properties[i].value;
 
-		return false;
-	}
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_properties(pi_camera_connection& connection, AL::uint8 error_code, const pi_camera_property* values, AL::uint8 count)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_PROPERTIES, error_code, nullptr, 0);
 
-	return true;
+	auto packet_buffer = pi_camera_properties_to_packet_buffer(values, count);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_PROPERTIES, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize()));
 }
-bool      pi_camera_service_update(pi_camera_service* camera_service)
+AL::uint8 pi_camera_net_begin_set_properties(pi_camera_connection& connection, const pi_camera_property* values, AL::uint8 count)
 {
-	pi_camera_session* camera_session;
+	auto packet_buffer = pi_camera_properties_to_packet_buffer(values, count);
 
-	while (camera_service->sessions.GetSize() < camera_service->max_connections)
-	{
-		if (!pi_camera_service_accept_session(camera_service, camera_session))
-			return false;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_PROPERTIES, &packet_buffer[0], static_cast<AL::uint32>(packet_buffer.GetSize())))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		if (camera_session == nullptr)
-			break;
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_properties(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_PROPERTIES, error_code, nullptr, 0);
+}
 
-		camera_service->sessions.PushBack(camera_session);
-	}
+AL::uint8 pi_camera_net_begin_get_contrast(pi_camera_connection& connection, AL::int8& value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_CONTRAST, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	for (auto it = camera_service->sessions.begin(); it != camera_service->sessions.end(); )
-	{
-		if (!pi_camera_service_update_session(camera_service, *it))
-		{
-			camera_service->sessions.Erase(it++);
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-			continue;
-		}
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		++it;
-	}
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-	return true;
+	value = static_cast<AL::int8>(packet_buffer[0]);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-void      pi_camera_service_thread_main(pi_camera_service* camera_service)
+bool      pi_camera_net_complete_get_contrast(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	AL::Game::Loop::Run(PI_CAMERA_SERVICE_TICK_RATE, [camera_service](AL::TimeSpan delta)
-	{
-		if (camera_service->is_thread_stopping)
-			return AL::False;
-
-		if (!pi_camera_service_update(camera_service))
-			return AL::False;
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CONTRAST, error_code, nullptr, 0);
 
-		return AL::True;
-	});
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CONTRAST, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
 }
-bool      pi_camera_service_thread_start(pi_camera_service* camera_service)
+AL::uint8 pi_camera_net_begin_set_contrast(pi_camera_connection& connection, AL::int8 value)
 {
-	try
-	{
-		camera_service->thread.Start([camera_service]()
-		{
-			pi_camera_service_thread_main(camera_service);
-		});
-	}
-	catch (const AL::Exception& exception)
-	{
-
-		return false;
-	}
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_CONTRAST, &value, sizeof(AL::int8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	return true;
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_service_thread_stop(pi_camera_service* camera_service)
+bool      pi_camera_net_complete_set_contrast(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	camera_service->is_thread_stopping = true;
-
-	try
-	{
-		while (!camera_service->thread.Join())
-		{
-		}
-	}
-	catch (const AL::Exception& exception)
-	{
-	}
-
-	camera_service->is_thread_stopping = false;
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_CONTRAST, error_code, nullptr, 0);
 }
-AL::uint8 pi_camera_service_start(pi_camera_service* camera_service)
+
+AL::uint8 pi_camera_net_begin_get_sharpness(pi_camera_connection& connection, AL::int8& value)
 {
-	if (!pi_camera_net_socket_listen(camera_service->socket, camera_service->local_end_point, camera_service->max_connections))
-		return PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_SHARPNESS, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	if (!pi_camera_service_thread_start(camera_service))
-	{
-		pi_camera_net_socket_close(camera_service->socket);
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
-	}
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = static_cast<AL::int8>(packet_buffer[0]);
 
 	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-void      pi_camera_service_stop(pi_camera_service* camera_service)
+bool      pi_camera_net_complete_get_sharpness(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	pi_camera_service_thread_stop(camera_service);
-	pi_camera_net_socket_close(camera_service->socket);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SHARPNESS, error_code, nullptr, 0);
 
-	for (auto it = camera_service->sessions.begin(); it != camera_service->sessions.end(); )
-	{
-		pi_camera_close(*it);
-		camera_service->sessions.Erase(it++);
-	}
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SHARPNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
 }
+AL::uint8 pi_camera_net_begin_set_sharpness(pi_camera_connection& connection, AL::int8 value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_SHARPNESS, &value, sizeof(AL::int8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-inline auto pi_camera_clamp_ev(AL::int8 value)
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_sharpness(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_EV_MIN, PI_CAMERA_EV_MAX);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_SHARPNESS, error_code, nullptr, 0);
 }
-inline auto pi_camera_clamp_iso(AL::uint16 value)
+
+AL::uint8 pi_camera_net_begin_get_brightness(pi_camera_connection& connection, AL::uint8& value)
 {
-	return AL::Math::Clamp<AL::uint16>(value, PI_CAMERA_ISO_MIN, PI_CAMERA_ISO_MAX);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_BRIGHTNESS, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = packet_buffer[0];
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-inline auto pi_camera_clamp_contrast(AL::int8 value)
+bool      pi_camera_net_complete_get_brightness(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_CONTRAST_MIN, PI_CAMERA_CONTRAST_MIN);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_BRIGHTNESS, error_code, nullptr, 0);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_BRIGHTNESS, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
 }
-inline auto pi_camera_clamp_sharpness(AL::int8 value)
+AL::uint8 pi_camera_net_begin_set_brightness(pi_camera_connection& connection, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_SHARPNESS_MIN, PI_CAMERA_SHARPNESS_MIN);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_BRIGHTNESS, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-inline auto pi_camera_clamp_brightness(AL::uint8 value)
+bool      pi_camera_net_complete_set_brightness(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_BRIGHTNESS_MIN, PI_CAMERA_BRIGHTNESS_MIN);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_BRIGHTNESS, error_code, nullptr, 0);
 }
-inline auto pi_camera_clamp_saturation(AL::int8 value)
+
+AL::uint8 pi_camera_net_begin_get_saturation(pi_camera_connection& connection, AL::int8& value)
 {
-	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_SATURATION_MIN, PI_CAMERA_SATURATION_MIN);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_SATURATION, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = static_cast<AL::int8>(packet_buffer[0]);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-inline auto pi_camera_clamp_shutter_speed(AL::uint64 value)
+bool      pi_camera_net_complete_get_saturation(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	return value;
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SATURATION, error_code, nullptr, 0);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SATURATION, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::int8));
 }
-inline auto pi_camera_clamp_jpg_quality(AL::uint8 value)
+AL::uint8 pi_camera_net_begin_set_saturation(pi_camera_connection& connection, AL::int8& value)
 {
-	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_JPG_QUALITY_MIN, PI_CAMERA_JPG_QUALITY_MAX);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_SATURATION, &value, sizeof(AL::int8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-inline auto pi_camera_clamp_image_size_width(AL::uint16 value)
+bool      pi_camera_net_complete_set_saturation(pi_camera_connection& connection, AL::uint8 error_code, AL::int8 value)
 {
-	return AL::Math::Clamp<AL::uint16>(value, 0, PI_CAMERA_IMAGE_SIZE_WIDTH_MAX);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_SATURATION, error_code, nullptr, 0);
 }
-inline auto pi_camera_clamp_image_size_height(AL::uint16 value)
+
+AL::uint8 pi_camera_net_begin_get_white_balance(pi_camera_connection& connection, AL::uint8& value)
 {
-	return AL::Math::Clamp<AL::uint16>(value, 0, PI_CAMERA_IMAGE_SIZE_HEIGHT_MAX);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = packet_buffer[0];
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-inline auto pi_camera_clamp_image_rotation(AL::uint16 value)
+bool      pi_camera_net_complete_get_white_balance(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::uint16>(value, PI_CAMERA_IMAGE_ROTATION_MIN, PI_CAMERA_IMAGE_ROTATION_MAX);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, error_code, nullptr, 0);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_WHITE_BALANCE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
 }
-inline auto pi_camera_clamp_video_bit_rate(AL::uint32 value)
+AL::uint8 pi_camera_net_begin_set_white_balance(pi_camera_connection& connection, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::uint32>(value, 1, AL::Integer<AL::uint32>::Maximum);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_WHITE_BALANCE, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-inline auto pi_camera_clamp_video_frame_rate(AL::uint8 value)
+bool      pi_camera_net_complete_set_white_balance(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_VIDEO_FRAME_RATE_MIN, PI_CAMERA_VIDEO_FRAME_RATE_MAX);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_WHITE_BALANCE, error_code, nullptr, 0);
 }
 
-AL::uint8 pi_camera_cli_execute(pi_camera_local* camera_local, const char* file_path)
+AL::uint8 pi_camera_net_begin_get_shutter_speed(pi_camera_connection& connection, AL::uint64& value)
 {
-	if (camera_local->is_busy)
-		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	try
-	{
-		AL::OS::Shell::Execute(
-			"raspistill",
-			AL::String::Format("%s -o \"%s\"", camera_local->cli_params.GetCString(), file_path)
-		);
-	}
-	catch (const AL::Exception& exception)
-	{
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
-	}
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
 
 	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-template<typename T>
-void      pi_camera_cli_build_params_append(AL::StringBuilder& sb, const char* key, T value)
+bool      pi_camera_net_complete_get_shutter_speed(pi_camera_connection& connection, AL::uint8 error_code, AL::uint64 value)
 {
-	if (sb.GetLength() != 0)
-		sb.Append(' ');
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, error_code, nullptr, 0);
 
-	sb << key << ' ' << value;
+	auto time = AL::BitConverter::HostToNetwork(value);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_SHUTTER_SPEED, PI_CAMERA_ERROR_CODE_SUCCESS, &time, sizeof(AL::uint64));
 }
-void      pi_camera_cli_build_params_append_ev(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+AL::uint8 pi_camera_net_begin_set_shutter_speed(pi_camera_connection& connection, AL::uint64 value)
 {
-	pi_camera_cli_build_params_append(sb, "-ev", camera_config.ev);
+	value = AL::BitConverter::HostToNetwork(value);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_SHUTTER_SPEED, &value, sizeof(AL::uint64)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_cli_build_params_append_iso(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_set_shutter_speed(pi_camera_connection& connection, AL::uint8 error_code, AL::uint64 value)
 {
-	pi_camera_cli_build_params_append(sb, "-ISO", camera_config.iso);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_SHUTTER_SPEED, error_code, nullptr, 0);
 }
-void      pi_camera_cli_build_params_append_contrast(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+
+AL::uint8 pi_camera_net_begin_get_exposure_mode(pi_camera_connection& connection, AL::uint8& value)
 {
-	pi_camera_cli_build_params_append(sb, "-co", camera_config.contrast);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = packet_buffer[0];
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-void      pi_camera_cli_build_params_append_sharpness(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_get_exposure_mode(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	pi_camera_cli_build_params_append(sb, "-sh", camera_config.sharpness);
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, error_code, nullptr, 0);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_EXPOSURE_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
 }
-void      pi_camera_cli_build_params_append_brightness(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+AL::uint8 pi_camera_net_begin_set_exposure_mode(pi_camera_connection& connection, AL::uint8 value)
 {
-	pi_camera_cli_build_params_append(sb, "-br", camera_config.brightness);
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_EXPOSURE_MODE, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_cli_build_params_append_saturation(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_set_exposure_mode(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	pi_camera_cli_build_params_append(sb, "-sa", camera_config.saturation);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_EXPOSURE_MODE, error_code, nullptr, 0);
 }
-void      pi_camera_cli_build_params_append_white_balance(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+
+AL::uint8 pi_camera_net_begin_get_metoring_mode(pi_camera_connection& connection, AL::uint8& value)
 {
-	switch (camera_config.white_balance)
-	{
-		case PI_CAMERA_WHITE_BALANCE_OFF:
-			pi_camera_cli_build_params_append(sb, "-awb", "off");
-			break;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_METORING_MODE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_WHITE_BALANCE_AUTO:
-			pi_camera_cli_build_params_append(sb, "-awb", "auto");
-			break;
-
-		case PI_CAMERA_WHITE_BALANCE_SUN:
-			pi_camera_cli_build_params_append(sb, "-awb", "sun");
-			break;
-
-		case PI_CAMERA_WHITE_BALANCE_FLASH:
-			pi_camera_cli_build_params_append(sb, "-awb", "flash");
-			break;
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		case PI_CAMERA_WHITE_BALANCE_SHADE:
-			pi_camera_cli_build_params_append(sb, "-awb", "cloudshade");
-			break;
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_WHITE_BALANCE_CLOUDS:
-			pi_camera_cli_build_params_append(sb, "-awb", "cloudshade");
-			break;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-		case PI_CAMERA_WHITE_BALANCE_HORIZON:
-			pi_camera_cli_build_params_append(sb, "-awb", "horizon");
-			break;
+	value = packet_buffer[0];
 
-		case PI_CAMERA_WHITE_BALANCE_TUNGSTEN:
-			pi_camera_cli_build_params_append(sb, "-awb", "tungsten");
-			break;
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_metoring_mode(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_METORING_MODE, error_code, nullptr, 0);
 
-		case PI_CAMERA_WHITE_BALANCE_FLUORESCENT:
-			pi_camera_cli_build_params_append(sb, "-awb", "fluorescent");
-			break;
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_METORING_MODE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+}
+AL::uint8 pi_camera_net_begin_set_metoring_mode(pi_camera_connection& connection, AL::uint8 value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_METORING_MODE, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_WHITE_BALANCE_INCANDESCENT:
-			pi_camera_cli_build_params_append(sb, "-awb", "incandescent");
-			break;
-	}
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_cli_build_params_append_shutter_speed(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_set_metoring_mode(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
 {
-	if (camera_config.shutter_speed_us != 0)
-		pi_camera_cli_build_params_append(sb, "-ss", camera_config.shutter_speed_us);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_METORING_MODE, error_code, nullptr, 0);
 }
-void      pi_camera_cli_build_params_append_exposure_mode(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+
+AL::uint8 pi_camera_net_begin_get_jpg_quality(pi_camera_connection& connection, AL::uint8& value)
 {
-	switch (camera_config.exposure_mode)
-	{
-		case PI_CAMERA_EXPOSURE_MODE_OFF:
-			pi_camera_cli_build_params_append(sb, "-ex", "off");
-			break;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_JPG_QUALITY, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_EXPOSURE_MODE_AUTO:
-			pi_camera_cli_build_params_append(sb, "-ex", "auto");
-			break;
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		case PI_CAMERA_EXPOSURE_MODE_SNOW:
-			pi_camera_cli_build_params_append(sb, "-ex", "snow");
-			break;
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_EXPOSURE_MODE_BEACH:
-			pi_camera_cli_build_params_append(sb, "-ex", "beach");
-			break;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-		case PI_CAMERA_EXPOSURE_MODE_NIGHT:
-			pi_camera_cli_build_params_append(sb, "-ex", "night");
-			break;
+	value = packet_buffer[0];
 
-		case PI_CAMERA_EXPOSURE_MODE_SPORTS:
-			pi_camera_cli_build_params_append(sb, "-ex", "sports");
-			break;
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_jpg_quality(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_JPG_QUALITY, error_code, nullptr, 0);
 
-		case PI_CAMERA_EXPOSURE_MODE_BACKLIGHT:
-			pi_camera_cli_build_params_append(sb, "-ex", "backlight");
-			break;
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_JPG_QUALITY, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+}
+AL::uint8 pi_camera_net_begin_set_jpg_quality(pi_camera_connection& connection, AL::uint8 value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_JPG_QUALITY, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_EXPOSURE_MODE_SPOTLIGHT:
-			pi_camera_cli_build_params_append(sb, "-ex", "spotlight");
-			break;
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_jpg_quality(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_JPG_QUALITY, error_code, nullptr, 0);
+}
 
-		case PI_CAMERA_EXPOSURE_MODE_VERY_LONG:
-			pi_camera_cli_build_params_append(sb, "-ex", "verylong");
-			break;
+AL::uint8 pi_camera_net_begin_get_image_size(pi_camera_connection& connection, AL::uint16& width, AL::uint16& height)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_IMAGE_SIZE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_EXPOSURE_MODE_FIXED_FPS:
-			pi_camera_cli_build_params_append(sb, "-ex", "fixedfps");
-			break;
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		case PI_CAMERA_EXPOSURE_MODE_FIREWORKS:
-			pi_camera_cli_build_params_append(sb, "-ex", "fireworks");
-			break;
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_EXPOSURE_MODE_ANTI_SHAKE:
-			pi_camera_cli_build_params_append(sb, "-ex", "antishake");
-			break;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-		case PI_CAMERA_EXPOSURE_MODE_NIGHT_PREVIEW:
-			pi_camera_cli_build_params_append(sb, "-ex", "nightpreview");
-			break;
-	}
+	width  = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
+	height = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[2]));
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-void      pi_camera_cli_build_params_append_metoring_mode(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_get_image_size(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 width, AL::uint16 height)
 {
-	switch (camera_config.metoring_mode)
-	{
-		case PI_CAMERA_METORING_MODE_SPOT:
-			pi_camera_cli_build_params_append(sb, "-mm", "spot");
-			break;
-
-		case PI_CAMERA_METORING_MODE_MATRIX:
-			pi_camera_cli_build_params_append(sb, "-mm", "matrix");
-			break;
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, error_code, nullptr, 0);
 
-		case PI_CAMERA_METORING_MODE_AVERAGE:
-			pi_camera_cli_build_params_append(sb, "-mm", "average");
-			break;
+	AL::uint16 packet_buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(width),
+		AL::BitConverter::HostToNetwork(height)
+	};
 
-		case PI_CAMERA_METORING_MODE_BACKLIT:
-			pi_camera_cli_build_params_append(sb, "-mm", "backlit");
-			break;
-	}
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, packet_buffer, sizeof(packet_buffer));
 }
-void      pi_camera_cli_build_params_append_jpg_quality(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+AL::uint8 pi_camera_net_begin_set_image_size(pi_camera_connection& connection, AL::uint16 width, AL::uint16 height)
 {
-	pi_camera_cli_build_params_append(sb, "-q", camera_config.jpg_quality);
+	AL::uint16 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(width),
+		AL::BitConverter::HostToNetwork(height)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_IMAGE_SIZE, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_cli_build_params_append_image_size(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+bool      pi_camera_net_complete_set_image_size(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 width, AL::uint16 height)
 {
-	pi_camera_cli_build_params_append(sb, "-w", camera_config.image_size_width);
-	pi_camera_cli_build_params_append(sb, "-h", camera_config.image_size_height);
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_IMAGE_SIZE, error_code, nullptr, 0);
 }
-void      pi_camera_cli_build_params_append_image_effect(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+
+AL::uint8 pi_camera_net_begin_get_image_effect(pi_camera_connection& connection, AL::uint8& value)
 {
-	switch (camera_config.image_effect)
-	{
-		case PI_CAMERA_IMAGE_EFFECT_NONE:
-			break;
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_IMAGE_EFFECT_NEGATIVE:
-			pi_camera_cli_build_params_append(sb, "-ifx", "negative");
-			break;
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		case PI_CAMERA_IMAGE_EFFECT_SOLARISE:
-			pi_camera_cli_build_params_append(sb, "-ifx", "solarise");
-			break;
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_IMAGE_EFFECT_WHITEBOARD:
-			pi_camera_cli_build_params_append(sb, "-ifx", "whiteboard");
-			break;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-		case PI_CAMERA_IMAGE_EFFECT_BLACKBOARD:
-			pi_camera_cli_build_params_append(sb, "-ifx", "blackboard");
-			break;
+	value = packet_buffer[0];
 
-		case PI_CAMERA_IMAGE_EFFECT_SKETCH:
-			pi_camera_cli_build_params_append(sb, "-ifx", "sketch");
-			break;
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_image_effect(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, error_code, nullptr, 0);
 
-		case PI_CAMERA_IMAGE_EFFECT_DENOISE:
-			pi_camera_cli_build_params_append(sb, "-ifx", "denoise");
-			break;
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_EFFECT, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+}
+AL::uint8 pi_camera_net_begin_set_image_effect(pi_camera_connection& connection, AL::uint8 value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_IMAGE_EFFECT, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_IMAGE_EFFECT_EMBOSS:
-			pi_camera_cli_build_params_append(sb, "-ifx", "emboss");
-			break;
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_image_effect(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_IMAGE_EFFECT, error_code, nullptr, 0);
+}
 
-		case PI_CAMERA_IMAGE_EFFECT_OIL_PAINT:
-			pi_camera_cli_build_params_append(sb, "-ifx", "oilpaint");
-			break;
+AL::uint8 pi_camera_net_begin_get_image_rotation(pi_camera_connection& connection, AL::uint16& value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_IMAGE_EFFECT_GRAPHITE_SKETCH:
-			pi_camera_cli_build_params_append(sb, "-ifx", "gpen");
-			break;
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
 
-		case PI_CAMERA_IMAGE_EFFECT_CROSS_HATCH_SKETCH:
-			pi_camera_cli_build_params_append(sb, "-ifx", "hatch");
-			break;
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-		case PI_CAMERA_IMAGE_EFFECT_PASTEL:
-			pi_camera_cli_build_params_append(sb, "-ifx", "pastel");
-			break;
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
 
-		case PI_CAMERA_IMAGE_EFFECT_WATERCOLOR:
-			pi_camera_cli_build_params_append(sb, "-ifx", "watercolour");
-			break;
+	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&packet_buffer[0]));
 
-		case PI_CAMERA_IMAGE_EFFECT_FILM:
-			pi_camera_cli_build_params_append(sb, "-ifx", "film");
-			break;
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_image_rotation(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, error_code, nullptr, 0);
 
-		case PI_CAMERA_IMAGE_EFFECT_BLUR:
-			pi_camera_cli_build_params_append(sb, "-ifx", "blur");
-			break;
+	value = AL::BitConverter::HostToNetwork(value);
 
-		case PI_CAMERA_IMAGE_EFFECT_SATURATE:
-			pi_camera_cli_build_params_append(sb, "-ifx", "saturation");
-			break;
-	}
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_IMAGE_ROTATION, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint16));
 }
-void      pi_camera_cli_build_params_append_image_rotation(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+AL::uint8 pi_camera_net_begin_set_image_rotation(pi_camera_connection& connection, AL::uint16 value)
 {
-	pi_camera_cli_build_params_append(sb, "-rot", camera_config.image_rotation);
+	auto rotation = AL::BitConverter::HostToNetwork(value);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_IMAGE_ROTATION, &rotation, sizeof(AL::uint16)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
 }
-void      pi_camera_cli_build_params(pi_camera_local* camera_local)
+bool      pi_camera_net_complete_set_image_rotation(pi_camera_connection& connection, AL::uint8 error_code, AL::uint16 value)
 {
-	// https://www.raspberrypi.org/app/uploads/2013/07/RaspiCam-Documentation.pdf
-	// https://github.com/raspberrypi/userland/blob/master/host_applications/linux/apps/raspicam/RaspiStill.c
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_IMAGE_ROTATION, error_code, nullptr, 0);
+}
 
-	AL::StringBuilder sb;
+AL::uint8 pi_camera_net_begin_get_video_bit_rate(pi_camera_connection& connection, AL::uint32& value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
 
-	pi_camera_cli_build_params_append_ev(sb, camera_local->config);
-	pi_camera_cli_build_params_append_iso(sb, camera_local->config);
-	pi_camera_cli_build_params_append_contrast(sb, camera_local->config);
-	pi_camera_cli_build_params_append_sharpness(sb, camera_local->config);
-	pi_camera_cli_build_params_append_brightness(sb, camera_local->config);
-	pi_camera_cli_build_params_append_saturation(sb, camera_local->config);
-	pi_camera_cli_build_params_append_white_balance(sb, camera_local->config);
-	pi_camera_cli_build_params_append_shutter_speed(sb, camera_local->config);
-	pi_camera_cli_build_params_append_exposure_mode(sb, camera_local->config);
-	pi_camera_cli_build_params_append_metoring_mode(sb, camera_local->config);
-	pi_camera_cli_build_params_append_jpg_quality(sb, camera_local->config);
-	pi_camera_cli_build_params_append_image_size(sb, camera_local->config);
-	pi_camera_cli_build_params_append_image_effect(sb, camera_local->config);
-	pi_camera_cli_build_params_append_image_rotation(sb, camera_local->config);
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&packet_buffer[0]));
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_video_bit_rate(pi_camera_connection& connection, AL::uint8 error_code, AL::uint32 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, error_code, nullptr, 0);
+
+	value = AL::BitConverter::HostToNetwork(value);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint32));
+}
+AL::uint8 pi_camera_net_begin_set_video_bit_rate(pi_camera_connection& connection, AL::uint32 value)
+{
+	auto rotation = AL::BitConverter::HostToNetwork(value);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE, &rotation, sizeof(AL::uint32)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_video_bit_rate(pi_camera_connection& connection, AL::uint8 error_code, AL::uint32 value)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE, error_code, nullptr, 0);
+}
+
+AL::uint8 pi_camera_net_begin_get_video_frame_rate(pi_camera_connection& connection, AL::uint8& value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	value = packet_buffer[0];
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_get_video_frame_rate(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, error_code, nullptr, 0);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE, PI_CAMERA_ERROR_CODE_SUCCESS, &value, sizeof(AL::uint8));
+}
+AL::uint8 pi_camera_net_begin_set_video_frame_rate(pi_camera_connection& connection, AL::uint8 value)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE, &value, sizeof(AL::uint8)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_receive_set_reply(connection);
+}
+bool      pi_camera_net_complete_set_video_frame_rate(pi_camera_connection& connection, AL::uint8 error_code, AL::uint8 value)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE, error_code, nullptr, 0);
+}
+
+// @return 0 on error
+// @return -1 if transfer was cancelled
+// @return 2 if no ack arrived yet, only when block_once is set
+int       pi_camera_net_receive_file_transfer_ack(pi_camera_connection& connection, pi_camera_packet_buffer& packet_buffer, AL::uint64 number_of_bytes_sent, AL::uint64& number_of_bytes_acked, bool block_once)
+{
+	pi_camera_packet_header packet_header;
+
+	switch (pi_camera_net_receive_packet(connection, packet_header, packet_buffer, block_once))
+	{
+		case 0:  return 0;
+		case -1: return 2;
+	}
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return -1;
+
+	// clients that predate windowed transfers send empty acks
+	if (packet_header.buffer_size < sizeof(AL::uint64))
+		number_of_bytes_acked = number_of_bytes_sent;
+	else
+		number_of_bytes_acked = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+
+	return 1;
+}
+// drops the chunks covered by the ack and tunes the chunk and window size to the rtt and throughput measured with it
+void      pi_camera_net_file_transfer_window_on_ack(pi_camera_connection& connection, pi_camera_file_transfer_window& window, AL::uint64 number_of_bytes_acked, AL::uint64 time_us)
+{
+	AL::uint64 chunk_send_time_us = 0;
+
+	for (; (window.chunk_count > 0) && (window.chunk_ends[window.chunk_index] <= number_of_bytes_acked); --window.chunk_count)
+	{
+		chunk_send_time_us = window.chunk_send_times_us[window.chunk_index];
+		window.chunk_index = (window.chunk_index + 1) % PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX;
+	}
+
+	// acks queued up behind a blocking send are read back to back, so throughput is sampled over at least one chunk time or once everything sent is acked
+	if ((chunk_send_time_us == 0) || (time_us == window.ack_time_us) || ((window.chunk_count != 0) && ((time_us - window.ack_time_us) < (PI_CAMERA_FILE_CHUNK_TIME_MS * 1000))))
+		return;
+
+	pi_camera_transfer_tuning_update(connection.transfer_tuning, connection.capabilities.chunk_size_max, time_us - chunk_send_time_us,
+		((number_of_bytes_acked - window.number_of_bytes_acked) * 1000000) / (time_us - window.ack_time_us));
+
+	window.ack_time_us           = time_us;
+	window.number_of_bytes_acked = number_of_bytes_acked;
+}
+// @param file nullptr on linux, chunks are read from file_handle there
+// @param window_size requested by the client
+// @return 0 on error
+// @return -1 if transfer was cancelled
+int       pi_camera_net_begin_file_transfer_chunks(pi_camera_connection& connection, pi_camera_file* file, int file_handle, AL::uint64 file_size, AL::uint8 window_size, AL::uint64& number_of_bytes_sent)
+{
+	auto&                          tuning = connection.transfer_tuning;
+	AL::OS::Timer                  timer;
+	pi_camera_packet_buffer        packet_buffer;
+	pi_camera_packet_buffer        packet_buffer_ack;
+	pi_camera_file_transfer_window window;
+	// a resumed transfer starts at the offset the client already has
+	AL::uint64                     number_of_bytes_acked = number_of_bytes_sent;
+	window.number_of_bytes_acked = number_of_bytes_sent;
+
+	// the client only acks every half window so fewer chunks in flight would stall it
+	auto window_size_min = AL::Math::Clamp<AL::uint8>(window_size / 2, 1, window_size);
+
+	while (number_of_bytes_sent < file_size)
+	{
+		auto chunk_size = static_cast<AL::uint32>(AL::Math::Lowest<AL::uint64>(pi_camera_transfer_tuning_get_chunk_size(tuning, connection.capabilities.chunk_size_max), (file_size - number_of_bytes_sent)));
+
+		while (window.chunk_count >= AL::Math::Clamp(tuning.window_size, window_size_min, window_size))
+		{
+			switch (pi_camera_net_receive_file_transfer_ack(connection, packet_buffer_ack, number_of_bytes_sent, number_of_bytes_acked, false))
+			{
+				case 0:  return 0;
+				case -1: return -1;
+			}
+
+			pi_camera_net_file_transfer_window_on_ack(connection, window, number_of_bytes_acked, timer.GetElapsed().ToMicroseconds());
+		}
+
+		window.chunk_ends[(window.chunk_index + window.chunk_count) % PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX]          = number_of_bytes_sent + chunk_size;
+		window.chunk_send_times_us[(window.chunk_index + window.chunk_count) % PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE_MAX] = timer.GetElapsed().ToMicroseconds();
+		window.chunk_count++;
+
+#if defined(PI_CAMERA_ZERO_COPY)
+		if (file_handle != -1)
+		{
+			// corked so the header goes out with the start of the chunk
+			pi_camera_net_socket_set_cork(connection.socket, true);
+
+			if (!pi_camera_net_send_packet_header(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_SUCCESS, chunk_size) ||
+				!pi_camera_net_socket_send_file(connection.socket, file_handle, number_of_bytes_sent, chunk_size))
+			{
+				// a socket still open afterwards must not hold back what the caller sends next
+				if (connection.socket.IsConnected())
+					pi_camera_net_socket_set_cork(connection.socket, false);
+
+				return 0;
+			}
+
+			pi_camera_net_socket_set_cork(connection.socket, false);
+		}
+		else
+#endif
+		{
+			if (packet_buffer.GetSize() < chunk_size)
+				packet_buffer.SetCapacity(chunk_size);
+
+#if defined(AL_PLATFORM_LINUX)
+			if (!pi_camera_file_read_at(file_handle, &packet_buffer[0], chunk_size, number_of_bytes_sent))
+#else
+			if (!pi_camera_file_read(file, &packet_buffer[0], chunk_size))
+#endif
+			{
+				if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_READ_ERROR, nullptr, 0))
+					return 0;
+
+				// a windowed client answers the error so the acks still in flight can be drained
+				if (window_size > 1)
+				{
+					int ack_result;
+
+					while ((ack_result = pi_camera_net_receive_file_transfer_ack(connection, packet_buffer_ack, number_of_bytes_sent, number_of_bytes_acked, false)) == 1)
+					{
+					}
+
+					if (ack_result == 0)
+						return 0;
+				}
+
+				return 1;
+			}
+
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_SUCCESS, &packet_buffer[0], chunk_size))
+				return 0;
+		}
+
+		number_of_bytes_sent += chunk_size;
+
+		// acks already waiting are taken now so the rtt isn't stretched by the time spent filling the window
+		for (int ack_result; (ack_result = pi_camera_net_receive_file_transfer_ack(connection, packet_buffer_ack, number_of_bytes_sent, number_of_bytes_acked, true)) != 2; )
+		{
+			switch (ack_result)
+			{
+				case 0:  return 0;
+				case -1: return -1;
+			}
+
+			pi_camera_net_file_transfer_window_on_ack(connection, window, number_of_bytes_acked, timer.GetElapsed().ToMicroseconds());
+		}
+	}
+
+	while (number_of_bytes_acked < file_size)
+	{
+		switch (pi_camera_net_receive_file_transfer_ack(connection, packet_buffer_ack, number_of_bytes_sent, number_of_bytes_acked, false))
+		{
+			case 0:  return 0;
+			case -1: return -1;
+		}
+
+		pi_camera_net_file_transfer_window_on_ack(connection, window, number_of_bytes_acked, timer.GetElapsed().ToMicroseconds());
+	}
+
+	return 1;
+}
+// @param stats can be nullptr
+// @param transfer_id 0 if the transfer can't be resumed
+// @param offset number of bytes the client already has
+bool      pi_camera_net_begin_file_transfer(pi_camera_connection& connection, const char* file_path, pi_camera_transfer_stats* stats, AL::uint64 transfer_id = 0, AL::uint64 offset = 0)
+{
+	AL::uint64 file_size;
+	AL::uint64 cpu_time_us = pi_camera_get_thread_cpu_time_us();
+
+	if (!pi_camera_file_get_size(file_path, file_size))
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR, nullptr, 0);
+
+	if (offset > file_size)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_READ_ERROR, nullptr, 0);
+
+	pi_camera_file* file        = nullptr;
+	int             file_handle = -1;
+
+#if defined(AL_PLATFORM_LINUX)
+	// chunks are read at their offset so a resumed transfer starts there without reading up to it
+	if ((file_handle = ::open(file_path, O_RDONLY | O_CLOEXEC)) == -1)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0);
+
+	::posix_fadvise(file_handle, static_cast<off_t>(offset), 0, POSIX_FADV_SEQUENTIAL);
+#else
+	if ((file = pi_camera_file_open(file_path, true, false)) == nullptr)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0);
+	else if (!pi_camera_file_skip(file, offset))
+	{
+		pi_camera_file_close(file);
+
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_READ_ERROR, nullptr, 0);
+	}
+#endif
+
+	auto file_close = [file, file_handle]()
+	{
+		if (file != nullptr)
+			pi_camera_file_close(file);
+
+#if defined(AL_PLATFORM_LINUX)
+		if (file_handle != -1)
+			::close(file_handle);
+#endif
+	};
+
+	pi_camera_file_transfer_header header =
+	{
+		.file_size       = AL::BitConverter::HostToNetwork(file_size),
+		.window_size_max = connection.capabilities.window_size_max,
+		.transfer_id     = AL::BitConverter::HostToNetwork(transfer_id),
+		.offset          = AL::BitConverter::HostToNetwork(offset)
+	};
+
+	// clients that predate resumable transfers only read up to window_size_max
+	bool is_resumable = (offset != 0) || ((transfer_id != 0) && (connection.capabilities.features & PI_CAMERA_FEATURE_RESUME_FILE_TRANSFER));
+
+	if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_SUCCESS, &header, is_resumable ? sizeof(pi_camera_file_transfer_header) : offsetof(pi_camera_file_transfer_header, transfer_id)))
+	{
+		file_close();
+
+		return false;
+	}
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer_ack;
+
+	if (!pi_camera_net_receive_packet(connection, packet_header, packet_buffer_ack, false))
+	{
+		file_close();
+
+		return false;
+	}
+
+	if (packet_header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		// the client requests how many chunks may be in flight before it has to ack
+		AL::uint8  window_size          = (packet_header.buffer_size < sizeof(AL::uint8)) ? 1 : AL::Math::Clamp<AL::uint8>(packet_buffer_ack[0], 1, connection.capabilities.window_size_max);
+		AL::uint64 number_of_bytes_sent = offset;
+
+		switch (pi_camera_net_begin_file_transfer_chunks(connection, file, file_handle, file_size, window_size, number_of_bytes_sent))
+		{
+			case 0:
+				file_close();
+				return false;
+
+			case -1:
+				file_close();
+				// let a windowed client drain the chunks still in flight
+				return (window_size == 1) || pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER, PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR, nullptr, 0);
+		}
+
+		if (stats != nullptr)
+		{
+			stats->number_of_transfers++;
+			stats->number_of_bytes_sent += number_of_bytes_sent - offset;
+			stats->cpu_time_us          += pi_camera_get_thread_cpu_time_us() - cpu_time_us;
+			stats->chunk_size            = pi_camera_transfer_tuning_get_chunk_size(connection.transfer_tuning, connection.capabilities.chunk_size_max);
+			stats->window_size           = AL::Math::Lowest(connection.transfer_tuning.window_size, window_size);
+			stats->rtt_us                = connection.transfer_tuning.rtt_us;
+			stats->bytes_per_second      = connection.transfer_tuning.bytes_per_second;
+		}
+	}
+
+	file_close();
+
+	return true;
+}
+// services that don't announce a window wait for an ack after every chunk
+// the announcement is capped at the window negotiated in the handshake
+AL::uint8 pi_camera_net_get_file_transfer_window_size(const pi_camera_connection& connection, const pi_camera_packet_header& packet_header, const pi_camera_packet_buffer& packet_buffer)
+{
+	if (packet_header.buffer_size < offsetof(pi_camera_file_transfer_header, transfer_id))
+		return 1;
+
+	auto window_size_max = reinterpret_cast<const pi_camera_file_transfer_header*>(&packet_buffer[0])->window_size_max;
+
+	return AL::Math::Clamp<AL::uint8>(AL::Math::Lowest<AL::uint8>(window_size_max, connection.capabilities.window_size_max), 1, PI_CAMERA_FILE_TRANSFER_WINDOW_SIZE);
+}
+// services that predate resumable transfers end the header after window_size_max
+// @return 0 if the transfer can't be resumed
+AL::uint64 pi_camera_net_get_file_transfer_id(const pi_camera_packet_header& packet_header, const pi_camera_packet_buffer& packet_buffer)
+{
+	if (packet_header.buffer_size < sizeof(pi_camera_file_transfer_header))
+		return 0;
+
+	return AL::BitConverter::NetworkToHost(reinterpret_cast<const pi_camera_file_transfer_header*>(&packet_buffer[0])->transfer_id);
+}
+// cumulative acks at half the window keep the service from stalling on a full window
+// @return 1 if the service waits for every chunk to be acked
+AL::uint8 pi_camera_net_get_file_transfer_ack_interval(AL::uint8 window_size)
+{
+	return (window_size > 1) ? (window_size / 2) : 1;
+}
+bool      pi_camera_net_send_file_transfer_ack(pi_camera_connection& connection, AL::uint64 number_of_bytes_received)
+{
+	number_of_bytes_received = AL::BitConverter::HostToNetwork(number_of_bytes_received);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_SUCCESS, &number_of_bytes_received, sizeof(AL::uint64));
+}
+// discard the chunks still in flight after a cancelled windowed transfer
+bool      pi_camera_net_cancel_file_transfer(pi_camera_connection& connection, pi_camera_packet_buffer& packet_buffer)
+{
+	pi_camera_packet_header packet_header;
+
+	do
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+			return false;
+	} while (packet_header.error_code == PI_CAMERA_ERROR_CODE_SUCCESS);
+
+	return true;
+}
+// @param file_path nullptr to receive into buffer
+// @param buffer points to nullptr to have it allocated with new[]
+// @param buffer_size capacity of a caller supplied buffer, set to the file size
+// @param on_progress_changed can be nullptr
+// @param offset size of the partial file at file_path when resuming a transfer
+AL::uint8 pi_camera_net_complete_file_transfer(pi_camera_connection& connection, const char* file_path, AL::uint8** buffer, AL::uint64* buffer_size, pi_camera_capture_on_progress_changed on_progress_changed, void* param, AL::uint64 offset = 0)
+{
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	if (packet_header.buffer_size < sizeof(AL::uint64))
+	{
+		pi_camera_net_socket_close(connection.socket);
+
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	}
+
+	pi_camera_file* file         = nullptr;
+	bool            is_allocated = false;
+	auto            file_size    = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+	AL::uint8       window_size  = pi_camera_net_get_file_transfer_window_size(connection, packet_header, packet_buffer);
+
+	connection.transfer_id = pi_camera_net_get_file_transfer_id(packet_header, packet_buffer);
+
+	if (file_path != nullptr)
+	{
+		if ((file = pi_camera_file_open(file_path, false, true, offset != 0)) == nullptr)
+		{
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0))
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+		}
+	}
+	else
+	{
+		AL::uint8 error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		// the size comes from the service, it isn't allocated beyond PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX
+		if ((*buffer != nullptr) ? (*buffer_size < file_size) : (file_size > PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX))
+		{
+			*buffer_size = file_size;
+			error_code   = PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL;
+		}
+		else if (*buffer == nullptr)
+		{
+			if ((*buffer = new (std::nothrow) AL::uint8[file_size]) == nullptr)
+				error_code = PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY;
+			else
+				is_allocated = true;
+		}
+
+		if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, error_code, nullptr, 0))
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			return error_code;
+		}
+	}
+
+	// an allocated buffer is only handed to the caller once the transfer completes
+	auto file_close = [file, is_allocated, buffer](bool is_complete)
+	{
+		if (file != nullptr)
+			pi_camera_file_close(file);
+		else if (is_allocated && !is_complete)
+		{
+			delete[] *buffer;
+			*buffer = nullptr;
+		}
+	};
+
+	if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_SUCCESS, &window_size, sizeof(AL::uint8)))
+	{
+		file_close(false);
+
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+	}
+
+	AL::uint32 ack_interval = pi_camera_net_get_file_transfer_ack_interval(window_size);
+
+	for (AL::uint64 number_of_bytes_received = offset, number_of_chunks_received = 0; number_of_bytes_received < file_size; )
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		{
+			file_close(false);
+
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		}
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			file_close(false);
+
+			if ((window_size > 1) && !pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, packet_header.error_code, nullptr, 0))
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			return packet_header.error_code;
+		}
+
+		auto file_chunk_size = AL::Math::Lowest(packet_buffer.GetSize(), (file_size - number_of_bytes_received));
+
+		if (file == nullptr)
+			::memcpy(&(*buffer)[number_of_bytes_received], &packet_buffer[0], file_chunk_size);
+		else if (!pi_camera_file_append(file, &packet_buffer[0], file_chunk_size))
+		{
+			file_close(false);
+
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR, nullptr, 0) ||
+				((window_size > 1) && !pi_camera_net_cancel_file_transfer(connection, packet_buffer)))
+			{
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			}
+
+			return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+		}
+
+		number_of_bytes_received += file_chunk_size;
+
+		if (on_progress_changed != nullptr)
+			on_progress_changed(file_size, number_of_bytes_received, param);
+
+		if (((++number_of_chunks_received % ack_interval) == 0) || (number_of_bytes_received == file_size))
+		{
+			if (!pi_camera_net_send_file_transfer_ack(connection, number_of_bytes_received))
+			{
+				file_close(false);
+
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+			}
+		}
+	}
+
+	file_close(true);
+
+	if (file_path == nullptr)
+		*buffer_size = file_size;
+
+	connection.transfer_id = 0;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_capture(pi_camera_connection& connection, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, file_path, nullptr, nullptr, on_progress_changed, param);
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_capture(pi_camera_connection& connection, AL::uint8 error_code, const char* file_path, pi_camera_transfer_stats* stats)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE, error_code, nullptr, 0);
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats);
+}
+
+AL::String pi_camera_capture_burst_get_file_path(const char* directory, AL::uint32 frame_index)
+{
+	return AL::String::Format("%s/burst_%04u.jpg", directory, frame_index);
+}
+
+struct pi_camera_net_capture_burst_context
+{
+	AL::uint32                                  frame_index;
+	pi_camera_capture_burst_on_progress_changed on_progress_changed;
+	void*                                       param;
+};
+
+void      pi_camera_net_capture_burst_on_progress_changed(AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+{
+	auto context = reinterpret_cast<pi_camera_net_capture_burst_context*>(param);
+
+	context->on_progress_changed(context->frame_index, file_size, number_of_bytes_received, context->param);
+}
+// Each frame arrives as a packet holding its index followed by a file transfer, a packet without an index ends the burst
+// @param on_progress_changed can be nullptr
+// @return first error, frames after a failed one are still received
+AL::uint8 pi_camera_net_begin_capture_burst(pi_camera_connection& connection, const char* directory, AL::uint32 count, AL::uint32 interval_ms, pi_camera_capture_burst_on_progress_changed on_progress_changed, void* param)
+{
+	AL::uint32 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(count),
+		AL::BitConverter::HostToNetwork(interval_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE_BURST, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_net_capture_burst_context context =
+	{
+		.frame_index         = 0,
+		.on_progress_changed = on_progress_changed,
+		.param               = param
+	};
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	while (true)
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return (error_code != PI_CAMERA_ERROR_CODE_SUCCESS) ? error_code : packet_header.error_code;
+
+		if (packet_header.buffer_size < sizeof(AL::uint32))
+			break;
+
+		context.frame_index = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&packet_buffer[0]));
+
+		auto frame_error_code = pi_camera_net_complete_file_transfer(connection, pi_camera_capture_burst_get_file_path(directory, context.frame_index).GetCString(), nullptr, nullptr, (on_progress_changed != nullptr) ? &pi_camera_net_capture_burst_on_progress_changed : nullptr, &context);
+
+		if (frame_error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+			error_code = frame_error_code;
+	}
+
+	return error_code;
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_capture_burst_frame(pi_camera_connection& connection, AL::uint32 frame_index, const char* frame_path, pi_camera_transfer_stats* stats)
+{
+	frame_index = AL::BitConverter::HostToNetwork(frame_index);
+
+	if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_BURST, PI_CAMERA_ERROR_CODE_SUCCESS, &frame_index, sizeof(AL::uint32)))
+		return false;
+
+	return pi_camera_net_begin_file_transfer(connection, frame_path, stats);
+}
+bool      pi_camera_net_complete_capture_burst(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_BURST, error_code, nullptr, 0);
+}
+
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_capture_to_buffer(pi_camera_connection& connection, AL::uint8** buffer, AL::uint64* size, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, nullptr, buffer, size, on_progress_changed, param);
+}
+
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_capture_video(pi_camera_connection& connection, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	video_length_seconds = AL::BitConverter::HostToNetwork(video_length_seconds);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO, &video_length_seconds, sizeof(AL::uint32)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, file_path, nullptr, nullptr, on_progress_changed, param);
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_capture_video(pi_camera_connection& connection, AL::uint8 error_code, const char* file_path, AL::uint64 transfer_id, pi_camera_transfer_stats* stats)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO, error_code, nullptr, 0);
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats, transfer_id);
+}
+
+// @return PI_CAMERA_ERROR_CODE_PENDING until the transfer completes
+AL::uint8 pi_camera_net_update_file_transfer_async(pi_camera_connection& connection, pi_camera_async* async)
+{
+	auto file_close = [async]()
+	{
+		if (async->file != nullptr)
+		{
+			pi_camera_file_close(async->file);
+			async->file = nullptr;
+		}
+	};
+
+	auto& packet_header = async->packet_header;
+	auto& packet_buffer = async->packet_buffer;
+
+	while (true)
+	{
+		switch (pi_camera_net_receive_packet_partial(connection, packet_header, packet_buffer, async->number_of_packet_bytes_received))
+		{
+			case 0:
+				file_close();
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			case -1:
+				return PI_CAMERA_ERROR_CODE_PENDING;
+		}
+
+		switch (async->state)
+		{
+			case PI_CAMERA_ASYNC_STATE_WAIT_FILE_SIZE:
+			{
+				if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+					return packet_header.error_code;
+
+				if (packet_header.buffer_size < sizeof(AL::uint64))
+				{
+					pi_camera_net_socket_close(connection.socket);
+
+					return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+				}
+
+				async->file_size       = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+				async->window_size     = pi_camera_net_get_file_transfer_window_size(connection, packet_header, packet_buffer);
+				connection.transfer_id = pi_camera_net_get_file_transfer_id(packet_header, packet_buffer);
+
+				if ((async->file = pi_camera_file_open(async->file_path.GetCString(), false, true)) == nullptr)
+				{
+					if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR, nullptr, 0))
+						return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+					return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+				}
+
+				if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_SUCCESS, &async->window_size, sizeof(AL::uint8)))
+				{
+					file_close();
+
+					return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+				}
+
+				if (async->file_size == 0)
+				{
+					file_close();
+					connection.transfer_id = 0;
+
+					return PI_CAMERA_ERROR_CODE_SUCCESS;
+				}
+
+				async->state = PI_CAMERA_ASYNC_STATE_RECEIVE;
+			}
+			break;
+
+			case PI_CAMERA_ASYNC_STATE_RECEIVE:
+			{
+				if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+				{
+					file_close();
+
+					if ((async->window_size > 1) && !pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, packet_header.error_code, nullptr, 0))
+						return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+					return packet_header.error_code;
+				}
+
+				auto file_chunk_size = AL::Math::Lowest(packet_buffer.GetSize(), (async->file_size - async->number_of_bytes_received));
+
+				if (!pi_camera_file_append(async->file, &packet_buffer[0], file_chunk_size))
+				{
+					file_close();
+
+					if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FILE_TRANSFER_ACK, PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR, nullptr, 0))
+						return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+					if (async->window_size == 1)
+						return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+					async->state      = PI_CAMERA_ASYNC_STATE_CANCEL;
+					async->error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+					break;
+				}
+
+				async->number_of_bytes_received += file_chunk_size;
+
+				if (async->on_progress_changed != nullptr)
+					async->on_progress_changed(async->file_size, async->number_of_bytes_received, async->param);
+
+				// cumulative acks at half the window keep the server from stalling on a full window
+				AL::uint32 ack_interval = pi_camera_net_get_file_transfer_ack_interval(async->window_size);
+
+				if (((++async->number_of_chunks_received % ack_interval) == 0) || (async->number_of_bytes_received == async->file_size))
+				{
+					if (!pi_camera_net_send_file_transfer_ack(connection, async->number_of_bytes_received))
+					{
+						file_close();
+
+						return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+					}
+				}
+
+				if (async->number_of_bytes_received == async->file_size)
+				{
+					file_close();
+					connection.transfer_id = 0;
+
+					return PI_CAMERA_ERROR_CODE_SUCCESS;
+				}
+			}
+			break;
+
+			case PI_CAMERA_ASYNC_STATE_CANCEL:
+			{
+				if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+					return async->error_code;
+			}
+			break;
+		}
+	}
+}
+
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_capture_stream(pi_camera_connection& connection, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	// file_path is only replaced once the whole image arrived
+	auto            file_path_tmp = AL::String::Format("%s.tmp", file_path);
+	pi_camera_file* file;
+
+	if ((file = pi_camera_file_open(file_path_tmp.GetCString(), false, true)) == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE_STREAM, nullptr, 0))
+		error_code = PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	// chunks keep arriving until an empty packet or an error, the total size is never known up front
+	for (AL::uint64 number_of_bytes_received = 0; error_code != PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED; )
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		{
+			error_code = PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			break;
+		}
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+				error_code = packet_header.error_code;
+
+			break;
+		}
+
+		if (packet_header.buffer_size == 0)
+			break;
+
+		// keep draining after a write error so the connection stays in sync
+		if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			continue;
+
+		if (!pi_camera_file_append(file, &packet_buffer[0], packet_header.buffer_size))
+		{
+			error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+			continue;
+		}
+
+		number_of_bytes_received += packet_header.buffer_size;
+
+		if (on_progress_changed != nullptr)
+			on_progress_changed(0, number_of_bytes_received, param);
+	}
+
+	pi_camera_file_close(file);
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (::rename(file_path_tmp.GetCString(), file_path) == -1))
+		error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_file_delete(file_path_tmp.GetCString());
+
+	return error_code;
+}
+bool      pi_camera_net_complete_capture_stream_chunk(pi_camera_connection& connection, const void* buffer, AL::uint32 size)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_STREAM, PI_CAMERA_ERROR_CODE_SUCCESS, buffer, size);
+}
+bool      pi_camera_net_complete_capture_stream(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_STREAM, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_preview_stream(pi_camera_connection& connection, pi_camera_preview_on_frame on_frame, void* param)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_PREVIEW_STREAM, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+	bool                    is_stopping = false;
+
+	// frames keep arriving until the service answers the stop request with an empty packet or reports an error
+	while (true)
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return packet_header.error_code;
+
+		if (packet_header.buffer_size == 0)
+			break;
+
+		// frames already in flight when the stop request was sent are dropped
+		if (is_stopping)
+			continue;
+
+		if (!on_frame(&packet_buffer[0], packet_header.buffer_size, param))
+		{
+			// sent with the id of the stream so the final reply still matches it
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_PREVIEW_STREAM, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			is_stopping = true;
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_preview_stream_frame(pi_camera_connection& connection, const void* buffer, AL::uint32 size)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_PREVIEW_STREAM, PI_CAMERA_ERROR_CODE_SUCCESS, buffer, size);
+}
+bool      pi_camera_net_complete_preview_stream(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_PREVIEW_STREAM, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_capture_video_stream(pi_camera_connection& connection, AL::uint32 video_length_seconds, pi_camera_video_on_nal_unit on_nal_unit, void* param)
+{
+	video_length_seconds = AL::BitConverter::HostToNetwork(video_length_seconds);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM, &video_length_seconds, sizeof(AL::uint32)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+	bool                    is_stopping = false;
+
+	// one packet per nal unit until an empty packet or an error
+	while (true)
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return packet_header.error_code;
+
+		if (packet_header.buffer_size == 0)
+			break;
+
+		// nal units already in flight when the stop request was sent are dropped
+		if (is_stopping)
+			continue;
+
+		if (!on_nal_unit(&packet_buffer[0], packet_header.buffer_size, param))
+		{
+			// sent with the id of the stream so the final reply still matches it
+			if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM, PI_CAMERA_ERROR_CODE_SUCCESS, nullptr, 0))
+				return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+			is_stopping = true;
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_capture_video_stream_nal_unit(pi_camera_connection& connection, const void* buffer, AL::uint32 size)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM, PI_CAMERA_ERROR_CODE_SUCCESS, buffer, size);
+}
+bool      pi_camera_net_complete_capture_video_stream(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM, error_code, nullptr, 0);
+}
+
+AL::uint8 pi_camera_net_begin_start_recording(pi_camera_connection& connection, AL::uint32 segment_length_seconds, AL::uint64 disk_budget)
+{
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork<AL::uint64>(segment_length_seconds),
+		AL::BitConverter::HostToNetwork(disk_budget)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_START_RECORDING, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_start_recording(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_START_RECORDING, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_stop_recording(pi_camera_connection& connection)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_STOP_RECORDING, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_stop_recording(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_STOP_RECORDING, error_code, nullptr, 0);
+}
+// the service replies with every matching segment, those beyond count are only counted
+AL::uint8 pi_camera_net_begin_get_recording_segments(pi_camera_connection& connection, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_recording_segment* values, AL::uint32* count)
+{
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(start_time_ms),
+		AL::BitConverter::HostToNetwork(end_time_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_RECORDING_SEGMENTS, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	auto segment_count = static_cast<AL::uint32>(packet_header.buffer_size / sizeof(pi_camera_recording_segment));
+
+	for (AL::uint32 i = 0; (i < segment_count) && (i < *count); ++i)
+	{
+		auto segment = reinterpret_cast<const pi_camera_recording_segment*>(&packet_buffer[i * sizeof(pi_camera_recording_segment)]);
+
+		values[i].id            = AL::BitConverter::NetworkToHost(segment->id);
+		values[i].start_time_ms = AL::BitConverter::NetworkToHost(segment->start_time_ms);
+		values[i].duration_ms   = AL::BitConverter::NetworkToHost(segment->duration_ms);
+		values[i].size          = AL::BitConverter::NetworkToHost(segment->size);
+	}
+
+	AL::uint8 error_code = (segment_count > *count) ? PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL : PI_CAMERA_ERROR_CODE_SUCCESS;
+	*count               = segment_count;
+
+	return error_code;
+}
+bool      pi_camera_net_complete_get_recording_segments(pi_camera_connection& connection, AL::uint8 error_code, const pi_camera_recording_segment* values, AL::uint32 count)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_RECORDING_SEGMENTS, error_code, nullptr, 0);
+
+	pi_camera_packet_buffer packet_buffer(count * sizeof(pi_camera_recording_segment));
+
+	for (AL::uint32 i = 0; i < count; ++i)
+	{
+		pi_camera_recording_segment segment =
+		{
+			.id            = AL::BitConverter::HostToNetwork(values[i].id),
+			.start_time_ms = AL::BitConverter::HostToNetwork(values[i].start_time_ms),
+			.duration_ms   = AL::BitConverter::HostToNetwork(values[i].duration_ms),
+			.size          = AL::BitConverter::HostToNetwork(values[i].size)
+		};
+
+		::memcpy(&packet_buffer[i * sizeof(pi_camera_recording_segment)], &segment, sizeof(pi_camera_recording_segment));
+	}
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_RECORDING_SEGMENTS, PI_CAMERA_ERROR_CODE_SUCCESS, (count != 0) ? &packet_buffer[0] : nullptr, static_cast<AL::uint32>(packet_buffer.GetSize()));
+}
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_get_recording_segment(pi_camera_connection& connection, AL::uint64 id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	id = AL::BitConverter::HostToNetwork(id);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_RECORDING_SEGMENT, &id, sizeof(AL::uint64)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, file_path, nullptr, nullptr, on_progress_changed, param);
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_get_recording_segment(pi_camera_connection& connection, AL::uint8 error_code, const char* file_path, AL::uint64 transfer_id, pi_camera_transfer_stats* stats)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_RECORDING_SEGMENT, error_code, nullptr, 0);
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats, transfer_id);
+}
+
+AL::uint8 pi_camera_net_begin_start_pre_roll(pi_camera_connection& connection, AL::uint32 pre_roll_seconds, AL::uint32 buffer_size)
+{
+	AL::uint32 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(pre_roll_seconds),
+		AL::BitConverter::HostToNetwork(buffer_size)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_START_PRE_ROLL, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_start_pre_roll(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_START_PRE_ROLL, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_stop_pre_roll(pi_camera_connection& connection)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_STOP_PRE_ROLL, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_stop_pre_roll(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_STOP_PRE_ROLL, error_code, nullptr, 0);
+}
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_capture_pre_roll(pi_camera_connection& connection, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	video_length_seconds = AL::BitConverter::HostToNetwork(video_length_seconds);
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_CAPTURE_PRE_ROLL, &video_length_seconds, sizeof(AL::uint32)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, file_path, nullptr, nullptr, on_progress_changed, param);
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_capture_pre_roll(pi_camera_connection& connection, AL::uint8 error_code, const char* file_path, AL::uint64 transfer_id, pi_camera_transfer_stats* stats)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_CAPTURE_PRE_ROLL, error_code, nullptr, 0);
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats, transfer_id);
+}
+
+AL::uint8 pi_camera_net_begin_start_timelapse(pi_camera_connection& connection, AL::uint32 interval_ms, AL::uint32 count, AL::uint64 end_time_ms)
+{
+	AL::uint64 buffer[3] =
+	{
+		AL::BitConverter::HostToNetwork<AL::uint64>(interval_ms),
+		AL::BitConverter::HostToNetwork<AL::uint64>(count),
+		AL::BitConverter::HostToNetwork(end_time_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_START_TIMELAPSE, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_start_timelapse(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_START_TIMELAPSE, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_stop_timelapse(pi_camera_connection& connection)
+{
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_STOP_TIMELAPSE, nullptr, 0))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return packet_header.error_code;
+}
+bool      pi_camera_net_complete_stop_timelapse(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_STOP_TIMELAPSE, error_code, nullptr, 0);
+}
+// the service replies with every matching capture, those beyond count are only counted
+AL::uint8 pi_camera_net_begin_get_captures(pi_camera_connection& connection, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_capture_info* values, AL::uint32* count)
+{
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(start_time_ms),
+		AL::BitConverter::HostToNetwork(end_time_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_GET_CAPTURES, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	auto capture_count = static_cast<AL::uint32>(packet_header.buffer_size / sizeof(pi_camera_capture_info));
+
+	for (AL::uint32 i = 0; (i < capture_count) && (i < *count); ++i)
+	{
+		auto capture = reinterpret_cast<const pi_camera_capture_info*>(&packet_buffer[i * sizeof(pi_camera_capture_info)]);
+
+		values[i].timestamp_ms = AL::BitConverter::NetworkToHost(capture->timestamp_ms);
+		values[i].size         = AL::BitConverter::NetworkToHost(capture->size);
+		values[i].config_hash  = AL::BitConverter::NetworkToHost(capture->config_hash);
+	}
+
+	AL::uint8 error_code = (capture_count > *count) ? PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL : PI_CAMERA_ERROR_CODE_SUCCESS;
+	*count               = capture_count;
+
+	return error_code;
+}
+bool      pi_camera_net_complete_get_captures(pi_camera_connection& connection, AL::uint8 error_code, const pi_camera_capture_info* values, AL::uint32 count)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CAPTURES, error_code, nullptr, 0);
+
+	pi_camera_packet_buffer packet_buffer(count * sizeof(pi_camera_capture_info));
+
+	for (AL::uint32 i = 0; i < count; ++i)
+	{
+		pi_camera_capture_info capture =
+		{
+			.timestamp_ms = AL::BitConverter::HostToNetwork(values[i].timestamp_ms),
+			.size         = AL::BitConverter::HostToNetwork(values[i].size),
+			.config_hash  = AL::BitConverter::HostToNetwork(values[i].config_hash)
+		};
+
+		::memcpy(&packet_buffer[i * sizeof(pi_camera_capture_info)], &capture, sizeof(pi_camera_capture_info));
+	}
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_GET_CAPTURES, PI_CAMERA_ERROR_CODE_SUCCESS, (count != 0) ? &packet_buffer[0] : nullptr, static_cast<AL::uint32>(packet_buffer.GetSize()));
+}
+
+struct pi_camera_net_fetch_captures_context
+{
+	AL::uint64                                   timestamp_ms;
+	pi_camera_fetch_captures_on_progress_changed on_progress_changed;
+	void*                                        param;
+};
+
+void      pi_camera_net_fetch_captures_on_progress_changed(AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param)
+{
+	auto context = reinterpret_cast<pi_camera_net_fetch_captures_context*>(param);
+
+	context->on_progress_changed(context->timestamp_ms, file_size, number_of_bytes_received, context->param);
+}
+// Each capture arrives as a packet holding its timestamp followed by a file transfer, a packet without a timestamp ends the fetch
+// @param on_progress_changed can be nullptr
+// @return first error, captures after a failed one are still received
+AL::uint8 pi_camera_net_begin_fetch_captures(pi_camera_connection& connection, AL::uint64 start_time_ms, AL::uint64 end_time_ms, const char* directory, pi_camera_fetch_captures_on_progress_changed on_progress_changed, void* param)
+{
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(start_time_ms),
+		AL::BitConverter::HostToNetwork(end_time_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_FETCH_CAPTURES, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_net_fetch_captures_context context =
+	{
+		.timestamp_ms        = 0,
+		.on_progress_changed = on_progress_changed,
+		.param               = param
+	};
+
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	while (true)
+	{
+		if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return (error_code != PI_CAMERA_ERROR_CODE_SUCCESS) ? error_code : packet_header.error_code;
+
+		if (packet_header.buffer_size < sizeof(AL::uint64))
+			break;
+
+		context.timestamp_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&packet_buffer[0]));
+
+		auto capture_error_code = pi_camera_net_complete_file_transfer(connection, pi_camera_store_get_file_path(directory, context.timestamp_ms).GetCString(), nullptr, nullptr, (on_progress_changed != nullptr) ? &pi_camera_net_fetch_captures_on_progress_changed : nullptr, &context);
+
+		if (capture_error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+		if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+			error_code = capture_error_code;
+	}
+
+	return error_code;
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_fetch_capture(pi_camera_connection& connection, AL::uint64 timestamp_ms, const char* file_path, pi_camera_transfer_stats* stats)
+{
+	timestamp_ms = AL::BitConverter::HostToNetwork(timestamp_ms);
+
+	if (!pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FETCH_CAPTURES, PI_CAMERA_ERROR_CODE_SUCCESS, &timestamp_ms, sizeof(AL::uint64)))
+		return false;
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats);
+}
+bool      pi_camera_net_complete_fetch_captures(pi_camera_connection& connection, AL::uint8 error_code)
+{
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_FETCH_CAPTURES, error_code, nullptr, 0);
+}
+AL::uint8 pi_camera_net_begin_delete_captures(pi_camera_connection& connection, AL::uint64 start_time_ms, AL::uint64 end_time_ms, AL::uint32* count)
+{
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(start_time_ms),
+		AL::BitConverter::HostToNetwork(end_time_ms)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_DELETE_CAPTURES, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = connection.packet_buffer;
+
+	if (pi_camera_net_receive_reply(connection, packet_header, packet_buffer) == 0)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	if (packet_header.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return packet_header.error_code;
+
+	if (packet_header.buffer_size < sizeof(AL::uint32))
+		return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+	if (count != nullptr)
+		*count = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&packet_buffer[0]));
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool      pi_camera_net_complete_delete_captures(pi_camera_connection& connection, AL::uint8 error_code, AL::uint32 count)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_DELETE_CAPTURES, error_code, nullptr, 0);
+
+	count = AL::BitConverter::HostToNetwork(count);
+
+	return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_DELETE_CAPTURES, PI_CAMERA_ERROR_CODE_SUCCESS, &count, sizeof(AL::uint32));
+}
+
+// Continues after the bytes already in the partial file at file_path
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_net_begin_resume_file_transfer(pi_camera_connection& connection, AL::uint64 transfer_id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	AL::uint64 offset;
+
+	if (!pi_camera_file_get_size(file_path, offset))
+		offset = 0;
+
+	AL::uint64 buffer[2] =
+	{
+		AL::BitConverter::HostToNetwork(transfer_id),
+		AL::BitConverter::HostToNetwork(offset)
+	};
+
+	if (!pi_camera_net_send_request(connection, PI_CAMERA_OPCODE_RESUME_FILE_TRANSFER, buffer, sizeof(buffer)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return pi_camera_net_complete_file_transfer(connection, file_path, nullptr, nullptr, on_progress_changed, param, offset);
+}
+// @param stats can be nullptr
+bool      pi_camera_net_complete_resume_file_transfer(pi_camera_connection& connection, AL::uint8 error_code, const char* file_path, AL::uint64 transfer_id, AL::uint64 offset, pi_camera_transfer_stats* stats)
+{
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_send_packet(connection, PI_CAMERA_OPCODE_RESUME_FILE_TRANSFER, error_code, nullptr, 0);
+
+	return pi_camera_net_begin_file_transfer(connection, file_path, stats, transfer_id, offset);
+}
+
+void       pi_camera_service_add_transfer_stats(pi_camera_service* camera_service, const pi_camera_transfer_stats& stats)
+{
+	AL::OS::MutexGuard lock(camera_service->transfer_stats_mutex);
+
+	camera_service->transfer_stats.number_of_transfers  += stats.number_of_transfers;
+	camera_service->transfer_stats.number_of_bytes_sent += stats.number_of_bytes_sent;
+	camera_service->transfer_stats.cpu_time_us          += stats.cpu_time_us;
+
+	if (stats.number_of_transfers != 0)
+	{
+		camera_service->transfer_stats.chunk_size       = stats.chunk_size;
+		camera_service->transfer_stats.window_size      = stats.window_size;
+		camera_service->transfer_stats.rtt_us           = stats.rtt_us;
+		camera_service->transfer_stats.bytes_per_second = stats.bytes_per_second;
+	}
+}
+void       pi_camera_service_add_request(pi_camera_service* camera_service)
+{
+	AL::OS::MutexGuard lock(camera_service->transfer_stats_mutex);
+
+	++camera_service->transfer_stats.number_of_requests;
+}
+// ids are random so a peer can't guess and resume another client's transfer, or collide with one a restarted service handed out
+// timestamps are used where no random source is available
+AL::uint64 pi_camera_service_next_transfer_id(pi_camera_service* camera_service)
+{
+#if defined(AL_PLATFORM_LINUX)
+	for (AL::uint64 transfer_id; ; )
+	{
+		auto bytes_read = ::getrandom(&transfer_id, sizeof(transfer_id), 0);
+
+		if ((bytes_read == -1) && (errno == EINTR))
+			continue;
+
+		if (bytes_read != static_cast<ssize_t>(sizeof(transfer_id)))
+			break;
+
+		// 0 means the transfer can't be resumed
+		if (transfer_id != 0)
+			return transfer_id;
+	}
+#endif
+
+	AL::OS::MutexGuard lock(camera_service->transfers_mutex);
+
+	return camera_service->transfer_id = pi_camera_get_next_time_ms(camera_service->transfer_id);
+}
+void       pi_camera_service_release_transfer(pi_camera_service_transfer* transfer)
+{
+	if (transfer->is_owned)
+		pi_camera_file_delete(transfer->file_path.GetCString());
+
+	delete transfer;
+}
+// @param expire_time_ms 0 to release every transfer
+void       pi_camera_service_expire_transfers(pi_camera_service* camera_service, AL::uint64 expire_time_ms)
+{
+	AL::OS::MutexGuard lock(camera_service->transfers_mutex);
+
+	for (auto it = camera_service->transfers.begin(); it != camera_service->transfers.end(); )
+	{
+		if ((expire_time_ms != 0) && ((*it)->expire_time_ms > expire_time_ms))
+			++it;
+		else
+		{
+			camera_service->transfers_size -= (*it)->file_size;
+			pi_camera_service_release_transfer(*it);
+			camera_service->transfers.Erase(it++);
+		}
+	}
+}
+// transfers are retained for the same time so the first one expires first
+// @return milliseconds until the next transfer expires, -1 if none is retained
+int        pi_camera_service_get_transfer_timeout_ms(pi_camera_service* camera_service, AL::uint64 time_ms)
+{
+	AL::OS::MutexGuard lock(camera_service->transfers_mutex);
+
+	if (camera_service->transfers.GetSize() == 0)
+		return -1;
+
+	auto expire_time_ms = (*camera_service->transfers.begin())->expire_time_ms;
+
+	return (expire_time_ms > time_ms) ? static_cast<int>(AL::Math::Clamp<AL::uint64>(expire_time_ms - time_ms, 0, AL::Integer<AL::int32>::Maximum)) : 0;
+}
+// Keeps the source of a transfer cut short by a lost connection so the client can resume it after reconnecting
+// The oldest are released once the files kept for them exceed PI_CAMERA_FILE_TRANSFER_RETAIN_SIZE_MAX bytes
+void       pi_camera_service_retain_transfer(pi_camera_service* camera_service, pi_camera_service_transfer* transfer)
+{
+	transfer->expire_time_ms = pi_camera_get_time_ms() + PI_CAMERA_FILE_TRANSFER_RETAIN_MS;
+
+	AL::OS::MutexGuard lock(camera_service->transfers_mutex);
+
+	camera_service->transfers.PushBack(transfer);
+	camera_service->transfers_size += transfer->file_size;
+
+	while (camera_service->transfers_size > PI_CAMERA_FILE_TRANSFER_RETAIN_SIZE_MAX)
+	{
+		auto it = camera_service->transfers.begin();
+
+		camera_service->transfers_size -= (*it)->file_size;
+		pi_camera_service_release_transfer(*it);
+		camera_service->transfers.Erase(it);
+	}
+}
+// Removes the transfer from the service so it isn't resumed twice at once
+// @return nullptr if it completed or expired
+pi_camera_service_transfer* pi_camera_service_resume_transfer(pi_camera_service* camera_service, AL::uint64 id)
+{
+	pi_camera_service_expire_transfers(camera_service, pi_camera_get_time_ms());
+
+	AL::OS::MutexGuard lock(camera_service->transfers_mutex);
+
+	for (auto it = camera_service->transfers.begin(); it != camera_service->transfers.end(); ++it)
+	{
+		if ((*it)->id == id)
+		{
+			auto transfer = *it;
+			camera_service->transfers.Erase(it);
+			camera_service->transfers_size -= transfer->file_size;
+
+			return transfer;
+		}
+	}
+
+	return nullptr;
+}
+// @param result false if the connection was lost
+void       pi_camera_service_complete_transfer(pi_camera_service* camera_service, AL::uint64 id, const char* file_path, bool is_owned, bool result)
+{
+	if (result)
+	{
+		if (is_owned)
+			pi_camera_file_delete(file_path);
+	}
+	else
+	{
+		AL::uint64 file_size = 0;
+
+		if (is_owned)
+			pi_camera_file_get_size(file_path, file_size);
+
+		pi_camera_service_retain_transfer(camera_service, new pi_camera_service_transfer
+		{
+			.id             = id,
+			.file_path      = file_path,
+			.file_size      = file_size,
+			.is_owned       = is_owned,
+			.expire_time_ms = 0
+		});
+	}
+}
+AL::String pi_camera_service_next_file_path(pi_camera_service* camera_service, const char* format, AL::uint64& counter)
+{
+	AL::OS::MutexGuard lock(camera_service->local.mutex);
+
+	return AL::String::Format(format, ++counter);
+}
+AL::String pi_camera_service_next_image_path(pi_camera_service* camera_service)
+{
+	AL::OS::MutexGuard lock(camera_service->local.mutex);
+
+	camera_service->image_timestamp_ms = pi_camera_get_next_time_ms(camera_service->image_timestamp_ms);
+
+	return AL::String::Format("./pi_image_%llu.jpg", camera_service->image_timestamp_ms);
+}
+
+// fnv-1a
+AL::uint32 pi_camera_config_get_hash(const pi_camera_config& config)
+{
+	auto       bytes = reinterpret_cast<const AL::uint8*>(&config);
+	AL::uint32 hash  = 2166136261;
+
+	for (AL::size_t i = 0; i < sizeof(pi_camera_config); ++i)
+		hash = (hash ^ bytes[i]) * 16777619;
+
+	return hash;
+}
+bool       pi_camera_config_is_equal(const pi_camera_config& a, const pi_camera_config& b)
+{
+	return (a.ev                == b.ev)                &&
+		(a.iso               == b.iso)               &&
+		(a.contrast          == b.contrast)          &&
+		(a.sharpness         == b.sharpness)         &&
+		(a.brightness        == b.brightness)        &&
+		(a.saturation        == b.saturation)        &&
+		(a.white_balance     == b.white_balance)     &&
+		(a.shutter_speed_us  == b.shutter_speed_us)  &&
+		(a.exposure_mode     == b.exposure_mode)     &&
+		(a.metoring_mode     == b.metoring_mode)     &&
+		(a.jpg_quality       == b.jpg_quality)       &&
+		(a.image_effect      == b.image_effect)      &&
+		(a.image_rotation    == b.image_rotation)    &&
+		(a.image_size_width  == b.image_size_width)  &&
+		(a.image_size_height == b.image_size_height) &&
+		(a.video_bit_rate    == b.video_bit_rate)    &&
+		(a.video_frame_rate  == b.video_frame_rate);
+}
+
+// Moves a captured image into the store
+// @param store_path set to where file_path was moved
+// @return false if it wasn't stored
+bool       pi_camera_service_store_capture(pi_camera_service* camera_service, const char* file_path, const pi_camera_config& config, AL::String& store_path)
+{
+#if defined(AL_PLATFORM_LINUX)
+	auto store = pi_camera_cli_store_open(&camera_service->local);
+
+	return (store != nullptr) && pi_camera_store_add(store, file_path, pi_camera_config_get_hash(config), &store_path);
+#else
+	return false;
+#endif
+}
+
+// @param mutex must be held
+void       pi_camera_service_capture_cache_entry_release(pi_camera_capture_cache_entry* entry)
+{
+	if (--entry->reference_count != 0)
+		return;
+
+	if (entry->is_owned)
+		pi_camera_file_delete(entry->file_path.GetCString());
+
+	delete entry;
+}
+void       pi_camera_service_capture_result_release(pi_camera_service* camera_service, pi_camera_capture_cache_entry* capture_result)
+{
+	AL::OS::MutexGuard lock(camera_service->capture_cache.mutex);
+
+	pi_camera_service_capture_cache_entry_release(capture_result);
+}
+// With a window of 0 a result is never handed out again once every joiner has it, an owned file is deleted with the last reference
+// @param mutex must be held
+void       pi_camera_service_capture_cache_release_unjoined(pi_camera_capture_cache& capture_cache)
+{
+	if ((capture_cache.window_ms != 0) || (capture_cache.joiner_count != 0) || (capture_cache.result == nullptr))
+		return;
+
+	pi_camera_service_capture_cache_entry_release(capture_cache.result);
+	capture_cache.result = nullptr;
+}
+// Requests with the current config join the capture in flight or reuse the last one while it is within the freshness window
+// @param capture_result set on success, release with pi_camera_service_capture_result_release
+AL::uint8  pi_camera_service_capture_cached(pi_camera_service* camera_service, pi_camera_capture_cache_entry*& capture_result)
+{
+	pi_camera_config config;
+	AL::uint8        error_code;
+
+	if ((error_code = pi_camera_get_config(camera_service, &config)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	auto& capture_cache = camera_service->capture_cache;
+
+	capture_cache.mutex.Lock();
+
+	while (true)
+	{
+		if (capture_cache.is_capturing)
+		{
+			bool is_joined  = pi_camera_config_is_equal(capture_cache.config, config);
+			auto generation = capture_cache.generation;
+
+			if (is_joined)
+				++capture_cache.joiner_count;
+
+			do
+			{
+				capture_cache.condition.Sleep(capture_cache.mutex);
+			} while (capture_cache.generation == generation);
+
+			if (!is_joined)
+				continue;
+
+			--capture_cache.joiner_count;
+
+			// the config may have changed while waiting, an image taken with the old one is captured again
+			// nothing takes the capture cache mutex while holding the camera mutex
+			if ((error_code = pi_camera_get_config(camera_service, &config)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+			{
+				pi_camera_service_capture_cache_release_unjoined(capture_cache);
+				capture_cache.mutex.Unlock();
+
+				return error_code;
+			}
+
+			if (!pi_camera_config_is_equal(capture_cache.config, config))
+			{
+				pi_camera_service_capture_cache_release_unjoined(capture_cache);
+
+				continue;
+			}
+		}
+		else if ((capture_cache.result == nullptr) ||
+			!pi_camera_config_is_equal(capture_cache.config, config) ||
+			((capture_cache.timer.GetElapsed().ToMilliseconds() - capture_cache.timestamp_ms) >= capture_cache.window_ms))
+		{
+			break;
+		}
+
+		if ((error_code = capture_cache.error_code) == PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			capture_result = capture_cache.result;
+			++capture_result->reference_count;
+		}
+
+		pi_camera_service_capture_cache_release_unjoined(capture_cache);
+		capture_cache.mutex.Unlock();
+
+		return error_code;
+	}
+
+	capture_cache.is_capturing = true;
+	capture_cache.config       = config;
+
+	capture_cache.mutex.Unlock();
+
+	auto                           file_path = pi_camera_service_next_image_path(camera_service);
+	AL::uint64                     file_size = 0;
+	pi_camera_capture_cache_entry* result    = nullptr;
+
+	if ((error_code = pi_camera_capture(camera_service, file_path.GetCString(), nullptr, nullptr)) == PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		// raspistill leaves an empty file behind when the capture failed
+		if (!pi_camera_file_get_size(file_path.GetCString(), file_size))
+			error_code = PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR;
+		else if (file_size == 0)
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_file_delete(file_path.GetCString());
+	else
+	{
+		result = new pi_camera_capture_cache_entry();
+
+		// kept so it can be fetched again after a disconnect, every waiter sends from the stored file
+		if (!pi_camera_service_store_capture(camera_service, file_path.GetCString(), config, result->file_path))
+		{
+			result->file_path = AL::Move(file_path);
+			result->is_owned  = true;
+		}
+	}
+
+	capture_cache.mutex.Lock();
+
+	if (capture_cache.result != nullptr)
+		pi_camera_service_capture_cache_entry_release(capture_cache.result);
+
+	capture_cache.result       = result;
+	capture_cache.error_code   = error_code;
+	capture_cache.timestamp_ms = capture_cache.timer.GetElapsed().ToMilliseconds();
+	capture_cache.is_capturing = false;
+	++capture_cache.generation;
+	capture_cache.condition.WakeAll();
+
+	if ((capture_result = result) != nullptr)
+		++capture_result->reference_count;
+
+	pi_camera_service_capture_cache_release_unjoined(capture_cache);
+	capture_cache.mutex.Unlock();
+
+	return error_code;
+}
+void       pi_camera_service_capture_cache_clear(pi_camera_service* camera_service)
+{
+	AL::OS::MutexGuard lock(camera_service->capture_cache.mutex);
+
+	if (camera_service->capture_cache.result != nullptr)
+		pi_camera_service_capture_cache_entry_release(camera_service->capture_cache.result);
+
+	camera_service->capture_cache.result = nullptr;
+}
+
+AL::uint8  pi_camera_cli_execute_preview(pi_camera_local* camera_local, pi_camera_preview_on_frame on_frame, void* param);
+
+void       pi_camera_service_preview_frame_release(pi_camera_service* camera_service, pi_camera_preview_frame* frame)
+{
+	AL::OS::MutexGuard lock(camera_service->preview.mutex);
+
+	if (--frame->reference_count == 0)
+		delete frame;
+}
+#if defined(AL_PLATFORM_LINUX)
+// Sends what the socket takes of the packets queued for a session, anything left goes out when the next frame is published
+// @param mutex must be held
+// @return -1 if the session still has bytes to send
+// @return 0 on error
+// @return 1 once nothing is left
+int        pi_camera_service_preview_session_send(pi_camera_session* camera_session)
+{
+	auto& session_preview = camera_session->preview;
+	auto& connection      = camera_session->connection;
+	auto  header_size     = pi_camera_packet_header_get_size(connection.protocol_version);
+
+	while (true)
+	{
+		if (!session_preview.is_sending)
+		{
+			AL::uint8  error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+			AL::uint32 size       = 0;
+
+			if (session_preview.is_ending)
+			{
+				if (session_preview.is_end_sent)
+					return 1;
+
+				error_code                  = session_preview.end_error_code;
+				session_preview.is_end_sent = true;
+			}
+			else if (session_preview.next_frame != nullptr)
+			{
+				session_preview.frame      = session_preview.next_frame;
+				session_preview.next_frame = nullptr;
+				size                       = static_cast<AL::uint32>(session_preview.frame->buffer.GetSize());
+			}
+			else
+				return 1;
+
+			session_preview.packet_header =
+			{
+				.opcode      = AL::BitConverter::HostToNetwork(static_cast<AL::uint8>(PI_CAMERA_OPCODE_PREVIEW_STREAM)),
+				.error_code  = AL::BitConverter::HostToNetwork(error_code),
+				.buffer_size = AL::BitConverter::HostToNetwork(size),
+				.request_id  = AL::BitConverter::HostToNetwork(connection.request_id)
+			};
+
+			session_preview.is_sending           = true;
+			session_preview.number_of_bytes_sent = 0;
+		}
+
+		AL::size_t payload_size = (session_preview.frame != nullptr) ? session_preview.frame->buffer.GetSize() : 0;
+		AL::size_t payload_sent = (session_preview.number_of_bytes_sent > header_size) ? (session_preview.number_of_bytes_sent - header_size) : 0;
+		AL::size_t buffer_count = 0;
+		iovec      buffers[2];
+
+		if (session_preview.number_of_bytes_sent < header_size)
+			buffers[buffer_count++] = { .iov_base = reinterpret_cast<AL::uint8*>(&session_preview.packet_header) + session_preview.number_of_bytes_sent, .iov_len = header_size - session_preview.number_of_bytes_sent };
+
+		if (payload_sent < payload_size)
+			buffers[buffer_count++] = { .iov_base = &session_preview.frame->buffer[payload_sent], .iov_len = payload_size - payload_sent };
+
+		AL::size_t number_of_bytes_sent;
+
+		if (!pi_camera_net_socket_try_send_vector(connection.socket, buffers, buffer_count, number_of_bytes_sent))
+			return 0;
+
+		if ((session_preview.number_of_bytes_sent += number_of_bytes_sent) < (header_size + payload_size))
+		{
+			if (number_of_bytes_sent == 0)
+				return -1;
+
+			continue;
+		}
+
+		if ((session_preview.frame != nullptr) && (--session_preview.frame->reference_count == 0))
+			delete session_preview.frame;
+
+		session_preview.frame      = nullptr;
+		session_preview.is_sending = false;
+	}
+}
+// Takes a session off the preview, the encoder stops on its next frame once the last subscriber leaves
+// @param mutex must be held
+void       pi_camera_service_preview_session_detach(pi_camera_service* camera_service, pi_camera_session* camera_session)
+{
+	auto& preview         = camera_service->preview;
+	auto& session_preview = camera_session->preview;
+
+	for (auto it = preview.sessions.begin(); it != preview.sessions.end(); ++it)
+	{
+		if (*it == camera_session)
+		{
+			preview.sessions.Erase(it);
+
+			break;
+		}
+	}
+
+	if ((session_preview.frame != nullptr) && (--session_preview.frame->reference_count == 0))
+		delete session_preview.frame;
+
+	if ((session_preview.next_frame != nullptr) && (--session_preview.next_frame->reference_count == 0))
+		delete session_preview.next_frame;
+
+	session_preview = pi_camera_session_preview();
+
+	if (--preview.subscriber_count == 0)
+		preview.is_stopping = true;
+}
+// Queues the final reply, no more frames are queued for the session
+// @param mutex must be held
+void       pi_camera_service_preview_session_end(pi_camera_session* camera_session, AL::uint8 error_code)
+{
+	auto& session_preview = camera_session->preview;
+
+	if (session_preview.is_ending)
+		return;
+
+	if ((session_preview.next_frame != nullptr) && (--session_preview.next_frame->reference_count == 0))
+		delete session_preview.next_frame;
+
+	session_preview.next_frame     = nullptr;
+	session_preview.is_ending      = true;
+	session_preview.end_error_code = error_code;
+}
+// Sends what every session can take, sessions whose stream has ended or failed are detached
+// a failed session is shut down so the service thread sees it close and removes it
+// @param mutex must be held
+// @return true if a session still has bytes to send
+bool       pi_camera_service_preview_sessions_send(pi_camera_service* camera_service)
+{
+	bool is_pending = false;
+
+	for (auto it = camera_service->preview.sessions.begin(); it != camera_service->preview.sessions.end(); )
+	{
+		auto camera_session = *it++;
+
+		switch (pi_camera_service_preview_session_send(camera_session))
+		{
+			case -1:
+				is_pending = true;
+				break;
+
+			case 0:
+				::shutdown(static_cast<int>(camera_session->connection.socket.GetHandle()), SHUT_RDWR);
+				pi_camera_service_preview_session_detach(camera_service, camera_session);
+				break;
+
+			case 1:
+				if (camera_session->preview.is_ending)
+					pi_camera_service_preview_session_detach(camera_service, camera_session);
+				break;
+		}
+	}
+
+	return is_pending;
+}
+// Sessions still subscribed when the encoder exits get its error once what they were sending is out
+// those that can't take it within PI_CAMERA_PREVIEW_FLUSH_TIMEOUT_MS are shut down
+void       pi_camera_service_preview_sessions_end(pi_camera_service* camera_service, AL::uint8 error_code)
+{
+	auto&         preview = camera_service->preview;
+	AL::OS::Timer timer;
+
+	AL::OS::MutexGuard lock(preview.mutex);
+
+	// the encoder only exits on its own when something went wrong
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		error_code = preview.is_closing ? PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED : PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+	// subscribers arriving now wait for the next run instead of joining a session list that is being drained
+	preview.is_stopped = true;
+
+	for (auto camera_session : preview.sessions)
+		pi_camera_service_preview_session_end(camera_session, error_code);
+
+	while (pi_camera_service_preview_sessions_send(camera_service) && (timer.GetElapsed().ToMilliseconds() < PI_CAMERA_PREVIEW_FLUSH_TIMEOUT_MS))
+		preview.condition.Sleep(preview.mutex, AL::TimeSpan::FromMilliseconds(10));
+
+	while (preview.sessions.GetSize() != 0)
+	{
+		auto camera_session = *preview.sessions.begin();
+
+		::shutdown(static_cast<int>(camera_session->connection.socket.GetHandle()), SHUT_RDWR);
+		pi_camera_service_preview_session_detach(camera_service, camera_session);
+	}
+}
+#endif
+bool       pi_camera_service_preview_on_frame(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto  camera_service = reinterpret_cast<pi_camera_service*>(param);
+	auto& preview        = camera_service->preview;
+
+	{
+		AL::OS::MutexGuard lock(preview.mutex);
+
+		if (preview.is_stopping)
+		{
+			preview.is_stopped = true;
+
+			return false;
+		}
+	}
+
+	// copied outside the lock so subscribers picking up the previous frame aren't held up
+	auto frame = new pi_camera_preview_frame();
+	frame->buffer.SetCapacity(size);
+	::memcpy(&frame->buffer[0], buffer, size);
+
+	AL::OS::MutexGuard lock(preview.mutex);
+
+	// subscribers still sending an older frame hold their own reference to it
+	if ((preview.frame != nullptr) && (--preview.frame->reference_count == 0))
+		delete preview.frame;
+
+	preview.frame = frame;
+	++preview.generation;
+	preview.condition.WakeAll();
+
+#if defined(AL_PLATFORM_LINUX)
+	// sessions still sending an older frame only ever get the newest one next
+	for (auto camera_session : preview.sessions)
+	{
+		auto& session_preview = camera_session->preview;
+
+		if (session_preview.is_ending)
+			continue;
+
+		if ((session_preview.next_frame != nullptr) && (--session_preview.next_frame->reference_count == 0))
+			delete session_preview.next_frame;
+
+		session_preview.next_frame = frame;
+		++frame->reference_count;
+	}
+
+	pi_camera_service_preview_sessions_send(camera_service);
+#endif
+
+	return true;
+}
+void       pi_camera_service_preview_thread_main(pi_camera_service* camera_service)
+{
+	auto  error_code = pi_camera_cli_execute_preview(&camera_service->local, &pi_camera_service_preview_on_frame, camera_service);
+	auto& preview    = camera_service->preview;
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_preview_sessions_end(camera_service, error_code);
+#endif
+
+	AL::OS::MutexGuard lock(preview.mutex);
+
+	if ((preview.frame != nullptr) && (--preview.frame->reference_count == 0))
+		delete preview.frame;
+
+	preview.frame      = nullptr;
+	preview.error_code = error_code;
+	preview.is_running = false;
+	preview.is_stopped = false;
+	++preview.generation;
+	preview.condition.WakeAll();
+}
+// Starts the encoder for the first subscriber
+AL::uint8  pi_camera_service_preview_subscribe(pi_camera_service* camera_service)
+{
+	auto& preview = camera_service->preview;
+
+	AL::OS::MutexGuard lock(preview.mutex);
+
+	// a run that already decided to stop can't be resumed
+	while (preview.is_stopped)
+		preview.condition.Sleep(preview.mutex);
+
+	if (preview.is_closing)
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	++preview.subscriber_count;
+	preview.is_stopping = false;
+
+	if (preview.is_running)
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	// the previous run has already left its last critical section
+	if (preview.thread != nullptr)
+	{
+		try
+		{
+			while (!preview.thread->Join())
+			{
+			}
+		}
+		catch (const AL::Exception& exception)
+		{
+		}
+
+		delete preview.thread;
+	}
+
+	preview.thread     = new AL::OS::Thread();
+	preview.is_running = true;
+	preview.error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	try
+	{
+		preview.thread->Start([camera_service]()
+		{
+			pi_camera_service_preview_thread_main(camera_service);
+		});
+	}
+	catch (const AL::Exception& exception)
+	{
+		delete preview.thread;
+
+		preview.thread     = nullptr;
+		preview.is_running = false;
+		--preview.subscriber_count;
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+// The encoder stops on its next frame once the last subscriber leaves
+void       pi_camera_service_preview_unsubscribe(pi_camera_service* camera_service)
+{
+	AL::OS::MutexGuard lock(camera_service->preview.mutex);
+
+	if (--camera_service->preview.subscriber_count == 0)
+		camera_service->preview.is_stopping = true;
+}
+// Delivers the latest frame each time on_frame returns, a slow subscriber skips frames instead of holding up the encoder or the other subscribers
+AL::uint8  pi_camera_service_preview(pi_camera_service* camera_service, pi_camera_preview_on_frame on_frame, void* param)
+{
+	AL::uint8 error_code;
+
+	if ((error_code = pi_camera_service_preview_subscribe(camera_service)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	auto&      preview    = camera_service->preview;
+	AL::uint64 generation = 0;
+
+	for (bool is_stopped = false; !is_stopped; )
+	{
+		preview.mutex.Lock();
+
+		while (preview.is_running && ((preview.frame == nullptr) || (preview.generation == generation)))
+			preview.condition.Sleep(preview.mutex);
+
+		if (!preview.is_running)
+		{
+			// the encoder only exits on its own when something went wrong
+			if ((error_code = preview.error_code) == PI_CAMERA_ERROR_CODE_SUCCESS)
+				error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+			preview.mutex.Unlock();
+
+			break;
+		}
+
+		auto frame = preview.frame;
+		++frame->reference_count;
+		generation = preview.generation;
+
+		preview.mutex.Unlock();
+
+		is_stopped = !on_frame(&frame->buffer[0], static_cast<AL::uint32>(frame->buffer.GetSize()), param);
+
+		pi_camera_service_preview_frame_release(camera_service, frame);
+	}
+
+	pi_camera_service_preview_unsubscribe(camera_service);
+
+	return error_code;
+}
+// Stops the encoder regardless of subscribers, they return with an error
+void       pi_camera_service_preview_stop(pi_camera_service* camera_service)
+{
+	auto&           preview = camera_service->preview;
+	AL::OS::Thread* thread;
+
+	{
+		AL::OS::MutexGuard lock(preview.mutex);
+
+		preview.is_closing  = true;
+		preview.is_stopping = true;
+		thread              = preview.thread;
+		preview.thread      = nullptr;
+	}
+
+	if (thread != nullptr)
+	{
+		try
+		{
+			while (!thread->Join())
+			{
+			}
+		}
+		catch (const AL::Exception& exception)
+		{
+		}
+
+		delete thread;
+	}
+}
+
+bool pi_camera_service_packet_handler_is_busy(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	bool      value;
+	AL::uint8 error_code = pi_camera_is_busy(camera_service, &value);
+
+	return pi_camera_net_complete_is_busy(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_ev(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::int8  value;
+	AL::uint8 error_code = pi_camera_get_ev(camera_service, &value);
+
+	return pi_camera_net_complete_get_ev(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_ev(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = static_cast<AL::int8>(buffer[0]);
+	AL::uint8 error_code = pi_camera_set_ev(camera_service, value);
+
+	return pi_camera_net_complete_set_ev(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_iso(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint16 value;
+	AL::uint8  error_code = pi_camera_get_iso(camera_service, &value);
+
+	return pi_camera_net_complete_get_iso(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_iso(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
+	AL::uint8 error_code = pi_camera_set_iso(camera_service, value);
+
+	return pi_camera_net_complete_set_iso(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_config(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	pi_camera_config value;
+	AL::uint8        error_code = pi_camera_get_config(camera_service, &value);
+
+	return pi_camera_net_complete_get_config(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_config(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = pi_camera_config_from_packet_buffer(buffer, size);
+	AL::uint8 error_code = pi_camera_set_config(camera_service, &value);
+
+	return pi_camera_net_complete_set_config(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_properties(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	pi_camera_property_list values;
+
+	if (!pi_camera_properties_from_packet_buffer(values, buffer, size) || (values.GetSize() > AL::Integer<AL::uint8>::Maximum))
+		return false;
+
+	auto      count      = static_cast<AL::uint8>(values.GetSize());
+	AL::uint8 error_code = pi_camera_get_properties(camera_service, (count != 0) ? &values[0] : nullptr, count);
+
+	return pi_camera_net_complete_get_properties(camera_session->connection, error_code, (count != 0) ? &values[0] : nullptr, count);
+}
+bool pi_camera_service_packet_handler_set_properties(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	pi_camera_property_list values;
+
+	if (!pi_camera_properties_from_packet_buffer(values, buffer, size) || (values.GetSize() > AL::Integer<AL::uint8>::Maximum))
+		return false;
+
+	auto      count      = static_cast<AL::uint8>(values.GetSize());
+	AL::uint8 error_code = pi_camera_set_properties(camera_service, (count != 0) ? &values[0] : nullptr, count);
+
+	return pi_camera_net_complete_set_properties(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_get_contrast(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::int8  value;
+	AL::uint8 error_code = pi_camera_get_contrast(camera_service, &value);
+
+	return pi_camera_net_complete_get_contrast(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_contrast(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = static_cast<AL::int8>(buffer[0]);
+	AL::uint8 error_code = pi_camera_set_contrast(camera_service, value);
+
+	return pi_camera_net_complete_set_contrast(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_sharpness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::int8  value;
+	AL::uint8 error_code = pi_camera_get_sharpness(camera_service, &value);
+
+	return pi_camera_net_complete_get_sharpness(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_sharpness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = static_cast<AL::int8>(buffer[0]);
+	AL::uint8 error_code = pi_camera_set_sharpness(camera_service, value);
+
+	return pi_camera_net_complete_set_sharpness(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_brightness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_brightness(camera_service, &value);
+
+	return pi_camera_net_complete_get_brightness(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_brightness(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_brightness(camera_service, value);
+
+	return pi_camera_net_complete_set_brightness(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_saturation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::int8  value;
+	AL::uint8 error_code = pi_camera_get_saturation(camera_service, &value);
+
+	return pi_camera_net_complete_get_saturation(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_saturation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = static_cast<AL::int8>(buffer[0]);
+	AL::uint8 error_code = pi_camera_set_saturation(camera_service, value);
+
+	return pi_camera_net_complete_set_saturation(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_white_balance(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_white_balance(camera_service, &value);
+
+	return pi_camera_net_complete_get_white_balance(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_white_balance(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_white_balance(camera_service, value);
+
+	return pi_camera_net_complete_set_white_balance(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_shutter_speed(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint64 value;
+	AL::uint8    error_code = pi_camera_get_shutter_speed(camera_service, &value);
+
+	return pi_camera_net_complete_get_shutter_speed(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_shutter_speed(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(buffer));
+	AL::uint8 error_code = pi_camera_set_shutter_speed(camera_service, value);
+
+	return pi_camera_net_complete_set_shutter_speed(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_exposure_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_exposure_mode(camera_service, &value);
+
+	return pi_camera_net_complete_get_exposure_mode(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_exposure_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_exposure_mode(camera_service, value);
+
+	return pi_camera_net_complete_set_exposure_mode(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_metoring_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_metoring_mode(camera_service, &value);
+
+	return pi_camera_net_complete_get_metoring_mode(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_metoring_mode(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_metoring_mode(camera_service, value);
+
+	return pi_camera_net_complete_set_metoring_mode(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_jpg_quality(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_jpg_quality(camera_service, &value);
+
+	return pi_camera_net_complete_get_jpg_quality(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_jpg_quality(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_jpg_quality(camera_service, value);
+
+	return pi_camera_net_complete_set_jpg_quality(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_image_size(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint16 width, height;
+	AL::uint8  error_code = pi_camera_get_image_size(camera_service, &width, &height);
+
+	return pi_camera_net_complete_get_image_size(camera_session->connection, error_code, width, height);
+}
+bool pi_camera_service_packet_handler_set_image_size(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      width      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
+	auto      height     = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(&buffer[2]));
+	AL::uint8 error_code = pi_camera_set_image_size(camera_service, width, height);
+
+	return pi_camera_net_complete_set_image_size(camera_session->connection, error_code, width, height);
+}
+bool pi_camera_service_packet_handler_get_image_effect(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_image_effect(camera_service, &value);
+
+	return pi_camera_net_complete_get_image_effect(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_image_effect(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = buffer[0];
+	AL::uint8 error_code = pi_camera_set_image_effect(camera_service, value);
+
+	return pi_camera_net_complete_set_image_effect(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_image_rotation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint16 value;
+	AL::uint8  error_code = pi_camera_get_image_rotation(camera_service, &value);
+
+	return pi_camera_net_complete_get_image_rotation(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_image_rotation(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint16*>(buffer));
+	AL::uint8 error_code = pi_camera_set_image_rotation(camera_service, value);
+
+	return pi_camera_net_complete_set_image_rotation(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_video_bit_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint32 value;
+	AL::uint8  error_code = pi_camera_get_video_bit_rate(camera_service, &value);
+
+	return pi_camera_net_complete_get_video_bit_rate(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_video_bit_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto      value      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
+	AL::uint8 error_code = pi_camera_set_video_bit_rate(camera_service, value);
+
+	return pi_camera_net_complete_set_video_bit_rate(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_get_video_frame_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 value;
+	AL::uint8 error_code = pi_camera_get_video_frame_rate(camera_service, &value);
+
+	return pi_camera_net_complete_get_video_frame_rate(camera_session->connection, error_code, value);
+}
+bool pi_camera_service_packet_handler_set_video_frame_rate(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_set_video_frame_rate(camera_service, *buffer);
+
+	return pi_camera_net_complete_set_video_frame_rate(camera_session->connection, error_code, *buffer);
+}
+bool pi_camera_service_packet_handler_capture(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	pi_camera_transfer_stats       transfer_stats = {};
+	pi_camera_capture_cache_entry* capture_result = nullptr;
+	AL::uint8                      error_code     = pi_camera_service_capture_cached(camera_service, capture_result);
+	bool                           result;
+
+	if (capture_result != nullptr)
+	{
+		result = pi_camera_net_complete_capture(camera_session->connection, error_code, capture_result->file_path.GetCString(), &transfer_stats);
+
+		pi_camera_service_capture_result_release(camera_service, capture_result);
+	}
+	else
+		result = pi_camera_net_complete_capture(camera_session->connection, error_code, nullptr, &transfer_stats);
+
+	pi_camera_service_add_transfer_stats(camera_service, transfer_stats);
+
+	return result;
+}
+bool pi_camera_service_packet_handler_capture_video(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	pi_camera_transfer_stats transfer_stats       = {};
+	auto                     video_length_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
+	auto                     file_path            = pi_camera_service_next_file_path(camera_service, "./pi_video_%llu.mp4", camera_service->video_counter);
+	auto                     transfer_id          = pi_camera_service_next_transfer_id(camera_service);
+	AL::uint8                error_code           = pi_camera_capture_video(camera_service, file_path.GetCString(), video_length_seconds, nullptr, nullptr);
+	bool                     result               = pi_camera_net_complete_capture_video(camera_session->connection, error_code, file_path.GetCString(), transfer_id, &transfer_stats);
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_file_delete(file_path.GetCString());
+	else
+		pi_camera_service_complete_transfer(camera_service, transfer_id, file_path.GetCString(), true, result);
+
+	pi_camera_service_add_transfer_stats(camera_service, transfer_stats);
+
+	return result;
+}
+
+AL::uint8 pi_camera_cli_execute_stream(pi_camera_local* camera_local, pi_camera_cli_on_output on_output, void* param);
+
+AL::uint8 pi_camera_service_capture_stream_on_output(const void* buffer, AL::size_t size, void* param)
+{
+	auto camera_session = reinterpret_cast<pi_camera_session*>(param);
+
+	if (!pi_camera_net_complete_capture_stream_chunk(camera_session->connection, buffer, static_cast<AL::uint32>(size)))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+bool pi_camera_service_packet_handler_capture_stream(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_cli_execute_stream(&camera_service->local, &pi_camera_service_capture_stream_on_output, camera_session);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+		return false;
+
+	return pi_camera_net_complete_capture_stream(camera_session->connection, error_code);
+}
+#if defined(AL_PLATFORM_LINUX)
+// Hands the session to the encoder thread, which sends it frames until the client sends any packet
+bool pi_camera_service_packet_handler_preview_stream(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto&     preview    = camera_service->preview;
+	AL::uint8 error_code = pi_camera_service_preview_subscribe(camera_service);
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return pi_camera_net_complete_preview_stream(camera_session->connection, error_code);
+
+	{
+		AL::OS::MutexGuard lock(preview.mutex);
+
+		if (preview.is_running && !preview.is_stopped)
+		{
+			auto& session_preview        = camera_session->preview;
+			session_preview              = pi_camera_session_preview();
+			session_preview.is_streaming = true;
+
+			if (preview.frame != nullptr)
+			{
+				session_preview.next_frame = preview.frame;
+				++preview.frame->reference_count;
+			}
+
+			preview.sessions.PushBack(camera_session);
+
+			return true;
+		}
+
+		// the encoder failed before the session could be added
+		if ((error_code = preview.error_code) == PI_CAMERA_ERROR_CODE_SUCCESS)
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+		if (--preview.subscriber_count == 0)
+			preview.is_stopping = true;
+	}
+
+	return pi_camera_net_complete_preview_stream(camera_session->connection, error_code);
+}
+#else
+bool pi_camera_service_preview_stream_on_frame(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto                    camera_session = reinterpret_cast<pi_camera_session*>(param);
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+
+	if (!pi_camera_net_complete_preview_stream_frame(camera_session->connection, buffer, size))
+		return false;
+
+	// any packet from the client ends the stream
+	return pi_camera_net_receive_packet(camera_session->connection, packet_header, packet_buffer) == -1;
+}
+bool pi_camera_service_packet_handler_preview_stream(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_service_preview(camera_service, &pi_camera_service_preview_stream_on_frame, camera_session);
+
+	return pi_camera_net_complete_preview_stream(camera_session->connection, error_code);
+}
+#endif
+AL::uint8 pi_camera_cli_video_execute_stream(pi_camera_local* camera_local, AL::uint32 video_length_seconds, AL::uint32 intra_period, pi_camera_video_on_nal_unit on_nal_unit, void* param);
+
+bool pi_camera_service_capture_video_stream_on_nal_unit(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto                    camera_session = reinterpret_cast<pi_camera_session*>(param);
+	pi_camera_packet_header packet_header;
+	pi_camera_packet_buffer packet_buffer;
+
+	if (!pi_camera_net_complete_capture_video_stream_nal_unit(camera_session->connection, buffer, size))
+		return false;
+
+	// any packet from the client ends the recording
+	return pi_camera_net_receive_packet(camera_session->connection, packet_header, packet_buffer) == -1;
+}
+bool pi_camera_service_packet_handler_capture_video_stream(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < sizeof(AL::uint32))
+		return pi_camera_net_complete_capture_video_stream(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	// a stream holds its worker until the client stops it, one is always left for everything else
+	bool is_pooled = pi_camera_worker_pool_is_running(&camera_service->worker_pool);
+
+	if (is_pooled)
+	{
+		AL::OS::MutexGuard lock(camera_service->video_stream_mutex);
+
+		if ((camera_service->video_stream_count + 1) >= camera_service->worker_count)
+			return pi_camera_net_complete_capture_video_stream(camera_session->connection, PI_CAMERA_ERROR_CODE_CAMERA_BUSY);
+
+		++camera_service->video_stream_count;
+	}
+
+	auto      video_length_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
+	AL::uint8 error_code           = pi_camera_cli_video_execute_stream(&camera_service->local, video_length_seconds, 0, &pi_camera_service_capture_video_stream_on_nal_unit, camera_session);
+
+	if (is_pooled)
+	{
+		AL::OS::MutexGuard lock(camera_service->video_stream_mutex);
+
+		--camera_service->video_stream_count;
+	}
+
+	return pi_camera_net_complete_capture_video_stream(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_start_recording(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_start_recording(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	auto      segment_length_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto      disk_budget            = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+	AL::uint8 error_code             = pi_camera_start_recording(camera_service, nullptr, static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>(segment_length_seconds, 0, AL::Integer<AL::uint32>::Maximum)), disk_budget);
+
+	return pi_camera_net_complete_start_recording(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_stop_recording(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_stop_recording(camera_service);
+
+	return pi_camera_net_complete_stop_recording(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_get_recording_segments(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_get_recording_segments(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, nullptr, 0);
+
+	auto start_time_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto end_time_ms   = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+
+	AL::Collections::Array<pi_camera_recording_segment> values;
+	AL::uint32                                          count = 0;
+	AL::uint8                                           error_code;
+
+	// segments may be added between counting and listing them
+	while ((error_code = pi_camera_get_recording_segments(camera_service, start_time_ms, end_time_ms, (count != 0) ? &values[0] : nullptr, &count)) == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL)
+		values.SetCapacity(count);
+
+	return pi_camera_net_complete_get_recording_segments(camera_session->connection, error_code, (count != 0) ? &values[0] : nullptr, count);
+}
+
+AL::uint8 pi_camera_cli_get_recording_segment_path(pi_camera_local* camera_local, AL::uint64 id, AL::String& file_path);
+
+bool pi_camera_service_packet_handler_get_recording_segment(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < sizeof(AL::uint64))
+		return pi_camera_net_complete_get_recording_segment(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, nullptr, 0, nullptr);
+
+	pi_camera_transfer_stats transfer_stats = {};
+	AL::String               file_path;
+	auto                     id             = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(buffer));
+	auto                     transfer_id    = pi_camera_service_next_transfer_id(camera_service);
+	AL::uint8                error_code     = pi_camera_cli_get_recording_segment_path(&camera_service->local, id, file_path);
+	bool                     result         = pi_camera_net_complete_get_recording_segment(camera_session->connection, error_code, file_path.GetCString(), transfer_id, &transfer_stats);
+
+	// the segment may still be deleted to respect the disk budget before the transfer is resumed
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_service_complete_transfer(camera_service, transfer_id, file_path.GetCString(), false, result);
+
+	pi_camera_service_add_transfer_stats(camera_service, transfer_stats);
+
+	return result;
+}
+
+bool pi_camera_service_packet_handler_start_pre_roll(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint32)))
+		return pi_camera_net_complete_start_pre_roll(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	auto      pre_roll_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&buffer[0]));
+	auto      buffer_size      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&buffer[4]));
+	AL::uint8 error_code       = pi_camera_start_pre_roll(camera_service, pre_roll_seconds, buffer_size);
+
+	return pi_camera_net_complete_start_pre_roll(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_stop_pre_roll(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_stop_pre_roll(camera_service);
+
+	return pi_camera_net_complete_stop_pre_roll(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_capture_pre_roll(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < sizeof(AL::uint32))
+		return pi_camera_net_complete_capture_pre_roll(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, nullptr, 0, nullptr);
+
+	pi_camera_transfer_stats transfer_stats       = {};
+	auto                     video_length_seconds = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(buffer));
+	auto                     file_path            = pi_camera_service_next_file_path(camera_service, "./pi_video_%llu.mp4", camera_service->video_counter);
+	auto                     transfer_id          = pi_camera_service_next_transfer_id(camera_service);
+	AL::uint8                error_code           = pi_camera_capture_pre_roll(camera_service, file_path.GetCString(), video_length_seconds, nullptr, nullptr);
+	bool                     result               = pi_camera_net_complete_capture_pre_roll(camera_session->connection, error_code, file_path.GetCString(), transfer_id, &transfer_stats);
+
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_file_delete(file_path.GetCString());
+	else
+		pi_camera_service_complete_transfer(camera_service, transfer_id, file_path.GetCString(), true, result);
+
+	pi_camera_service_add_transfer_stats(camera_service, transfer_stats);
+
+	return result;
+}
+
+AL::uint8 pi_camera_cli_execute_burst(pi_camera_local* camera_local, AL::uint32 count, AL::uint32 interval_ms, pi_camera_cli_on_burst_frame on_frame, void* param);
+
+struct pi_camera_service_transfer_context
+{
+	pi_camera_service* camera_service;
+	pi_camera_session* camera_session;
+};
+
+AL::uint8 pi_camera_service_capture_burst_on_frame(AL::uint32 frame_index, const char* frame_path, void* param)
+{
+	auto                     context        = reinterpret_cast<pi_camera_service_transfer_context*>(param);
+	pi_camera_transfer_stats transfer_stats = {};
+	bool                     result         = pi_camera_net_complete_capture_burst_frame(context->camera_session->connection, frame_index, frame_path, &transfer_stats);
+
+	pi_camera_service_add_transfer_stats(context->camera_service, transfer_stats);
+
+	return result ? PI_CAMERA_ERROR_CODE_SUCCESS : PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+}
+bool pi_camera_service_packet_handler_capture_burst(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint32)))
+		return pi_camera_net_complete_capture_burst(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	pi_camera_service_transfer_context context =
+	{
+		.camera_service = camera_service,
+		.camera_session = camera_session
+	};
+
+	auto      count       = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&buffer[0]));
+	auto      interval_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint32*>(&buffer[4]));
+	AL::uint8 error_code  = pi_camera_cli_execute_burst(&camera_service->local, count, interval_ms, &pi_camera_service_capture_burst_on_frame, &context);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+		return false;
+
+	return pi_camera_net_complete_capture_burst(camera_session->connection, error_code);
+}
+
+bool pi_camera_service_packet_handler_start_timelapse(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (3 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_start_timelapse(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	auto      interval_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto      count       = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+	auto      end_time_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[16]));
+	AL::uint8 error_code  = pi_camera_start_timelapse(camera_service, static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>(interval_ms, 0, AL::Integer<AL::uint32>::Maximum)), static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>(count, 0, AL::Integer<AL::uint32>::Maximum)), end_time_ms);
+
+	return pi_camera_net_complete_start_timelapse(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_stop_timelapse(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	AL::uint8 error_code = pi_camera_stop_timelapse(camera_service);
+
+	return pi_camera_net_complete_stop_timelapse(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_get_captures(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_get_captures(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, nullptr, 0);
+
+	auto start_time_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto end_time_ms   = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+
+	AL::Collections::Array<pi_camera_capture_info> values;
+	AL::uint32                                     count = 0;
+	AL::uint8                                      error_code;
+
+	// captures may be stored between counting and listing them
+	while ((error_code = pi_camera_get_captures(camera_service, start_time_ms, end_time_ms, (count != 0) ? &values[0] : nullptr, &count)) == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL)
+		values.SetCapacity(count);
+
+	return pi_camera_net_complete_get_captures(camera_session->connection, error_code, (count != 0) ? &values[0] : nullptr, count);
+}
+
+AL::uint8 pi_camera_cli_execute_captures(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_cli_on_capture on_capture, void* param);
+
+AL::uint8 pi_camera_service_fetch_captures_on_capture(const pi_camera_capture_info& capture, const char* file_path, void* param)
+{
+	auto                     context        = reinterpret_cast<pi_camera_service_transfer_context*>(param);
+	pi_camera_transfer_stats transfer_stats = {};
+	bool                     result         = pi_camera_net_complete_fetch_capture(context->camera_session->connection, capture.timestamp_ms, file_path, &transfer_stats);
+
+	pi_camera_service_add_transfer_stats(context->camera_service, transfer_stats);
+
+	return result ? PI_CAMERA_ERROR_CODE_SUCCESS : PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+}
+bool pi_camera_service_packet_handler_fetch_captures(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_fetch_captures(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED);
+
+	pi_camera_service_transfer_context context =
+	{
+		.camera_service = camera_service,
+		.camera_session = camera_session
+	};
+
+	auto      start_time_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto      end_time_ms   = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+	AL::uint8 error_code    = pi_camera_cli_execute_captures(&camera_service->local, start_time_ms, end_time_ms, &pi_camera_service_fetch_captures_on_capture, &context);
+
+	if (error_code == PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED)
+		return false;
+
+	return pi_camera_net_complete_fetch_captures(camera_session->connection, error_code);
+}
+bool pi_camera_service_packet_handler_delete_captures(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_delete_captures(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, 0);
+
+	AL::uint32 count         = 0;
+	auto       start_time_ms = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto       end_time_ms   = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+	AL::uint8  error_code    = pi_camera_delete_captures(camera_service, start_time_ms, end_time_ms, &count);
+
+	return pi_camera_net_complete_delete_captures(camera_session->connection, error_code, count);
+}
+bool pi_camera_service_packet_handler_resume_file_transfer(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	if (size < (2 * sizeof(AL::uint64)))
+		return pi_camera_net_complete_resume_file_transfer(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_SUPPORTED, nullptr, 0, 0, nullptr);
+
+	auto transfer_id = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[0]));
+	auto offset      = AL::BitConverter::NetworkToHost(*reinterpret_cast<const AL::uint64*>(&buffer[8]));
+	auto transfer    = pi_camera_service_resume_transfer(camera_service, transfer_id);
+
+	if (transfer == nullptr)
+		return pi_camera_net_complete_resume_file_transfer(camera_session->connection, PI_CAMERA_ERROR_CODE_NOT_FOUND, nullptr, 0, 0, nullptr);
+
+	pi_camera_transfer_stats transfer_stats = {};
+	bool                     result         = pi_camera_net_complete_resume_file_transfer(camera_session->connection, PI_CAMERA_ERROR_CODE_SUCCESS, transfer->file_path.GetCString(), transfer_id, offset, &transfer_stats);
+
+	// a transfer cut short again is kept for another grace period
+	if (result)
+		pi_camera_service_release_transfer(transfer);
+	else
+		pi_camera_service_retain_transfer(camera_service, transfer);
+
+	pi_camera_service_add_transfer_stats(camera_service, transfer_stats);
+
+	return result;
+}
+bool pi_camera_service_packet_handler_hello(pi_camera_service* camera_service, pi_camera_session* camera_session, const pi_camera_packet_header& header, const AL::uint8* buffer, AL::size_t size)
+{
+	auto capabilities = pi_camera_capabilities_from_protocol_version(PI_CAMERA_PROTOCOL_VERSION_1);
+
+	if (size >= sizeof(pi_camera_capabilities))
+		capabilities = pi_camera_capabilities_from_network(buffer);
+	else if (size >= sizeof(AL::uint8))
+		capabilities = pi_camera_capabilities_from_protocol_version(buffer[0]);
+
+	return pi_camera_net_complete_hello(camera_session->connection, pi_camera_capabilities_negotiate(capabilities));
+}
+
+constexpr pi_camera_service_packet_handler_context pi_camera_service_packet_handlers[PI_CAMERA_OPCODE_COUNT] =
+{
+	{ PI_CAMERA_OPCODE_IS_BUSY,                &pi_camera_service_packet_handler_is_busy,                false },
+
+	{ PI_CAMERA_OPCODE_GET_EV,                 &pi_camera_service_packet_handler_get_ev,                 false },
+	{ PI_CAMERA_OPCODE_SET_EV,                 &pi_camera_service_packet_handler_set_ev,                 false },
+
+	{ PI_CAMERA_OPCODE_GET_ISO,                &pi_camera_service_packet_handler_get_iso,                false },
+	{ PI_CAMERA_OPCODE_SET_ISO,                &pi_camera_service_packet_handler_set_iso,                false },
+
+	{ PI_CAMERA_OPCODE_GET_CONFIG,             &pi_camera_service_packet_handler_get_config,             false },
+	{ PI_CAMERA_OPCODE_SET_CONFIG,             &pi_camera_service_packet_handler_set_config,             false },
+
+	{ PI_CAMERA_OPCODE_GET_CONTRAST,           &pi_camera_service_packet_handler_get_contrast,           false },
+	{ PI_CAMERA_OPCODE_SET_CONTRAST,           &pi_camera_service_packet_handler_set_contrast,           false },
+
+	{ PI_CAMERA_OPCODE_GET_SHARPNESS,          &pi_camera_service_packet_handler_get_sharpness,          false },
+	{ PI_CAMERA_OPCODE_SET_SHARPNESS,          &pi_camera_service_packet_handler_set_sharpness,          false },
+
+	{ PI_CAMERA_OPCODE_GET_BRIGHTNESS,         &pi_camera_service_packet_handler_get_brightness,         false },
+	{ PI_CAMERA_OPCODE_SET_BRIGHTNESS,         &pi_camera_service_packet_handler_set_brightness,         false },
+
+	{ PI_CAMERA_OPCODE_GET_SATURATION,         &pi_camera_service_packet_handler_get_saturation,         false },
+	{ PI_CAMERA_OPCODE_SET_SATURATION,         &pi_camera_service_packet_handler_set_saturation,         false },
+
+	{ PI_CAMERA_OPCODE_GET_WHITE_BALANCE,      &pi_camera_service_packet_handler_get_white_balance,      false },
+	{ PI_CAMERA_OPCODE_SET_WHITE_BALANCE,      &pi_camera_service_packet_handler_set_white_balance,      false },
+
+	{ PI_CAMERA_OPCODE_GET_SHUTTER_SPEED,      &pi_camera_service_packet_handler_get_shutter_speed,      false },
+	{ PI_CAMERA_OPCODE_SET_SHUTTER_SPEED,      &pi_camera_service_packet_handler_set_shutter_speed,      false },
+
+	{ PI_CAMERA_OPCODE_GET_EXPOSURE_MODE,      &pi_camera_service_packet_handler_get_exposure_mode,      false },
+	{ PI_CAMERA_OPCODE_SET_EXPOSURE_MODE,      &pi_camera_service_packet_handler_set_exposure_mode,      false },
+
+	{ PI_CAMERA_OPCODE_GET_METORING_MODE,      &pi_camera_service_packet_handler_get_metoring_mode,      false },
+	{ PI_CAMERA_OPCODE_SET_METORING_MODE,      &pi_camera_service_packet_handler_set_metoring_mode,      false },
+
+	{ PI_CAMERA_OPCODE_GET_JPG_QUALITY,        &pi_camera_service_packet_handler_get_jpg_quality,        false },
+	{ PI_CAMERA_OPCODE_SET_JPG_QUALITY,        &pi_camera_service_packet_handler_set_jpg_quality,        false },
+
+	{ PI_CAMERA_OPCODE_GET_IMAGE_SIZE,         &pi_camera_service_packet_handler_get_image_size,         false },
+	{ PI_CAMERA_OPCODE_SET_IMAGE_SIZE,         &pi_camera_service_packet_handler_set_image_size,         false },
+
+	{ PI_CAMERA_OPCODE_GET_IMAGE_EFFECT,       &pi_camera_service_packet_handler_get_image_effect,       false },
+	{ PI_CAMERA_OPCODE_SET_IMAGE_EFFECT,       &pi_camera_service_packet_handler_set_image_effect,       false },
+
+	{ PI_CAMERA_OPCODE_GET_IMAGE_ROTATION,     &pi_camera_service_packet_handler_get_image_rotation,     false },
+	{ PI_CAMERA_OPCODE_SET_IMAGE_ROTATION,     &pi_camera_service_packet_handler_set_image_rotation,     false },
+
+	{ PI_CAMERA_OPCODE_GET_VIDEO_BIT_RATE,     &pi_camera_service_packet_handler_get_video_bit_rate,     false },
+	{ PI_CAMERA_OPCODE_SET_VIDEO_BIT_RATE,     &pi_camera_service_packet_handler_set_video_bit_rate,     false },
+
+	{ PI_CAMERA_OPCODE_GET_VIDEO_FRAME_RATE,   &pi_camera_service_packet_handler_get_video_frame_rate,   false },
+	{ PI_CAMERA_OPCODE_SET_VIDEO_FRAME_RATE,   &pi_camera_service_packet_handler_set_video_frame_rate,   false },
+
+	{ PI_CAMERA_OPCODE_FILE_TRANSFER,          nullptr,                                                  false },
+	{ PI_CAMERA_OPCODE_FILE_TRANSFER_ACK,      nullptr,                                                  false },
+
+	{ PI_CAMERA_OPCODE_CAPTURE,                &pi_camera_service_packet_handler_capture,                true },
+	{ PI_CAMERA_OPCODE_CAPTURE_VIDEO,          &pi_camera_service_packet_handler_capture_video,          true },
+	{ PI_CAMERA_OPCODE_CAPTURE_STREAM,         &pi_camera_service_packet_handler_capture_stream,         true },
+
+	{ PI_CAMERA_OPCODE_HELLO,                  &pi_camera_service_packet_handler_hello,                  false },
+
+	{ PI_CAMERA_OPCODE_GET_PROPERTIES,         &pi_camera_service_packet_handler_get_properties,         false },
+	{ PI_CAMERA_OPCODE_SET_PROPERTIES,         &pi_camera_service_packet_handler_set_properties,         false },
+
+#if defined(AL_PLATFORM_LINUX)
+	// fanned out by the encoder thread
+	{ PI_CAMERA_OPCODE_PREVIEW_STREAM,         &pi_camera_service_packet_handler_preview_stream,         false },
+#else
+	{ PI_CAMERA_OPCODE_PREVIEW_STREAM,         &pi_camera_service_packet_handler_preview_stream,         true },
+#endif
+	{ PI_CAMERA_OPCODE_CAPTURE_VIDEO_STREAM,   &pi_camera_service_packet_handler_capture_video_stream,   true },
+
+	{ PI_CAMERA_OPCODE_START_RECORDING,        &pi_camera_service_packet_handler_start_recording,        false },
+	{ PI_CAMERA_OPCODE_STOP_RECORDING,         &pi_camera_service_packet_handler_stop_recording,         true },
+	{ PI_CAMERA_OPCODE_GET_RECORDING_SEGMENTS, &pi_camera_service_packet_handler_get_recording_segments, false },
+	{ PI_CAMERA_OPCODE_GET_RECORDING_SEGMENT,  &pi_camera_service_packet_handler_get_recording_segment,  true },
+
+	{ PI_CAMERA_OPCODE_START_PRE_ROLL,         &pi_camera_service_packet_handler_start_pre_roll,         false },
+	{ PI_CAMERA_OPCODE_STOP_PRE_ROLL,          &pi_camera_service_packet_handler_stop_pre_roll,          true },
+	{ PI_CAMERA_OPCODE_CAPTURE_PRE_ROLL,       &pi_camera_service_packet_handler_capture_pre_roll,       true },
+
+	{ PI_CAMERA_OPCODE_CAPTURE_BURST,          &pi_camera_service_packet_handler_capture_burst,          true },
+
+	{ PI_CAMERA_OPCODE_START_TIMELAPSE,        &pi_camera_service_packet_handler_start_timelapse,        false },
+	{ PI_CAMERA_OPCODE_STOP_TIMELAPSE,         &pi_camera_service_packet_handler_stop_timelapse,         true },
+
+	{ PI_CAMERA_OPCODE_GET_CAPTURES,           &pi_camera_service_packet_handler_get_captures,           false },
+	{ PI_CAMERA_OPCODE_FETCH_CAPTURES,         &pi_camera_service_packet_handler_fetch_captures,         true },
+	{ PI_CAMERA_OPCODE_DELETE_CAPTURES,        &pi_camera_service_packet_handler_delete_captures,        true },
+
+	{ PI_CAMERA_OPCODE_RESUME_FILE_TRANSFER,   &pi_camera_service_packet_handler_resume_file_transfer,   true }
+};
+
+template<AL::size_t ... INDEXES>
+constexpr bool pi_camera_service_packet_handlers_is_valid(AL::Index_Sequence<INDEXES ...>)
+{
+	return ((pi_camera_service_packet_handlers[INDEXES].opcode == INDEXES) && ...);
+}
+
+static_assert(pi_camera_service_packet_handlers_is_valid(typename AL::Make_Index_Sequence<PI_CAMERA_OPCODE_COUNT>::Type {}));
+
+AL::uint8 pi_camera_open_session(pi_camera_session** camera_session, pi_camera_service* camera_service, AL::Network::TcpSocket&& socket);
+
+bool      pi_camera_service_accept_session(pi_camera_service* camera_service, pi_camera_session*& camera_session)
+{
+	AL::Network::TcpSocket socket(camera_service->socket.GetAddressFamily());
+
+	switch (pi_camera_net_socket_accept(camera_service->socket, socket))
+	{
+		case 0:                            return false;
+		case -1: camera_session = nullptr; return true;
+	}
+
+	if (pi_camera_open_session(&camera_session, camera_service, AL::Move(socket)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		socket.Close();
+
+		return false;
+	}
+
+	return true;
+}
+void      pi_camera_service_post_job(pi_camera_service* camera_service, pi_camera_session* camera_session, pi_camera_service_packet_handler packet_handler, const pi_camera_packet_header& packet_header, const pi_camera_packet_buffer& packet_buffer);
+
+bool      pi_camera_service_update_session(pi_camera_service* camera_service, pi_camera_session* camera_session)
+{
+	pi_camera_packet_header packet_header;
+	auto&                   packet_buffer = camera_session->connection.packet_buffer;
+
+	switch (pi_camera_net_receive_packet(camera_session->connection, packet_header, packet_buffer))
+	{
+		case 0:  return false;
+		case -1: return true;
+	}
+
+	pi_camera_service_add_request(camera_service);
+
+#if defined(AL_PLATFORM_LINUX)
+	{
+		AL::OS::MutexGuard lock(camera_service->preview.mutex);
+
+		// any packet from the client ends the stream, the encoder thread sends the final reply after the frame in flight
+		if (camera_session->preview.is_streaming)
+		{
+			if (camera_session->preview.is_ending)
+			{
+				pi_camera_net_socket_close(camera_session->connection.socket);
+
+				return false;
+			}
+
+			pi_camera_service_preview_session_end(camera_session, PI_CAMERA_ERROR_CODE_SUCCESS);
+			pi_camera_service_preview_sessions_send(camera_service);
+
+			return true;
+		}
+	}
+#endif
+
+	if (packet_header.opcode >= PI_CAMERA_OPCODE_COUNT)
+	{
+		pi_camera_net_socket_close(camera_session->connection.socket);
+
+		return false;
+	}
+
+	auto& packet_handler_context = pi_camera_service_packet_handlers[packet_header.opcode];
+
+	if (packet_handler_context.packet_handler == nullptr)
+	{
+		pi_camera_net_socket_close(camera_session->connection.socket);
+
+		return false;
+	}
+
+	if (packet_handler_context.is_long_running && pi_camera_worker_pool_is_running(&camera_service->worker_pool))
+	{
+		pi_camera_service_post_job(camera_service, camera_session, packet_handler_context.packet_handler, packet_header, packet_buffer);
+
+		return true;
+	}
+
+	camera_session->connection.request_id = packet_header.request_id;
+
+	if (!packet_handler_context.packet_handler(camera_service, camera_session, packet_header, &packet_buffer[0], packet_header.buffer_size))
+	{
+		pi_camera_net_socket_close(camera_session->connection.socket);
+
+		return false;
+	}
+
+	return true;
+}
+#if defined(AL_PLATFORM_LINUX)
+bool      pi_camera_service_epoll_add(pi_camera_service* camera_service, int fd, void* data)
+{
+	epoll_event event =
+	{
+		.events = EPOLLIN,
+		.data   = { .ptr = data }
+	};
+
+	return ::epoll_ctl(camera_service->epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+bool      pi_camera_service_epoll_modify(pi_camera_service* camera_service, int fd, void* data, AL::uint32 events)
+{
+	epoll_event event =
+	{
+		.events = events,
+		.data   = { .ptr = data }
+	};
+
+	return ::epoll_ctl(camera_service->epoll, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+void      pi_camera_service_epoll_remove(pi_camera_service* camera_service, int fd)
+{
+	::epoll_ctl(camera_service->epoll, EPOLL_CTL_DEL, fd, nullptr);
+}
+void      pi_camera_service_epoll_close(pi_camera_service* camera_service)
+{
+	if (camera_service->epoll_wake != -1)
+	{
+		::close(camera_service->epoll_wake);
+		camera_service->epoll_wake = -1;
+	}
+
+	if (camera_service->epoll != -1)
+	{
+		::close(camera_service->epoll);
+		camera_service->epoll = -1;
+	}
+}
+bool      pi_camera_service_epoll_open(pi_camera_service* camera_service)
+{
+	if ((camera_service->epoll = ::epoll_create1(EPOLL_CLOEXEC)) == -1)
+		return false;
+
+	if ((camera_service->epoll_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+	{
+		pi_camera_service_epoll_close(camera_service);
+
+		return false;
+	}
+
+	if (!pi_camera_service_epoll_add(camera_service, camera_service->epoll_wake, &camera_service->epoll_wake) ||
+		!pi_camera_service_epoll_add(camera_service, static_cast<int>(camera_service->socket.GetHandle()), camera_service))
+	{
+		pi_camera_service_epoll_close(camera_service);
+
+		return false;
+	}
+
+	camera_service->is_accepting = true;
+
+	return true;
+}
+// @return false if the service thread could not be woken
+bool      pi_camera_service_epoll_wake(pi_camera_service* camera_service)
+{
+	AL::uint64 value = 1;
+
+	if (camera_service->epoll_wake == -1)
+		return false;
+
+	while (::write(camera_service->epoll_wake, &value, sizeof(AL::uint64)) == -1)
+	{
+		// the counter only fills up while a wake is already pending
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return true;
+
+		if (errno != EINTR)
+			return false;
+	}
+
+	return true;
+}
+// a job whose wake was lost is still collected within a tick, idle services keep blocking
+int       pi_camera_service_get_epoll_timeout_ms(pi_camera_service* camera_service, AL::uint64 time_ms)
+{
+	auto timeout_ms = pi_camera_service_get_transfer_timeout_ms(camera_service, time_ms);
+
+	if ((camera_service->job_count != 0) && ((timeout_ms == -1) || (timeout_ms > (1000 / PI_CAMERA_SERVICE_TICK_RATE))))
+		timeout_ms = 1000 / PI_CAMERA_SERVICE_TICK_RATE;
+
+	return timeout_ms;
+}
+// stop polling the listen socket while the service is full so a pending connection doesn't spin the reactor
+void      pi_camera_service_epoll_set_accepting(pi_camera_service* camera_service, bool value)
+{
+	if (camera_service->is_accepting != value)
+	{
+		pi_camera_service_epoll_modify(camera_service, static_cast<int>(camera_service->socket.GetHandle()), camera_service, value ? EPOLLIN : 0);
+
+		camera_service->is_accepting = value;
+	}
+}
+#endif
+
+void      pi_camera_service_job_main(void* param)
+{
+	auto camera_service_job = static_cast<pi_camera_service_job*>(param);
+
+	camera_service_job->session->connection.request_id = camera_service_job->packet_header.request_id;
+	camera_service_job->result = camera_service_job->packet_handler(camera_service_job->service, camera_service_job->session, camera_service_job->packet_header, &camera_service_job->packet_buffer[0], camera_service_job->packet_header.buffer_size);
+
+	{
+		AL::OS::MutexGuard lock(camera_service_job->service->jobs_completed_mutex);
+
+		camera_service_job->service->jobs_completed.PushBack(camera_service_job);
+	}
+
+#if defined(AL_PLATFORM_LINUX)
+	// a lost wake is collected on the next timeout of the service thread, which is bounded while jobs are pending
+	pi_camera_service_epoll_wake(camera_service_job->service);
+#endif
+}
+// @param packet_buffer copied so the session keeps its receive buffer
+void      pi_camera_service_post_job(pi_camera_service* camera_service, pi_camera_session* camera_session, pi_camera_service_packet_handler packet_handler, const pi_camera_packet_header& packet_header, const pi_camera_packet_buffer& packet_buffer)
+{
+	auto camera_service_job = new pi_camera_service_job
+	{
+		.service        = camera_service,
+		.session        = camera_session,
+		.packet_handler = packet_handler,
+		.packet_header  = packet_header,
+		.packet_buffer  = packet_buffer,
+		.result         = false
+	};
+
+	// the job owns the session socket until it completes
+	camera_session->is_job_pending = true;
+	++camera_service->job_count;
+
+#if defined(AL_PLATFORM_LINUX)
+	// hangups are reported even with an empty event mask so the socket leaves epoll until the job completes
+	pi_camera_service_epoll_remove(camera_service, static_cast<int>(camera_session->connection.socket.GetHandle()));
+#endif
+
+	pi_camera_worker_pool_post(&camera_service->worker_pool, &pi_camera_service_job_main, camera_service_job);
+}
+
+bool      pi_camera_service_accept_sessions(pi_camera_service* camera_service)
+{
+	pi_camera_session* camera_session;
+
+	while (camera_service->sessions.GetSize() < camera_service->max_connections)
+	{
+		if (!pi_camera_service_accept_session(camera_service, camera_session))
+			return false;
+
+		if (camera_session == nullptr)
+			break;
+
+#if defined(AL_PLATFORM_LINUX)
+		if (!pi_camera_service_epoll_add(camera_service, static_cast<int>(camera_session->connection.socket.GetHandle()), camera_session))
+		{
+			pi_camera_net_socket_close(camera_session->connection.socket);
+			pi_camera_close(camera_session);
+
+			continue;
+		}
+#endif
+
+		camera_service->sessions.PushBack(camera_session);
+	}
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_epoll_set_accepting(camera_service, camera_service->sessions.GetSize() < camera_service->max_connections);
+#endif
+
+	return true;
+}
+void      pi_camera_service_remove_session(pi_camera_service* camera_service, pi_camera_session* camera_session)
+{
+	for (auto it = camera_service->sessions.begin(); it != camera_service->sessions.end(); ++it)
+	{
+		if (*it == camera_session)
+		{
+			camera_service->sessions.Erase(it);
+
+			break;
+		}
+	}
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_epoll_remove(camera_service, static_cast<int>(camera_session->connection.socket.GetHandle()));
+
+	{
+		AL::OS::MutexGuard lock(camera_service->preview.mutex);
+
+		// the encoder thread must be done with the socket before it closes
+		if (camera_session->preview.is_streaming)
+			pi_camera_service_preview_session_detach(camera_service, camera_session);
+	}
+#endif
+
+	pi_camera_net_socket_close(camera_session->connection.socket);
+	pi_camera_close(camera_session);
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_epoll_set_accepting(camera_service, camera_service->sessions.GetSize() < camera_service->max_connections);
+#endif
+}
+void      pi_camera_service_update_jobs(pi_camera_service* camera_service)
+{
+	AL::OS::MutexGuard lock(camera_service->jobs_completed_mutex);
+
+	for (auto it = camera_service->jobs_completed.begin(); it != camera_service->jobs_completed.end(); )
+	{
+		auto camera_service_job = *it;
+		camera_service->jobs_completed.Erase(it++);
+		--camera_service->job_count;
+
+		if (!camera_service_job->result)
+		{
+			pi_camera_net_socket_close(camera_service_job->session->connection.socket);
+			pi_camera_service_remove_session(camera_service, camera_service_job->session);
+		}
+		else
+		{
+			camera_service_job->session->is_job_pending = false;
+
+#if defined(AL_PLATFORM_LINUX)
+			if (!pi_camera_service_epoll_add(camera_service, static_cast<int>(camera_service_job->session->connection.socket.GetHandle()), camera_service_job->session))
+				pi_camera_service_remove_session(camera_service, camera_service_job->session);
+#endif
+		}
+
+		delete camera_service_job;
+	}
+}
+bool      pi_camera_service_update(pi_camera_service* camera_service)
+{
+	pi_camera_service_update_jobs(camera_service);
+	pi_camera_service_expire_transfers(camera_service, pi_camera_get_time_ms());
+
+	if (!pi_camera_service_accept_sessions(camera_service))
+		return false;
+
+	for (auto it = camera_service->sessions.begin(); it != camera_service->sessions.end(); )
+	{
+		auto camera_session = *it++;
+
+		if (camera_session->is_job_pending)
+			continue;
+
+		if (!pi_camera_service_update_session(camera_service, camera_session))
+			pi_camera_service_remove_session(camera_service, camera_session);
+	}
+
+	return true;
+}
+#if defined(AL_PLATFORM_LINUX)
+// @return false on error
+bool      pi_camera_service_update_epoll(pi_camera_service* camera_service)
+{
+	epoll_event events[PI_CAMERA_SERVICE_EPOLL_EVENT_COUNT];
+	int         event_count;
+	auto        time_ms = pi_camera_get_time_ms();
+
+	// the worker that retains a transfer wakes epoll once its job completes, so the timeout covers it
+	pi_camera_service_expire_transfers(camera_service, time_ms);
+
+	if ((event_count = ::epoll_wait(camera_service->epoll, events, PI_CAMERA_SERVICE_EPOLL_EVENT_COUNT, pi_camera_service_get_epoll_timeout_ms(camera_service, time_ms))) == -1)
+		return errno == EINTR;
+
+	if ((event_count == 0) && (camera_service->job_count != 0))
+		pi_camera_service_update_jobs(camera_service);
+
+	for (int i = 0; i < event_count; ++i)
+	{
+		if (events[i].data.ptr == &camera_service->epoll_wake)
+		{
+			AL::uint64 value;
+
+			// EAGAIN means another wake was already read, the jobs are collected either way
+			if ((::read(camera_service->epoll_wake, &value, sizeof(AL::uint64)) == -1) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+				return false;
+
+			pi_camera_service_update_jobs(camera_service);
+		}
+		else if (events[i].data.ptr == camera_service)
+		{
+			if (!pi_camera_service_accept_sessions(camera_service))
+				return false;
+		}
+		else
+		{
+			auto camera_session = static_cast<pi_camera_session*>(events[i].data.ptr);
+
+			// the worker running the job owns the session, update_jobs removes it if the job fails
+			if (camera_session->is_job_pending)
+				continue;
+
+			if (!pi_camera_service_update_session(camera_service, camera_session))
+				pi_camera_service_remove_session(camera_service, camera_session);
+		}
+	}
+
+	return true;
+}
+#endif
+void      pi_camera_service_thread_main(pi_camera_service* camera_service)
+{
+#if defined(PI_CAMERA_ZERO_COPY)
+	pi_camera_thread_block_sigpipe();
+#endif
+
+#if defined(AL_PLATFORM_LINUX)
+	while (!camera_service->is_thread_stopping)
+	{
+		if (!pi_camera_service_update_epoll(camera_service))
+			break;
+	}
+#else
+	AL::Game::Loop::Run(PI_CAMERA_SERVICE_TICK_RATE, [camera_service](AL::TimeSpan delta)
+	{
+		if (camera_service->is_thread_stopping)
+			return AL::False;
+
+		if (!pi_camera_service_update(camera_service))
+			return AL::False;
+
+		return AL::True;
+	});
+#endif
+}
+bool      pi_camera_service_thread_start(pi_camera_service* camera_service)
+{
+	try
+	{
+		camera_service->thread.Start([camera_service]()
+		{
+			pi_camera_service_thread_main(camera_service);
+		});
+	}
+	catch (const AL::Exception& exception)
+	{
+
+		return false;
+	}
+
+	return true;
+}
+void      pi_camera_service_thread_stop(pi_camera_service* camera_service)
+{
+	camera_service->is_thread_stopping = true;
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_epoll_wake(camera_service);
+#endif
+
+	try
+	{
+		while (!camera_service->thread.Join())
+		{
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+	}
+
+	camera_service->is_thread_stopping = false;
+}
+AL::uint8 pi_camera_service_start(pi_camera_service* camera_service)
+{
+	if (!pi_camera_net_socket_listen(camera_service->socket, camera_service->local_end_point, camera_service->max_connections))
+		return PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED;
+
+#if defined(AL_PLATFORM_LINUX)
+	if (!pi_camera_service_epoll_open(camera_service))
+	{
+		pi_camera_net_socket_close(camera_service->socket);
+
+		return PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED;
+	}
+#endif
+
+	if (!pi_camera_worker_pool_start(&camera_service->worker_pool, camera_service->worker_count))
+	{
+#if defined(AL_PLATFORM_LINUX)
+		pi_camera_service_epoll_close(camera_service);
+#endif
+
+		pi_camera_net_socket_close(camera_service->socket);
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	if (!pi_camera_service_thread_start(camera_service))
+	{
+		pi_camera_worker_pool_stop(&camera_service->worker_pool);
+
+#if defined(AL_PLATFORM_LINUX)
+		pi_camera_service_epoll_close(camera_service);
+#endif
+
+		pi_camera_net_socket_close(camera_service->socket);
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+void      pi_camera_service_stop(pi_camera_service* camera_service)
+{
+	pi_camera_service_thread_stop(camera_service);
+	pi_camera_net_socket_close(camera_service->socket);
+
+#if defined(AL_PLATFORM_LINUX)
+	// wake jobs blocked on a session socket
+	for (auto camera_session : camera_service->sessions)
+		if (camera_session->is_job_pending)
+			::shutdown(static_cast<int>(camera_session->connection.socket.GetHandle()), SHUT_RDWR);
+#endif
+
+	// wake jobs waiting for a preview frame
+	pi_camera_service_preview_stop(camera_service);
+	pi_camera_worker_pool_stop(&camera_service->worker_pool);
+
+	{
+		AL::OS::MutexGuard lock(camera_service->jobs_completed_mutex);
+
+		for (auto it = camera_service->jobs_completed.begin(); it != camera_service->jobs_completed.end(); )
+		{
+			delete *it;
+			camera_service->jobs_completed.Erase(it++);
+		}
+	}
+
+	for (auto it = camera_service->sessions.begin(); it != camera_service->sessions.end(); )
+	{
+		pi_camera_net_socket_close((*it)->connection.socket);
+		pi_camera_close(*it);
+		camera_service->sessions.Erase(it++);
+	}
+
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_service_epoll_close(camera_service);
+#endif
+}
+
+inline auto pi_camera_clamp_ev(AL::int8 value)
+{
+	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_EV_MIN, PI_CAMERA_EV_MAX);
+}
+inline auto pi_camera_clamp_iso(AL::uint16 value)
+{
+	return AL::Math::Clamp<AL::uint16>(value, PI_CAMERA_ISO_MIN, PI_CAMERA_ISO_MAX);
+}
+inline auto pi_camera_clamp_contrast(AL::int8 value)
+{
+	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_CONTRAST_MIN, PI_CAMERA_CONTRAST_MIN);
+}
+inline auto pi_camera_clamp_sharpness(AL::int8 value)
+{
+	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_SHARPNESS_MIN, PI_CAMERA_SHARPNESS_MIN);
+}
+inline auto pi_camera_clamp_brightness(AL::uint8 value)
+{
+	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_BRIGHTNESS_MIN, PI_CAMERA_BRIGHTNESS_MIN);
+}
+inline auto pi_camera_clamp_saturation(AL::int8 value)
+{
+	return AL::Math::Clamp<AL::int8>(value, PI_CAMERA_SATURATION_MIN, PI_CAMERA_SATURATION_MIN);
+}
+inline auto pi_camera_clamp_shutter_speed(AL::uint64 value)
+{
+	return value;
+}
+inline auto pi_camera_clamp_jpg_quality(AL::uint8 value)
+{
+	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_JPG_QUALITY_MIN, PI_CAMERA_JPG_QUALITY_MAX);
+}
+inline auto pi_camera_clamp_image_size_width(AL::uint16 value)
+{
+	return AL::Math::Clamp<AL::uint16>(value, 0, PI_CAMERA_IMAGE_SIZE_WIDTH_MAX);
+}
+inline auto pi_camera_clamp_image_size_height(AL::uint16 value)
+{
+	return AL::Math::Clamp<AL::uint16>(value, 0, PI_CAMERA_IMAGE_SIZE_HEIGHT_MAX);
+}
+inline auto pi_camera_clamp_image_rotation(AL::uint16 value)
+{
+	return AL::Math::Clamp<AL::uint16>(value, PI_CAMERA_IMAGE_ROTATION_MIN, PI_CAMERA_IMAGE_ROTATION_MAX);
+}
+inline auto pi_camera_clamp_video_bit_rate(AL::uint32 value)
+{
+	return AL::Math::Clamp<AL::uint32>(value, 1, AL::Integer<AL::uint32>::Maximum);
+}
+inline auto pi_camera_clamp_video_frame_rate(AL::uint8 value)
+{
+	return AL::Math::Clamp<AL::uint8>(value, PI_CAMERA_VIDEO_FRAME_RATE_MIN, PI_CAMERA_VIDEO_FRAME_RATE_MAX);
+}
+
+// @return false if busy
+bool      pi_camera_cli_begin(pi_camera_local* camera_local, AL::String& cli_params, bool video)
+{
+	AL::OS::MutexGuard lock(camera_local->mutex);
+
+	if (camera_local->is_busy)
+		return false;
+
+	camera_local->is_busy = true;
+	cli_params            = video ? camera_local->cli_params_video : camera_local->cli_params;
+
+	return true;
+}
+void      pi_camera_cli_end(pi_camera_local* camera_local)
+{
+	AL::OS::MutexGuard lock(camera_local->mutex);
+
+	camera_local->is_busy = false;
+}
+
+#if defined(AL_PLATFORM_LINUX)
+// raspistill leaves partial frames behind when it is stopped mid capture
+void      pi_camera_cli_still_worker_remove_directory(const AL::String& directory)
+{
+	DIR* handle;
+
+	if ((handle = ::opendir(directory.GetCString())) != nullptr)
+	{
+		for (dirent* entry; (entry = ::readdir(handle)) != nullptr; )
+		{
+			if ((::strcmp(entry->d_name, ".") == 0) || (::strcmp(entry->d_name, "..") == 0))
+				continue;
+
+			::unlink(AL::String::Format("%s/%s", directory.GetCString(), entry->d_name).GetCString());
+		}
+
+		::closedir(handle);
+	}
+
+	::rmdir(directory.GetCString());
+}
+void      pi_camera_cli_still_worker_stop(pi_camera_local* camera_local)
+{
+	if (camera_local->still_worker.pid != -1)
+		pi_camera_process_close(camera_local->still_worker, true);
+
+	if (camera_local->still_worker_watch != -1)
+	{
+		::close(camera_local->still_worker_watch);
+		camera_local->still_worker_watch = -1;
+	}
+
+	if (camera_local->still_worker_directory.GetLength() != 0)
+	{
+		pi_camera_cli_still_worker_remove_directory(camera_local->still_worker_directory);
+		camera_local->still_worker_directory = AL::String();
+	}
+
+	camera_local->still_worker_cli_params = AL::String();
+	camera_local->still_worker_is_ready   = false;
+}
+bool      pi_camera_cli_still_worker_start(pi_camera_local* camera_local, const AL::String& cli_params)
+{
+	// frames land on tmpfs so the sd card only sees the final image
+	camera_local->still_worker_directory = AL::String::Format("/tmp/pi_camera_%i_%p", static_cast<int>(::getpid()), static_cast<void*>(camera_local));
+
+	if ((::mkdir(camera_local->still_worker_directory.GetCString(), 0700) == -1) && (errno != EEXIST))
+	{
+		camera_local->still_worker_directory = AL::String();
+
+		return false;
+	}
+
+	if (((camera_local->still_worker_watch = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) ||
+		(::inotify_add_watch(camera_local->still_worker_watch, camera_local->still_worker_directory.GetCString(), IN_MOVED_TO | IN_CLOSE_WRITE) == -1))
+	{
+		pi_camera_cli_still_worker_stop(camera_local);
+
+		return false;
+	}
+
+	// raspistill sigwaits on SIGUSR1, keeping it blocked means a trigger sent during camera init doesn't kill it
+	sigset_t signal_mask;
+	::sigemptyset(&signal_mask);
+	::sigaddset(&signal_mask, SIGUSR1);
+
+	if (!pi_camera_process_open(camera_local->still_worker, AL::String::Format("raspistill %s -n -s -t 0 -o \"%s/frame_%%04d.jpg\"", cli_params.GetCString(), camera_local->still_worker_directory.GetCString()).GetCString(), &signal_mask))
+	{
+		pi_camera_cli_still_worker_stop(camera_local);
+
+		return false;
+	}
+
+	camera_local->still_worker_cli_params = cli_params;
+
+	return true;
+}
+// @return false if the frame did not appear before the timeout
+bool      pi_camera_cli_still_worker_wait(pi_camera_local* camera_local, AL::String& frame_path)
+{
+	alignas(inotify_event) char buffer[4096];
+	AL::OS::Timer               timer;
+
+	for (AL::uint64 elapsed_ms; (elapsed_ms = timer.GetElapsed().ToMilliseconds()) < PI_CAMERA_STILL_WORKER_TIMEOUT_MS; )
+	{
+		pollfd watch_poll =
+		{
+			.fd      = camera_local->still_worker_watch,
+			.events  = POLLIN,
+			.revents = 0
+		};
+
+		if (::poll(&watch_poll, 1, static_cast<int>(PI_CAMERA_STILL_WORKER_TIMEOUT_MS - elapsed_ms)) <= 0)
+			continue;
+
+		auto number_of_bytes_read = ::read(camera_local->still_worker_watch, buffer, sizeof(buffer));
+
+		for (ssize_t i = 0; i < number_of_bytes_read; i += sizeof(inotify_event) + reinterpret_cast<const inotify_event*>(&buffer[i])->len)
+		{
+			auto event             = reinterpret_cast<const inotify_event*>(&buffer[i]);
+			auto event_name_length = (event->len == 0) ? 0 : ::strlen(event->name);
+
+			// raspistill writes to name~ and renames it once the jpeg is complete
+			if ((event_name_length == 0) || (event->name[event_name_length - 1] == '~'))
+				continue;
+
+			frame_path = AL::String::Format("%s/%s", camera_local->still_worker_directory.GetCString(), event->name);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+// raspistill sets SIGUSR1 to SIG_IGN first thing and only sigwaits once the camera is up, setting SIG_IGN discards a pending SIGUSR1 even while blocked
+// blocked signals are never discarded after that, so a trigger sent once /proc shows SIGUSR1 ignored stays pending until raspistill sigwaits
+// @return false if raspistill exited or didn't get that far before the timeout
+bool      pi_camera_cli_still_worker_wait_ready(pi_camera_local* camera_local)
+{
+	auto          status_path = AL::String::Format("/proc/%i/status", static_cast<int>(camera_local->still_worker.pid));
+	AL::OS::Timer timer;
+
+	while (timer.GetElapsed().ToMilliseconds() < PI_CAMERA_STILL_WORKER_TIMEOUT_MS)
+	{
+		char    buffer[4096];
+		int     status_handle;
+		ssize_t number_of_bytes_read;
+
+		if ((status_handle = ::open(status_path.GetCString(), O_RDONLY | O_CLOEXEC)) == -1)
+			return false;
+
+		number_of_bytes_read = ::read(status_handle, buffer, sizeof(buffer) - 1);
+		::close(status_handle);
+
+		if (number_of_bytes_read > 0)
+		{
+			buffer[number_of_bytes_read] = '\0';
+
+			// a zombie has nothing left to wait for
+			if (::strstr(buffer, "State:\tZ") != nullptr)
+				return false;
+
+			if (auto signals_ignored = ::strstr(buffer, "SigIgn:"))
+				if (::strtoull(signals_ignored + 7, nullptr, 16) & (1ULL << (SIGUSR1 - 1)))
+					return true;
+		}
+
+		AL::OS::Sleep(AL::TimeSpan::FromMilliseconds(PI_CAMERA_STILL_WORKER_READY_POLL_MS));
+	}
+
+	return false;
+}
+// @return false if the trigger could not be sent
+bool      pi_camera_cli_still_worker_signal(pi_camera_local* camera_local)
+{
+	if (!camera_local->still_worker_is_ready && !(camera_local->still_worker_is_ready = pi_camera_cli_still_worker_wait_ready(camera_local)))
+		return false;
+
+	return ::kill(camera_local->still_worker.pid, SIGUSR1) != -1;
+}
+// starts the still worker unless it is already running with cli_params
+bool      pi_camera_cli_still_worker_open(pi_camera_local* camera_local, const AL::String& cli_params)
+{
+	if ((camera_local->still_worker.pid != -1) && (camera_local->still_worker_cli_params != cli_params))
+		pi_camera_cli_still_worker_stop(camera_local);
+
+	return (camera_local->still_worker.pid != -1) || pi_camera_cli_still_worker_start(camera_local, cli_params);
+}
+// @return false if the frame could not be moved to file_path, it is deleted either way
+bool      pi_camera_cli_still_worker_move_frame(const AL::String& frame_path, const char* file_path)
+{
+	if (::rename(frame_path.GetCString(), file_path) == -1)
+	{
+		// tmpfs and the destination are usually different file systems
+		pi_camera_file* source;
+		pi_camera_file* destination;
+		AL::uint64      file_size;
+		bool            is_copied = false;
+
+		if (pi_camera_file_get_size(frame_path.GetCString(), file_size) && ((source = pi_camera_file_open(frame_path.GetCString(), true, false)) != nullptr))
+		{
+			if ((destination = pi_camera_file_open(file_path, false, true)) != nullptr)
+			{
+				// an empty frame copies to an empty file, the same as a rename
+				if (file_size == 0)
+					is_copied = true;
+				else
+				{
+					pi_camera_packet_buffer buffer(file_size);
+
+					is_copied = pi_camera_file_read(source, &buffer[0], file_size) && pi_camera_file_append(destination, &buffer[0], file_size);
+				}
+
+				pi_camera_file_close(destination);
+			}
+
+			pi_camera_file_close(source);
+		}
+
+		pi_camera_file_delete(frame_path.GetCString());
+
+		return is_copied;
+	}
+
+	return true;
+}
+// @param frame_path set to the new frame, the caller deletes it
+// @return false if the worker could not deliver a frame, it is stopped so the caller can fall back to a one shot raspistill
+bool      pi_camera_cli_still_worker_trigger(pi_camera_local* camera_local, const AL::String& cli_params, AL::String& frame_path)
+{
+	if (!pi_camera_cli_still_worker_open(camera_local, cli_params))
+		return false;
+
+	if (!pi_camera_cli_still_worker_signal(camera_local) || !pi_camera_cli_still_worker_wait(camera_local, frame_path))
+	{
+		pi_camera_cli_still_worker_stop(camera_local);
+
+		return false;
+	}
+
+	return true;
+}
+// Reads a frame into a caller supplied buffer or one allocated for it, the frame is deleted either way
+AL::uint8 pi_camera_cli_still_worker_read_frame(const AL::String& frame_path, AL::uint8** buffer, AL::uint64* size, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	AL::uint8       error_code   = PI_CAMERA_ERROR_CODE_SUCCESS;
+	AL::uint64      file_size    = 0;
+	pi_camera_file* file;
+	bool            is_allocated = *buffer == nullptr;
+
+	if (!pi_camera_file_get_size(frame_path.GetCString(), file_size))
+		error_code = PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR;
+	// raspistill leaves an empty file behind when the capture failed
+	else if (file_size == 0)
+		error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	else if (is_allocated ? (file_size > PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX) : (*size < file_size))
+		error_code = PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL;
+	else if (is_allocated && ((*buffer = new (std::nothrow) AL::uint8[file_size]) == nullptr))
+		error_code = PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY;
+	else if ((file = pi_camera_file_open(frame_path.GetCString(), true, false)) == nullptr)
+		error_code = PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+	else
+	{
+		if (!pi_camera_file_read(file, *buffer, file_size))
+			error_code = PI_CAMERA_ERROR_CODE_FILE_READ_ERROR;
+
+		pi_camera_file_close(file);
+	}
+
+	pi_camera_file_delete(frame_path.GetCString());
+
+	if ((error_code != PI_CAMERA_ERROR_CODE_SUCCESS) && is_allocated)
+	{
+		delete[] *buffer;
+		*buffer = nullptr;
+	}
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) || (error_code == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL))
+		*size = file_size;
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (on_progress_changed != nullptr))
+		on_progress_changed(file_size, file_size, param);
+
+	return error_code;
+}
+#endif
+
+// @param camera_local must be held with pi_camera_cli_begin
+AL::uint8 pi_camera_cli_execute_still(pi_camera_local* camera_local, const AL::String& cli_params, const char* file_path)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String frame_path;
+
+	// a frame that can't be moved is a destination error, only a worker that failed and was stopped falls back to a one shot raspistill
+	if (pi_camera_cli_still_worker_trigger(camera_local, cli_params, frame_path))
+		return pi_camera_cli_still_worker_move_frame(frame_path, file_path) ? PI_CAMERA_ERROR_CODE_SUCCESS : PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+#endif
+
+	try
+	{
+		AL::OS::Shell::Execute(
+			"raspistill",
+			AL::String::Format("%s -o \"%s\"", cli_params.GetCString(), file_path)
+		);
+	}
+	catch (const AL::Exception& exception)
+	{
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+AL::uint8 pi_camera_cli_execute(pi_camera_local* camera_local, const char* file_path)
+{
+	AL::String cli_params;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params, false))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	AL::uint8 error_code = pi_camera_cli_execute_still(camera_local, cli_params, file_path);
+
+	pi_camera_cli_end(camera_local);
+
+	return error_code;
+}
+// Triggers the still worker every interval_ms, each frame is handed to on_frame while the next one is captured
+// @param on_frame anything but PI_CAMERA_ERROR_CODE_SUCCESS stops the burst, the frame is deleted once it returns
+AL::uint8 pi_camera_cli_execute_burst(pi_camera_local* camera_local, AL::uint32 count, AL::uint32 interval_ms, pi_camera_cli_on_burst_frame on_frame, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String cli_params;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params, false))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	if (!pi_camera_cli_still_worker_open(camera_local, cli_params))
+	{
+		pi_camera_cli_end(camera_local);
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	AL::uint8     error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	AL::OS::Timer timer;
+	AL::String    frame_path;
+
+	for (AL::uint32 i = 0; i < count; ++i)
+	{
+		auto trigger_ms = static_cast<AL::uint64>(i) * interval_ms;
+		auto elapsed_ms = timer.GetElapsed().ToMilliseconds();
+
+		if (elapsed_ms < trigger_ms)
+			AL::OS::Sleep(AL::TimeSpan::FromMilliseconds(trigger_ms - elapsed_ms));
+
+		if (!pi_camera_cli_still_worker_signal(camera_local))
+		{
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+			break;
+		}
+
+		// a cold worker takes a while to accept the first trigger, the rest are paced from it
+		if (i == 0)
+			timer.Reset();
+
+		if (i != 0)
+		{
+			error_code = on_frame(i - 1, frame_path.GetCString(), param);
+			pi_camera_file_delete(frame_path.GetCString());
+
+			if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+				break;
+		}
+
+		if (!pi_camera_cli_still_worker_wait(camera_local, frame_path))
+		{
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+			break;
+		}
+	}
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (count != 0))
+	{
+		error_code = on_frame(count - 1, frame_path.GetCString(), param);
+		pi_camera_file_delete(frame_path.GetCString());
+	}
+
+	// a frame triggered before the burst stopped would be mistaken for the next capture's
+	if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		pi_camera_cli_still_worker_stop(camera_local);
+
+	pi_camera_cli_end(camera_local);
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+#if defined(AL_PLATFORM_LINUX)
+struct pi_camera_cli_capture_burst_context
+{
+	const char*                                 directory;
+	pi_camera_capture_burst_on_progress_changed on_progress_changed;
+	void*                                       param;
+};
+
+AL::uint8 pi_camera_cli_capture_burst_on_frame(AL::uint32 frame_index, const char* frame_path, void* param)
+{
+	auto       context = reinterpret_cast<pi_camera_cli_capture_burst_context*>(param);
+	AL::uint64 file_size;
+
+	if (!pi_camera_file_get_size(frame_path, file_size))
+		return PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR;
+
+	if (!pi_camera_cli_still_worker_move_frame(frame_path, pi_camera_capture_burst_get_file_path(context->directory, frame_index).GetCString()))
+		return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+	if (context->on_progress_changed != nullptr)
+		context->on_progress_changed(frame_index, file_size, file_size, context->param);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+#endif
+// @param on_progress_changed can be nullptr
+AL::uint8 pi_camera_cli_capture_burst(pi_camera_local* camera_local, const char* directory, AL::uint32 count, AL::uint32 interval_ms, pi_camera_capture_burst_on_progress_changed on_progress_changed, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	pi_camera_cli_capture_burst_context context =
+	{
+		.directory           = directory,
+		.on_progress_changed = on_progress_changed,
+		.param               = param
+	};
+
+	return pi_camera_cli_execute_burst(camera_local, count, interval_ms, &pi_camera_cli_capture_burst_on_frame, &context);
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// @param on_output called with each piece of the image as raspistill writes it, anything but PI_CAMERA_ERROR_CODE_SUCCESS stops the capture
+AL::uint8 pi_camera_cli_execute_stream(pi_camera_local* camera_local, pi_camera_cli_on_output on_output, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String cli_params;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params, false))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	// the still worker holds the camera open
+	pi_camera_cli_still_worker_stop(camera_local);
+
+	pi_camera_process process;
+
+	if (!pi_camera_process_open(process, AL::String::Format("raspistill %s -o -", cli_params.GetCString()).GetCString()))
+	{
+		pi_camera_cli_end(camera_local);
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_packet_buffer buffer(PI_CAMERA_STREAM_CHUNK_SIZE);
+	AL::size_t              number_of_bytes_read;
+	int                     read_result;
+
+	// forward whatever is in the pipe instead of waiting for a full chunk to keep time to first byte low
+	while ((read_result = pi_camera_process_read(process, &buffer[0], buffer.GetSize(), number_of_bytes_read)) == 1)
+	{
+		if ((error_code = on_output(&buffer[0], number_of_bytes_read, param)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+			break;
+	}
+
+	// 0 is a failed read, -1 the end of the image
+	if ((read_result == 0) && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+		error_code = PI_CAMERA_ERROR_CODE_FILE_READ_ERROR;
+
+	if ((pi_camera_process_close(process, read_result != -1) != 0) && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+		error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+	pi_camera_cli_end(camera_local);
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// splits raspivid's mjpeg output into frames on the jpg end of image marker
+// @param on_frame called with each frame, return false to stop the preview
+AL::uint8 pi_camera_cli_execute_preview(pi_camera_local* camera_local, pi_camera_preview_on_frame on_frame, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String cli_params_video;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params_video, true))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	// the still worker holds the camera open
+	pi_camera_cli_still_worker_stop(camera_local);
+
+	pi_camera_process process;
+
+	if (!pi_camera_process_open(process, AL::String::Format("raspivid %s -t 0 -cd MJPEG -w %u -h %u -o -", cli_params_video.GetCString(), PI_CAMERA_PREVIEW_WIDTH, PI_CAMERA_PREVIEW_HEIGHT).GetCString()))
+	{
+		pi_camera_cli_end(camera_local);
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_packet_buffer buffer(PI_CAMERA_PREVIEW_FRAME_SIZE_MAX);
+	AL::size_t              buffer_size = 0;
+	AL::size_t              number_of_bytes_read;
+	bool                    is_stopped = false;
+
+	while (!is_stopped && (pi_camera_process_read(process, &buffer[buffer_size], buffer.GetSize() - buffer_size, number_of_bytes_read) == 1))
+	{
+		// the previous read may have ended between 0xFF and 0xD9
+		AL::size_t i           = (buffer_size != 0) ? (buffer_size - 1) : 0;
+		AL::size_t frame_start = 0;
+
+		buffer_size += number_of_bytes_read;
+
+		for (; (i + 1) < buffer_size; ++i)
+		{
+			if ((buffer[i] != 0xFF) || (buffer[i + 1] != 0xD9))
+				continue;
+
+			if (!on_frame(&buffer[frame_start], static_cast<AL::uint32>(i + 2 - frame_start), param))
+			{
+				is_stopped = true;
+
+				break;
+			}
+
+			frame_start = i + 2;
+			++i;
+		}
+
+		if (frame_start != 0)
+		{
+			if ((buffer_size -= frame_start) != 0)
+				::memmove(&buffer[0], &buffer[frame_start], buffer_size);
+		}
+		else if (buffer_size == buffer.GetSize())
+		{
+			// no end of image within PI_CAMERA_PREVIEW_FRAME_SIZE_MAX bytes
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+			break;
+		}
+	}
+
+	// raspivid runs until killed so only a stop requested by on_frame counts as success
+	pi_camera_process_close(process, true);
+
+	if (!is_stopped && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+		error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+	pi_camera_cli_end(camera_local);
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+struct pi_camera_capture_to_buffer_context
+{
+	AL::uint8*                            buffer;
+	AL::uint64                            buffer_size;
+	AL::uint64                            buffer_capacity;
+	bool                                  is_allocated;
+	pi_camera_capture_on_progress_changed on_progress_changed;
+	void*                                 param;
+};
+
+AL::uint8 pi_camera_capture_to_buffer_on_output(const void* buffer, AL::size_t size, void* param)
+{
+	auto context = reinterpret_cast<pi_camera_capture_to_buffer_context*>(param);
+
+	if ((context->buffer_size + size) > context->buffer_capacity)
+	{
+		// past PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX the caller learns the size the same as with a buffer that's too small
+		if (context->is_allocated && ((context->buffer_size + size) <= PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX))
+		{
+			auto buffer_capacity = AL::Math::Clamp<AL::uint64>(context->buffer_capacity * 2, PI_CAMERA_FILE_CHUNK_SIZE, PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX);
+
+			while (buffer_capacity < (context->buffer_size + size))
+				buffer_capacity = AL::Math::Lowest<AL::uint64>(buffer_capacity * 2, PI_CAMERA_CAPTURE_TO_BUFFER_SIZE_MAX);
+
+			auto buffer_new = new (std::nothrow) AL::uint8[buffer_capacity];
+
+			if (buffer_new == nullptr)
+				return PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY;
+
+			if (context->buffer_size != 0)
+				::memcpy(buffer_new, context->buffer, context->buffer_size);
+
+			delete[] context->buffer;
+
+			context->buffer          = buffer_new;
+			context->buffer_capacity = buffer_capacity;
+		}
+		else
+		{
+			// keep reading so the caller learns how large the buffer has to be
+			context->buffer_size += size;
+
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
+	}
+
+	::memcpy(&context->buffer[context->buffer_size], buffer, size);
+	context->buffer_size += size;
+
+	if (context->on_progress_changed != nullptr)
+		context->on_progress_changed(0, context->buffer_size, context->param);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+// reads a still worker frame or raspistill's stdout straight into memory
+AL::uint8 pi_camera_cli_execute_to_buffer(pi_camera_local* camera_local, AL::uint8** buffer, AL::uint64* size, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String cli_params;
+	AL::String frame_path;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params, false))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	// the still worker keeps the camera open between captures, streaming from a one shot raspistill is the fallback
+	if (pi_camera_cli_still_worker_trigger(camera_local, cli_params, frame_path))
+	{
+		// read before the camera is released, restarting the worker removes its frames
+		AL::uint8 error_code = pi_camera_cli_still_worker_read_frame(frame_path, buffer, size, on_progress_changed, param);
+
+		pi_camera_cli_end(camera_local);
+
+		return error_code;
+	}
+
+	pi_camera_cli_end(camera_local);
+#endif
+
+	pi_camera_capture_to_buffer_context context =
+	{
+		.buffer              = *buffer,
+		.buffer_size         = 0,
+		.buffer_capacity     = (*buffer == nullptr) ? 0 : *size,
+		.is_allocated        = *buffer == nullptr,
+		.on_progress_changed = on_progress_changed,
+		.param               = param
+	};
+
+	AL::uint8 error_code = pi_camera_cli_execute_stream(camera_local, &pi_camera_capture_to_buffer_on_output, &context);
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (context.buffer_size > context.buffer_capacity))
+		error_code = PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL;
+
+	if (context.is_allocated)
+	{
+		if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		{
+			delete[] context.buffer;
+			context.buffer = nullptr;
+		}
+
+		*buffer = context.buffer;
+	}
+
+	if ((error_code == PI_CAMERA_ERROR_CODE_SUCCESS) || (error_code == PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL))
+		*size = context.buffer_size;
+
+	return error_code;
+}
+template<typename T>
+void      pi_camera_cli_build_params_append(AL::StringBuilder& sb, const char* key, T value)
+{
+	if (sb.GetLength() != 0)
+		sb.Append(' ');
+
+	sb << key << ' ' << value;
+}
+void      pi_camera_cli_build_params_append_ev(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-ev", camera_config.ev);
+}
+void      pi_camera_cli_build_params_append_iso(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-ISO", camera_config.iso);
+}
+void      pi_camera_cli_build_params_append_contrast(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-co", camera_config.contrast);
+}
+void      pi_camera_cli_build_params_append_sharpness(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-sh", camera_config.sharpness);
+}
+void      pi_camera_cli_build_params_append_brightness(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-br", camera_config.brightness);
+}
+void      pi_camera_cli_build_params_append_saturation(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-sa", camera_config.saturation);
+}
+void      pi_camera_cli_build_params_append_white_balance(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	switch (camera_config.white_balance)
+	{
+		case PI_CAMERA_WHITE_BALANCE_OFF:
+			pi_camera_cli_build_params_append(sb, "-awb", "off");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_AUTO:
+			pi_camera_cli_build_params_append(sb, "-awb", "auto");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_SUN:
+			pi_camera_cli_build_params_append(sb, "-awb", "sun");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_FLASH:
+			pi_camera_cli_build_params_append(sb, "-awb", "flash");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_SHADE:
+			pi_camera_cli_build_params_append(sb, "-awb", "cloudshade");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_CLOUDS:
+			pi_camera_cli_build_params_append(sb, "-awb", "cloudshade");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_HORIZON:
+			pi_camera_cli_build_params_append(sb, "-awb", "horizon");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_TUNGSTEN:
+			pi_camera_cli_build_params_append(sb, "-awb", "tungsten");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_FLUORESCENT:
+			pi_camera_cli_build_params_append(sb, "-awb", "fluorescent");
+			break;
+
+		case PI_CAMERA_WHITE_BALANCE_INCANDESCENT:
+			pi_camera_cli_build_params_append(sb, "-awb", "incandescent");
+			break;
+	}
+}
+void      pi_camera_cli_build_params_append_shutter_speed(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	if (camera_config.shutter_speed_us != 0)
+		pi_camera_cli_build_params_append(sb, "-ss", camera_config.shutter_speed_us);
+}
+void      pi_camera_cli_build_params_append_exposure_mode(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	switch (camera_config.exposure_mode)
+	{
+		case PI_CAMERA_EXPOSURE_MODE_OFF:
+			pi_camera_cli_build_params_append(sb, "-ex", "off");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_AUTO:
+			pi_camera_cli_build_params_append(sb, "-ex", "auto");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_SNOW:
+			pi_camera_cli_build_params_append(sb, "-ex", "snow");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_BEACH:
+			pi_camera_cli_build_params_append(sb, "-ex", "beach");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_NIGHT:
+			pi_camera_cli_build_params_append(sb, "-ex", "night");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_SPORTS:
+			pi_camera_cli_build_params_append(sb, "-ex", "sports");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_BACKLIGHT:
+			pi_camera_cli_build_params_append(sb, "-ex", "backlight");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_SPOTLIGHT:
+			pi_camera_cli_build_params_append(sb, "-ex", "spotlight");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_VERY_LONG:
+			pi_camera_cli_build_params_append(sb, "-ex", "verylong");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_FIXED_FPS:
+			pi_camera_cli_build_params_append(sb, "-ex", "fixedfps");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_FIREWORKS:
+			pi_camera_cli_build_params_append(sb, "-ex", "fireworks");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_ANTI_SHAKE:
+			pi_camera_cli_build_params_append(sb, "-ex", "antishake");
+			break;
+
+		case PI_CAMERA_EXPOSURE_MODE_NIGHT_PREVIEW:
+			pi_camera_cli_build_params_append(sb, "-ex", "nightpreview");
+			break;
+	}
+}
+void      pi_camera_cli_build_params_append_metoring_mode(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	switch (camera_config.metoring_mode)
+	{
+		case PI_CAMERA_METORING_MODE_SPOT:
+			pi_camera_cli_build_params_append(sb, "-mm", "spot");
+			break;
+
+		case PI_CAMERA_METORING_MODE_MATRIX:
+			pi_camera_cli_build_params_append(sb, "-mm", "matrix");
+			break;
+
+		case PI_CAMERA_METORING_MODE_AVERAGE:
+			pi_camera_cli_build_params_append(sb, "-mm", "average");
+			break;
+
+		case PI_CAMERA_METORING_MODE_BACKLIT:
+			pi_camera_cli_build_params_append(sb, "-mm", "backlit");
+			break;
+	}
+}
+void      pi_camera_cli_build_params_append_jpg_quality(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-q", camera_config.jpg_quality);
+}
+void      pi_camera_cli_build_params_append_image_size(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-w", camera_config.image_size_width);
+	pi_camera_cli_build_params_append(sb, "-h", camera_config.image_size_height);
+}
+void      pi_camera_cli_build_params_append_image_effect(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	switch (camera_config.image_effect)
+	{
+		case PI_CAMERA_IMAGE_EFFECT_NONE:
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_NEGATIVE:
+			pi_camera_cli_build_params_append(sb, "-ifx", "negative");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_SOLARISE:
+			pi_camera_cli_build_params_append(sb, "-ifx", "solarise");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_WHITEBOARD:
+			pi_camera_cli_build_params_append(sb, "-ifx", "whiteboard");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_BLACKBOARD:
+			pi_camera_cli_build_params_append(sb, "-ifx", "blackboard");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_SKETCH:
+			pi_camera_cli_build_params_append(sb, "-ifx", "sketch");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_DENOISE:
+			pi_camera_cli_build_params_append(sb, "-ifx", "denoise");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_EMBOSS:
+			pi_camera_cli_build_params_append(sb, "-ifx", "emboss");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_OIL_PAINT:
+			pi_camera_cli_build_params_append(sb, "-ifx", "oilpaint");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_GRAPHITE_SKETCH:
+			pi_camera_cli_build_params_append(sb, "-ifx", "gpen");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_CROSS_HATCH_SKETCH:
+			pi_camera_cli_build_params_append(sb, "-ifx", "hatch");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_PASTEL:
+			pi_camera_cli_build_params_append(sb, "-ifx", "pastel");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_WATERCOLOR:
+			pi_camera_cli_build_params_append(sb, "-ifx", "watercolour");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_FILM:
+			pi_camera_cli_build_params_append(sb, "-ifx", "film");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_BLUR:
+			pi_camera_cli_build_params_append(sb, "-ifx", "blur");
+			break;
+
+		case PI_CAMERA_IMAGE_EFFECT_SATURATE:
+			pi_camera_cli_build_params_append(sb, "-ifx", "saturation");
+			break;
+	}
+}
+void      pi_camera_cli_build_params_append_image_rotation(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-rot", camera_config.image_rotation);
+}
+void      pi_camera_cli_build_params(pi_camera_local* camera_local)
+{
+	// https://www.raspberrypi.org/app/uploads/2013/07/RaspiCam-Documentation.pdf
+	// https://github.com/raspberrypi/userland/blob/master/host_applications/linux/apps/raspicam/RaspiStill.c
+
+	AL::StringBuilder sb;
+
+	pi_camera_cli_build_params_append_ev(sb, camera_local->config);
+	pi_camera_cli_build_params_append_iso(sb, camera_local->config);
+	pi_camera_cli_build_params_append_contrast(sb, camera_local->config);
+	pi_camera_cli_build_params_append_sharpness(sb, camera_local->config);
+	pi_camera_cli_build_params_append_brightness(sb, camera_local->config);
+	pi_camera_cli_build_params_append_saturation(sb, camera_local->config);
+	pi_camera_cli_build_params_append_white_balance(sb, camera_local->config);
+	pi_camera_cli_build_params_append_shutter_speed(sb, camera_local->config);
+	pi_camera_cli_build_params_append_exposure_mode(sb, camera_local->config);
+	pi_camera_cli_build_params_append_metoring_mode(sb, camera_local->config);
+	pi_camera_cli_build_params_append_jpg_quality(sb, camera_local->config);
+	pi_camera_cli_build_params_append_image_size(sb, camera_local->config);
+	pi_camera_cli_build_params_append_image_effect(sb, camera_local->config);
+	pi_camera_cli_build_params_append_image_rotation(sb, camera_local->config);
+
+	camera_local->cli_params = sb.ToString();
+}
+
+#if defined(AL_PLATFORM_LINUX)
+AL::uint8 pi_camera_cli_video_execute_mp4(pi_camera_local* camera_local, const char* file_path, AL::uint32 video_length_seconds);
+#endif
+
+AL::uint8 pi_camera_cli_video_execute(pi_camera_local* camera_local, const char* file_path, AL::uint32 video_length_seconds)
+{
+#if defined(AL_PLATFORM_LINUX)
+	return pi_camera_cli_video_execute_mp4(camera_local, file_path, video_length_seconds);
+#else
+	AL::String cli_params_video;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params_video, true))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	try
+	{
+		AL::OS::Shell::Execute(
+			"raspivid",
+			AL::String::Format("%s -t %s -o \"%s.h264\"", cli_params_video.GetCString(), AL::ToString(video_length_seconds * 1000).GetCString(), file_path)
+		);
+
+		AL::OS::Shell::Execute(
+			"MP4Box",
+			AL::String::Format("-add \"%s.h264\" \"%s\"", file_path, file_path)
+		);
+
+		AL::FileSystem::File::Delete(
+			AL::String::Format("%s.h264", file_path)
+		);
+	}
+	catch (const AL::Exception& exception)
+	{
+		pi_camera_cli_end(camera_local);
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	pi_camera_cli_end(camera_local);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#endif
+}
+// @param nal_unit begins with an annex b start code
+// @return 4 for 00 00 00 01, 3 for 00 00 01
+AL::uint32 pi_camera_video_get_start_code_size(const AL::uint8* nal_unit, AL::uint32 size)
+{
+	return ((size > 3) && (nal_unit[2] == 0x00)) ? 4 : 3;
+}
+// splits raspivid's annex b output into nal units as they are encoded
+// @param video_length_seconds 0 to record until on_nal_unit returns false
+// @param intra_period frames between key frames, 0 for raspivid's default
+// @param on_nal_unit called with each nal unit, return false to stop the recording
+AL::uint8 pi_camera_cli_video_execute_stream(pi_camera_local* camera_local, AL::uint32 video_length_seconds, AL::uint32 intra_period, pi_camera_video_on_nal_unit on_nal_unit, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::String cli_params_video;
+
+	if (!pi_camera_cli_begin(camera_local, cli_params_video, true))
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	// the still worker holds the camera open
+	pi_camera_cli_still_worker_stop(camera_local);
+
+	if (intra_period != 0)
+		cli_params_video = AL::String::Format("%s -g %u", cli_params_video.GetCString(), intra_period);
+
+	pi_camera_process process;
+
+	// -ih repeats sps/pps before each key frame, -fl flushes each nal unit instead of waiting for a full buffer
+	if (!pi_camera_process_open(process, AL::String::Format("raspivid %s -t %u -ih -fl -o -", cli_params_video.GetCString(), video_length_seconds * 1000).GetCString()))
+	{
+		pi_camera_cli_end(camera_local);
+
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+	}
+
+	AL::uint8               error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	pi_camera_packet_buffer buffer(PI_CAMERA_VIDEO_NAL_UNIT_SIZE_MAX);
+	AL::size_t              buffer_size = 0;
+	AL::size_t              number_of_bytes_read;
+	int                     read_result;
+	bool                    is_stopped = false;
+
+	// a nal unit is complete once the start code of the next one arrives
+	// emulation prevention keeps 00 00 01 out of nal unit payloads, a zero byte in front of it makes the 4 byte form
+	while (!is_stopped && ((read_result = pi_camera_process_read(process, &buffer[buffer_size], buffer.GetSize() - buffer_size, number_of_bytes_read)) == 1))
+	{
+		// the previous read may have ended inside a start code
+		AL::size_t i              = (buffer_size > 2) ? (buffer_size - 2) : 0;
+		AL::size_t nal_unit_start = 0;
+
+		buffer_size += number_of_bytes_read;
+
+		for (; (i + 2) < buffer_size; ++i)
+		{
+			if ((buffer[i] != 0x00) || (buffer[i + 1] != 0x00) || (buffer[i + 2] != 0x01))
+				continue;
+
+			AL::size_t start_code = ((i > nal_unit_start) && (buffer[i - 1] == 0x00)) ? (i - 1) : i;
+
+			// the start code of the nal unit at nal_unit_start
+			if (start_code == nal_unit_start)
+			{
+				i += 2;
+
+				continue;
+			}
+
+			if (!on_nal_unit(&buffer[nal_unit_start], static_cast<AL::uint32>(start_code - nal_unit_start), param))
+			{
+				is_stopped = true;
+
+				break;
+			}
+
+			nal_unit_start = start_code;
+			i += 2;
+		}
+
+		if (nal_unit_start != 0)
+		{
+			buffer_size -= nal_unit_start;
+			::memmove(&buffer[0], &buffer[nal_unit_start], buffer_size);
+		}
+		else if (buffer_size == buffer.GetSize())
+		{
+			// no start code within PI_CAMERA_VIDEO_NAL_UNIT_SIZE_MAX bytes
+			error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+			break;
+		}
+	}
+
+	// the last nal unit ends with the output
+	if (!is_stopped && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (read_result == -1) && (buffer_size != 0))
+		on_nal_unit(&buffer[0], static_cast<AL::uint32>(buffer_size), param);
+
+	if ((pi_camera_process_close(process, read_result == 1) != 0) && !is_stopped && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+		error_code = PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+	pi_camera_cli_end(camera_local);
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+#if defined(AL_PLATFORM_LINUX)
+typedef AL::Collections::LinkedList<AL::uint32> pi_camera_mp4_sample_list;
+
+struct pi_camera_mp4_buffer
+{
+	AL::uint8* buffer   = nullptr;
+	AL::size_t size     = 0;
+	AL::size_t capacity = 0;
+};
+
+struct pi_camera_mp4_writer
+{
+	const char*               file_path;
+	int                       file       = -1;
+	AL::uint8                 error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+	// offset of the first sample, mdat's size is patched in once recording ends
+	AL::uint64                mdat_offset = 0;
+	AL::uint64                mdat_size   = 0;
+
+	AL::uint32                sample_size      = 0;
+	bool                      sample_has_slice = false;
+	bool                      sample_is_sync   = false;
+	pi_camera_mp4_sample_list sample_sizes;
+	// 1 based numbers of the samples holding an idr slice
+	pi_camera_mp4_sample_list sync_samples;
+
+	pi_camera_packet_buffer   sps;
+	pi_camera_packet_buffer   pps;
+
+	// fragmented writers keep the samples of the next fragment in memory and describe them with a moof instead of moov
+	bool                      is_fragmented   = false;
+	pi_camera_mp4_buffer      fragment;
+	AL::uint32                sequence_number = 0;
+	// media time of the next fragment
+	AL::uint64                decode_time     = 0;
+};
+
+struct pi_camera_h264_bit_reader
+{
+	pi_camera_packet_buffer buffer;
+	AL::size_t              size     = 0;
+	AL::size_t              position = 0;
+};
+
+struct pi_camera_h264_sps
+{
+	AL::uint16 width                   = 0;
+	AL::uint16 height                  = 0;
+	// only coded by the high profiles, 4:2:0 8 bit otherwise
+	AL::uint8  chroma_format_idc       = 1;
+	AL::uint8  bit_depth_luma_minus8   = 0;
+	AL::uint8  bit_depth_chroma_minus8 = 0;
+};
+
+void       pi_camera_mp4_buffer_write(pi_camera_mp4_buffer& buffer, const void* value, AL::size_t size)
+{
+	if ((buffer.size + size) > buffer.capacity)
+	{
+		auto capacity = AL::Math::Clamp<AL::size_t>(buffer.capacity * 2, 4096, AL::Integer<AL::size_t>::Maximum);
+
+		while (capacity < (buffer.size + size))
+			capacity *= 2;
+
+		auto buffer_new = new AL::uint8[capacity];
+
+		if (buffer.size != 0)
+			::memcpy(buffer_new, buffer.buffer, buffer.size);
+
+		delete[] buffer.buffer;
+
+		buffer.buffer   = buffer_new;
+		buffer.capacity = capacity;
+	}
+
+	if (size != 0)
+		::memcpy(&buffer.buffer[buffer.size], value, size);
+
+	buffer.size += size;
+}
+template<typename T>
+void       pi_camera_mp4_buffer_write_integer(pi_camera_mp4_buffer& buffer, T value)
+{
+	value = AL::BitConverter::HostToNetwork(value);
+
+	pi_camera_mp4_buffer_write(buffer, &value, sizeof(T));
+}
+void       pi_camera_mp4_buffer_write_zeros(pi_camera_mp4_buffer& buffer, AL::size_t size)
+{
+	for (AL::size_t i = 0; i < size; ++i)
+		pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0);
+}
+void       pi_camera_mp4_buffer_write_matrix(pi_camera_mp4_buffer& buffer)
+{
+	static constexpr AL::uint32 MATRIX[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+
+	for (auto value : MATRIX)
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, value);
+}
+// @return offset to pass to pi_camera_mp4_buffer_end_box
+AL::size_t pi_camera_mp4_buffer_begin_box(pi_camera_mp4_buffer& buffer, const char* type)
+{
+	auto offset = buffer.size;
+
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+	pi_camera_mp4_buffer_write(buffer, type, 4);
+
+	return offset;
+}
+// @return offset to pass to pi_camera_mp4_buffer_end_box
+AL::size_t pi_camera_mp4_buffer_begin_full_box(pi_camera_mp4_buffer& buffer, const char* type, AL::uint8 version, AL::uint32 flags)
+{
+	auto offset = pi_camera_mp4_buffer_begin_box(buffer, type);
+
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, (static_cast<AL::uint32>(version) << 24) | (flags & 0x00FFFFFF));
+
+	return offset;
+}
+void       pi_camera_mp4_buffer_end_box(pi_camera_mp4_buffer& buffer, AL::size_t offset)
+{
+	auto size = AL::BitConverter::HostToNetwork(static_cast<AL::uint32>(buffer.size - offset));
+
+	::memcpy(&buffer.buffer[offset], &size, sizeof(AL::uint32));
+}
+
+// reads past the end yield zeros, callers sanity check what they parsed
+AL::uint32 pi_camera_h264_read_bits(pi_camera_h264_bit_reader& reader, AL::uint8 count)
+{
+	AL::uint32 value = 0;
+
+	for (; count > 0; --count, ++reader.position)
+	{
+		AL::uint8 byte = ((reader.position / 8) < reader.size) ? reader.buffer[reader.position / 8] : 0;
+
+		value = (value << 1) | ((byte >> (7 - (reader.position % 8))) & 0x01);
+	}
+
+	return value;
+}
+AL::uint32 pi_camera_h264_read_ue(pi_camera_h264_bit_reader& reader)
+{
+	AL::uint8 leading_zero_bits = 0;
+
+	while ((pi_camera_h264_read_bits(reader, 1) == 0) && (leading_zero_bits < 31))
+		++leading_zero_bits;
+
+	return ((1u << leading_zero_bits) - 1) + pi_camera_h264_read_bits(reader, leading_zero_bits);
+}
+AL::int32  pi_camera_h264_read_se(pi_camera_h264_bit_reader& reader)
+{
+	auto value = pi_camera_h264_read_ue(reader);
+
+	return (value & 0x01) ? static_cast<AL::int32>((value + 1) / 2) : -static_cast<AL::int32>(value / 2);
+}
+// @param sps nal unit without its start code
+bool       pi_camera_h264_sps_parse(const AL::uint8* sps, AL::size_t size, pi_camera_h264_sps& value)
+{
+	pi_camera_h264_bit_reader reader;
+	reader.buffer.SetCapacity(size);
+
+	// strip emulation prevention bytes, the nal header is skipped
+	for (AL::size_t i = 1, zero_count = 0; i < size; ++i)
+	{
+		if ((zero_count >= 2) && (sps[i] == 0x03))
+		{
+			zero_count = 0;
+
+			continue;
+		}
+
+		zero_count = (sps[i] == 0x00) ? (zero_count + 1) : 0;
+		reader.buffer[reader.size++] = sps[i];
+	}
+
+	auto profile_idc = pi_camera_h264_read_bits(reader, 8);
+	pi_camera_h264_read_bits(reader, 16); // constraint flags, level_idc
+	pi_camera_h264_read_ue(reader);       // seq_parameter_set_id
+
+	// ChromaArrayType, 0 when the colour planes are coded separately
+	AL::uint32 chroma_format_idc = 1;
+
+	switch (profile_idc)
+	{
+		case 100: case 110: case 122: case 244: case 44:
+		case 83:  case 86:  case 118: case 128: case 138:
+		case 139: case 134: case 135:
+		{
+			if ((chroma_format_idc = pi_camera_h264_read_ue(reader)) == 3)
+			{
+				// separate_colour_plane_flag
+				if (pi_camera_h264_read_bits(reader, 1) != 0)
+					chroma_format_idc = 0;
+			}
+
+			value.chroma_format_idc       = static_cast<AL::uint8>((chroma_format_idc == 0) ? 3 : chroma_format_idc);
+			value.bit_depth_luma_minus8   = static_cast<AL::uint8>(pi_camera_h264_read_ue(reader));
+			value.bit_depth_chroma_minus8 = static_cast<AL::uint8>(pi_camera_h264_read_ue(reader));
+			pi_camera_h264_read_bits(reader, 1); // qpprime_y_zero_transform_bypass_flag
+
+			// seq_scaling_matrix_present_flag
+			if (pi_camera_h264_read_bits(reader, 1) != 0)
+			{
+				for (AL::size_t i = 0; i < ((chroma_format_idc != 3) ? 8 : 12); ++i)
+				{
+					if (pi_camera_h264_read_bits(reader, 1) == 0)
+						continue;
+
+					for (AL::int32 j = 0, last_scale = 8, next_scale = 8; j < ((i < 6) ? 16 : 64); ++j)
+					{
+						if (next_scale != 0)
+							next_scale = (last_scale + pi_camera_h264_read_se(reader) + 256) % 256;
+
+						if (next_scale != 0)
+							last_scale = next_scale;
+					}
+				}
+			}
+		}
+		break;
+	}
+
+	pi_camera_h264_read_ue(reader); // log2_max_frame_num_minus4
+
+	switch (pi_camera_h264_read_ue(reader))
+	{
+		case 0:
+			pi_camera_h264_read_ue(reader); // log2_max_pic_order_cnt_lsb_minus4
+			break;
+
+		case 1:
+		{
+			pi_camera_h264_read_bits(reader, 1); // delta_pic_order_always_zero_flag
+			pi_camera_h264_read_se(reader);      // offset_for_non_ref_pic
+			pi_camera_h264_read_se(reader);      // offset_for_top_to_bottom_field
+
+			for (AL::uint32 i = 0, count = pi_camera_h264_read_ue(reader); i < count; ++i)
+				pi_camera_h264_read_se(reader);
+		}
+		break;
+	}
+
+	pi_camera_h264_read_ue(reader);      // max_num_ref_frames
+	pi_camera_h264_read_bits(reader, 1); // gaps_in_frame_num_value_allowed_flag
+
+	auto width_in_mbs         = pi_camera_h264_read_ue(reader) + 1;
+	auto height_in_map_units  = pi_camera_h264_read_ue(reader) + 1;
+	auto frame_mbs_only_flag  = pi_camera_h264_read_bits(reader, 1);
+
+	if (frame_mbs_only_flag == 0)
+		pi_camera_h264_read_bits(reader, 1); // mb_adaptive_frame_field_flag
+
+	pi_camera_h264_read_bits(reader, 1); // direct_8x8_inference_flag
+
+	AL::uint32 crop_left   = 0;
+	AL::uint32 crop_right  = 0;
+	AL::uint32 crop_top    = 0;
+	AL::uint32 crop_bottom = 0;
+
+	if (pi_camera_h264_read_bits(reader, 1) != 0)
+	{
+		crop_left   = pi_camera_h264_read_ue(reader);
+		crop_right  = pi_camera_h264_read_ue(reader);
+		crop_top    = pi_camera_h264_read_ue(reader);
+		crop_bottom = pi_camera_h264_read_ue(reader);
+	}
+
+	AL::uint32 crop_unit_x = ((chroma_format_idc == 1) || (chroma_format_idc == 2)) ? 2 : 1;
+	AL::uint32 crop_unit_y = ((chroma_format_idc == 1) ? 2 : 1) * (2 - frame_mbs_only_flag);
+	AL::uint64 value_x     = static_cast<AL::uint64>(width_in_mbs) * 16;
+	AL::uint64 value_y     = static_cast<AL::uint64>(height_in_map_units) * 16 * (2 - frame_mbs_only_flag);
+	AL::uint64 crop_x      = static_cast<AL::uint64>(crop_left + crop_right) * crop_unit_x;
+	AL::uint64 crop_y      = static_cast<AL::uint64>(crop_top + crop_bottom) * crop_unit_y;
+
+	if ((chroma_format_idc > 3) || (value.bit_depth_luma_minus8 > 6) || (value.bit_depth_chroma_minus8 > 6))
+		return false;
+
+	if ((reader.position > (reader.size * 8)) || (crop_x >= value_x) || (crop_y >= value_y) || ((value_x - crop_x) > AL::Integer<AL::uint16>::Maximum) || ((value_y - crop_y) > AL::Integer<AL::uint16>::Maximum))
+		return false;
+
+	value.width  = static_cast<AL::uint16>(value_x - crop_x);
+	value.height = static_cast<AL::uint16>(value_y - crop_y);
+
+	return true;
+}
+
+bool       pi_camera_mp4_writer_write(pi_camera_mp4_writer& writer, const void* buffer, AL::size_t size)
+{
+	for (AL::size_t number_of_bytes_written = 0; number_of_bytes_written < size; )
+	{
+		auto result = ::write(writer.file, &reinterpret_cast<const AL::uint8*>(buffer)[number_of_bytes_written], size - number_of_bytes_written);
+
+		if (result == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			writer.error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+			return false;
+		}
+
+		number_of_bytes_written += static_cast<AL::size_t>(result);
+	}
+
+	return true;
+}
+// the file is only created once raspivid produces output so a busy camera leaves file_path alone
+bool       pi_camera_mp4_writer_open(pi_camera_mp4_writer& writer)
+{
+	if ((writer.file = ::open(writer.file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1)
+	{
+		writer.error_code = PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+		return false;
+	}
+
+	pi_camera_mp4_buffer buffer;
+
+	auto ftyp = pi_camera_mp4_buffer_begin_box(buffer, "ftyp");
+	pi_camera_mp4_buffer_write(buffer, "isom", 4);
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0x200);
+	pi_camera_mp4_buffer_write(buffer, "isomiso2avc1mp41", 16);
+	pi_camera_mp4_buffer_end_box(buffer, ftyp);
+
+	// 64 bit size so long clips don't overflow it, patched in by pi_camera_mp4_writer_close
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+	pi_camera_mp4_buffer_write(buffer, "mdat", 4);
+	pi_camera_mp4_buffer_write_integer<AL::uint64>(buffer, 0);
+
+	writer.mdat_offset = buffer.size;
+
+	bool result = pi_camera_mp4_writer_write(writer, buffer.buffer, buffer.size);
+
+	delete[] buffer.buffer;
+
+	return result;
+}
+void       pi_camera_mp4_writer_end_sample(pi_camera_mp4_writer& writer)
+{
+	writer.sample_sizes.PushBack(writer.sample_size);
+
+	if (writer.sample_is_sync)
+		writer.sync_samples.PushBack(static_cast<AL::uint32>(writer.sample_sizes.GetSize()));
+
+	writer.sample_size      = 0;
+	writer.sample_has_slice = false;
+	writer.sample_is_sync   = false;
+}
+// Converts each annex b nal unit to a length prefixed one in mdat, sps/pps are kept for avcC instead
+bool       pi_camera_mp4_writer_on_nal_unit(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto writer          = reinterpret_cast<pi_camera_mp4_writer*>(param);
+	auto start_code_size = pi_camera_video_get_start_code_size(buffer, size);
+
+	if (size <= start_code_size)
+		return true;
+
+	buffer += start_code_size;
+	size   -= start_code_size;
+
+	auto nal_unit_type = buffer[0] & 0x1F;
+	bool is_slice      = (nal_unit_type == 1) || (nal_unit_type == 5);
+
+	// a picture ends at the first nal unit that isn't a slice or at a slice with first_mb_in_slice 0, which is a single 1 bit
+	if (writer->sample_has_slice && (!is_slice || ((size > 1) && ((buffer[1] & 0x80) != 0))))
+		pi_camera_mp4_writer_end_sample(*writer);
+
+	switch (nal_unit_type)
+	{
+		case 7:
+		case 8:
+		{
+			// raspivid repeats them before every key frame
+			auto& parameter_set = (nal_unit_type == 7) ? writer->sps : writer->pps;
+
+			if (parameter_set.GetSize() == 0)
+			{
+				parameter_set.SetCapacity(size);
+				::memcpy(&parameter_set[0], buffer, size);
+			}
+		}
+		return true;
+
+		// access unit delimiter
+		case 9:
+			return true;
+	}
+
+	auto length = AL::BitConverter::HostToNetwork(size);
+
+	if (writer->is_fragmented)
+	{
+		pi_camera_mp4_buffer_write(writer->fragment, &length, sizeof(AL::uint32));
+		pi_camera_mp4_buffer_write(writer->fragment, buffer, size);
+	}
+	else
+	{
+		if ((writer->file == -1) && !pi_camera_mp4_writer_open(*writer))
+			return false;
+
+		if (!pi_camera_mp4_writer_write(*writer, &length, sizeof(AL::uint32)) || !pi_camera_mp4_writer_write(*writer, buffer, size))
+			return false;
+
+		writer->mdat_size += sizeof(AL::uint32) + size;
+	}
+
+	writer->sample_size += sizeof(AL::uint32) + size;
+
+	if (is_slice)
+	{
+		writer->sample_has_slice = true;
+
+		if (nal_unit_type == 5)
+			writer->sample_is_sync = true;
+	}
+
+	return true;
+}
+// fragmented writers leave the sample tables empty, each moof describes its own samples
+void       pi_camera_mp4_buffer_write_moov(pi_camera_mp4_buffer& buffer, const pi_camera_mp4_writer& writer, AL::uint8 frame_rate)
+{
+	pi_camera_h264_sps sps;
+
+	// players take the size from avcC, tkhd/avc1 are informational
+	if (!pi_camera_h264_sps_parse(&writer.sps[0], writer.sps.GetSize(), sps))
+		sps = pi_camera_h264_sps();
+
+	auto width  = sps.width;
+	auto height = sps.height;
+
+	auto sample_count   = writer.is_fragmented ? 0 : static_cast<AL::uint32>(writer.sample_sizes.GetSize());
+	auto sample_delta   = static_cast<AL::uint32>(PI_CAMERA_MP4_TIMESCALE / frame_rate);
+	auto duration       = static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>(static_cast<AL::uint64>(sample_count) * sample_delta, 0, AL::Integer<AL::uint32>::Maximum));
+	auto movie_duration = static_cast<AL::uint32>((static_cast<AL::uint64>(duration) * 1000) / PI_CAMERA_MP4_TIMESCALE);
+
+	auto moov = pi_camera_mp4_buffer_begin_box(buffer, "moov");
+	{
+		auto mvhd = pi_camera_mp4_buffer_begin_full_box(buffer, "mvhd", 0, 0);
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);          // creation_time
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);          // modification_time
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1000);       // timescale
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, movie_duration);
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0x00010000); // rate
+		pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 0x0100);     // volume
+		pi_camera_mp4_buffer_write_zeros(buffer, 10);
+		pi_camera_mp4_buffer_write_matrix(buffer);
+		pi_camera_mp4_buffer_write_zeros(buffer, 24);
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 2);          // next_track_ID
+		pi_camera_mp4_buffer_end_box(buffer, mvhd);
+
+		auto trak = pi_camera_mp4_buffer_begin_box(buffer, "trak");
+		{
+			// enabled | in movie
+			auto tkhd = pi_camera_mp4_buffer_begin_full_box(buffer, "tkhd", 0, 0x000003);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);      // creation_time
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);      // modification_time
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);      // track_ID
+			pi_camera_mp4_buffer_write_zeros(buffer, 4);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, movie_duration);
+			pi_camera_mp4_buffer_write_zeros(buffer, 16);                   // reserved, layer, alternate_group, volume, reserved
+			pi_camera_mp4_buffer_write_matrix(buffer);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, static_cast<AL::uint32>(width) << 16);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, static_cast<AL::uint32>(height) << 16);
+			pi_camera_mp4_buffer_end_box(buffer, tkhd);
+
+			auto mdia = pi_camera_mp4_buffer_begin_box(buffer, "mdia");
+			{
+				auto mdhd = pi_camera_mp4_buffer_begin_full_box(buffer, "mdhd", 0, 0);
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);  // creation_time
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);  // modification_time
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, PI_CAMERA_MP4_TIMESCALE);
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, duration);
+				pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 0x55C4); // und
+				pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 0);
+				pi_camera_mp4_buffer_end_box(buffer, mdhd);
+
+				auto hdlr = pi_camera_mp4_buffer_begin_full_box(buffer, "hdlr", 0, 0);
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+				pi_camera_mp4_buffer_write(buffer, "vide", 4);
+				pi_camera_mp4_buffer_write_zeros(buffer, 12);
+				pi_camera_mp4_buffer_write(buffer, "VideoHandler", 13);
+				pi_camera_mp4_buffer_end_box(buffer, hdlr);
+
+				auto minf = pi_camera_mp4_buffer_begin_box(buffer, "minf");
+				{
+					auto vmhd = pi_camera_mp4_buffer_begin_full_box(buffer, "vmhd", 0, 0x000001);
+					pi_camera_mp4_buffer_write_zeros(buffer, 8);            // graphicsmode, opcolor
+					pi_camera_mp4_buffer_end_box(buffer, vmhd);
+
+					auto dinf = pi_camera_mp4_buffer_begin_box(buffer, "dinf");
+					auto dref = pi_camera_mp4_buffer_begin_full_box(buffer, "dref", 0, 0);
+					pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+					// media is in this file
+					auto url  = pi_camera_mp4_buffer_begin_full_box(buffer, "url ", 0, 0x000001);
+					pi_camera_mp4_buffer_end_box(buffer, url);
+					pi_camera_mp4_buffer_end_box(buffer, dref);
+					pi_camera_mp4_buffer_end_box(buffer, dinf);
+
+					auto stbl = pi_camera_mp4_buffer_begin_box(buffer, "stbl");
+					{
+						auto stsd = pi_camera_mp4_buffer_begin_full_box(buffer, "stsd", 0, 0);
+						pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+						{
+							auto avc1 = pi_camera_mp4_buffer_begin_box(buffer, "avc1");
+							pi_camera_mp4_buffer_write_zeros(buffer, 6);
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 1);          // data_reference_index
+							pi_camera_mp4_buffer_write_zeros(buffer, 16);
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, width);
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, height);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0x00480000); // horizresolution
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0x00480000); // vertresolution
+							pi_camera_mp4_buffer_write_zeros(buffer, 4);
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 1);          // frame_count
+							pi_camera_mp4_buffer_write_zeros(buffer, 32);                       // compressorname
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 0x0018);     // depth
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, 0xFFFF);
+
+							auto avcC = pi_camera_mp4_buffer_begin_box(buffer, "avcC");
+							pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 1);
+							pi_camera_mp4_buffer_write(buffer, &writer.sps[1], 3);              // profile, compatibility, level
+							pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0xFF);        // 4 byte nal unit lengths
+							pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0xE1);        // 1 sps
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, static_cast<AL::uint16>(writer.sps.GetSize()));
+							pi_camera_mp4_buffer_write(buffer, &writer.sps[0], writer.sps.GetSize());
+							pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 1);           // 1 pps
+							pi_camera_mp4_buffer_write_integer<AL::uint16>(buffer, static_cast<AL::uint16>(writer.pps.GetSize()));
+							pi_camera_mp4_buffer_write(buffer, &writer.pps[0], writer.pps.GetSize());
+
+							// high profiles carry the chroma format and bit depths, with reserved bits set
+							switch (writer.sps[1])
+							{
+								case 100: case 110: case 122: case 144:
+									pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0xFC | sps.chroma_format_idc);
+									pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0xF8 | sps.bit_depth_luma_minus8);
+									pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0xF8 | sps.bit_depth_chroma_minus8);
+									pi_camera_mp4_buffer_write_integer<AL::uint8>(buffer, 0);   // 0 sps ext
+									break;
+							}
+
+							pi_camera_mp4_buffer_end_box(buffer, avcC);
+
+							pi_camera_mp4_buffer_end_box(buffer, avc1);
+						}
+						pi_camera_mp4_buffer_end_box(buffer, stsd);
+
+						if (writer.is_fragmented)
+						{
+							for (auto type : { "stts", "stsc", "stco" })
+							{
+								auto box = pi_camera_mp4_buffer_begin_full_box(buffer, type, 0, 0);
+								pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+								pi_camera_mp4_buffer_end_box(buffer, box);
+							}
+
+							auto stsz = pi_camera_mp4_buffer_begin_full_box(buffer, "stsz", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+							pi_camera_mp4_buffer_end_box(buffer, stsz);
+						}
+						else
+						{
+							auto stts = pi_camera_mp4_buffer_begin_full_box(buffer, "stts", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_count);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_delta);
+							pi_camera_mp4_buffer_end_box(buffer, stts);
+
+							auto stss = pi_camera_mp4_buffer_begin_full_box(buffer, "stss", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, static_cast<AL::uint32>(writer.sync_samples.GetSize()));
+							for (auto sample_number : writer.sync_samples)
+								pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_number);
+							pi_camera_mp4_buffer_end_box(buffer, stss);
+
+							// every sample is in a single chunk at the start of mdat
+							auto stsc = pi_camera_mp4_buffer_begin_full_box(buffer, "stsc", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);              // first_chunk
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_count);   // samples_per_chunk
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);              // sample_description_index
+							pi_camera_mp4_buffer_end_box(buffer, stsc);
+
+							auto stsz = pi_camera_mp4_buffer_begin_full_box(buffer, "stsz", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_count);
+							for (auto sample_size : writer.sample_sizes)
+								pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_size);
+							pi_camera_mp4_buffer_end_box(buffer, stsz);
+
+							auto stco = pi_camera_mp4_buffer_begin_full_box(buffer, "stco", 0, 0);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);
+							pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, static_cast<AL::uint32>(writer.mdat_offset));
+							pi_camera_mp4_buffer_end_box(buffer, stco);
+						}
+					}
+					pi_camera_mp4_buffer_end_box(buffer, stbl);
+				}
+				pi_camera_mp4_buffer_end_box(buffer, minf);
+			}
+			pi_camera_mp4_buffer_end_box(buffer, mdia);
+		}
+		pi_camera_mp4_buffer_end_box(buffer, trak);
+
+		if (writer.is_fragmented)
+		{
+			auto mvex = pi_camera_mp4_buffer_begin_box(buffer, "mvex");
+			auto trex = pi_camera_mp4_buffer_begin_full_box(buffer, "trex", 0, 0);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);            // track_ID
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1);            // default_sample_description_index
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_delta); // default_sample_duration
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);            // default_sample_size
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);            // default_sample_flags
+			pi_camera_mp4_buffer_end_box(buffer, trex);
+			pi_camera_mp4_buffer_end_box(buffer, mvex);
+		}
+	}
+	pi_camera_mp4_buffer_end_box(buffer, moov);
+}
+AL::uint8  pi_camera_mp4_writer_write_moov(pi_camera_mp4_writer& writer, AL::uint8 frame_rate)
+{
+	if (writer.sample_has_slice)
+		pi_camera_mp4_writer_end_sample(writer);
+
+	if ((writer.sample_sizes.GetSize() == 0) || (writer.sps.GetSize() < 4) || (writer.pps.GetSize() == 0))
+		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+
+	pi_camera_mp4_buffer buffer;
+	pi_camera_mp4_buffer_write_moov(buffer, writer, frame_rate);
+
+	bool result = pi_camera_mp4_writer_write(writer, buffer.buffer, buffer.size);
+
+	delete[] buffer.buffer;
+
+	if (!result)
+		return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+	auto mdat_size = AL::BitConverter::HostToNetwork<AL::uint64>(writer.mdat_size + 16);
+
+	if (::pwrite(writer.file, &mdat_size, sizeof(AL::uint64), static_cast<off_t>(writer.mdat_offset - sizeof(AL::uint64))) != sizeof(AL::uint64))
+		return PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+// writes ftyp and a moov without samples, the samples follow in moof/mdat pairs
+bool       pi_camera_mp4_writer_open_fragmented(pi_camera_mp4_writer& writer, AL::uint8 frame_rate)
+{
+	if ((writer.file = ::open(writer.file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1)
+	{
+		writer.error_code = PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+		return false;
+	}
+
+	pi_camera_mp4_buffer buffer;
+
+	auto ftyp = pi_camera_mp4_buffer_begin_box(buffer, "ftyp");
+	pi_camera_mp4_buffer_write(buffer, "iso5", 4);
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0x200);
+	pi_camera_mp4_buffer_write(buffer, "iso5iso6avc1mp41", 16);
+	pi_camera_mp4_buffer_end_box(buffer, ftyp);
+
+	pi_camera_mp4_buffer_write_moov(buffer, writer, frame_rate);
+
+	bool result = pi_camera_mp4_writer_write(writer, buffer.buffer, buffer.size);
+
+	delete[] buffer.buffer;
+
+	return result;
+}
+// Writes the completed samples buffered since the last fragment as a moof/mdat pair
+// A file cut short by a crash is still playable up to its last complete fragment
+bool       pi_camera_mp4_writer_write_fragment(pi_camera_mp4_writer& writer, AL::uint8 frame_rate)
+{
+	if (writer.sample_has_slice)
+		pi_camera_mp4_writer_end_sample(writer);
+
+	if (writer.sample_sizes.GetSize() == 0)
+		return true;
+
+	// nal units of a picture without a slice yet belong to the next fragment
+	auto samples_size = writer.fragment.size - writer.sample_size;
+	auto sample_count = static_cast<AL::uint32>(writer.sample_sizes.GetSize());
+	auto sample_delta = static_cast<AL::uint32>(PI_CAMERA_MP4_TIMESCALE / frame_rate);
+
+	pi_camera_mp4_buffer buffer;
+
+	auto moof = pi_camera_mp4_buffer_begin_box(buffer, "moof");
+	{
+		auto mfhd = pi_camera_mp4_buffer_begin_full_box(buffer, "mfhd", 0, 0);
+		pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, ++writer.sequence_number);
+		pi_camera_mp4_buffer_end_box(buffer, mfhd);
+
+		auto traf = pi_camera_mp4_buffer_begin_box(buffer, "traf");
+		{
+			// default-base-is-moof | default-sample-duration-present
+			auto tfhd = pi_camera_mp4_buffer_begin_full_box(buffer, "tfhd", 0, 0x020008);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 1); // track_ID
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_delta);
+			pi_camera_mp4_buffer_end_box(buffer, tfhd);
+
+			auto tfdt = pi_camera_mp4_buffer_begin_full_box(buffer, "tfdt", 1, 0);
+			pi_camera_mp4_buffer_write_integer<AL::uint64>(buffer, writer.decode_time);
+			pi_camera_mp4_buffer_end_box(buffer, tfdt);
+
+			// data-offset-present | sample-size-present | sample-flags-present
+			auto trun = pi_camera_mp4_buffer_begin_full_box(buffer, "trun", 0, 0x000601);
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_count);
+			auto data_offset = buffer.size;
+			pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, 0);
+
+			auto       sync_sample   = writer.sync_samples.begin();
+			AL::uint32 sample_number = 0;
+
+			for (auto sample_size : writer.sample_sizes)
+			{
+				bool is_sync = (sync_sample != writer.sync_samples.end()) && (*sync_sample == ++sample_number);
+
+				if (is_sync)
+					++sync_sample;
+
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, sample_size);
+				// depends on no other sample, or depends on others and is not a sync sample
+				pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, is_sync ? 0x02000000 : 0x01010000);
+			}
+
+			pi_camera_mp4_buffer_end_box(buffer, trun);
+
+			// the first sample follows moof and the mdat header
+			auto data_offset_value = AL::BitConverter::HostToNetwork(static_cast<AL::uint32>(buffer.size - moof + 8));
+			::memcpy(&buffer.buffer[data_offset], &data_offset_value, sizeof(AL::uint32));
+		}
+		pi_camera_mp4_buffer_end_box(buffer, traf);
+	}
+	pi_camera_mp4_buffer_end_box(buffer, moof);
+
+	pi_camera_mp4_buffer_write_integer<AL::uint32>(buffer, static_cast<AL::uint32>(samples_size + 8));
+	pi_camera_mp4_buffer_write(buffer, "mdat", 4);
+
+	bool result = pi_camera_mp4_writer_write(writer, buffer.buffer, buffer.size) && pi_camera_mp4_writer_write(writer, writer.fragment.buffer, samples_size);
+
+	delete[] buffer.buffer;
+
+	if (writer.sample_size != 0)
+		::memmove(writer.fragment.buffer, &writer.fragment.buffer[samples_size], writer.sample_size);
+
+	writer.fragment.size = writer.sample_size;
+	writer.decode_time  += static_cast<AL::uint64>(sample_count) * sample_delta;
+	writer.sample_sizes.Clear();
+	writer.sync_samples.Clear();
+
+	return result;
+}
+// muxes raspivid's output while it records instead of staging an .h264 file for MP4Box to rewrite
+AL::uint8  pi_camera_cli_video_execute_mp4(pi_camera_local* camera_local, const char* file_path, AL::uint32 video_length_seconds)
+{
+	AL::uint8 frame_rate;
+
+	{
+		AL::OS::MutexGuard lock(camera_local->mutex);
+
+		frame_rate = camera_local->config.video_frame_rate;
+	}
+
+	pi_camera_mp4_writer writer;
+	writer.file_path = file_path;
+
+	AL::uint8 error_code = pi_camera_cli_video_execute_stream(camera_local, video_length_seconds, 0, &pi_camera_mp4_writer_on_nal_unit, &writer);
+
+	if (writer.error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+		error_code = writer.error_code;
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		error_code = pi_camera_mp4_writer_write_moov(writer, frame_rate);
+
+	if (writer.file != -1)
+	{
+		if ((::close(writer.file) == -1) && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+			error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+		if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			::unlink(file_path);
+	}
+
+	return error_code;
+}
+typedef AL::Collections::LinkedList<pi_camera_recording_segment> pi_camera_recording_segment_list;
+
+struct pi_camera_recording
+{
+	bool                             is_stopping = false;
+
+	pi_camera_local*                 camera_local;
+	AL::String                       directory;
+	AL::uint32                       segment_length_seconds;
+	AL::uint64                       disk_budget;
+	AL::OS::Thread                   thread;
+
+	AL::OS::Mutex                    mutex;
+	AL::OS::ConditionalVariable      condition;
+	// completed segments, oldest first
+	pi_camera_recording_segment_list segments;
+	AL::uint64                       segments_size   = 0;
+	AL::uint64                       next_segment_id = 0;
+
+	// only touched by thread
+	AL::uint8                        frame_rate;
+	AL::String                       segment_path;
+	pi_camera_recording_segment      segment;
+	pi_camera_mp4_writer             writer;
+};
+
+AL::String pi_camera_recording_get_segment_path(pi_camera_recording* recording, AL::uint64 id)
+{
+	return AL::String::Format("%s/segment_%llu.mp4", recording->directory.GetCString(), id);
+}
+// Segments missing from disk no longer count against the budget
+// A segment cut short by a crash isn't indexed, the next segment reuses its id and overwrites it
+void       pi_camera_recording_read_index(pi_camera_recording* recording)
+{
+	auto                    index_path = AL::String::Format("%s/index", recording->directory.GetCString());
+	AL::uint64              index_size;
+	pi_camera_packet_buffer index;
+
+	if (!pi_camera_file_get_size(index_path.GetCString(), index_size) || (index_size < sizeof(pi_camera_recording_segment)) || !pi_camera_file_read_all(index_path.GetCString(), index))
+		return;
+
+	for (AL::size_t i = 0; (i + sizeof(pi_camera_recording_segment)) <= index.GetSize(); i += sizeof(pi_camera_recording_segment))
+	{
+		pi_camera_recording_segment segment;
+		::memcpy(&segment, &index[i], sizeof(pi_camera_recording_segment));
+
+		if (segment.id >= recording->next_segment_id)
+			recording->next_segment_id = segment.id + 1;
+
+		if (!pi_camera_file_get_size(pi_camera_recording_get_segment_path(recording, segment.id).GetCString(), segment.size))
+			continue;
+
+		recording->segments.PushBack(segment);
+		recording->segments_size += segment.size;
+	}
+}
+// Replaced with a rename so a power loss leaves either the old or the new index
+// @param recording mutex must be held
+void       pi_camera_recording_write_index(pi_camera_recording* recording)
+{
+	auto index_path     = AL::String::Format("%s/index", recording->directory.GetCString());
+	auto index_path_tmp = AL::String::Format("%s.tmp", index_path.GetCString());
+	auto file           = pi_camera_file_open(index_path_tmp.GetCString(), false, true);
+
+	if (file == nullptr)
+		return;
+
+	bool result = true;
+
+	for (auto& segment : recording->segments)
+		if (!(result = pi_camera_file_append(file, &segment, sizeof(pi_camera_recording_segment))))
+			break;
+
+	pi_camera_file_close(file);
+
+	if (!result || (::rename(index_path_tmp.GetCString(), index_path.GetCString()) == -1))
+		::unlink(index_path_tmp.GetCString());
+}
+bool       pi_camera_recording_begin_segment(pi_camera_recording* recording)
+{
+	{
+		AL::OS::MutexGuard lock(recording->mutex);
+
+		recording->segment.id = recording->next_segment_id++;
+	}
+
+	auto& writer            = recording->writer;
+	auto  sample_count      = writer.sample_sizes.GetSize() + (writer.sample_has_slice ? 1 : 0);
+	// the first fragment is written once it ends
+	auto  fragment_duration = (static_cast<AL::uint64>(sample_count) * 1000) / recording->frame_rate;
+
+	recording->segment_path          = pi_camera_recording_get_segment_path(recording, recording->segment.id);
+	recording->segment.start_time_ms = pi_camera_get_time_ms() - fragment_duration;
+	recording->segment.duration_ms   = 0;
+	recording->segment.size          = 0;
+	writer.file_path                 = recording->segment_path.GetCString();
+	writer.sequence_number           = 0;
+	writer.decode_time               = 0;
+
+	return pi_camera_mp4_writer_open_fragmented(writer, recording->frame_rate);
+}
+// Indexes the segment being written and deletes the oldest segments beyond the disk budget
+void       pi_camera_recording_end_segment(pi_camera_recording* recording)
+{
+	auto& writer = recording->writer;
+
+	if (writer.file == -1)
+		return;
+
+	struct stat file_stat;
+
+	if (::fstat(writer.file, &file_stat) == 0)
+		recording->segment.size = static_cast<AL::uint64>(file_stat.st_size);
+
+	::close(writer.file);
+	writer.file = -1;
+
+	recording->segment.duration_ms = static_cast<AL::uint32>(AL::Math::Clamp<AL::uint64>((writer.decode_time * 1000) / PI_CAMERA_MP4_TIMESCALE, 0, AL::Integer<AL::uint32>::Maximum));
+
+	AL::OS::MutexGuard lock(recording->mutex);
+
+	recording->segments.PushBack(recording->segment);
+	recording->segments_size += recording->segment.size;
+
+	// the newest segment is kept even if it alone exceeds the budget
+	while ((recording->segments_size > recording->disk_budget) && (recording->segments.GetSize() > 1))
+	{
+		auto it = recording->segments.begin();
+
+		::unlink(pi_camera_recording_get_segment_path(recording, it->id).GetCString());
+		recording->segments_size -= it->size;
+		recording->segments.Erase(it);
+	}
+
+	pi_camera_recording_write_index(recording);
+}
+// Starts a new segment with this fragment once the current one is segment_length_seconds long
+bool       pi_camera_recording_write_fragment(pi_camera_recording* recording)
+{
+	auto& writer = recording->writer;
+
+	if ((writer.file != -1) && (writer.decode_time >= (static_cast<AL::uint64>(recording->segment_length_seconds) * PI_CAMERA_MP4_TIMESCALE)))
+		pi_camera_recording_end_segment(recording);
+
+	if ((writer.file == -1) && !pi_camera_recording_begin_segment(recording))
+		return false;
+
+	return pi_camera_mp4_writer_write_fragment(writer, recording->frame_rate);
+}
+bool       pi_camera_recording_on_nal_unit(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto  recording = reinterpret_cast<pi_camera_recording*>(param);
+	auto& writer    = recording->writer;
+
+	{
+		AL::OS::MutexGuard lock(recording->mutex);
+
+		if (recording->is_stopping)
+			return false;
+	}
+
+	auto start_code_size = pi_camera_video_get_start_code_size(buffer, size);
+
+	// -ih puts an sps in front of every key frame, fragments and segments start there so each plays on its own
+	if ((size > start_code_size) && ((buffer[start_code_size] & 0x1F) == 7) && (writer.sample_has_slice || (writer.sample_sizes.GetSize() != 0)))
+	{
+		if (!pi_camera_recording_write_fragment(recording))
+			return false;
+	}
+
+	return pi_camera_mp4_writer_on_nal_unit(buffer, size, &writer);
+}
+// raspivid runs until the recording stops, it is restarted if it fails
+void       pi_camera_recording_thread_main(pi_camera_recording* recording)
+{
+	auto& writer = recording->writer;
+
+	while (true)
+	{
+		{
+			AL::OS::MutexGuard lock(recording->camera_local->mutex);
+
+			recording->frame_rate = recording->camera_local->config.video_frame_rate;
+		}
+
+		// a new process may have been configured differently
+		writer.sps.SetCapacity(0);
+		writer.pps.SetCapacity(0);
+		writer.error_code = PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		// a key frame every second bounds how far a segment overruns segment_length_seconds
+		pi_camera_cli_video_execute_stream(recording->camera_local, 0, recording->frame_rate, &pi_camera_recording_on_nal_unit, recording);
+
+		// keep what was recorded since the last key frame
+		if ((writer.error_code == PI_CAMERA_ERROR_CODE_SUCCESS) && (writer.sample_has_slice || (writer.sample_sizes.GetSize() != 0)))
+			pi_camera_recording_write_fragment(recording);
+
+		pi_camera_recording_end_segment(recording);
+
+		writer.fragment.size    = 0;
+		writer.sample_size      = 0;
+		writer.sample_has_slice = false;
+		writer.sample_is_sync   = false;
+		writer.sample_sizes.Clear();
+		writer.sync_samples.Clear();
+
+		AL::OS::MutexGuard lock(recording->mutex);
+
+		if (!recording->is_stopping)
+			recording->condition.Sleep(recording->mutex, AL::TimeSpan::FromMilliseconds(PI_CAMERA_RECORDING_RETRY_MS));
+
+		if (recording->is_stopping)
+			break;
+	}
+}
+// @param recording_mutex must be held
+void       pi_camera_recording_stop(pi_camera_recording* recording)
+{
+	{
+		AL::OS::MutexGuard lock(recording->mutex);
+
+		if (recording->is_stopping)
+			return;
+
+		recording->is_stopping = true;
+		recording->condition.WakeAll();
+	}
+
+	try
+	{
+		while (!recording->thread.Join())
+		{
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+	}
+}
+void       pi_camera_recording_delete(pi_camera_recording* recording)
+{
+	pi_camera_recording_stop(recording);
+
+	delete[] recording->writer.fragment.buffer;
+	delete recording;
+}
+
+struct pi_camera_pre_roll_gop
+{
+	AL::size_t size        = 0;
+	AL::uint32 frame_count = 0;
+};
+
+typedef AL::Collections::LinkedList<pi_camera_pre_roll_gop> pi_camera_pre_roll_gop_list;
+
+// the capturing thread writes the mp4, the encoder thread only queues nal units for it
+struct pi_camera_pre_roll_capture
+{
+	bool                    is_started     = false;
+	// raspivid stopped or the writer fell behind, nothing more is queued
+	bool                    is_ended       = false;
+	// frames to record once the buffered ones are written
+	AL::uint32              frame_count;
+	// nal units each preceded by their 32 bit size, the first replay_size bytes queued are the pre-roll
+	pi_camera_packet_buffer nal_units;
+	AL::size_t              nal_units_size = 0;
+	AL::size_t              replay_size    = 0;
+};
+
+struct pi_camera_pre_roll
+{
+	bool                        is_stopping = false;
+
+	pi_camera_local*            camera_local;
+	AL::uint32                  pre_roll_seconds;
+	AL::OS::Thread              thread;
+
+	AL::OS::Mutex               mutex;
+	AL::OS::ConditionalVariable condition;
+	AL::uint8                   frame_rate;
+	// ring of annex b nal units, each preceded by its 32 bit size
+	AL::uint8*                  buffer;
+	AL::size_t                  buffer_capacity;
+	AL::size_t                  buffer_start = 0;
+	AL::size_t                  buffer_size  = 0;
+	// completed key frame intervals, oldest first, gop is the one being received
+	pi_camera_pre_roll_gop_list gops;
+	pi_camera_pre_roll_gop      gop;
+	AL::uint32                  frame_count   = 0;
+	// set once a key frame interval outgrew the buffer, nothing is kept until the next key frame
+	bool                        is_discarding = true;
+	pi_camera_pre_roll_capture* capture       = nullptr;
+};
+
+void       pi_camera_pre_roll_buffer_write(pi_camera_pre_roll* pre_roll, const void* value, AL::size_t size)
+{
+	auto offset = (pre_roll->buffer_start + pre_roll->buffer_size) % pre_roll->buffer_capacity;
+	auto size_0 = AL::Math::Clamp<AL::size_t>(pre_roll->buffer_capacity - offset, 0, size);
+
+	::memcpy(&pre_roll->buffer[offset], value, size_0);
+	::memcpy(pre_roll->buffer, &reinterpret_cast<const AL::uint8*>(value)[size_0], size - size_0);
+
+	pre_roll->buffer_size += size;
+}
+// @param offset relative to the oldest byte
+void       pi_camera_pre_roll_buffer_read(pi_camera_pre_roll* pre_roll, AL::size_t offset, void* value, AL::size_t size)
+{
+	offset      = (pre_roll->buffer_start + offset) % pre_roll->buffer_capacity;
+	auto size_0 = AL::Math::Clamp<AL::size_t>(pre_roll->buffer_capacity - offset, 0, size);
+
+	::memcpy(value, &pre_roll->buffer[offset], size_0);
+	::memcpy(&reinterpret_cast<AL::uint8*>(value)[size_0], pre_roll->buffer, size - size_0);
+}
+void       pi_camera_pre_roll_drop_gop(pi_camera_pre_roll* pre_roll)
+{
+	auto it = pre_roll->gops.begin();
+
+	pre_roll->buffer_start  = (pre_roll->buffer_start + it->size) % pre_roll->buffer_capacity;
+	pre_roll->buffer_size  -= it->size;
+	pre_roll->frame_count  -= it->frame_count;
+	pre_roll->gops.Erase(it);
+}
+void       pi_camera_pre_roll_clear(pi_camera_pre_roll* pre_roll)
+{
+	pre_roll->buffer_start  = 0;
+	pre_roll->buffer_size   = 0;
+	pre_roll->gop           = pi_camera_pre_roll_gop {};
+	pre_roll->frame_count   = 0;
+	pre_roll->is_discarding = true;
+	pre_roll->gops.Clear();
+}
+// Buffers a nal unit, the oldest key frame intervals are dropped once the newer ones cover pre_roll_seconds or to make room
+// @param pre_roll mutex must be held
+void       pi_camera_pre_roll_push(pi_camera_pre_roll* pre_roll, const AL::uint8* buffer, AL::uint32 size)
+{
+	auto start_code_size = pi_camera_video_get_start_code_size(buffer, size);
+	auto nal_unit_type   = (size > start_code_size) ? (buffer[start_code_size] & 0x1F) : 0;
+
+	// -ih puts an sps in front of every key frame
+	if (nal_unit_type == 7)
+	{
+		if (!pre_roll->is_discarding)
+			pre_roll->gops.PushBack(pre_roll->gop);
+
+		pre_roll->gop           = pi_camera_pre_roll_gop {};
+		pre_roll->is_discarding = false;
+	}
+
+	if (pre_roll->is_discarding)
+		return;
+
+	while ((pre_roll->buffer_size + sizeof(AL::uint32) + size) > pre_roll->buffer_capacity)
+	{
+		if (pre_roll->gops.GetSize() == 0)
+		{
+			pi_camera_pre_roll_clear(pre_roll);
+
+			return;
+		}
+
+		pi_camera_pre_roll_drop_gop(pre_roll);
+	}
+
+	pi_camera_pre_roll_buffer_write(pre_roll, &size, sizeof(AL::uint32));
+	pi_camera_pre_roll_buffer_write(pre_roll, buffer, size);
+
+	pre_roll->gop.size += sizeof(AL::uint32) + size;
+
+	// a slice with first_mb_in_slice 0 starts a picture
+	if (((nal_unit_type == 1) || (nal_unit_type == 5)) && (size > (start_code_size + 1)) && ((buffer[start_code_size + 1] & 0x80) != 0))
+	{
+		++pre_roll->gop.frame_count;
+		++pre_roll->frame_count;
+	}
+
+	auto frame_count_min = pre_roll->pre_roll_seconds * pre_roll->frame_rate;
+
+	while ((pre_roll->gops.GetSize() != 0) && ((pre_roll->frame_count - pre_roll->gops.begin()->frame_count) >= frame_count_min))
+		pi_camera_pre_roll_drop_gop(pre_roll);
+}
+// @param pre_roll mutex must be held
+// @return nullptr once the capture fell more than a pre-roll behind
+AL::uint8* pi_camera_pre_roll_capture_reserve(pi_camera_pre_roll* pre_roll, AL::size_t size)
+{
+	auto capture = pre_roll->capture;
+	auto offset  = capture->nal_units_size;
+
+	if ((offset + size) > (capture->replay_size + pre_roll->buffer_capacity))
+	{
+		capture->is_ended = true;
+
+		return nullptr;
+	}
+
+	if ((offset + size) > capture->nal_units.GetSize())
+		capture->nal_units.SetCapacity(2 * (offset + size));
+
+	capture->nal_units_size += size;
+
+	return &capture->nal_units[offset];
+}
+// @param pre_roll mutex must be held
+void       pi_camera_pre_roll_capture_push(pi_camera_pre_roll* pre_roll, const AL::uint8* buffer, AL::uint32 size)
+{
+	auto capture = pre_roll->capture;
+
+	if (capture->is_started)
+	{
+		if (auto nal_unit = pi_camera_pre_roll_capture_reserve(pre_roll, sizeof(AL::uint32) + size))
+		{
+			::memcpy(nal_unit, &size, sizeof(AL::uint32));
+			::memcpy(&nal_unit[sizeof(AL::uint32)], buffer, size);
+		}
+	}
+	// a capture starts with the buffered nal units, which include this one and always start with an sps, or waits for the next key frame
+	else if (pre_roll->buffer_size != 0)
+	{
+		if (auto nal_units = pi_camera_pre_roll_capture_reserve(pre_roll, pre_roll->buffer_size))
+		{
+			pi_camera_pre_roll_buffer_read(pre_roll, 0, nal_units, pre_roll->buffer_size);
+
+			capture->replay_size = pre_roll->buffer_size;
+			capture->is_started  = true;
+		}
+	}
+	else
+		return;
+
+	pre_roll->condition.WakeAll();
+}
+bool       pi_camera_pre_roll_on_nal_unit(const AL::uint8* buffer, AL::uint32 size, void* param)
+{
+	auto pre_roll = reinterpret_cast<pi_camera_pre_roll*>(param);
+
+	AL::OS::MutexGuard lock(pre_roll->mutex);
+
+	if (pre_roll->is_stopping)
+		return false;
+
+	pi_camera_pre_roll_push(pre_roll, buffer, size);
+
+	if ((pre_roll->capture != nullptr) && !pre_roll->capture->is_ended)
+		pi_camera_pre_roll_capture_push(pre_roll, buffer, size);
+
+	return true;
+}
+// raspivid runs until the pre-roll stops, it is restarted if it fails
+void       pi_camera_pre_roll_thread_main(pi_camera_pre_roll* pre_roll)
+{
+	while (true)
+	{
+		AL::uint8 frame_rate;
+
+		{
+			AL::OS::MutexGuard lock(pre_roll->camera_local->mutex);
+
+			frame_rate = pre_roll->camera_local->config.video_frame_rate;
+		}
+
+		{
+			AL::OS::MutexGuard lock(pre_roll->mutex);
+
+			pre_roll->frame_rate = frame_rate;
+		}
+
+		// key frames every second keep the pre-roll close to pre_roll_seconds
+		pi_camera_cli_video_execute_stream(pre_roll->camera_local, 0, frame_rate, &pi_camera_pre_roll_on_nal_unit, pre_roll);
+
+		AL::OS::MutexGuard lock(pre_roll->mutex);
+
+		// a capture ends with whatever was recorded before raspivid stopped
+		if (pre_roll->capture != nullptr)
+		{
+			pre_roll->capture->is_ended = true;
+			pre_roll->condition.WakeAll();
+		}
+
+		// a new process may have been configured differently
+		pi_camera_pre_roll_clear(pre_roll);
+
+		if (!pre_roll->is_stopping)
+			pre_roll->condition.Sleep(pre_roll->mutex, AL::TimeSpan::FromMilliseconds(PI_CAMERA_RECORDING_RETRY_MS));
+
+		if (pre_roll->is_stopping)
+			break;
+	}
+}
+// @param pre_roll_mutex must be held
+void       pi_camera_pre_roll_delete(pi_camera_pre_roll* pre_roll)
+{
+	{
+		AL::OS::MutexGuard lock(pre_roll->mutex);
+
+		pre_roll->is_stopping = true;
+		pre_roll->condition.WakeAll();
+	}
+
+	try
+	{
+		while (!pre_roll->thread.Join())
+		{
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+	}
+
+	delete[] pre_roll->buffer;
+	delete pre_roll;
+}
+
+struct pi_camera_timelapse
+{
+	bool                        is_running  = false;
+	bool                        is_stopping = false;
+
+	pi_camera_local*            camera_local;
+	pi_camera_store*            store;
+	AL::OS::Thread*             thread      = nullptr;
+
+	AL::OS::Mutex               mutex;
+	AL::OS::ConditionalVariable condition;
+
+	// snapshot taken when the job started, only touched by thread
+	AL::String                  cli_params;
+	AL::uint32                  config_hash;
+	AL::uint32                  interval_ms;
+	AL::uint32                  count;
+	AL::uint64                  end_time_ms;
+};
+
+// @return false if stopped while waiting
+bool       pi_camera_timelapse_wait_ms(pi_camera_timelapse* timelapse, AL::OS::Timer& timer, AL::uint64 time_ms)
+{
+	AL::OS::MutexGuard lock(timelapse->mutex);
+
+	for (AL::uint64 elapsed_ms; !timelapse->is_stopping && ((elapsed_ms = timer.GetElapsed().ToMilliseconds()) < time_ms); )
+		timelapse->condition.Sleep(timelapse->mutex, AL::TimeSpan::FromMilliseconds(time_ms - elapsed_ms));
+
+	return !timelapse->is_stopping;
+}
+// Waits for the camera until the next frame is due, the frame is skipped if it stays busy
+// @param next_frame_ms elapsed time on timer the next frame is due at
+void       pi_camera_timelapse_capture(pi_camera_timelapse* timelapse, AL::OS::Timer& timer, AL::uint64 next_frame_ms)
+{
+	AL::String cli_params;
+
+	while (!pi_camera_cli_begin(timelapse->camera_local, cli_params, false))
+	{
+		auto retry_ms = timer.GetElapsed().ToMilliseconds() + PI_CAMERA_TIMELAPSE_BUSY_RETRY_MS;
+
+		if ((retry_ms >= next_frame_ms) || !pi_camera_timelapse_wait_ms(timelapse, timer, retry_ms))
+			return;
+	}
+
+	// a camera runs one timelapse at a time
+	auto file_path  = AL::String::Format("%s/timelapse.jpg", timelapse->store->directory.GetCString());
+	auto error_code = pi_camera_cli_execute_still(timelapse->camera_local, timelapse->cli_params, file_path.GetCString());
+
+	pi_camera_cli_end(timelapse->camera_local);
+
+	if ((error_code != PI_CAMERA_ERROR_CODE_SUCCESS) || !pi_camera_store_add(timelapse->store, file_path.GetCString(), timelapse->config_hash))
+		pi_camera_file_delete(file_path.GetCString());
+}
+void       pi_camera_timelapse_thread_main(pi_camera_timelapse* timelapse)
+{
+	AL::OS::Timer timer;
+
+	for (AL::uint32 i = 0; (timelapse->count == 0) || (i < timelapse->count); ++i)
+	{
+		auto frame_ms = static_cast<AL::uint64>(i) * timelapse->interval_ms;
+
+		if (!pi_camera_timelapse_wait_ms(timelapse, timer, frame_ms))
+			break;
+
+		if ((timelapse->end_time_ms != 0) && (pi_camera_get_time_ms() >= timelapse->end_time_ms))
+			break;
+
+		pi_camera_timelapse_capture(timelapse, timer, frame_ms + timelapse->interval_ms);
+	}
+
+	AL::OS::MutexGuard lock(timelapse->mutex);
+
+	timelapse->is_running = false;
+}
+// Joins the job's thread
+// @param timelapse_mutex must be held
+void       pi_camera_timelapse_stop(pi_camera_timelapse* timelapse)
+{
+	if (timelapse->thread == nullptr)
+		return;
+
+	{
+		AL::OS::MutexGuard lock(timelapse->mutex);
+
+		timelapse->is_stopping = true;
+		timelapse->condition.WakeAll();
+	}
+
+	try
+	{
+		while (!timelapse->thread->Join())
+		{
+		}
+	}
+	catch (const AL::Exception& exception)
+	{
+	}
+
+	delete timelapse->thread;
+	timelapse->thread = nullptr;
+}
+// @param timelapse_mutex must be held
+void       pi_camera_timelapse_delete(pi_camera_timelapse* timelapse)
+{
+	pi_camera_timelapse_stop(timelapse);
+
+	delete timelapse;
+}
+#endif
+
+AL::uint8  pi_camera_cli_start_recording(pi_camera_local* camera_local, const char* directory, AL::uint32 segment_length_seconds, AL::uint64 disk_budget)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->recording_mutex);
+
+	if (camera_local->recording != nullptr)
+	{
+		{
+			AL::OS::MutexGuard recording_lock(camera_local->recording->mutex);
+
+			if (!camera_local->recording->is_stopping)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+		}
+
+		pi_camera_recording_delete(camera_local->recording);
+		camera_local->recording = nullptr;
+	}
+
+	if (directory == nullptr)
+		directory = PI_CAMERA_RECORDING_DIRECTORY;
+
+	if ((::mkdir(directory, 0755) == -1) && (errno != EEXIST))
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	auto recording = new pi_camera_recording();
+	recording->camera_local           = camera_local;
+	recording->directory              = directory;
+	recording->segment_length_seconds = AL::Math::Clamp<AL::uint32>(segment_length_seconds, 1, AL::Integer<AL::uint32>::Maximum);
+	recording->disk_budget            = disk_budget;
+	recording->writer.is_fragmented   = true;
+
+	pi_camera_recording_read_index(recording);
+
+	try
+	{
+		recording->thread.Start([recording]()
+		{
+			pi_camera_recording_thread_main(recording);
+		});
+	}
+	catch (const AL::Exception& exception)
+	{
+		delete recording;
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	camera_local->recording = recording;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_stop_recording(pi_camera_local* camera_local)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->recording_mutex);
+
+	if (camera_local->recording != nullptr)
+		pi_camera_recording_stop(camera_local->recording);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_get_recording_segments(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_recording_segment* values, AL::uint32* count)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->recording_mutex);
+
+	AL::uint32 segment_count = 0;
+
+	if (camera_local->recording != nullptr)
+	{
+		AL::OS::MutexGuard recording_lock(camera_local->recording->mutex);
+
+		for (auto& segment : camera_local->recording->segments)
+		{
+			if (((segment.start_time_ms + segment.duration_ms) < start_time_ms) || (segment.start_time_ms > end_time_ms))
+				continue;
+
+			if (segment_count < *count)
+				values[segment_count] = segment;
+
+			++segment_count;
+		}
+	}
+
+	AL::uint8 error_code = (segment_count > *count) ? PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL : PI_CAMERA_ERROR_CODE_SUCCESS;
+	*count               = segment_count;
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if the segment isn't indexed
+AL::uint8  pi_camera_cli_get_recording_segment_path(pi_camera_local* camera_local, AL::uint64 id, AL::String& file_path)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->recording_mutex);
+
+	if (camera_local->recording == nullptr)
+		return PI_CAMERA_ERROR_CODE_NOT_FOUND;
+
+	AL::OS::MutexGuard recording_lock(camera_local->recording->mutex);
+
+	for (auto& segment : camera_local->recording->segments)
+	{
+		if (segment.id != id)
+			continue;
+
+		file_path = pi_camera_recording_get_segment_path(camera_local->recording, id);
+
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+	}
+
+	return PI_CAMERA_ERROR_CODE_NOT_FOUND;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// @param on_progress_changed can be nullptr
+AL::uint8  pi_camera_cli_get_recording_segment(pi_camera_local* camera_local, AL::uint64 id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+{
+	AL::String segment_path;
+	AL::uint8  error_code;
+
+	if ((error_code = pi_camera_cli_get_recording_segment_path(camera_local, id, segment_path)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+		return error_code;
+
+	return pi_camera_file_copy(segment_path.GetCString(), file_path, on_progress_changed, param);
+}
+AL::uint8  pi_camera_cli_start_pre_roll(pi_camera_local* camera_local, AL::uint32 pre_roll_seconds, AL::uint32 buffer_size)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->pre_roll_mutex);
+
+	if (camera_local->pre_roll != nullptr)
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+	// buffer_size may come from a remote peer
+	auto buffer_capacity = AL::Math::Clamp<AL::size_t>(buffer_size, PI_CAMERA_PRE_ROLL_BUFFER_SIZE_MIN, PI_CAMERA_PRE_ROLL_BUFFER_SIZE_MAX);
+	auto buffer          = new (std::nothrow) AL::uint8[buffer_capacity];
+
+	if (buffer == nullptr)
+		return PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY;
+
+	auto pre_roll = new pi_camera_pre_roll();
+	pre_roll->camera_local     = camera_local;
+	pre_roll->pre_roll_seconds = pre_roll_seconds;
+	pre_roll->frame_rate       = PI_CAMERA_VIDEO_FRAME_RATE_MAX;
+	pre_roll->buffer_capacity  = buffer_capacity;
+	pre_roll->buffer           = buffer;
+
+	try
+	{
+		pre_roll->thread.Start([pre_roll]()
+		{
+			pi_camera_pre_roll_thread_main(pre_roll);
+		});
+	}
+	catch (const AL::Exception& exception)
+	{
+		delete[] pre_roll->buffer;
+		delete pre_roll;
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	camera_local->pre_roll = pre_roll;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_stop_pre_roll(pi_camera_local* camera_local)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->pre_roll_mutex);
+
+	if (camera_local->pre_roll != nullptr)
+	{
+		pi_camera_pre_roll_delete(camera_local->pre_roll);
+		camera_local->pre_roll = nullptr;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// Captures run one at a time, the next one gets its own pre-roll
+// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if the pre-roll isn't running
+AL::uint8  pi_camera_cli_capture_pre_roll(pi_camera_local* camera_local, const char* file_path, AL::uint32 video_length_seconds)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->pre_roll_mutex);
+
+	auto pre_roll = camera_local->pre_roll;
+
+	if (pre_roll == nullptr)
+		return PI_CAMERA_ERROR_CODE_NOT_FOUND;
+
+	pi_camera_pre_roll_capture capture;
+	pi_camera_mp4_writer       writer;
+	writer.file_path = file_path;
+	// swapped with capture.nal_units so each batch is written outside the pre-roll mutex
+	pi_camera_packet_buffer    nal_units;
+	AL::uint32                 sample_count_end = AL::Integer<AL::uint32>::Maximum;
+	AL::uint8                  frame_rate;
+
+	pre_roll->mutex.Lock();
+
+	capture.frame_count = video_length_seconds * pre_roll->frame_rate;
+	pre_roll->capture   = &capture;
+
+	for (bool is_complete = false; !is_complete; )
+	{
+		while (!capture.is_ended && (capture.nal_units_size == 0))
+			pre_roll->condition.Sleep(pre_roll->mutex);
+
+		if (capture.nal_units_size == 0)
+			break;
+
+		auto nal_units_size = capture.nal_units_size;
+		auto replay_size    = capture.replay_size;
+		auto queued         = AL::Move(capture.nal_units);
+		capture.nal_units      = AL::Move(nal_units);
+		capture.nal_units_size = 0;
+		capture.replay_size    = 0;
+		nal_units              = AL::Move(queued);
+
+		pre_roll->mutex.Unlock();
+
+		for (AL::size_t offset = 0; !is_complete && (offset < nal_units_size); )
+		{
+			AL::uint32 size;
+			::memcpy(&size, &nal_units[offset], sizeof(AL::uint32));
+
+			pi_camera_mp4_writer_on_nal_unit(&nal_units[offset + sizeof(AL::uint32)], size, &writer);
+
+			if ((offset += sizeof(AL::uint32) + size) == replay_size)
+				sample_count_end = static_cast<AL::uint32>(writer.sample_sizes.GetSize()) + capture.frame_count;
+
+			is_complete = (writer.error_code != PI_CAMERA_ERROR_CODE_SUCCESS) || (writer.sample_sizes.GetSize() >= sample_count_end);
+		}
+
+		pre_roll->mutex.Lock();
+	}
+
+	pre_roll->capture = nullptr;
+	frame_rate        = pre_roll->frame_rate;
+
+	pre_roll->mutex.Unlock();
+
+	auto error_code = writer.error_code;
+
+	if (error_code == PI_CAMERA_ERROR_CODE_SUCCESS)
+		error_code = pi_camera_mp4_writer_write_moov(writer, frame_rate);
+
+	if (writer.file != -1)
+	{
+		if ((::close(writer.file) == -1) && (error_code == PI_CAMERA_ERROR_CODE_SUCCESS))
+			error_code = PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR;
+
+		if (error_code != PI_CAMERA_ERROR_CODE_SUCCESS)
+			::unlink(file_path);
+	}
+
+	return error_code;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_start_timelapse(pi_camera_local* camera_local, AL::uint32 interval_ms, AL::uint32 count, AL::uint64 end_time_ms)
+{
+#if defined(AL_PLATFORM_LINUX)
+	auto store = pi_camera_cli_store_open(camera_local);
+
+	if (store == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	AL::OS::MutexGuard lock(camera_local->timelapse_mutex);
+
+	if (camera_local->timelapse == nullptr)
+		camera_local->timelapse = new pi_camera_timelapse();
+
+	auto timelapse = camera_local->timelapse;
+
+	{
+		AL::OS::MutexGuard timelapse_lock(timelapse->mutex);
+
+		if (timelapse->is_running)
+			return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+	}
+
+	// the previous job already ended
+	pi_camera_timelapse_stop(timelapse);
+
+	{
+		AL::OS::MutexGuard camera_lock(camera_local->mutex);
+
+		timelapse->cli_params  = camera_local->cli_params;
+		timelapse->config_hash = pi_camera_config_get_hash(camera_local->config);
+	}
+
+	timelapse->is_running   = true;
+	timelapse->is_stopping  = false;
+	timelapse->camera_local = camera_local;
+	timelapse->store        = store;
+	timelapse->interval_ms  = interval_ms;
+	timelapse->count        = count;
+	timelapse->end_time_ms  = end_time_ms;
+	timelapse->thread       = new AL::OS::Thread();
+
+	try
+	{
+		timelapse->thread->Start([timelapse]()
+		{
+			pi_camera_timelapse_thread_main(timelapse);
+		});
+	}
+	catch (const AL::Exception& exception)
+	{
+		delete timelapse->thread;
+		timelapse->thread     = nullptr;
+		timelapse->is_running = false;
+
+		return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_stop_timelapse(pi_camera_local* camera_local)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->timelapse_mutex);
+
+	if (camera_local->timelapse != nullptr)
+		pi_camera_timelapse_stop(camera_local->timelapse);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8  pi_camera_cli_get_captures(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_capture_info* values, AL::uint32* count)
+{
+#if defined(AL_PLATFORM_LINUX)
+	auto store = pi_camera_cli_store_open(camera_local);
+
+	if (store == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	if (!pi_camera_store_list(store, start_time_ms, end_time_ms, values, *count))
+		return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// Hands every stored capture from start_time_ms to end_time_ms to on_capture, oldest first
+// @param on_capture anything but PI_CAMERA_ERROR_CODE_SUCCESS stops at that capture
+AL::uint8  pi_camera_cli_execute_captures(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_cli_on_capture on_capture, void* param)
+{
+#if defined(AL_PLATFORM_LINUX)
+	auto store = pi_camera_cli_store_open(camera_local);
+
+	if (store == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	AL::Collections::Array<pi_camera_capture_info> values;
+	AL::uint32                                     count = 0;
+
+	// captures may be stored between counting and listing them
+	while (!pi_camera_store_list(store, start_time_ms, end_time_ms, (count != 0) ? &values[0] : nullptr, count))
+		values.SetCapacity(count);
+
+	for (AL::uint32 i = 0; i < count; ++i)
+	{
+		AL::uint8 error_code;
+
+		if ((error_code = on_capture(values[i], pi_camera_store_get_file_path(store->directory.GetCString(), values[i].timestamp_ms).GetCString(), param)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+			return error_code;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+
+struct pi_camera_cli_fetch_captures_context
+{
+	const char*                                  directory;
+	AL::uint64                                   timestamp_ms;
+	pi_camera_fetch_captures_on_progress_changed on_progress_changed;
+	void*                                        param;
+};
+
+void       pi_camera_cli_fetch_captures_on_progress_changed(AL::uint64 file_size, AL::uint64 number_of_bytes_copied, void* param)
+{
+	auto context = reinterpret_cast<pi_camera_cli_fetch_captures_context*>(param);
+
+	context->on_progress_changed(context->timestamp_ms, file_size, number_of_bytes_copied, context->param);
+}
+AL::uint8  pi_camera_cli_fetch_captures_on_capture(const pi_camera_capture_info& capture, const char* file_path, void* param)
+{
+	auto context = reinterpret_cast<pi_camera_cli_fetch_captures_context*>(param);
+
+	context->timestamp_ms = capture.timestamp_ms;
+
+	auto error_code = pi_camera_file_copy(file_path, pi_camera_store_get_file_path(context->directory, capture.timestamp_ms).GetCString(), (context->on_progress_changed != nullptr) ? &pi_camera_cli_fetch_captures_on_progress_changed : nullptr, context);
+
+	// deleted since it was listed
+	if (error_code == PI_CAMERA_ERROR_CODE_NOT_FOUND)
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	return error_code;
+}
+// @param on_progress_changed can be nullptr
+AL::uint8  pi_camera_cli_fetch_captures(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, const char* directory, pi_camera_fetch_captures_on_progress_changed on_progress_changed, void* param)
+{
+	pi_camera_cli_fetch_captures_context context =
+	{
+		.directory           = directory,
+		.timestamp_ms        = 0,
+		.on_progress_changed = on_progress_changed,
+		.param               = param
+	};
+
+	return pi_camera_cli_execute_captures(camera_local, start_time_ms, end_time_ms, &pi_camera_cli_fetch_captures_on_capture, &context);
+}
+// @param count can be nullptr, set to the number of captures deleted
+AL::uint8  pi_camera_cli_delete_captures(pi_camera_local* camera_local, AL::uint64 start_time_ms, AL::uint64 end_time_ms, AL::uint32* count)
+{
+#if defined(AL_PLATFORM_LINUX)
+	auto store = pi_camera_cli_store_open(camera_local);
+
+	if (store == nullptr)
+		return PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR;
+
+	auto capture_count = pi_camera_store_delete(store, start_time_ms, end_time_ms);
+
+	if (count != nullptr)
+		*count = capture_count;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+// Applies to the open store right away, captures beyond the new budget are deleted
+AL::uint8  pi_camera_cli_set_store_budget(pi_camera_local* camera_local, AL::uint64 size_max, AL::uint32 capture_count_max)
+{
+#if defined(AL_PLATFORM_LINUX)
+	AL::OS::MutexGuard lock(camera_local->store_mutex);
+
+	camera_local->store_size_max          = size_max;
+	camera_local->store_capture_count_max = capture_count_max;
+
+	if (camera_local->store != nullptr)
+		pi_camera_store_set_budget(camera_local->store, size_max, capture_count_max);
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+
+void      pi_camera_cli_video_build_params_append_bit_rate(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-b", camera_config.video_bit_rate);
+}
+void      pi_camera_cli_video_build_params_append_frame_rate(AL::StringBuilder& sb, const pi_camera_config& camera_config)
+{
+	pi_camera_cli_build_params_append(sb, "-fps", camera_config.video_frame_rate);
+}
+void      pi_camera_cli_video_build_params(pi_camera_local* camera_local)
+{
+	// https://www.raspberrypi.org/app/uploads/2013/07/RaspiCam-Documentation.pdf
+
+	AL::StringBuilder sb;
+
+	pi_camera_cli_build_params_append_ev(sb, camera_local->config);
+	pi_camera_cli_build_params_append_iso(sb, camera_local->config);
+	pi_camera_cli_build_params_append_contrast(sb, camera_local->config);
+	pi_camera_cli_build_params_append_sharpness(sb, camera_local->config);
+	pi_camera_cli_build_params_append_brightness(sb, camera_local->config);
+	pi_camera_cli_build_params_append_white_balance(sb, camera_local->config);
+	pi_camera_cli_build_params_append_exposure_mode(sb, camera_local->config);
+	pi_camera_cli_build_params_append_metoring_mode(sb, camera_local->config);
+	pi_camera_cli_build_params_append_image_effect(sb, camera_local->config);
+	pi_camera_cli_build_params_append_image_rotation(sb, camera_local->config);
+
+	pi_camera_cli_video_build_params_append_bit_rate(sb, camera_local->config);
+	pi_camera_cli_video_build_params_append_frame_rate(sb, camera_local->config);
+
+	camera_local->cli_params_video = sb.ToString();
+}
+
+constexpr pi_camera_error_string pi_camera_error_strings[PI_CAMERA_ERROR_CODE_COUNT] =
+{
+	{ PI_CAMERA_ERROR_CODE_SUCCESS,                  "Success" },
+	{ PI_CAMERA_ERROR_CODE_DNS_FAILED,               "DNS failed" },
+	{ PI_CAMERA_ERROR_CODE_CAMERA_BUSY,              "Camera busy" },
+	{ PI_CAMERA_ERROR_CODE_CAMERA_FAILED,            "Camera failed" },
+	{ PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR,          "File open error" },
+	{ PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR,          "File stat error" },
+	{ PI_CAMERA_ERROR_CODE_FILE_READ_ERROR,          "File read error" },
+	{ PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR,         "File write error" },
+	{ PI_CAMERA_ERROR_CODE_THREAD_START_FAILED,      "Thread start failed" },
+	{ PI_CAMERA_ERROR_CODE_CONNECTION_FAILED,        "Connection failed" },
+	{ PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED,        "Connection closed" },
+	{ PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED, "Connection listen failed" },
+	{ PI_CAMERA_ERROR_CODE_UNDEFINED,                "Undefined" },
+	{ PI_CAMERA_ERROR_CODE_NOT_SUPPORTED,            "Not supported" },
+	{ PI_CAMERA_ERROR_CODE_PENDING,                  "Pending" },
+	{ PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL,         "Buffer too small" },
+	{ PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY,            "Out of memory" },
+	{ PI_CAMERA_ERROR_CODE_NOT_FOUND,                "Not found" },
+	{ PI_CAMERA_ERROR_CODE_CORRUPT_DATA,             "Corrupt data" }
+};
+
+template<AL::size_t ... INDEXES>
+constexpr bool pi_camera_error_strings_is_valid(AL::Index_Sequence<INDEXES ...>)
+{
+	return ((pi_camera_error_strings[INDEXES].code == INDEXES) && ...);
+}
+
+static_assert(pi_camera_error_strings_is_valid(typename AL::Make_Index_Sequence<PI_CAMERA_ERROR_CODE_COUNT>::Type {}));
+
+bool      PI_CAMERA_API_CALL pi_camera_get_error_string(const char** value, AL::uint8 error_code)
+{
+	if (error_code >= PI_CAMERA_ERROR_CODE_COUNT)
+		return false;
+
+	*value = pi_camera_error_strings[error_code].string;
+
+	return true;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_open(pi_camera** camera)
+{
+	*camera = new pi_camera_local();
+
+	pi_camera_cli_build_params(static_cast<pi_camera_local*>(*camera));
+	pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(*camera));
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_open_remote(pi_camera** camera, const char* remote_host, AL::uint16 remote_port)
+{
+	AL::Network::IPEndPoint remote_end_point;
+
+	if (!pi_camera_net_socket_resolve_end_point(remote_end_point, remote_host, remote_port))
+		return PI_CAMERA_ERROR_CODE_DNS_FAILED;
+
+	auto camera_remote = new pi_camera_remote(AL::Move(remote_end_point));
+
+	*camera = camera_remote;
+
+	if (!pi_camera_net_socket_connect(camera_remote->connection.socket, camera_remote->remote_end_point))
+	{
+		delete *camera;
+
+		return PI_CAMERA_ERROR_CODE_CONNECTION_FAILED;
+	}
+
+	switch (pi_camera_net_begin_hello(camera_remote->connection))
+	{
+		case PI_CAMERA_ERROR_CODE_SUCCESS:
+			break;
+
+		// services that predate the handshake drop the connection on unknown opcodes
+		case PI_CAMERA_ERROR_CODE_NOT_SUPPORTED:
+			camera_remote->connection.protocol_version = PI_CAMERA_PROTOCOL_VERSION_1;
+			camera_remote->connection.capabilities     = pi_camera_capabilities_from_protocol_version(PI_CAMERA_PROTOCOL_VERSION_1);
+
+			pi_camera_net_socket_close(camera_remote->connection.socket);
+
+			if (!pi_camera_net_socket_connect(camera_remote->connection.socket, camera_remote->remote_end_point))
+			{
+				delete *camera;
+
+				return PI_CAMERA_ERROR_CODE_CONNECTION_FAILED;
+			}
+			break;
+
+		default:
+			delete *camera;
+
+			return PI_CAMERA_ERROR_CODE_CONNECTION_FAILED;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_open_service(pi_camera** camera, const char* local_host, AL::uint16 local_port, AL::uint32 max_connections)
+{
+	return pi_camera_open_service_ex(camera, local_host, local_port, max_connections, PI_CAMERA_SERVICE_WORKER_COUNT_DEFAULT);
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_open_service_ex(pi_camera** camera, const char* local_host, AL::uint16 local_port, AL::uint32 max_connections, AL::uint32 worker_count)
+{
+	AL::Network::IPEndPoint local_end_point;
+
+	if (!pi_camera_net_socket_resolve_end_point(local_end_point, local_host, local_port))
+		return PI_CAMERA_ERROR_CODE_DNS_FAILED;
+
+	*camera = new pi_camera_service(AL::Move(local_end_point), max_connections, worker_count);
+
+	pi_camera_cli_build_params(&static_cast<pi_camera_service*>(*camera)->local);
+	pi_camera_cli_video_build_params(&static_cast<pi_camera_service*>(*camera)->local);
+
+	AL::uint8 error_code;
+
+	if ((error_code = pi_camera_service_start(static_cast<pi_camera_service*>(*camera))) != PI_CAMERA_ERROR_CODE_SUCCESS)
+	{
+		delete *camera;
+
+		return error_code;
+	}
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+AL::uint8                    pi_camera_open_session(pi_camera_session** camera_session, pi_camera_service* camera_service, AL::Network::TcpSocket&& socket)
+{
+	*camera_session = new pi_camera_session(camera_service, AL::Move(socket));
+
+	AL::OS::MutexGuard lock(camera_service->transfer_stats_mutex);
+	(*camera_session)->connection.transfer_tuning.chunk_size_min = camera_service->file_chunk_size_min;
+	(*camera_session)->connection.transfer_tuning.chunk_size_max = camera_service->file_chunk_size_max;
+	(*camera_session)->connection.receive_size_max               = PI_CAMERA_SERVICE_REQUEST_SIZE_MAX;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+}
+void      pi_camera_capture_async_cancel(pi_camera_async* async);
+
+void      PI_CAMERA_API_CALL pi_camera_close(pi_camera* camera)
+{
+	// the async outlives its camera, it completes here so pi_camera_poll and pi_camera_async_close never touch the camera again
+	if (camera->async != nullptr)
+		pi_camera_capture_async_cancel(camera->async);
+
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+#if defined(AL_PLATFORM_LINUX)
+			if (static_cast<pi_camera_local*>(camera)->recording != nullptr)
+				pi_camera_recording_delete(static_cast<pi_camera_local*>(camera)->recording);
+
+			if (static_cast<pi_camera_local*>(camera)->pre_roll != nullptr)
+				pi_camera_pre_roll_delete(static_cast<pi_camera_local*>(camera)->pre_roll);
+
+			if (static_cast<pi_camera_local*>(camera)->timelapse != nullptr)
+				pi_camera_timelapse_delete(static_cast<pi_camera_local*>(camera)->timelapse);
+
+			if (static_cast<pi_camera_local*>(camera)->store != nullptr)
+				pi_camera_store_close(static_cast<pi_camera_local*>(camera)->store);
+
+			pi_camera_cli_still_worker_stop(static_cast<pi_camera_local*>(camera));
+#endif
+			break;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			pi_camera_net_socket_close(static_cast<pi_camera_remote*>(camera)->connection.socket);
+			break;
+
+		case PI_CAMERA_TYPE_SERVICE:
+			pi_camera_service_stop(static_cast<pi_camera_service*>(camera));
+			pi_camera_service_capture_cache_clear(static_cast<pi_camera_service*>(camera));
+			pi_camera_service_expire_transfers(static_cast<pi_camera_service*>(camera), 0);
+#if defined(AL_PLATFORM_LINUX)
+			if (static_cast<pi_camera_service*>(camera)->local.recording != nullptr)
+				pi_camera_recording_delete(static_cast<pi_camera_service*>(camera)->local.recording);
+
+			if (static_cast<pi_camera_service*>(camera)->local.pre_roll != nullptr)
+				pi_camera_pre_roll_delete(static_cast<pi_camera_service*>(camera)->local.pre_roll);
+
+			if (static_cast<pi_camera_service*>(camera)->local.timelapse != nullptr)
+				pi_camera_timelapse_delete(static_cast<pi_camera_service*>(camera)->local.timelapse);
+
+			if (static_cast<pi_camera_service*>(camera)->local.store != nullptr)
+				pi_camera_store_close(static_cast<pi_camera_service*>(camera)->local.store);
+
+			pi_camera_cli_still_worker_stop(&static_cast<pi_camera_service*>(camera)->local);
+#endif
+			break;
+
+		case PI_CAMERA_TYPE_SESSION:
+			break;
+	}
+
+	delete camera;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_is_busy(pi_camera* camera, bool* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->is_busy;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_is_busy(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_is_busy(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_is_busy(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+bool      PI_CAMERA_API_CALL pi_camera_is_remote(pi_camera* camera)
+{
+	return camera->type == PI_CAMERA_TYPE_REMOTE;
+}
+bool      PI_CAMERA_API_CALL pi_camera_is_service(pi_camera* camera)
+{
+	return camera->type == PI_CAMERA_TYPE_SERVICE;
+}
+bool                         pi_camera_is_session(pi_camera* camera)
+{
+	return camera->type == PI_CAMERA_TYPE_SESSION;
+}
+bool      PI_CAMERA_API_CALL pi_camera_is_connected(pi_camera* camera)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			return false;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			return static_cast<pi_camera_remote*>(camera)->connection.socket.IsConnected();
+
+		case PI_CAMERA_TYPE_SERVICE:
+			return false;
+
+		case PI_CAMERA_TYPE_SESSION:
+			return static_cast<pi_camera_session*>(camera)->connection.socket.IsConnected();
+	}
+
+	return false;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_ev(pi_camera* camera, AL::int8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.ev;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_ev(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_ev(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_ev(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_ev(pi_camera* camera, AL::int8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.ev = pi_camera_clamp_ev(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_ev(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_ev(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_ev(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_iso(pi_camera* camera, AL::uint16* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.iso;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_iso(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_iso(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_iso(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_iso(pi_camera* camera, AL::uint16 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.iso = pi_camera_clamp_iso(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_iso(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_iso(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_iso(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_config(pi_camera* camera, pi_camera_config* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_config(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_config(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_config(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_config(pi_camera* camera, const pi_camera_config* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.ev                = pi_camera_clamp_ev(value->ev);
+			static_cast<pi_camera_local*>(camera)->config.iso               = pi_camera_clamp_iso(value->iso);
+			static_cast<pi_camera_local*>(camera)->config.contrast          = pi_camera_clamp_contrast(value->contrast);
+			static_cast<pi_camera_local*>(camera)->config.sharpness         = pi_camera_clamp_sharpness(value->sharpness);
+			static_cast<pi_camera_local*>(camera)->config.brightness        = pi_camera_clamp_brightness(value->brightness);
+			static_cast<pi_camera_local*>(camera)->config.saturation        = pi_camera_clamp_saturation(value->saturation);
+			static_cast<pi_camera_local*>(camera)->config.white_balance     = value->white_balance;
+			static_cast<pi_camera_local*>(camera)->config.shutter_speed_us  = pi_camera_clamp_shutter_speed(value->shutter_speed_us);
+			static_cast<pi_camera_local*>(camera)->config.exposure_mode     = value->exposure_mode;
+			static_cast<pi_camera_local*>(camera)->config.metoring_mode     = value->metoring_mode;
+			static_cast<pi_camera_local*>(camera)->config.jpg_quality       = pi_camera_clamp_jpg_quality(value->jpg_quality);
+			static_cast<pi_camera_local*>(camera)->config.image_size_width  = pi_camera_clamp_image_size_width(value->image_size_width);
+			static_cast<pi_camera_local*>(camera)->config.image_size_height = pi_camera_clamp_image_size_height(value->image_size_height);
+			static_cast<pi_camera_local*>(camera)->config.image_effect      = value->image_effect;
+			static_cast<pi_camera_local*>(camera)->config.image_rotation    = pi_camera_clamp_image_rotation(value->image_rotation);
+			static_cast<pi_camera_local*>(camera)->config.video_bit_rate    = pi_camera_clamp_video_bit_rate(value->video_bit_rate);
+			static_cast<pi_camera_local*>(camera)->config.video_frame_rate  = pi_camera_clamp_video_frame_rate(value->video_frame_rate);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_config(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_config(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_config(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_properties(pi_camera* camera, pi_camera_property* values, AL::uint8 count)
+{
+	if (count == 0)
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+		{
+			for (AL::uint8 i = 0; i < count; ++i)
+				if (!pi_camera_config_get_property(static_cast<pi_camera_local*>(camera)->config, values[i]))
+					return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
+
+		case PI_CAMERA_TYPE_REMOTE:
+		{
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			if (static_cast<pi_camera_remote*>(camera)->connection.capabilities.features & PI_CAMERA_FEATURE_PROPERTIES)
+				return pi_camera_net_begin_get_properties(static_cast<pi_camera_remote*>(camera)->connection, values, count);
+
+			// services that predate the batch opcodes still answer with the whole config
+			pi_camera_config config;
+			AL::uint8        error_code;
+
+			if ((error_code = pi_camera_net_begin_get_config(static_cast<pi_camera_remote*>(camera)->connection, config)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+				return error_code;
+
+			for (AL::uint8 i = 0; i < count; ++i)
+				if (!pi_camera_config_get_property(config, values[i]))
+					return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_properties(&static_cast<pi_camera_service*>(camera)->local, values, count);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_properties(&static_cast<pi_camera_session*>(camera)->service->local, values, count);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_properties(pi_camera* camera, const pi_camera_property* values, AL::uint8 count)
+{
+	if (count == 0)
+		return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+		{
+			auto config = static_cast<pi_camera_local*>(camera)->config;
+
+			for (AL::uint8 i = 0; i < count; ++i)
+				if (!pi_camera_config_set_property(config, values[i]))
+					return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+			// clamps every value and rebuilds the cli params once
+			return pi_camera_set_config(camera, &config);
+		}
+
+		case PI_CAMERA_TYPE_REMOTE:
+		{
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			if (static_cast<pi_camera_remote*>(camera)->connection.capabilities.features & PI_CAMERA_FEATURE_PROPERTIES)
+				return pi_camera_net_begin_set_properties(static_cast<pi_camera_remote*>(camera)->connection, values, count);
+
+			// services that predate the batch opcodes take the whole config instead
+			// the get and set are separate requests, a change another client makes in between is overwritten
+			pi_camera_config config;
+			AL::uint8        error_code;
+
+			if ((error_code = pi_camera_net_begin_get_config(static_cast<pi_camera_remote*>(camera)->connection, config)) != PI_CAMERA_ERROR_CODE_SUCCESS)
+				return error_code;
+
+			for (AL::uint8 i = 0; i < count; ++i)
+				if (!pi_camera_config_set_property(config, values[i]))
+					return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+			return pi_camera_net_begin_set_config(static_cast<pi_camera_remote*>(camera)->connection, config);
+		}
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_properties(&static_cast<pi_camera_service*>(camera)->local, values, count);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_properties(&static_cast<pi_camera_session*>(camera)->service->local, values, count);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_contrast(pi_camera* camera, AL::int8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.contrast;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_contrast(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_contrast(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_contrast(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_contrast(pi_camera* camera, AL::int8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.contrast = pi_camera_clamp_contrast(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_contrast(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_contrast(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_contrast(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_sharpness(pi_camera* camera, AL::int8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.sharpness;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_sharpness(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_sharpness(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_sharpness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_sharpness(pi_camera* camera, AL::int8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.sharpness = pi_camera_clamp_sharpness(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_sharpness(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_sharpness(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_sharpness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_brightness(pi_camera* camera, AL::uint8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.brightness;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_brightness(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_brightness(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_brightness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_brightness(pi_camera* camera, AL::uint8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.brightness = pi_camera_clamp_brightness(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_brightness(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_brightness(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_brightness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_saturation(pi_camera* camera, AL::int8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.saturation;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_saturation(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_saturation(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_saturation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_saturation(pi_camera* camera, AL::int8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.saturation = pi_camera_clamp_saturation(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_saturation(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_saturation(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_saturation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_white_balance(pi_camera* camera, AL::uint8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.white_balance;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_white_balance(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_white_balance(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_white_balance(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_white_balance(pi_camera* camera, AL::uint8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.white_balance = value;
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_white_balance(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_white_balance(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_white_balance(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_shutter_speed(pi_camera* camera, AL::uint64* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.shutter_speed_us;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_shutter_speed(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_shutter_speed(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_shutter_speed(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_shutter_speed(pi_camera* camera, AL::uint64 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.shutter_speed_us = pi_camera_clamp_shutter_speed(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_shutter_speed(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_shutter_speed(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_shutter_speed(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_exposure_mode(pi_camera* camera, AL::uint8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.exposure_mode;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_exposure_mode(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_exposure_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_exposure_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_exposure_mode(pi_camera* camera, AL::uint8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.exposure_mode = value;
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_exposure_mode(static_cast<pi_camera_remote*>(camera)->connection, value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_exposure_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_exposure_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_metoring_mode(pi_camera* camera, AL::uint8* value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.metoring_mode;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_metoring_mode(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_metoring_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_metoring_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
 
-	camera_local->cli_params = sb.ToString();
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 pi_camera_cli_video_execute(pi_camera_local* camera_local, const char* file_path, AL::uint32 video_length_seconds)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_metoring_mode(pi_camera* camera, AL::uint8 value)
 {
-	if (camera_local->is_busy)
-		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
-
-	try
+	switch (camera->type)
 	{
-		AL::OS::Shell::Execute(
-			"raspivid",
-			AL::String::Format("%s -t %s -o \"%s.h264\"", camera_local->cli_params_video.GetCString(), AL::ToString(video_length_seconds * 1000).GetCString(), file_path)
-		);
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.metoring_mode = value;
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-		AL::OS::Shell::Execute(
-			"MP4Box",
-			AL::String::Format("-add \"%s.h264\" \"%s\"", file_path, file_path)
-		);
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-		AL::FileSystem::File::Delete(
-			AL::String::Format("%s.h264", file_path)
-		);
-	}
-	catch (const AL::Exception& exception)
-	{
+			return pi_camera_net_begin_set_metoring_mode(static_cast<pi_camera_remote*>(camera)->connection, value);
 
-		return PI_CAMERA_ERROR_CODE_CAMERA_FAILED;
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_metoring_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_metoring_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
-}
-void      pi_camera_cli_video_build_params_append_bit_rate(AL::StringBuilder& sb, const pi_camera_config& camera_config)
-{
-	pi_camera_cli_build_params_append(sb, "-b", camera_config.video_bit_rate);
-}
-void      pi_camera_cli_video_build_params_append_frame_rate(AL::StringBuilder& sb, const pi_camera_config& camera_config)
-{
-	pi_camera_cli_build_params_append(sb, "-fps", camera_config.video_frame_rate);
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-void      pi_camera_cli_video_build_params(pi_camera_local* camera_local)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_jpg_quality(pi_camera* camera, AL::uint8* value)
 {
-	// https://www.raspberrypi.org/app/uploads/2013/07/RaspiCam-Documentation.pdf
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.jpg_quality;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-	AL::StringBuilder sb;
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-	pi_camera_cli_build_params_append_ev(sb, camera_local->config);
-	pi_camera_cli_build_params_append_iso(sb, camera_local->config);
-	pi_camera_cli_build_params_append_contrast(sb, camera_local->config);
-	pi_camera_cli_build_params_append_sharpness(sb, camera_local->config);
-	pi_camera_cli_build_params_append_brightness(sb, camera_local->config);
-	pi_camera_cli_build_params_append_white_balance(sb, camera_local->config);
-	pi_camera_cli_build_params_append_exposure_mode(sb, camera_local->config);
-	pi_camera_cli_build_params_append_metoring_mode(sb, camera_local->config);
-	pi_camera_cli_build_params_append_image_effect(sb, camera_local->config);
-	pi_camera_cli_build_params_append_image_rotation(sb, camera_local->config);
+			return pi_camera_net_begin_get_jpg_quality(static_cast<pi_camera_remote*>(camera)->connection, *value);
 
-	pi_camera_cli_video_build_params_append_bit_rate(sb, camera_local->config);
-	pi_camera_cli_video_build_params_append_frame_rate(sb, camera_local->config);
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
 
-	camera_local->cli_params_video = sb.ToString();
-}
+			return pi_camera_get_jpg_quality(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
-constexpr pi_camera_error_string pi_camera_error_strings[PI_CAMERA_ERROR_CODE_COUNT] =
-{
-	{ PI_CAMERA_ERROR_CODE_SUCCESS,                  "Success" },
-	{ PI_CAMERA_ERROR_CODE_DNS_FAILED,               "DNS failed" },
-	{ PI_CAMERA_ERROR_CODE_CAMERA_BUSY,              "Camera busy" },
-	{ PI_CAMERA_ERROR_CODE_CAMERA_FAILED,            "Camera failed" },
-	{ PI_CAMERA_ERROR_CODE_FILE_OPEN_ERROR,          "File open error" },
-	{ PI_CAMERA_ERROR_CODE_FILE_STAT_ERROR,          "File stat error" },
-	{ PI_CAMERA_ERROR_CODE_FILE_READ_ERROR,          "File read error" },
-	{ PI_CAMERA_ERROR_CODE_FILE_WRITE_ERROR,         "File write error" },
-	{ PI_CAMERA_ERROR_CODE_THREAD_START_FAILED,      "Thread start failed" },
-	{ PI_CAMERA_ERROR_CODE_CONNECTION_FAILED,        "Connection failed" },
-	{ PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED,        "Connection closed" },
-	{ PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED, "Connection listen failed" },
-	{ PI_CAMERA_ERROR_CODE_UNDEFINED,                "Undefined" }
-};
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
 
-template<AL::size_t ... INDEXES>
-constexpr bool pi_camera_error_strings_is_valid(AL::Index_Sequence<INDEXES ...>)
-{
-	return ((pi_camera_error_strings[INDEXES].code == INDEXES) && ...);
+			return pi_camera_get_jpg_quality(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_jpg_quality(pi_camera* camera, AL::uint8 value)
+{
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.jpg_quality = pi_camera_clamp_jpg_quality(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-static_assert(pi_camera_error_strings_is_valid(typename AL::Make_Index_Sequence<PI_CAMERA_ERROR_CODE_COUNT>::Type {}));
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-bool      PI_CAMERA_API_CALL pi_camera_get_error_string(const char** value, AL::uint8 error_code)
-{
-	if (error_code >= PI_CAMERA_ERROR_CODE_COUNT)
-		return false;
+			return pi_camera_net_begin_set_jpg_quality(static_cast<pi_camera_remote*>(camera)->connection, value);
 
-	*value = pi_camera_error_strings[error_code].string;
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
 
-	return true;
-}
+			return pi_camera_set_jpg_quality(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_open(pi_camera** camera)
-{
-	*camera = new pi_camera_local();
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
 
-	pi_camera_cli_build_params(static_cast<pi_camera_local*>(*camera));
-	pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(*camera));
+			return pi_camera_set_jpg_quality(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_open_remote(pi_camera** camera, const char* remote_host, AL::uint16 remote_port)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_size(pi_camera* camera, AL::uint16* width, AL::uint16* height)
 {
-	AL::Network::IPEndPoint remote_end_point;
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*width  = static_cast<pi_camera_local*>(camera)->config.image_size_width;
+			*height = static_cast<pi_camera_local*>(camera)->config.image_size_height;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-	if (!pi_camera_net_socket_resolve_end_point(remote_end_point, remote_host, remote_port))
-		return PI_CAMERA_ERROR_CODE_DNS_FAILED;
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-	*camera = new pi_camera_remote(AL::Move(remote_end_point));
+			return pi_camera_net_begin_get_image_size(static_cast<pi_camera_remote*>(camera)->connection, *width, *height);
 
-	if (!pi_camera_net_socket_connect(static_cast<pi_camera_remote*>(*camera)->socket, static_cast<pi_camera_remote*>(*camera)->remote_end_point))
-	{
-		delete *camera;
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
 
-		return PI_CAMERA_ERROR_CODE_CONNECTION_FAILED;
+			return pi_camera_get_image_size(&static_cast<pi_camera_service*>(camera)->local, width, height);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_image_size(&static_cast<pi_camera_session*>(camera)->service->local, width, height);
+		}
 	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_open_service(pi_camera** camera, const char* local_host, AL::uint16 local_port, AL::uint32 max_connections)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_size(pi_camera* camera, AL::uint16 width, AL::uint16 height)
 {
-	AL::Network::IPEndPoint local_end_point;
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			static_cast<pi_camera_local*>(camera)->config.image_size_width  = pi_camera_clamp_image_size_width(width);
+			static_cast<pi_camera_local*>(camera)->config.image_size_height = pi_camera_clamp_image_size_height(height);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-	if (!pi_camera_net_socket_resolve_end_point(local_end_point, local_host, local_port))
-		return PI_CAMERA_ERROR_CODE_DNS_FAILED;
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-	*camera = new pi_camera_service(AL::Move(local_end_point), max_connections);
+			return pi_camera_net_begin_set_image_size(static_cast<pi_camera_remote*>(camera)->connection, width, height);
 
-	pi_camera_cli_build_params(&static_cast<pi_camera_service*>(*camera)->local);
-	pi_camera_cli_video_build_params(&static_cast<pi_camera_service*>(*camera)->local);
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
 
-	AL::uint8 error_code;
+			return pi_camera_set_image_size(&static_cast<pi_camera_service*>(camera)->local, width, height);
+		}
 
-	if ((error_code = pi_camera_service_start(static_cast<pi_camera_service*>(*camera))) != PI_CAMERA_ERROR_CODE_SUCCESS)
-	{
-		delete *camera;
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
 
-		return error_code;
+			return pi_camera_set_image_size(&static_cast<pi_camera_session*>(camera)->service->local, width, height);
+		}
 	}
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8                    pi_camera_open_session(pi_camera_session** camera_session, pi_camera_service* camera_service, AL::Network::TcpSocket&& socket)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_effect(pi_camera* camera, AL::uint8* value)
 {
-	*camera_session = new pi_camera_session(camera_service, AL::Move(socket));
+	switch (camera->type)
+	{
+		case PI_CAMERA_TYPE_LOCAL:
+			*value = static_cast<pi_camera_local*>(camera)->config.image_effect;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
-	return PI_CAMERA_ERROR_CODE_SUCCESS;
+		case PI_CAMERA_TYPE_REMOTE:
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_image_effect(static_cast<pi_camera_remote*>(camera)->connection, *value);
+
+		case PI_CAMERA_TYPE_SERVICE:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_image_effect(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
+
+		case PI_CAMERA_TYPE_SESSION:
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_image_effect(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
+	}
+
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-void      PI_CAMERA_API_CALL pi_camera_close(pi_camera* camera)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_effect(pi_camera* camera, AL::uint8 value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			break;
+			static_cast<pi_camera_local*>(camera)->config.image_effect = value;
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			pi_camera_net_socket_close(static_cast<pi_camera_remote*>(camera)->socket);
-			break;
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_image_effect(static_cast<pi_camera_remote*>(camera)->connection, value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			pi_camera_service_stop(static_cast<pi_camera_service*>(camera));
-			break;
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_image_effect(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			break;
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_image_effect(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
-	delete camera;
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_is_busy(pi_camera* camera, bool* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_rotation(pi_camera* camera, AL::uint16* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->is_busy;
+			*value = static_cast<pi_camera_local*>(camera)->config.image_rotation;
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_is_busy(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_image_rotation(static_cast<pi_camera_remote*>(camera)->connection, *value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_is_busy(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_image_rotation(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_is_busy(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_image_rotation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-bool      PI_CAMERA_API_CALL pi_camera_is_remote(pi_camera* camera)
-{
-	return camera->type == PI_CAMERA_TYPE_REMOTE;
-}
-bool      PI_CAMERA_API_CALL pi_camera_is_service(pi_camera* camera)
-{
-	return camera->type == PI_CAMERA_TYPE_SERVICE;
-}
-bool                         pi_camera_is_session(pi_camera* camera)
-{
-	return camera->type == PI_CAMERA_TYPE_SESSION;
-}
-bool      PI_CAMERA_API_CALL pi_camera_is_connected(pi_camera* camera)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_rotation(pi_camera* camera, AL::uint16 value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			return false;
+			static_cast<pi_camera_local*>(camera)->config.image_rotation = pi_camera_clamp_image_rotation(value);
+			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
+			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return static_cast<pi_camera_remote*>(camera)->socket.IsConnected();
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_image_rotation(static_cast<pi_camera_remote*>(camera)->connection, value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return false;
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_image_rotation(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return static_cast<pi_camera_session*>(camera)->socket.IsConnected();
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_image_rotation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
-	return false;
+	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_ev(pi_camera* camera, AL::int8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_video_bit_rate(pi_camera* camera, AL::uint32* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.ev;
+			*value = static_cast<pi_camera_local*>(camera)->config.video_bit_rate;
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_ev(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_video_bit_rate(static_cast<pi_camera_remote*>(camera)->connection, *value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_ev(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_video_bit_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_ev(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_video_bit_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_ev(pi_camera* camera, AL::int8 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_video_bit_rate(pi_camera* camera, AL::uint32 value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.ev = pi_camera_clamp_ev(value);
+			static_cast<pi_camera_local*>(camera)->config.video_bit_rate = pi_camera_clamp_video_bit_rate(value);
 			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
 			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_ev(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_video_bit_rate(static_cast<pi_camera_remote*>(camera)->connection, value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_ev(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_video_bit_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_ev(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_video_bit_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_iso(pi_camera* camera, AL::uint16* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_video_frame_rate(pi_camera* camera, AL::uint8* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.iso;
+			*value = static_cast<pi_camera_local*>(camera)->config.video_frame_rate;
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_iso(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_video_frame_rate(static_cast<pi_camera_remote*>(camera)->connection, *value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_iso(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_get_video_frame_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_iso(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_get_video_frame_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_iso(pi_camera* camera, AL::uint16 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_video_frame_rate(pi_camera* camera, AL::uint8 value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.iso = pi_camera_clamp_iso(value);
+			static_cast<pi_camera_local*>(camera)->config.video_frame_rate = pi_camera_clamp_video_frame_rate(value);
 			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
 			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_iso(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_set_video_frame_rate(static_cast<pi_camera_remote*>(camera)->connection, value);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_iso(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->local.mutex);
+
+			return pi_camera_set_video_frame_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_iso(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_session*>(camera)->service->local.mutex);
+
+			return pi_camera_set_video_frame_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_config(pi_camera* camera, pi_camera_config* value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_execute(static_cast<pi_camera_local*>(camera), file_path);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_config(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture(static_cast<pi_camera_remote*>(camera)->connection, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_config(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture(&static_cast<pi_camera_service*>(camera)->local, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_config(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture(&static_cast<pi_camera_session*>(camera)->service->local, file_path, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_config(pi_camera* camera, const pi_camera_config* value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_burst(pi_camera* camera, const char* directory, AL::uint32 count, AL::uint32 interval_ms, pi_camera_capture_burst_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.ev                = pi_camera_clamp_ev(value->ev);
-			static_cast<pi_camera_local*>(camera)->config.iso               = pi_camera_clamp_iso(value->iso);
-			static_cast<pi_camera_local*>(camera)->config.contrast          = pi_camera_clamp_contrast(value->contrast);
-			static_cast<pi_camera_local*>(camera)->config.sharpness         = pi_camera_clamp_sharpness(value->sharpness);
-			static_cast<pi_camera_local*>(camera)->config.brightness        = pi_camera_clamp_brightness(value->brightness);
-			static_cast<pi_camera_local*>(camera)->config.saturation        = pi_camera_clamp_saturation(value->saturation);
-			static_cast<pi_camera_local*>(camera)->config.white_balance     = value->white_balance;
-			static_cast<pi_camera_local*>(camera)->config.shutter_speed_us  = pi_camera_clamp_shutter_speed(value->shutter_speed_us);
-			static_cast<pi_camera_local*>(camera)->config.exposure_mode     = value->exposure_mode;
-			static_cast<pi_camera_local*>(camera)->config.metoring_mode     = value->metoring_mode;
-			static_cast<pi_camera_local*>(camera)->config.jpg_quality       = pi_camera_clamp_jpg_quality(value->jpg_quality);
-			static_cast<pi_camera_local*>(camera)->config.image_size_width  = pi_camera_clamp_image_size_width(value->image_size_width);
-			static_cast<pi_camera_local*>(camera)->config.image_size_height = pi_camera_clamp_image_size_height(value->image_size_height);
-			static_cast<pi_camera_local*>(camera)->config.image_effect      = value->image_effect;
-			static_cast<pi_camera_local*>(camera)->config.image_rotation    = pi_camera_clamp_image_rotation(value->image_rotation);
-			static_cast<pi_camera_local*>(camera)->config.video_bit_rate    = pi_camera_clamp_video_bit_rate(value->video_bit_rate);
-			static_cast<pi_camera_local*>(camera)->config.video_frame_rate  = pi_camera_clamp_video_frame_rate(value->video_frame_rate);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_capture_burst(static_cast<pi_camera_local*>(camera), directory, count, interval_ms, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_config(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_burst(static_cast<pi_camera_remote*>(camera)->connection, directory, count, interval_ms, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_config(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_burst(&static_cast<pi_camera_service*>(camera)->local, directory, count, interval_ms, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_config(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_burst(&static_cast<pi_camera_session*>(camera)->service->local, directory, count, interval_ms, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_contrast(pi_camera* camera, AL::int8* value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.contrast;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_video_execute(static_cast<pi_camera_local*>(camera), file_path, video_length_seconds);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_contrast(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_video(static_cast<pi_camera_remote*>(camera)->connection, file_path, video_length_seconds, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_contrast(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_video(&static_cast<pi_camera_service*>(camera)->local, file_path, video_length_seconds, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_contrast(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_video(&static_cast<pi_camera_session*>(camera)->service->local, file_path, video_length_seconds, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_contrast(pi_camera* camera, AL::int8 value)
+
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_stream(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.contrast = pi_camera_clamp_contrast(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_execute(static_cast<pi_camera_local*>(camera), file_path);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_contrast(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_stream(static_cast<pi_camera_remote*>(camera)->connection, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_contrast(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_stream(&static_cast<pi_camera_service*>(camera)->local, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_contrast(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_stream(&static_cast<pi_camera_session*>(camera)->service->local, file_path, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_sharpness(pi_camera* camera, AL::int8* value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_to_buffer(pi_camera* camera, AL::uint8** buffer, AL::uint64* size, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.sharpness;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_execute_to_buffer(static_cast<pi_camera_local*>(camera), buffer, size, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_sharpness(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_to_buffer(static_cast<pi_camera_remote*>(camera)->connection, buffer, size, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_sharpness(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_to_buffer(&static_cast<pi_camera_service*>(camera)->local, buffer, size, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_sharpness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_to_buffer(&static_cast<pi_camera_session*>(camera)->service->local, buffer, size, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_sharpness(pi_camera* camera, AL::int8 value)
+void      PI_CAMERA_API_CALL pi_camera_free_buffer(AL::uint8* buffer)
+{
+	delete[] buffer;
+}
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video_stream(pi_camera* camera, AL::uint32 video_length_seconds, pi_camera_video_on_nal_unit on_nal_unit, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.sharpness = pi_camera_clamp_sharpness(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_video_execute_stream(static_cast<pi_camera_local*>(camera), video_length_seconds, 0, on_nal_unit, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_sharpness(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_video_stream(static_cast<pi_camera_remote*>(camera)->connection, video_length_seconds, on_nal_unit, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_sharpness(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_video_stream(&static_cast<pi_camera_service*>(camera)->local, video_length_seconds, on_nal_unit, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_sharpness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_video_stream(&static_cast<pi_camera_session*>(camera)->service->local, video_length_seconds, on_nal_unit, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_brightness(pi_camera* camera, AL::uint8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_preview(pi_camera* camera, pi_camera_preview_on_frame on_frame, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.brightness;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_execute_preview(static_cast<pi_camera_local*>(camera), on_frame, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_brightness(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_preview_stream(static_cast<pi_camera_remote*>(camera)->connection, on_frame, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_brightness(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_service_preview(static_cast<pi_camera_service*>(camera), on_frame, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_brightness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_service_preview(static_cast<pi_camera_session*>(camera)->service, on_frame, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_brightness(pi_camera* camera, AL::uint8 value)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_start_recording(pi_camera* camera, const char* directory, AL::uint32 segment_length_seconds, AL::uint64 disk_budget)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.brightness = pi_camera_clamp_brightness(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_start_recording(static_cast<pi_camera_local*>(camera), directory, segment_length_seconds, disk_budget);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_brightness(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_start_recording(static_cast<pi_camera_remote*>(camera)->connection, segment_length_seconds, disk_budget);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_brightness(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_start_recording(&static_cast<pi_camera_service*>(camera)->local, directory, segment_length_seconds, disk_budget);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_brightness(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_start_recording(&static_cast<pi_camera_session*>(camera)->service->local, directory, segment_length_seconds, disk_budget);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_saturation(pi_camera* camera, AL::int8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_recording(pi_camera* camera)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.saturation;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_stop_recording(static_cast<pi_camera_local*>(camera));
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_saturation(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_stop_recording(static_cast<pi_camera_remote*>(camera)->connection);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_saturation(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_stop_recording(&static_cast<pi_camera_service*>(camera)->local);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_saturation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_stop_recording(&static_cast<pi_camera_session*>(camera)->service->local);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_saturation(pi_camera* camera, AL::int8 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_recording_segments(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_recording_segment* values, AL::uint32* count)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.saturation = pi_camera_clamp_saturation(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_get_recording_segments(static_cast<pi_camera_local*>(camera), start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_saturation(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_recording_segments(static_cast<pi_camera_remote*>(camera)->connection, start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_saturation(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_get_recording_segments(&static_cast<pi_camera_service*>(camera)->local, start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_saturation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_get_recording_segments(&static_cast<pi_camera_session*>(camera)->service->local, start_time_ms, end_time_ms, values, count);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_white_balance(pi_camera* camera, AL::uint8* value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_recording_segment(pi_camera* camera, AL::uint64 id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.white_balance;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_get_recording_segment(static_cast<pi_camera_local*>(camera), id, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_white_balance(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_recording_segment(static_cast<pi_camera_remote*>(camera)->connection, id, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_white_balance(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_get_recording_segment(&static_cast<pi_camera_service*>(camera)->local, id, file_path, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_white_balance(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_get_recording_segment(&static_cast<pi_camera_session*>(camera)->service->local, id, file_path, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_white_balance(pi_camera* camera, AL::uint8 value)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_start_pre_roll(pi_camera* camera, AL::uint32 pre_roll_seconds, AL::uint32 buffer_size)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.white_balance = value;
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_start_pre_roll(static_cast<pi_camera_local*>(camera), pre_roll_seconds, buffer_size);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_white_balance(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_start_pre_roll(static_cast<pi_camera_remote*>(camera)->connection, pre_roll_seconds, buffer_size);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_white_balance(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_start_pre_roll(&static_cast<pi_camera_service*>(camera)->local, pre_roll_seconds, buffer_size);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_white_balance(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_start_pre_roll(&static_cast<pi_camera_session*>(camera)->service->local, pre_roll_seconds, buffer_size);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_shutter_speed(pi_camera* camera, AL::uint64* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_pre_roll(pi_camera* camera)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.shutter_speed_us;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_stop_pre_roll(static_cast<pi_camera_local*>(camera));
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_shutter_speed(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_stop_pre_roll(static_cast<pi_camera_remote*>(camera)->connection);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_shutter_speed(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_stop_pre_roll(&static_cast<pi_camera_service*>(camera)->local);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_shutter_speed(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_stop_pre_roll(&static_cast<pi_camera_session*>(camera)->service->local);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_shutter_speed(pi_camera* camera, AL::uint64 value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_pre_roll(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.shutter_speed_us = pi_camera_clamp_shutter_speed(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_capture_pre_roll(static_cast<pi_camera_local*>(camera), file_path, video_length_seconds);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_shutter_speed(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_capture_pre_roll(static_cast<pi_camera_remote*>(camera)->connection, file_path, video_length_seconds, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_shutter_speed(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_capture_pre_roll(&static_cast<pi_camera_service*>(camera)->local, file_path, video_length_seconds, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_shutter_speed(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_capture_pre_roll(&static_cast<pi_camera_session*>(camera)->service->local, file_path, video_length_seconds, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_exposure_mode(pi_camera* camera, AL::uint8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_start_timelapse(pi_camera* camera, AL::uint32 interval_ms, AL::uint32 count, AL::uint64 end_time_ms)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.exposure_mode;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_start_timelapse(static_cast<pi_camera_local*>(camera), interval_ms, count, end_time_ms);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_exposure_mode(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_start_timelapse(static_cast<pi_camera_remote*>(camera)->connection, interval_ms, count, end_time_ms);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_exposure_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_start_timelapse(&static_cast<pi_camera_service*>(camera)->local, interval_ms, count, end_time_ms);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_exposure_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_start_timelapse(&static_cast<pi_camera_session*>(camera)->service->local, interval_ms, count, end_time_ms);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_exposure_mode(pi_camera* camera, AL::uint8 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_timelapse(pi_camera* camera)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.exposure_mode = value;
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_stop_timelapse(static_cast<pi_camera_local*>(camera));
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_exposure_mode(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_stop_timelapse(static_cast<pi_camera_remote*>(camera)->connection);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_exposure_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_stop_timelapse(&static_cast<pi_camera_service*>(camera)->local);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_exposure_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_stop_timelapse(&static_cast<pi_camera_session*>(camera)->service->local);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_metoring_mode(pi_camera* camera, AL::uint8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_capture_info* values, AL::uint32* count)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.metoring_mode;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_get_captures(static_cast<pi_camera_local*>(camera), start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_metoring_mode(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_get_captures(static_cast<pi_camera_remote*>(camera)->connection, start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_metoring_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_get_captures(&static_cast<pi_camera_service*>(camera)->local, start_time_ms, end_time_ms, values, count);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_metoring_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_get_captures(&static_cast<pi_camera_session*>(camera)->service->local, start_time_ms, end_time_ms, values, count);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_metoring_mode(pi_camera* camera, AL::uint8 value)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_fetch_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, const char* directory, pi_camera_fetch_captures_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.metoring_mode = value;
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_fetch_captures(static_cast<pi_camera_local*>(camera), start_time_ms, end_time_ms, directory, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_metoring_mode(static_cast<pi_camera_remote*>(camera)->socket, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_fetch_captures(static_cast<pi_camera_remote*>(camera)->connection, start_time_ms, end_time_ms, directory, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_metoring_mode(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_fetch_captures(&static_cast<pi_camera_service*>(camera)->local, start_time_ms, end_time_ms, directory, on_progress_changed, param);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_metoring_mode(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_fetch_captures(&static_cast<pi_camera_session*>(camera)->service->local, start_time_ms, end_time_ms, directory, on_progress_changed, param);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_jpg_quality(pi_camera* camera, AL::uint8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_delete_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, AL::uint32* count)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.jpg_quality;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_delete_captures(static_cast<pi_camera_local*>(camera), start_time_ms, end_time_ms, count);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_jpg_quality(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+
+			return pi_camera_net_begin_delete_captures(static_cast<pi_camera_remote*>(camera)->connection, start_time_ms, end_time_ms, count);
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_jpg_quality(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_delete_captures(&static_cast<pi_camera_service*>(camera)->local, start_time_ms, end_time_ms, count);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_jpg_quality(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_delete_captures(&static_cast<pi_camera_session*>(camera)->service->local, start_time_ms, end_time_ms, count);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_jpg_quality(pi_camera* camera, AL::uint8 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_store_budget(pi_camera* camera, AL::uint64 size_max, AL::uint32 capture_count_max)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.jpg_quality = pi_camera_clamp_jpg_quality(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+			return pi_camera_cli_set_store_budget(static_cast<pi_camera_local*>(camera), size_max, capture_count_max);
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_jpg_quality(static_cast<pi_camera_remote*>(camera)->socket, value);
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_jpg_quality(&static_cast<pi_camera_service*>(camera)->local, value);
+			return pi_camera_set_store_budget(&static_cast<pi_camera_service*>(camera)->local, size_max, capture_count_max);
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_jpg_quality(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_set_store_budget(&static_cast<pi_camera_session*>(camera)->service->local, size_max, capture_count_max);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_size(pi_camera* camera, AL::uint16* width, AL::uint16* height)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_transfer_id(pi_camera* camera, AL::uint64* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*width  = static_cast<pi_camera_local*>(camera)->config.image_size_width;
-			*height = static_cast<pi_camera_local*>(camera)->config.image_size_height;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
-
-		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_image_size(static_cast<pi_camera_remote*>(camera)->socket, *width, *height);
-
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_image_size(&static_cast<pi_camera_service*>(camera)->local, width, height);
-
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_image_size(&static_cast<pi_camera_session*>(camera)->service->local, width, height);
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
+		case PI_CAMERA_TYPE_REMOTE:
+			*value = static_cast<pi_camera_remote*>(camera)->connection.transfer_id;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_size(pi_camera* camera, AL::uint16 width, AL::uint16 height)
+// @param on_progress_changed can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_resume_transfer(pi_camera* camera, AL::uint64 transfer_id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.image_size_width  = pi_camera_clamp_image_size_width(width);
-			static_cast<pi_camera_local*>(camera)->config.image_size_height = pi_camera_clamp_image_size_height(height);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		case PI_CAMERA_TYPE_SERVICE:
+		case PI_CAMERA_TYPE_SESSION:
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_image_size(static_cast<pi_camera_remote*>(camera)->socket, width, height);
+		{
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_image_size(&static_cast<pi_camera_service*>(camera)->local, width, height);
+			if (!(static_cast<pi_camera_remote*>(camera)->connection.capabilities.features & PI_CAMERA_FEATURE_RESUME_FILE_TRANSFER))
+				return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_image_size(&static_cast<pi_camera_session*>(camera)->service->local, width, height);
+			return pi_camera_net_begin_resume_file_transfer(static_cast<pi_camera_remote*>(camera)->connection, transfer_id, file_path, on_progress_changed, param);
+		}
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_effect(pi_camera* camera, AL::uint8* value)
+AL::uint8 pi_camera_capture_async_begin(pi_camera* camera, bool is_video, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, pi_camera_capture_on_complete on_complete, void* param, pi_camera_async** async)
 {
-	switch (camera->type)
+	auto camera_async = new pi_camera_async();
+	camera_async->camera               = camera;
+	camera_async->is_video             = is_video;
+	camera_async->file_path            = file_path;
+	camera_async->video_length_seconds = video_length_seconds;
+	camera_async->on_progress_changed  = on_progress_changed;
+	camera_async->on_complete          = on_complete;
+	camera_async->param                = param;
+
+	if (camera->async != nullptr)
 	{
-		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.image_effect;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		delete camera_async;
 
-		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_image_effect(static_cast<pi_camera_remote*>(camera)->socket, *value);
+		return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+	}
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_image_effect(&static_cast<pi_camera_service*>(camera)->local, value);
+	if (camera->type == PI_CAMERA_TYPE_REMOTE)
+	{
+		auto camera_remote = static_cast<pi_camera_remote*>(camera);
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_image_effect(&static_cast<pi_camera_session*>(camera)->service->local, value);
+		if (camera_remote->connection.is_pipelining)
+		{
+			delete camera_async;
+
+			return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
+		}
+
+		video_length_seconds = AL::BitConverter::HostToNetwork(video_length_seconds);
+
+		if (!(is_video ? pi_camera_net_send_request(camera_remote->connection, PI_CAMERA_OPCODE_CAPTURE_VIDEO, &video_length_seconds, sizeof(AL::uint32)) :
+			pi_camera_net_send_request(camera_remote->connection, PI_CAMERA_OPCODE_CAPTURE, nullptr, 0)))
+		{
+			delete camera_async;
+
+			return PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED;
+		}
 	}
+	else
+	{
+		camera_async->thread = new AL::OS::Thread();
 
-	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+		try
+		{
+			camera_async->thread->Start([camera_async]()
+			{
+				AL::uint8 error_code;
+
+				if (camera_async->is_video)
+					error_code = pi_camera_capture_video(camera_async->camera, camera_async->file_path.GetCString(), camera_async->video_length_seconds, nullptr, nullptr);
+				else
+					error_code = pi_camera_capture(camera_async->camera, camera_async->file_path.GetCString(), nullptr, nullptr);
+
+				AL::OS::MutexGuard lock(camera_async->thread_mutex);
+
+				camera_async->thread_error_code = error_code;
+				camera_async->is_thread_done    = true;
+				camera_async->thread_condition.WakeAll();
+			});
+		}
+		catch (const AL::Exception& exception)
+		{
+			delete camera_async->thread;
+			delete camera_async;
+
+			return PI_CAMERA_ERROR_CODE_THREAD_START_FAILED;
+		}
+	}
+
+	camera->async = camera_async;
+	*async        = camera_async;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_effect(pi_camera* camera, AL::uint8 value)
+void      pi_camera_capture_async_end(pi_camera_async* async, AL::uint8 error_code)
 {
-	switch (camera->type)
+	if (async->thread != nullptr)
 	{
-		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.image_effect = value;
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		try
+		{
+			while (!async->thread->Join())
+			{
+			}
+		}
+		catch (const AL::Exception& exception)
+		{
+		}
 
-		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_image_effect(static_cast<pi_camera_remote*>(camera)->socket, value);
+		delete async->thread;
+		async->thread = nullptr;
+	}
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_image_effect(&static_cast<pi_camera_service*>(camera)->local, value);
+	async->camera->async = nullptr;
+	async->state         = PI_CAMERA_ASYNC_STATE_COMPLETE;
+	async->error_code    = error_code;
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_image_effect(&static_cast<pi_camera_session*>(camera)->service->local, value);
+	if (async->on_complete != nullptr)
+		async->on_complete(error_code, async->param);
+}
+
+// @param on_progress_changed can be nullptr
+// @param on_complete can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_async(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, pi_camera_capture_on_complete on_complete, void* param, pi_camera_async** async)
+{
+	return pi_camera_capture_async_begin(camera, false, file_path, 0, on_progress_changed, on_complete, param, async);
+}
+// @param on_progress_changed can be nullptr
+// @param on_complete can be nullptr
+AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video_async(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, pi_camera_capture_on_complete on_complete, void* param, pi_camera_async** async)
+{
+	return pi_camera_capture_async_begin(camera, true, file_path, video_length_seconds, on_progress_changed, on_complete, param, async);
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_poll(pi_camera_async* async)
+{
+	if (async->state == PI_CAMERA_ASYNC_STATE_COMPLETE)
+		return async->error_code;
+
+	AL::uint8 error_code;
+
+	if (async->thread != nullptr)
+	{
+		AL::OS::MutexGuard lock(async->thread_mutex);
+
+		if (!async->is_thread_done)
+			return PI_CAMERA_ERROR_CODE_PENDING;
+
+		error_code = async->thread_error_code;
 	}
+	else if ((error_code = pi_camera_net_update_file_transfer_async(static_cast<pi_camera_remote*>(async->camera)->connection, async)) == PI_CAMERA_ERROR_CODE_PENDING)
+		return PI_CAMERA_ERROR_CODE_PENDING;
 
-	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+	pi_camera_capture_async_end(async, error_code);
+
+	return error_code;
 }
+AL::uint8 PI_CAMERA_API_CALL pi_camera_wait(pi_camera_async* async, AL::uint32 timeout_ms)
+{
+	AL::OS::Timer timer;
+	AL::uint8     error_code;
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_image_rotation(pi_camera* camera, AL::uint16* value)
+	while ((error_code = pi_camera_poll(async)) == PI_CAMERA_ERROR_CODE_PENDING)
+	{
+		auto elapsed_ms = timer.GetElapsed().ToMilliseconds();
+
+		if (elapsed_ms >= timeout_ms)
+			break;
+
+		auto remaining_ms = static_cast<AL::uint32>(timeout_ms - elapsed_ms);
+
+		if (async->thread != nullptr)
+		{
+			AL::OS::MutexGuard lock(async->thread_mutex);
+
+			if (!async->is_thread_done)
+				async->thread_condition.Sleep(async->thread_mutex, AL::TimeSpan::FromMilliseconds(remaining_ms));
+		}
+		else
+		{
+#if defined(AL_PLATFORM_LINUX)
+			pollfd socket_poll =
+			{
+				.fd      = static_cast<int>(static_cast<pi_camera_remote*>(async->camera)->connection.socket.GetHandle()),
+				.events  = POLLIN,
+				.revents = 0
+			};
+
+			::poll(&socket_poll, 1, static_cast<int>(AL::Math::Lowest<AL::uint32>(remaining_ms, AL::Integer<AL::int32>::Maximum)));
+#else
+			AL::OS::Sleep(AL::TimeSpan::FromMilliseconds(1));
+#endif
+		}
+	}
+
+	return error_code;
+}
+// Completes async with PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED if remote, a pending local capture is waited for
+void      pi_camera_capture_async_cancel(pi_camera_async* async)
 {
-	switch (camera->type)
+	if (async->thread != nullptr)
 	{
-		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.image_rotation;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		// the capture can't be interrupted
+		pi_camera_wait(async, AL::Integer<AL::uint32>::Maximum);
 
-		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_image_rotation(static_cast<pi_camera_remote*>(camera)->socket, *value);
+		return;
+	}
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_image_rotation(&static_cast<pi_camera_service*>(camera)->local, value);
+	// the rest of the transfer is still on the wire
+	pi_camera_net_socket_close(static_cast<pi_camera_remote*>(async->camera)->connection.socket);
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_image_rotation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+	if (async->file != nullptr)
+	{
+		pi_camera_file_close(async->file);
+		async->file = nullptr;
 	}
 
-	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+	pi_camera_capture_async_end(async, PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED);
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_image_rotation(pi_camera* camera, AL::uint16 value)
+void      PI_CAMERA_API_CALL pi_camera_async_close(pi_camera_async* async)
 {
-	switch (camera->type)
+	if (async->state != PI_CAMERA_ASYNC_STATE_COMPLETE)
 	{
-		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.image_rotation = pi_camera_clamp_image_rotation(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		if (async->thread != nullptr)
+		{
+			// the capture can't be interrupted
+			pi_camera_wait(async, AL::Integer<AL::uint32>::Maximum);
+		}
+		else
+		{
+			auto camera_remote = static_cast<pi_camera_remote*>(async->camera);
 
-		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_image_rotation(static_cast<pi_camera_remote*>(camera)->socket, value);
+			// the rest of the transfer is still on the wire
+			pi_camera_net_socket_close(camera_remote->connection.socket);
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_image_rotation(&static_cast<pi_camera_service*>(camera)->local, value);
+			if (async->file != nullptr)
+				pi_camera_file_close(async->file);
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_image_rotation(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			async->camera->async = nullptr;
+		}
 	}
 
-	return PI_CAMERA_ERROR_CODE_UNDEFINED;
+	delete async;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_video_bit_rate(pi_camera* camera, AL::uint32* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_transfer_stats(pi_camera* camera, pi_camera_transfer_stats* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.video_bit_rate;
-			return PI_CAMERA_ERROR_CODE_SUCCESS;
-
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_video_bit_rate(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_video_bit_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->transfer_stats_mutex);
+			*value = static_cast<pi_camera_service*>(camera)->transfer_stats;
+
+			{
+				AL::OS::MutexGuard lock_allocations(pi_camera_packet_buffer_allocations_mutex);
+
+				value->number_of_buffer_allocations = pi_camera_packet_buffer_allocations;
+			}
+
+#if defined(PI_CAMERA_COMPRESSION)
+			{
+				AL::OS::MutexGuard lock_compression_stats(pi_camera_compression_stats_mutex);
+
+				value->compression_bytes_in    = pi_camera_compression_bytes_in;
+				value->compression_bytes_out   = pi_camera_compression_bytes_out;
+				value->compression_cpu_time_us = pi_camera_compression_cpu_time_us;
+			}
+#endif
+
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_video_bit_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_get_transfer_stats(static_cast<pi_camera_session*>(camera)->service, value);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_video_bit_rate(pi_camera* camera, AL::uint32 value)
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_get_capabilities(pi_camera* camera, pi_camera_capabilities* value)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.video_bit_rate = pi_camera_clamp_video_bit_rate(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+		case PI_CAMERA_TYPE_SERVICE:
+			*value = PI_CAMERA_CAPABILITIES;
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_video_bit_rate(static_cast<pi_camera_remote*>(camera)->socket, value);
-
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_video_bit_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+			*value = static_cast<pi_camera_remote*>(camera)->connection.capabilities;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_video_bit_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			*value = static_cast<pi_camera_session*>(camera)->connection.capabilities;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-AL::uint8 PI_CAMERA_API_CALL pi_camera_get_video_frame_rate(pi_camera* camera, AL::uint8* value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_begin_pipeline(pi_camera* camera)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			*value = static_cast<pi_camera_local*>(camera)->config.video_frame_rate;
+		case PI_CAMERA_TYPE_SERVICE:
+		case PI_CAMERA_TYPE_SESSION:
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_get_video_frame_rate(static_cast<pi_camera_remote*>(camera)->socket, *value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_get_video_frame_rate(&static_cast<pi_camera_service*>(camera)->local, value);
-
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_get_video_frame_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_net_begin_pipeline(static_cast<pi_camera_remote*>(camera)->connection);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-AL::uint8 PI_CAMERA_API_CALL pi_camera_set_video_frame_rate(pi_camera* camera, AL::uint8 value)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_end_pipeline(pi_camera* camera)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			static_cast<pi_camera_local*>(camera)->config.video_frame_rate = pi_camera_clamp_video_frame_rate(value);
-			pi_camera_cli_build_params(static_cast<pi_camera_local*>(camera));
-			pi_camera_cli_video_build_params(static_cast<pi_camera_local*>(camera));
+		case PI_CAMERA_TYPE_SERVICE:
+		case PI_CAMERA_TYPE_SESSION:
 			return PI_CAMERA_ERROR_CODE_SUCCESS;
 
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_set_video_frame_rate(static_cast<pi_camera_remote*>(camera)->socket, value);
-
-		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_set_video_frame_rate(&static_cast<pi_camera_service*>(camera)->local, value);
+			if (camera->async != nullptr)
+				return PI_CAMERA_ERROR_CODE_CAMERA_BUSY;
 
-		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_set_video_frame_rate(&static_cast<pi_camera_session*>(camera)->service->local, value);
+			return pi_camera_net_end_pipeline(static_cast<pi_camera_remote*>(camera)->connection);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
 
-// @param on_progress_changed can be nullptr
-AL::uint8 PI_CAMERA_API_CALL pi_camera_capture(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_file_chunk_size(pi_camera* camera, AL::uint32 min, AL::uint32 max)
 {
+	if ((min == 0) || (min > max))
+		return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			return pi_camera_cli_execute(static_cast<pi_camera_local*>(camera), file_path);
-
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_capture(static_cast<pi_camera_remote*>(camera)->socket, file_path, on_progress_changed, param);
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_capture(&static_cast<pi_camera_service*>(camera)->local, file_path, on_progress_changed, param);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->transfer_stats_mutex);
+			static_cast<pi_camera_service*>(camera)->file_chunk_size_min = min;
+			static_cast<pi_camera_service*>(camera)->file_chunk_size_max = max;
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_capture(&static_cast<pi_camera_session*>(camera)->service->local, file_path, on_progress_changed, param);
+			return pi_camera_set_file_chunk_size(static_cast<pi_camera_session*>(camera)->service, min, max);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
-// @param on_progress_changed can be nullptr
-AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param)
+AL::uint8 PI_CAMERA_API_CALL pi_camera_set_capture_cache_window(pi_camera* camera, AL::uint32 milliseconds)
 {
 	switch (camera->type)
 	{
 		case PI_CAMERA_TYPE_LOCAL:
-			return pi_camera_cli_video_execute(static_cast<pi_camera_local*>(camera), file_path, video_length_seconds);
-
 		case PI_CAMERA_TYPE_REMOTE:
-			return pi_camera_net_begin_capture_video(static_cast<pi_camera_remote*>(camera)->socket, file_path, video_length_seconds, on_progress_changed, param);
+			return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
 
 		case PI_CAMERA_TYPE_SERVICE:
-			return pi_camera_capture_video(&static_cast<pi_camera_service*>(camera)->local, file_path, video_length_seconds, on_progress_changed, param);
+		{
+			AL::OS::MutexGuard lock(static_cast<pi_camera_service*>(camera)->capture_cache.mutex);
+			static_cast<pi_camera_service*>(camera)->capture_cache.window_ms = milliseconds;
+			pi_camera_service_capture_cache_release_unjoined(static_cast<pi_camera_service*>(camera)->capture_cache);
+			return PI_CAMERA_ERROR_CODE_SUCCESS;
+		}
 
 		case PI_CAMERA_TYPE_SESSION:
-			return pi_camera_capture_video(&static_cast<pi_camera_session*>(camera)->service->local, file_path, video_length_seconds, on_progress_changed, param);
+			return pi_camera_set_capture_cache_window(static_cast<pi_camera_session*>(camera)->service, milliseconds);
 	}
 
 	return PI_CAMERA_ERROR_CODE_UNDEFINED;
 }
+
+AL::uint8 PI_CAMERA_API_CALL pi_camera_compress(const void* buffer, AL::uint32 size, void* compressed_buffer, AL::uint32 compressed_buffer_size, AL::uint32* compressed_size)
+{
+#if defined(PI_CAMERA_COMPRESSION)
+	if ((*compressed_size = static_cast<AL::uint32>(pi_camera_lz4_compress(static_cast<const AL::uint8*>(buffer), size, static_cast<AL::uint8*>(compressed_buffer), compressed_buffer_size))) == 0)
+		return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
+AL::uint8 PI_CAMERA_API_CALL pi_camera_decompress(const void* compressed_buffer, AL::uint32 compressed_size, void* buffer, AL::uint32 size)
+{
+#if defined(PI_CAMERA_COMPRESSION)
+	if (!pi_camera_lz4_decompress(static_cast<const AL::uint8*>(compressed_buffer), compressed_size, static_cast<AL::uint8*>(buffer), size))
+		return PI_CAMERA_ERROR_CODE_CORRUPT_DATA;
+
+	return PI_CAMERA_ERROR_CODE_SUCCESS;
+#else
+	return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED;
+#endif
+}
@@ -12,6 +12,7 @@
 #endif
 
 struct pi_camera;
+struct pi_camera_async;
 
 enum PI_CAMERA_EV : AL::int8
 {
@@ -162,6 +163,21 @@ enum PI_CAMERA_VIDEO_FRAME_RATE : AL::uint8
 	PI_CAMERA_VIDEO_FRAME_RATE_MAX = 30
 };
 
+enum PI_CAMERA_SERVICE_WORKER_COUNT : AL::uint32
+{
+	PI_CAMERA_SERVICE_WORKER_COUNT_DEFAULT = 2
+};
+
+enum PI_CAMERA_STORE_SIZE : AL::uint64
+{
+	PI_CAMERA_STORE_SIZE_DEFAULT = 1000000000
+};
+
+enum PI_CAMERA_STORE_CAPTURE_COUNT : AL::uint32
+{
+	PI_CAMERA_STORE_CAPTURE_COUNT_DEFAULT = 10000
+};
+
 enum PI_CAMERA_ERROR_CODES : AL::uint8
 {
 	PI_CAMERA_ERROR_CODE_SUCCESS,
@@ -177,7 +193,15 @@ enum PI_CAMERA_ERROR_CODES : AL::uint8
 	PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED,
 	PI_CAMERA_ERROR_CODE_CONNECTION_LISTEN_FAILED,
 
-	PI_CAMERA_ERROR_CODE_UNDEFINED
+	PI_CAMERA_ERROR_CODE_UNDEFINED,
+
+	// error codes are sent to peers, new ones go after UNDEFINED so older peers keep reading it as before
+	PI_CAMERA_ERROR_CODE_NOT_SUPPORTED,
+	PI_CAMERA_ERROR_CODE_PENDING,
+	PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL,
+	PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY,
+	PI_CAMERA_ERROR_CODE_NOT_FOUND,
+	PI_CAMERA_ERROR_CODE_CORRUPT_DATA
 };
 
 #pragma pack(push, 1)
@@ -224,7 +248,122 @@ constexpr pi_camera_config PI_CAMERA_CONFIG_DEFAULT =
 	.video_frame_rate  = PI_CAMERA_VIDEO_FRAME_RATE_MAX
 };
 
+enum PI_CAMERA_PROPERTIES : AL::uint8
+{
+	PI_CAMERA_PROPERTY_EV,
+	PI_CAMERA_PROPERTY_ISO,
+	PI_CAMERA_PROPERTY_CONTRAST,
+	PI_CAMERA_PROPERTY_SHARPNESS,
+	PI_CAMERA_PROPERTY_BRIGHTNESS,
+	PI_CAMERA_PROPERTY_SATURATION,
+	PI_CAMERA_PROPERTY_WHITE_BALANCE,
+	PI_CAMERA_PROPERTY_SHUTTER_SPEED,
+	PI_CAMERA_PROPERTY_EXPOSURE_MODE,
+	PI_CAMERA_PROPERTY_METORING_MODE,
+	PI_CAMERA_PROPERTY_JPG_QUALITY,
+	// value is (width << 16) | height
+	PI_CAMERA_PROPERTY_IMAGE_SIZE,
+	PI_CAMERA_PROPERTY_IMAGE_EFFECT,
+	PI_CAMERA_PROPERTY_IMAGE_ROTATION,
+	PI_CAMERA_PROPERTY_VIDEO_BIT_RATE,
+	PI_CAMERA_PROPERTY_VIDEO_FRAME_RATE,
+
+	PI_CAMERA_PROPERTY_COUNT
+};
+
+#pragma pack(push, 1)
+struct pi_camera_property
+{
+	AL::uint8  id;
+	// signed values are sign extended
+	AL::uint64 value;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct pi_camera_recording_segment
+{
+	AL::uint64 id;
+	// milliseconds since the unix epoch
+	AL::uint64 start_time_ms;
+	AL::uint32 duration_ms;
+	AL::uint64 size;
+};
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+struct pi_camera_capture_info
+{
+	// milliseconds since the unix epoch, unique within the store
+	AL::uint64 timestamp_ms;
+	AL::uint64 size;
+	// hash of the config the image was captured with
+	AL::uint32 config_hash;
+};
+#pragma pack(pop)
+
+enum PI_CAMERA_FEATURES : AL::uint32
+{
+	// setters can be sent without waiting for their reply
+	PI_CAMERA_FEATURE_PIPELINE             = 0x1,
+	// properties are read and written in batches
+	PI_CAMERA_FEATURE_PROPERTIES           = 0x2,
+	// transfers cut short by a lost connection can be resumed
+	PI_CAMERA_FEATURE_RESUME_FILE_TRANSFER = 0x4
+};
+
+enum PI_CAMERA_CODECS : AL::uint8
+{
+	PI_CAMERA_CODEC_NONE,
+	// lz4 block, used on packet payloads other than jpg and h264
+	PI_CAMERA_CODEC_LZ4,
+
+	PI_CAMERA_CODEC_COUNT
+};
+
+#pragma pack(push, 1)
+struct pi_camera_capabilities
+{
+	AL::uint8  protocol_version;
+	// PI_CAMERA_FEATURES
+	AL::uint32 features;
+	// largest file transfer chunk in bytes
+	AL::uint32 chunk_size_max;
+	// most file transfer chunks in flight
+	AL::uint8  window_size_max;
+	// bit per PI_CAMERA_CODECS
+	AL::uint32 codecs;
+};
+#pragma pack(pop)
+
+struct pi_camera_transfer_stats
+{
+	AL::uint64 number_of_transfers;
+	AL::uint64 number_of_bytes_sent;
+	AL::uint64 cpu_time_us;
+	AL::uint64 number_of_requests;
+	// made by packet buffers anywhere in the process
+	AL::uint64 number_of_buffer_allocations;
+	// chosen for the last file transfer from its measured rtt and throughput
+	AL::uint32 chunk_size;
+	AL::uint8  window_size;
+	AL::uint64 rtt_us;
+	AL::uint64 bytes_per_second;
+	// packet payloads handed to the compressor, sent after it and the time spent on them anywhere in the process
+	AL::uint64 compression_bytes_in;
+	AL::uint64 compression_bytes_out;
+	AL::uint64 compression_cpu_time_us;
+};
+
 typedef void(*pi_camera_capture_on_progress_changed)(AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param);
+typedef void(*pi_camera_capture_on_complete)(AL::uint8 error_code, void* param);
+typedef void(*pi_camera_capture_burst_on_progress_changed)(AL::uint32 frame_index, AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param);
+typedef void(*pi_camera_fetch_captures_on_progress_changed)(AL::uint64 timestamp_ms, AL::uint64 file_size, AL::uint64 number_of_bytes_received, void* param);
+// @return false to stop the preview
+typedef bool(*pi_camera_preview_on_frame)(const AL::uint8* buffer, AL::uint32 size, void* param);
+// @param buffer one h264 nal unit including its 00 00 01 or 00 00 00 01 start code
+// @return false to stop the recording
+typedef bool(*pi_camera_video_on_nal_unit)(const AL::uint8* buffer, AL::uint32 size, void* param);
 
 extern "C"
 {
@@ -232,7 +371,11 @@ extern "C"
 
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_open(pi_camera** camera);
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_open_remote(pi_camera** camera, const char* remote_host, AL::uint16 remote_port);
+	// Capture requests run on PI_CAMERA_SERVICE_WORKER_COUNT_DEFAULT workers
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_open_service(pi_camera** camera, const char* local_host, AL::uint16 local_port, AL::uint32 max_connections);
+	// @param worker_count 0 to run capture requests on the service thread
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_open_service_ex(pi_camera** camera, const char* local_host, AL::uint16 local_port, AL::uint32 max_connections, AL::uint32 worker_count);
+	// A pending remote async capture completes with PI_CAMERA_ERROR_CODE_CONNECTION_CLOSED, a pending local one is waited for
 	PI_CAMERA_API_EXPORT void      PI_CAMERA_API_CALL pi_camera_close(pi_camera* camera);
 
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_is_busy(pi_camera* camera, bool* value);
@@ -249,6 +392,14 @@ extern "C"
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_config(pi_camera* camera, pi_camera_config* value);
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_config(pi_camera* camera, const pi_camera_config* value);
 
+	// @param values id of each property to get, value is set on success
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if an id is unknown
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_properties(pi_camera* camera, pi_camera_property* values, AL::uint8 count);
+	// Applies every property or none of them
+	// Services that predate protocol version 2 get a read-modify-write of the whole config, changes other clients make in between are lost
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if an id is unknown
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_properties(pi_camera* camera, const pi_camera_property* values, AL::uint8 count);
+
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_contrast(pi_camera* camera, AL::int8* value);
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_contrast(pi_camera* camera, AL::int8 value);
 
@@ -293,6 +444,132 @@ extern "C"
 
 	// @param on_progress_changed can be nullptr
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+	// Captures count images interval_ms apart without restarting the camera between them, saved as directory/burst_0000.jpg onwards
+	// Each image is transferred while the next one is captured
+	// @param on_progress_changed can be nullptr
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_burst(pi_camera* camera, const char* directory, AL::uint32 count, AL::uint32 interval_ms, pi_camera_capture_burst_on_progress_changed on_progress_changed, void* param);
 	// @param on_progress_changed can be nullptr
 	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+	// Delivers the raw h264 stream as raspivid encodes it instead of muxing and transferring it once recording ends
+	// Sps and pps are repeated before every key frame so the stream can be consumed from any key frame
+	// A service holds a worker per stream and keeps one free for other requests, streams beyond that fail with PI_CAMERA_ERROR_CODE_CAMERA_BUSY
+	// @param video_length_seconds 0 to record until on_nal_unit returns false
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video_stream(pi_camera* camera, AL::uint32 video_length_seconds, pi_camera_video_on_nal_unit on_nal_unit, void* param);
+	// Streams the image as raspistill produces it instead of staging it on the remote SD card
+	// @param on_progress_changed can be nullptr, file_size is always 0 since the final size is unknown
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_stream(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+	// Captures an image into memory without staging it in a file on this side
+	// @param buffer points to a caller supplied buffer, or to nullptr to have one allocated that must be released with pi_camera_free_buffer
+	// @param size capacity of a caller supplied buffer, set to the size of the image
+	// @param on_progress_changed can be nullptr
+	// @return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL if the image does not fit in a caller supplied buffer or is too large to allocate one for, size is set to the size required
+	// @return PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY if the buffer could not be allocated
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_to_buffer(pi_camera* camera, AL::uint8** buffer, AL::uint64* size, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+	PI_CAMERA_API_EXPORT void      PI_CAMERA_API_CALL pi_camera_free_buffer(AL::uint8* buffer);
+	// Streams low resolution jpg frames until on_frame returns false, stills can't be captured while a preview is running
+	// Services share one encoder between every preview, frames produced while on_frame is busy are skipped
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_preview(pi_camera* camera, pi_camera_preview_on_frame on_frame, void* param);
+
+	// Records in the background until pi_camera_stop_recording, the camera is busy meanwhile
+	// Segments are fragmented mp4 files starting at a key frame, the oldest are deleted once every segment together exceeds disk_budget bytes
+	// @param directory nullptr for ./pi_recording, remote cameras always record to the service's ./pi_recording
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_start_recording(pi_camera* camera, const char* directory, AL::uint32 segment_length_seconds, AL::uint64 disk_budget);
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_recording(pi_camera* camera);
+	// Lists the completed segments overlapping start_time_ms to end_time_ms, segments stay listed after the recording stops
+	// @param count capacity of values, set to the number of segments found
+	// @return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL if more segments match than fit in values, values holds the first ones
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_recording_segments(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_recording_segment* values, AL::uint32* count);
+	// @param on_progress_changed can be nullptr
+	// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if the segment was deleted to respect the disk budget
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_recording_segment(pi_camera* camera, AL::uint64 id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+
+	// Keeps the last pre_roll_seconds of video in memory, starting at a key frame, until pi_camera_stop_pre_roll, the camera is busy meanwhile
+	// @param buffer_size memory held for the pre-roll, older key frame intervals are dropped sooner if they don't fit, at most 256 MB
+	// @return PI_CAMERA_ERROR_CODE_OUT_OF_MEMORY if the buffer can't be allocated
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_start_pre_roll(pi_camera* camera, AL::uint32 pre_roll_seconds, AL::uint32 buffer_size);
+	// Waits for a capture in progress
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_pre_roll(pi_camera* camera);
+	// Saves the buffered pre-roll followed by the next video_length_seconds as one mp4
+	// @param on_progress_changed can be nullptr
+	// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if the pre-roll isn't running
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_pre_roll(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+
+	// Captures an image every interval_ms in the background with the config at the time of the call, remote cameras keep going once disconnected
+	// Images are kept in the capture store, one that is due while the camera is busy is skipped
+	// @param count 0 for no limit
+	// @param end_time_ms milliseconds since the unix epoch, 0 for no limit
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_start_timelapse(pi_camera* camera, AL::uint32 interval_ms, AL::uint32 count, AL::uint64 end_time_ms);
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_stop_timelapse(pi_camera* camera);
+
+	// The capture store in ./pi_store keeps timelapse images and the images captured for remote cameras
+	// The oldest images are deleted once it holds more than PI_CAMERA_STORE_SIZE_DEFAULT bytes or PI_CAMERA_STORE_CAPTURE_COUNT_DEFAULT images, see pi_camera_set_store_budget
+	// Lists the stored images captured from start_time_ms to end_time_ms
+	// @param count capacity of values, set to the number of images found
+	// @return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL if more images match than fit in values, values holds the first ones
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, pi_camera_capture_info* values, AL::uint32* count);
+	// Saves every stored image captured from start_time_ms to end_time_ms as directory/capture_<timestamp_ms>.jpg, remote images are sent back to back
+	// @param on_progress_changed can be nullptr
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_fetch_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, const char* directory, pi_camera_fetch_captures_on_progress_changed on_progress_changed, void* param);
+	// Deletes every stored image captured from start_time_ms to end_time_ms
+	// @param count can be nullptr, set to the number of images deleted
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_delete_captures(pi_camera* camera, AL::uint64 start_time_ms, AL::uint64 end_time_ms, AL::uint32* count);
+	// Sets how much the capture store holds before the oldest images are deleted, the newest image is always kept
+	// @param size_max bytes, 0 for no limit
+	// @param capture_count_max images, 0 for no limit
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is remote
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_store_budget(pi_camera* camera, AL::uint64 size_max, AL::uint32 capture_count_max);
+
+	// Id of the last video or recording segment a remote camera didn't finish receiving, 0 if none
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is not remote
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_transfer_id(pi_camera* camera, AL::uint64* value);
+	// Sends the rest of a transfer cut short by a lost connection, appended to the partial file at file_path
+	// The service keeps the source for 5 minutes after the connection was lost, the camera may be a new connection to it
+	// The oldest sources are dropped sooner once the files kept for them exceed 256 MB
+	// @param on_progress_changed can be nullptr
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is not remote or the service predates resuming
+	// @return PI_CAMERA_ERROR_CODE_NOT_FOUND if the transfer completed or expired
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_resume_transfer(pi_camera* camera, AL::uint64 transfer_id, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, void* param);
+
+	// Returns once the request is sent, callbacks are invoked from pi_camera_poll/pi_camera_wait
+	// Only one capture can be pending per camera, remote cameras return PI_CAMERA_ERROR_CODE_CAMERA_BUSY to any other request until it completes
+	// @param on_progress_changed can be nullptr, only called for remote cameras
+	// @param on_complete can be nullptr
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_async(pi_camera* camera, const char* file_path, pi_camera_capture_on_progress_changed on_progress_changed, pi_camera_capture_on_complete on_complete, void* param, pi_camera_async** async);
+	// @param on_progress_changed can be nullptr, only called for remote cameras
+	// @param on_complete can be nullptr
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_capture_video_async(pi_camera* camera, const char* file_path, AL::uint32 video_length_seconds, pi_camera_capture_on_progress_changed on_progress_changed, pi_camera_capture_on_complete on_complete, void* param, pi_camera_async** async);
+	// Processes whatever has arrived without blocking
+	// @return PI_CAMERA_ERROR_CODE_PENDING until the capture completes
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_poll(pi_camera_async* async);
+	// @return PI_CAMERA_ERROR_CODE_PENDING if the capture did not complete within timeout_ms
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_wait(pi_camera_async* async, AL::uint32 timeout_ms);
+	// Closing a pending remote capture closes the connection, a pending local capture is waited for
+	PI_CAMERA_API_EXPORT void      PI_CAMERA_API_CALL pi_camera_async_close(pi_camera_async* async);
+
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is not a service
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_transfer_stats(pi_camera* camera, pi_camera_transfer_stats* value);
+	// File transfers size their chunks within min and max bytes from the measured throughput, applies to sessions opened afterwards
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is not a service
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_file_chunk_size(pi_camera* camera, AL::uint32 min, AL::uint32 max);
+	// Captures requested within milliseconds of the last one with the same config get the same image, 0 (the default) only joins captures in flight
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if camera is not a service
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_set_capture_cache_window(pi_camera* camera, AL::uint32 milliseconds);
+
+	// What both ends of a remote camera or session agreed on during the handshake, local cameras and services return their own
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_get_capabilities(pi_camera* camera, pi_camera_capabilities* value);
+
+	// Setters called between begin and end don't wait for their reply
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if the remote service predates pipelining
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_begin_pipeline(pi_camera* camera);
+	// Waits for the replies of every pipelined setter
+	// @return first error reported by a pipelined setter
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_end_pipeline(pi_camera* camera);
+
+	// Compresses buffer into the lz4 block packet payloads use
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if built without compression
+	// @return PI_CAMERA_ERROR_CODE_BUFFER_TOO_SMALL if the block doesn't fit in compressed_buffer_size bytes
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_compress(const void* buffer, AL::uint32 size, void* compressed_buffer, AL::uint32 compressed_buffer_size, AL::uint32* compressed_size);
+	// @return PI_CAMERA_ERROR_CODE_NOT_SUPPORTED if built without compression
+	// @return PI_CAMERA_ERROR_CODE_CORRUPT_DATA if compressed_buffer is not an lz4 block of exactly size bytes
+	PI_CAMERA_API_EXPORT AL::uint8 PI_CAMERA_API_CALL pi_camera_decompress(const void* compressed_buffer, AL::uint32 compressed_size, void* buffer, AL::uint32 size);
 }